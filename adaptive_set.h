@@ -0,0 +1,705 @@
+/***********************************************************************
+ * Header:
+ *    Adaptive Set
+ * Summary:
+ *    A set that changes how it stores its elements as it grows, shrinks,
+ *    and is used:
+ *
+ *       INLINE : up to N elements in a sorted array inside the object;
+ *                no heap at all
+ *       FLAT   : a sorted array on the heap (flat_set)
+ *       TREE   : a balanced tree (set on the Tree backend)
+ *
+ *    It starts INLINE and goes FLAT when the N+1st element arrives. The
+ *    flat_set benchmark found a sorted array faster than the tree at any
+ *    mix of reads and writes up to a few thousand elements, so only a
+ *    bigger set that is being written to goes to TREE. It comes back to
+ *    FLAT when it is mostly read or scanned again, or when it shrinks to
+ *    half that size, and back INLINE when it shrinks to N/2. The gaps
+ *    between the ways out and the ways back are there so a set sitting
+ *    on a boundary does not convert on every insert and erase.
+ *
+ *    The mix is counted in windows of WINDOW operations. Reads are
+ *    counted by const member functions, with relaxed atomic loads and
+ *    stores: concurrent readers do not race, they only lose a count
+ *    now and then, which the heuristic does not mind.
+ *
+ *    Iterators:
+ *       - reads (find, lower_bound, begin, ...) never move an element,
+ *         so they never invalidate an iterator
+ *       - any insert or erase may convert the set, so it invalidates
+ *         every iterator, as it would for a vector; the iterator that
+ *         insert() and erase() return is valid
+ *       - while INLINE, the elements live in the object, so moving or
+ *         swapping the set invalidates its iterators too
+ *
+ *    This will contain the class definition of:
+ *        adaptive_set               : A set that picks its own layout
+ *        adaptive_set::iterator     : An iterator through any layout
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <new>        // for placement new
+#include <atomic>     // for std::atomic
+#include <vector>     // for std::vector
+#include <algorithm>  // for std::lower_bound, std::move_backward
+#include <iterator>   // for std::make_move_iterator
+#include <utility>    // for std::pair
+#include <initializer_list>
+#include "set.h"
+#include "flat_set.h"
+
+class TestAdaptiveSet;    // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * ADAPTIVE SET
+    * A set of unique values stored inline, in a flat
+    * array, or in a tree, whichever suits it now
+    ***********************************************/
+   template <typename T, int N = 16, typename Tree = rb_tree>
+   class adaptive_set
+   {
+      friend class ::TestAdaptiveSet; // give unit tests access to the privates
+
+      using FlatSet = flat_set<T>;
+      using TreeSet = set<T, std::less<T>, Tree>;
+   public:
+      enum class layout : unsigned char { INLINE, FLAT, TREE };
+
+      // the most elements kept in the object, and the size it comes back at
+      static const size_t INLINE_MAX  = N;
+      static const size_t INLINE_BACK = N / 2;
+
+      // a sorted array up to this many elements whatever the mix, and
+      // the size a tree comes back to one at
+      static const size_t FLAT_ALWAYS = 4096;
+      static const size_t FLAT_BACK   = FLAT_ALWAYS / 2;
+
+      // operations counted before the mix is looked at; a scan counts
+      // as this many reads
+      static const unsigned WINDOW      = 1024;
+      static const unsigned SCAN_WEIGHT = 32;
+
+      static_assert(N >= 2, "an inline array needs room for two elements");
+      static_assert(N <= FLAT_ALWAYS, "past FLAT_ALWAYS a flat array is not always the better");
+
+      //
+      // Construct
+      //
+      adaptive_set() noexcept : numInline(0), shape(layout::INLINE)
+      {
+         resetCounts();
+      }
+      adaptive_set(const adaptive_set& rhs) : adaptive_set()
+      {
+         copyFrom(rhs);
+      }
+      adaptive_set(adaptive_set&& rhs) : adaptive_set()
+      {
+         moveFrom(rhs);
+      }
+      adaptive_set(const std::initializer_list<T>& il) : adaptive_set()
+      {
+         insert(il.begin(), il.end());
+      }
+      template <class Iterator>
+      adaptive_set(Iterator first, Iterator last) : adaptive_set()
+      {
+         insert(first, last);
+      }
+      ~adaptive_set()
+      {
+         destroy();
+      }
+
+      //
+      // Assign
+      //
+      adaptive_set& operator =(const adaptive_set& rhs)
+      {
+         if (this != &rhs)
+         {
+            destroy();
+            copyFrom(rhs);
+         }
+         return *this;
+      }
+      adaptive_set& operator =(adaptive_set&& rhs)
+      {
+         if (this != &rhs)
+         {
+            destroy();
+            moveFrom(rhs);
+         }
+         return *this;
+      }
+      adaptive_set& operator =(const std::initializer_list<T>& il)
+      {
+         clear();
+         insert(il.begin(), il.end());
+         return *this;
+      }
+      void swap(adaptive_set& rhs)
+      {
+         adaptive_set temp(std::move(rhs));
+         rhs = std::move(*this);
+         *this = std::move(temp);
+      }
+
+      //
+      // Iterator
+      //
+      class iterator;
+      using reverse_iterator = std::reverse_iterator<iterator>;
+      iterator begin() const;
+      iterator end() const noexcept;
+      reverse_iterator rbegin() const { return reverse_iterator(end()); }
+      reverse_iterator rend()   const { return reverse_iterator(begin()); }
+
+      //
+      // Access
+      //
+      iterator find(const T& t) const;
+      iterator lower_bound(const T& t) const;
+      bool contains(const T& t) const
+      {
+         return find(t) != end();
+      }
+
+      //
+      // Status
+      //
+      bool   empty() const noexcept { return size() == 0; }
+      size_t size()  const noexcept
+      {
+         return shape == layout::INLINE ? numInline :
+                shape == layout::FLAT   ? flat.size() : tree.size();
+      }
+      layout representation() const noexcept { return shape; }
+
+      // change layout now if the counts call for it, rather than at the
+      // next write: for a set about to be only read. May invalidate
+      // iterators, as a write would.
+      void adapt();
+
+      //
+      // Insert
+      //
+      std::pair<iterator, bool> insert(const T& t)
+      {
+         return insertValue(t);
+      }
+      std::pair<iterator, bool> insert(T&& t)
+      {
+         return insertValue(std::move(t));
+      }
+      void insert(const std::initializer_list<T>& il)
+      {
+         insert(il.begin(), il.end());
+      }
+      template <class Iterator>
+      void insert(Iterator first, Iterator last)
+      {
+         for (; first != last; ++first)
+            insertValue(*first);
+      }
+
+      //
+      // Remove
+      //
+      size_t   erase(const T& t);
+      iterator erase(iterator it);
+      void clear() noexcept
+      {
+         destroy();
+         resetCounts();
+      }
+
+   private:
+
+      template <class U>
+      std::pair<iterator, bool> insertValue(U&& t);
+      iterator eraseAt(iterator it);
+      void toInline();
+      void toFlat();
+      void toTree();
+      void takeAll(std::vector<T>& sorted);
+      void copyFrom(const adaptive_set& rhs);
+      void moveFrom(adaptive_set& rhs);
+      void destroy() noexcept;
+      size_t lowerIndex(const T& t) const;
+      const T* flatPointer(typename FlatSet::iterator it) const;
+
+      T*       inlineKeys()       noexcept { return reinterpret_cast<T*>(buffer); }
+      const T* inlineKeys() const noexcept { return reinterpret_cast<const T*>(buffer); }
+
+      // one more of an operation; a lost count under contention is fine
+      static void note(std::atomic<unsigned>& count) noexcept
+      {
+         count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      }
+      void resetCounts() noexcept
+      {
+         numReads.store(0, std::memory_order_relaxed);
+         numWrites.store(0, std::memory_order_relaxed);
+         numScans.store(0, std::memory_order_relaxed);
+      }
+
+      // the elements, in whichever one shape says is alive
+      union
+      {
+         alignas(T) unsigned char buffer[N * sizeof(T)];
+         FlatSet flat;
+         TreeSet tree;
+      };
+      size_t numInline;                        // elements in buffer
+      layout shape;                            // which of the three is in use
+
+      // the operations since the mix was last looked at
+      mutable std::atomic<unsigned> numReads;
+      mutable std::atomic<unsigned> numWrites;
+      mutable std::atomic<unsigned> numScans;
+   };
+
+   /**************************************************
+    * ADAPTIVE SET ITERATOR
+    * A pointer into the array while INLINE or FLAT,
+    * a tree iterator while TREE
+    *************************************************/
+   template <typename T, int N, typename Tree>
+   class adaptive_set<T, N, Tree>::iterator
+   {
+      friend class ::TestAdaptiveSet;
+      friend class custom::adaptive_set<T, N, Tree>;
+   public:
+      // so std::reverse_iterator and the algorithms can use it
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const T*;
+      using reference         = const T&;
+
+      iterator() : p(nullptr), it(), inTree(false)
+      {}
+
+      bool operator ==(const iterator& rhs) const
+      {
+         return inTree ? it == rhs.it : p == rhs.p;
+      }
+      bool operator !=(const iterator& rhs) const
+      {
+         return !(*this == rhs);
+      }
+
+      const T& operator *() const
+      {
+         return inTree ? *it : *p;
+      }
+
+      iterator& operator ++()
+      {
+         if (inTree)
+            ++it;
+         else
+            ++p;
+         return *this;
+      }
+      iterator operator ++(int postfix)
+      {
+         iterator temp(*this);
+         ++*this;
+         return temp;
+      }
+      iterator& operator --()
+      {
+         if (inTree)
+            --it;
+         else
+            --p;
+         return *this;
+      }
+      iterator operator --(int postfix)
+      {
+         iterator temp(*this);
+         --*this;
+         return temp;
+      }
+
+   private:
+      explicit iterator(const T* p) : p(p), it(), inTree(false)
+      {}
+      explicit iterator(const typename TreeSet::iterator& it) : p(nullptr), it(it), inTree(true)
+      {}
+
+      const T* p;                           // into the array, INLINE or FLAT
+      typename TreeSet::iterator it;        // into the tree, TREE
+      bool inTree;                          // which of the two
+   };
+
+
+   /*********************************************
+    * ADAPTIVE SET :: BEGIN
+    * A walk from the start counts as a scan
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   typename adaptive_set<T, N, Tree>::iterator adaptive_set<T, N, Tree>::begin() const
+   {
+      note(numScans);
+      if (shape == layout::TREE)
+         return iterator(tree.begin());
+      if (shape == layout::FLAT)
+         return iterator(flatPointer(flat.begin()));
+      return iterator(inlineKeys());
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: END
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   typename adaptive_set<T, N, Tree>::iterator adaptive_set<T, N, Tree>::end() const noexcept
+   {
+      if (shape == layout::TREE)
+         return iterator(tree.end());
+      if (shape == layout::FLAT)
+         return iterator(flatPointer(flat.end()));
+      return iterator(inlineKeys() + numInline);
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: FIND
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   typename adaptive_set<T, N, Tree>::iterator adaptive_set<T, N, Tree>::find(const T& t) const
+   {
+      // set::find() changes nothing, it is only not declared const; and
+      // it stops at a match where lower_bound() goes on to a leaf
+      if (shape == layout::TREE)
+      {
+         note(numReads);
+         return iterator(const_cast<TreeSet&>(tree).find(t));
+      }
+      iterator it = lower_bound(t);
+      return (it != end() && !(t < *it)) ? it : end();
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: LOWER BOUND
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   typename adaptive_set<T, N, Tree>::iterator adaptive_set<T, N, Tree>::lower_bound(const T& t) const
+   {
+      note(numReads);
+      if (shape == layout::TREE)
+         return iterator(tree.lower_bound(t));
+      if (shape == layout::FLAT)
+         return iterator(flatPointer(flat.lower_bound(t)));
+      return iterator(inlineKeys() + lowerIndex(t));
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: INSERT VALUE
+    * Shift along inside the object while there is
+    * room; the element after that goes FLAT first
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   template <class U>
+   std::pair<typename adaptive_set<T, N, Tree>::iterator, bool>
+      adaptive_set<T, N, Tree>::insertValue(U&& t)
+   {
+      note(numWrites);
+      adapt();
+
+      if (shape == layout::INLINE)
+      {
+         T* keys = inlineKeys();
+         size_t i = lowerIndex(t);
+         if (i < numInline && !(t < keys[i]))
+            return { iterator(keys + i), false };
+         if (numInline < INLINE_MAX)
+         {
+            if (i == numInline)
+               new (keys + i) T(std::forward<U>(t));
+            else
+            {
+               new (keys + numInline) T(std::move(keys[numInline - 1]));
+               std::move_backward(keys + i, keys + numInline - 1, keys + numInline);
+               keys[i] = T(std::forward<U>(t));
+            }
+            numInline++;
+            return { iterator(keys + i), true };
+         }
+         toFlat();
+      }
+
+      if (shape == layout::FLAT)
+      {
+         auto result = flat.insert(std::forward<U>(t));
+         return { iterator(flatPointer(result.first)), result.second };
+      }
+
+      auto result = tree.insert(std::forward<U>(t));
+      return { iterator(result.first), result.second };
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: ERASE VALUE
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   size_t adaptive_set<T, N, Tree>::erase(const T& t)
+   {
+      note(numWrites);
+      adapt();
+      size_t num = 0;
+      if (shape == layout::TREE)
+         num = tree.erase(t);
+      else if (shape == layout::FLAT)
+         num = flat.erase(t);
+      else
+      {
+         size_t i = lowerIndex(t);
+         if (i == numInline || t < inlineKeys()[i])
+            return 0;
+         eraseAt(iterator(inlineKeys() + i));
+         return 1;
+      }
+
+      if (shape != layout::INLINE && size() <= INLINE_BACK)
+         toInline();
+      return num;
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: ERASE ITERATOR
+    * The layout can only go back INLINE here: any
+    * other change waits for the next write, so it
+    * does not invalidate the iterator handed in. At
+    * INLINE_BACK elements, the offset of the next one
+    * is a short walk to find again after the move.
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   typename adaptive_set<T, N, Tree>::iterator adaptive_set<T, N, Tree>::erase(iterator it)
+   {
+      note(numWrites);
+      iterator itNext = eraseAt(it);
+      if (shape == layout::INLINE || size() > INLINE_BACK)
+         return itNext;
+
+      size_t offset = 0;
+      iterator itWalk = shape == layout::TREE ? iterator(tree.begin()) :
+                                                iterator(flatPointer(flat.begin()));
+      for (; itWalk != itNext; ++itWalk)
+         offset++;
+      toInline();
+      return iterator(inlineKeys() + offset);
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: ERASE AT
+    * Remove one element in whatever the layout is
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   typename adaptive_set<T, N, Tree>::iterator adaptive_set<T, N, Tree>::eraseAt(iterator it)
+   {
+      if (shape == layout::TREE)
+         return iterator(tree.erase(it.it));
+      if (shape == layout::FLAT)
+      {
+         auto itFlat = flat.begin() + (it.p - flatPointer(flat.begin()));
+         return iterator(flatPointer(flat.erase(itFlat)));
+      }
+
+      T* keys = inlineKeys();
+      T* p = keys + (it.p - keys);
+      std::move(p + 1, keys + numInline, p);
+      keys[numInline - 1].~T();
+      numInline--;
+      return iterator(p);
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: ADAPT
+    * Before a write, or when asked: look at the mix once a window
+    * is full, and at the size, and change layout if
+    * they call for it. A tree goes FLAT when under 1%
+    * of the operations were writes; a big flat array
+    * becomes a tree when over 5% were.
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   void adaptive_set<T, N, Tree>::adapt()
+   {
+      unsigned reads  = numReads.load(std::memory_order_relaxed);
+      unsigned writes = numWrites.load(std::memory_order_relaxed);
+      unsigned scans  = numScans.load(std::memory_order_relaxed);
+      unsigned ops = reads + writes + scans * SCAN_WEIGHT;
+      bool isWindowFull = ops >= WINDOW;
+      size_t num = size();
+
+      if (shape != layout::INLINE && num <= INLINE_BACK)
+         toInline();
+      else if (shape == layout::FLAT && num > FLAT_ALWAYS && isWindowFull && writes * 20 > ops)
+         toTree();
+      else if (shape == layout::TREE &&
+               (num <= FLAT_BACK || (isWindowFull && writes * 100 < ops)))
+         toFlat();
+
+      if (isWindowFull)
+         resetCounts();
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: TO INLINE
+    * The caller makes sure the elements fit
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   void adaptive_set<T, N, Tree>::toInline()
+   {
+      std::vector<T> sorted;
+      takeAll(sorted);
+      assert(sorted.size() <= INLINE_MAX);
+      T* keys = inlineKeys();
+      for (size_t i = 0; i < sorted.size(); i++)
+         new (keys + i) T(std::move(sorted[i]));
+      numInline = sorted.size();
+      shape = layout::INLINE;
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: TO FLAT
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   void adaptive_set<T, N, Tree>::toFlat()
+   {
+      std::vector<T> sorted;
+      sorted.reserve(size() + 1);
+      takeAll(sorted);
+      new (&flat) FlatSet();
+      shape = layout::FLAT;
+      flat.replace(std::move(sorted));
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: TO TREE
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   void adaptive_set<T, N, Tree>::toTree()
+   {
+      std::vector<T> sorted;
+      takeAll(sorted);
+      new (&tree) TreeSet(std::make_move_iterator(sorted.begin()),
+                          std::make_move_iterator(sorted.end()));
+      shape = layout::TREE;
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: TAKE ALL
+    * Move the elements out in order, and end the
+    * life of whatever held them
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   void adaptive_set<T, N, Tree>::takeAll(std::vector<T>& sorted)
+   {
+      if (shape == layout::INLINE)
+      {
+         T* keys = inlineKeys();
+         for (size_t i = 0; i < numInline; i++)
+            sorted.push_back(std::move(keys[i]));
+      }
+      else if (shape == layout::FLAT)
+         sorted = flat.extract_sequence();
+      else
+         sorted.insert(sorted.end(), tree.begin(), tree.end());
+      destroy();
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: COPY FROM
+    * Into a set with nothing alive
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   void adaptive_set<T, N, Tree>::copyFrom(const adaptive_set& rhs)
+   {
+      if (rhs.shape == layout::TREE)
+         new (&tree) TreeSet(rhs.tree);
+      else if (rhs.shape == layout::FLAT)
+         new (&flat) FlatSet(rhs.flat);
+      else
+      {
+         for (size_t i = 0; i < rhs.numInline; i++)
+            new (inlineKeys() + i) T(rhs.inlineKeys()[i]);
+         numInline = rhs.numInline;
+      }
+      shape = rhs.shape;
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: MOVE FROM
+    * Into a set with nothing alive; rhs is left
+    * empty and INLINE
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   void adaptive_set<T, N, Tree>::moveFrom(adaptive_set& rhs)
+   {
+      if (rhs.shape == layout::TREE)
+         new (&tree) TreeSet(std::move(rhs.tree));
+      else if (rhs.shape == layout::FLAT)
+         new (&flat) FlatSet(std::move(rhs.flat));
+      else
+      {
+         for (size_t i = 0; i < rhs.numInline; i++)
+            new (inlineKeys() + i) T(std::move(rhs.inlineKeys()[i]));
+         numInline = rhs.numInline;
+      }
+      shape = rhs.shape;
+      rhs.destroy();
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: DESTROY
+    * End whatever is alive, leaving an empty INLINE set
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   void adaptive_set<T, N, Tree>::destroy() noexcept
+   {
+      if (shape == layout::TREE)
+         tree.~TreeSet();
+      else if (shape == layout::FLAT)
+         flat.~FlatSet();
+      else
+         for (size_t i = 0; i < numInline; i++)
+            inlineKeys()[i].~T();
+      numInline = 0;
+      shape = layout::INLINE;
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: LOWER INDEX
+    * Where t goes among the inline elements
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   size_t adaptive_set<T, N, Tree>::lowerIndex(const T& t) const
+   {
+      const T* keys = inlineKeys();
+      return std::lower_bound(keys, keys + numInline, t) - keys;
+   }
+
+   /*********************************************
+    * ADAPTIVE SET :: FLAT POINTER
+    * A flat_set iterator as a pointer, end included
+    ********************************************/
+   template <typename T, int N, typename Tree>
+   const T* adaptive_set<T, N, Tree>::flatPointer(typename FlatSet::iterator it) const
+   {
+      if (flat.empty())
+         return nullptr;
+      return &*flat.begin() + (it - flat.begin());
+   }
+
+} // namespace custom
@@ -0,0 +1,1290 @@
+/***********************************************************************
+ * Header:
+ *    BENCH SET
+ * Summary:
+ *    Timing measurements for set and the containers built beside it
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef BENCHMARK
+
+#include "benchmark.h"
+#include "set.h"
+#include "persistent_set.h"
+#include "published_set.h"
+#include "sharded_set.h"
+#include "set_accumulator.h"
+#include "interleaved_lookup.h"
+#include "lean_set.h"
+#include "threaded_set.h"
+#include "btree_set.h"
+#include "flat_set.h"
+#include "adaptive_set.h"
+#include "frozen_set.h"
+#include "set_backend.h"
+#include <mutex>      // for std::mutex
+
+#include <vector>
+#include <string>     // for std::to_string
+#include <thread>     // for std::thread
+#include <atomic>     // for std::atomic
+#include <algorithm>  // for std::sort
+#include <set>        // for std::set
+#include <queue>      // for std::priority_queue
+#include <random>     // for std::mt19937
+
+/***********************************************
+ * BENCH SET
+ * Timing measurements for the set containers
+ ***********************************************/
+class BenchSet : public Benchmark
+{
+public:
+   // number of elements in the "large" sets
+   static const size_t NUM = 1000000;
+
+   // number of elements in a set well past the last level cache
+   static const size_t NUM_HUGE = 10000000;
+
+   void run()
+   {
+      bench_persistent_snapshot();
+      bench_persistent_update();
+      bench_persistent_copyOnWrite();
+      bench_published_readLatency();
+      bench_sharded_scaling();
+      bench_accumulator_collect();
+      bench_set_findMany();
+      bench_set_applyBatch();
+      bench_set_insertParallel();
+      bench_set_eraseRange();
+      bench_set_eraseValue();
+      bench_set_ends();
+      bench_set_priorityQueue();
+      bench_lean_vsSet();
+      bench_threaded_scan();
+      bench_btree_vsSet();
+      bench_btree_nodeSearch();
+      bench_flat_crossover();
+      bench_backend_find();
+      bench_adaptive_phases();
+      bench_small_manySets();
+      bench_static_vsSet();
+      bench_frozen_lookup();
+      bench_set_optimizeLayout();
+      bench_set_compact();
+#if defined(__cpp_impl_coroutine)
+      bench_interleaved_width();
+#endif // __cpp_impl_coroutine
+   }
+
+   /***************************************
+    * PERSISTENT SET
+    ***************************************/
+
+   // a snapshot of a persistent set against a deep copy of a set
+   void bench_persistent_snapshot()
+   {
+      heading("Snapshot");
+      std::vector<int> keys = randomKeys(NUM);
+      custom::set<int> s(keys.begin(), keys.end());
+      custom::persistent_set<int> ps(keys.begin(), keys.end());
+      const size_t numSnapshots = 1000;
+      size_t total = 0;
+
+      double seconds = time([&]()
+      {
+         for (size_t i = 0; i < numSnapshots; i++)
+         {
+            custom::persistent_set<int> snap = ps.snapshot();
+            total += snap.size();
+         }
+      });
+      report("persistent_set::snapshot()", seconds, numSnapshots);
+
+      seconds = time([&]()
+      {
+         custom::set<int> copy(s);
+         total += copy.size();
+      });
+      report("set copy constructor", seconds, 1);
+   }
+
+   // insert and erase on a persistent set against the mutable tree
+   void bench_persistent_update()
+   {
+      heading("Update");
+      std::vector<int> keys = randomKeys(NUM);
+      custom::set<int> s;
+      custom::persistent_set<int> ps;
+
+      double seconds = time([&]() { for (int key : keys) s.insert(key); });
+      report("set::insert()", seconds, keys.size());
+      seconds = time([&]() { for (int key : keys) ps.insert(key); });
+      report("persistent_set::insert()", seconds, keys.size());
+
+      // keep a snapshot alive so every update has to copy its path
+      custom::persistent_set<int> snap = ps.snapshot();
+      seconds = time([&]() { for (size_t i = 0; i < keys.size(); i += 2) ps.erase(keys[i]); });
+      report("persistent_set::erase() with a live snapshot", seconds, keys.size() / 2);
+      seconds = time([&]() { for (size_t i = 0; i < keys.size(); i += 2) s.erase(keys[i]); });
+      report("set::erase()", seconds, keys.size() / 2);
+   }
+
+   // pass-by-value copies that are rarely changed
+   void bench_persistent_copyOnWrite()
+   {
+      heading("Copy on write");
+      std::vector<int> keys = randomKeys(NUM);
+      custom::persistent_set<int> ps(keys.begin(), keys.end());
+      const size_t numCopies = 1000;
+      size_t total = 0;
+
+      double seconds = time([&]()
+      {
+         for (size_t i = 0; i < numCopies; i++)
+         {
+            custom::persistent_set<int> copy(ps);
+            total += copy.size();
+         }
+      });
+      report("persistent_set copy, never changed", seconds, numCopies);
+
+      seconds = time([&]()
+      {
+         for (size_t i = 0; i < numCopies; i++)
+         {
+            custom::persistent_set<int> copy(ps);
+            copy.insert(-(int)i - 1);
+            total += copy.size();
+         }
+      });
+      report("persistent_set copy, then one insert", seconds, numCopies);
+
+      // nobody shares this one, so updates happen in place
+      custom::persistent_set<int> unique;
+      seconds = time([&]() { for (int key : keys) unique.insert(key); });
+      report("persistent_set::insert(), never copied", seconds, keys.size());
+   }
+
+   /***************************************
+    * PUBLISHED SET
+    ***************************************/
+
+   // reader latency with an idle writer and with a writer publishing
+   // as fast as it can. The two should look the same.
+   void bench_published_readLatency()
+   {
+      heading("Published set reads");
+      const size_t numElements = 100000;
+      const int numReaders = 4;
+      const int batch = 256;
+      std::vector<int> keys = randomKeys(numElements);
+      custom::published_set<int> s;
+      for (int key : keys)
+         s.insert(key);
+      s.publish();
+
+      for (int busyWriter = 0; busyWriter < 2; busyWriter++)
+      {
+         std::atomic<bool> done(false);
+         std::vector<std::vector<double>> samples(numReaders);
+         std::vector<std::thread> readers;
+         for (int id = 0; id < numReaders; id++)
+            readers.push_back(std::thread([&, id]()
+            {
+               size_t found = 0;
+               size_t i = id;
+               for (int round = 0; round < 2000; round++)
+               {
+                  double seconds = time([&]()
+                  {
+                     for (int j = 0; j < batch; j++)
+                        found += s.contains(keys[i++ % numElements]) ? 1 : 0;
+                  });
+                  samples[id].push_back(seconds * 1e9 / batch);
+               }
+               done = true;
+            }));
+
+         // the writer churns one element and publishes
+         size_t numPublished = 0;
+         while (busyWriter && !done.load())
+         {
+            s.erase(keys[numPublished % numElements]);
+            s.insert(keys[numPublished % numElements]);
+            s.publish();
+            numPublished++;
+         }
+         for (auto& thread : readers)
+            thread.join();
+
+         std::vector<double> all;
+         for (auto& v : samples)
+            all.insert(all.end(), v.begin(), v.end());
+         reportPercentiles(busyWriter ? "contains(), writer publishing" : "contains(), writer idle", all);
+      }
+   }
+
+   /***************************************
+    * SHARDED SET
+    ***************************************/
+
+   // insert throughput as writers are added: one set behind one
+   // mutex against a sharded set. The gap only shows on a machine
+   // with at least as many cores as writers.
+   void bench_sharded_scaling()
+   {
+      heading("Sharded set writers");
+      std::vector<int> keys = randomKeys(NUM);
+      for (int numThreads = 1; numThreads <= 8; numThreads *= 2)
+      {
+         custom::set<int> s;
+         std::mutex mutex;
+         custom::sharded_set<int> ss;
+         size_t numEach = keys.size() / numThreads;
+
+         auto spread = [&](auto work)
+         {
+            return time([&]()
+            {
+               std::vector<std::thread> writers;
+               for (int id = 0; id < numThreads; id++)
+                  writers.push_back(std::thread([&, id]()
+                  {
+                     for (size_t i = id * numEach; i < (id + 1) * numEach; i++)
+                        work(keys[i]);
+                  }));
+               for (auto& thread : writers)
+                  thread.join();
+            });
+         };
+
+         std::string name = std::to_string(numThreads) + " writers, set with one mutex";
+         double seconds = spread([&](int key)
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            s.insert(key);
+         });
+         report(name.c_str(), seconds, numEach * numThreads);
+
+         name = std::to_string(numThreads) + " writers, sharded_set";
+         seconds = spread([&](int key) { ss.insert(key); });
+         report(name.c_str(), seconds, numEach * numThreads);
+      }
+   }
+
+   /***************************************
+    * SET ACCUMULATOR
+    ***************************************/
+
+   // four threads collecting overlapping values into one set: a shared
+   // set behind a mutex, per-thread sets merged with insert(first,last),
+   // and an accumulator
+   void bench_accumulator_collect()
+   {
+      heading("Collecting from threads");
+      const int numThreads = 4;
+      std::vector<int> keys = randomKeys(NUM);
+      size_t numEach = keys.size() / numThreads;
+
+      // each thread sees its own quarter and half of the next one
+      auto spread = [&](auto work)
+      {
+         std::vector<std::thread> threads;
+         for (int id = 0; id < numThreads; id++)
+            threads.push_back(std::thread([&, id]()
+            {
+               for (size_t i = id * numEach; i < (id + 1) * numEach + numEach / 2; i++)
+                  work(id, keys[i % keys.size()]);
+            }));
+         for (auto& thread : threads)
+            thread.join();
+      };
+      size_t numOps = numThreads * (numEach + numEach / 2);
+
+      custom::set<int> shared;
+      std::mutex mutex;
+      double seconds = time([&]()
+      {
+         spread([&](int /*id*/, int key)
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            shared.insert(key);
+         });
+      });
+      report("set behind one mutex", seconds, numOps);
+
+      std::vector<custom::set<int>> locals(numThreads);
+      seconds = time([&]()
+      {
+         spread([&](int id, int key) { locals[id].insert(key); });
+         for (int id = 1; id < numThreads; id++)
+            locals[0].insert(locals[id].begin(), locals[id].end());
+      });
+      report("set per thread, then insert(first, last)", seconds, numOps);
+
+      custom::set_accumulator<int> acc;
+      std::vector<custom::set_accumulator<int>::collector*> collectors;
+      for (int id = 0; id < numThreads; id++)
+         collectors.push_back(&acc.local());
+      custom::set<int> s;
+      seconds = time([&]()
+      {
+         spread([&](int id, int key) { collectors[id]->insert(key); });
+         s = acc.finalize();
+      });
+      report("set_accumulator", seconds, numOps);
+      report("   of which finalize() sort", acc.timing().sort, numOps);
+      report("   of which finalize() merge", acc.timing().merge, numOps);
+      report("   of which finalize() build", acc.timing().build, numOps);
+   }
+
+   /***************************************
+    * BATCHED LOOKUP
+    ***************************************/
+
+   // a batch of lookups in a set too big for the cache: one find()
+   // after another against the interleaved descents of find_many()
+   void bench_set_findMany()
+   {
+      heading("Batched lookup");
+      std::vector<int> keys = randomKeys(NUM_HUGE);
+      custom::set<int> s;
+      for (size_t i = 0; i < keys.size(); i += 2)
+         s.insert(keys[i]);
+      std::vector<int> queries(keys.begin(), keys.begin() + NUM);
+      std::vector<custom::set<int>::iterator> out;
+      std::vector<bool> bits;
+      size_t numFound = 0;
+
+      double seconds = time([&]()
+      {
+         for (int query : queries)
+            numFound += (s.find(query) != s.end()) ? 1 : 0;
+      });
+      keep(numFound);
+      report("find() in a loop", seconds, queries.size());
+
+      seconds = time([&]() { s.find_many(queries, out); });
+      report("find_many()", seconds, queries.size());
+
+      seconds = time([&]() { s.contains_many(queries, bits); });
+      report("contains_many()", seconds, queries.size());
+   }
+
+   /***************************************
+    * BATCH APPLY
+    ***************************************/
+
+   // mixed batches of inserts and erases against a big set: applied
+   // one at a time, and through apply_batch()
+   void bench_set_applyBatch()
+   {
+      heading("Batch apply");
+      std::vector<int> keys = randomKeys(2 * NUM);
+      for (size_t numBatch : { (size_t)10000, (size_t)100000, NUM })
+      {
+         // half the batch erases what is there, half inserts what is not
+         std::vector<custom::set<int>::update> batch;
+         for (size_t i = 0; i < numBatch; i++)
+            batch.push_back({ keys[i % 2 ? NUM + i : i], i % 2 == 0 });
+
+         custom::set<int> s1(keys.begin(), keys.begin() + NUM);
+         custom::set<int> s2(s1);
+
+         double seconds = time([&]()
+         {
+            for (auto& u : batch)
+               if (u.erase)
+                  s1.erase(u.value);
+               else
+                  s1.insert(u.value);
+         });
+         std::string name = std::to_string(numBatch) + " updates, one at a time";
+         report(name.c_str(), seconds, numBatch);
+
+         custom::set<int>::batch_result result;
+         seconds = time([&]() { result = s2.apply_batch(batch); });
+         keep(result.inserted + result.erased + result.skipped);
+         name = std::to_string(numBatch) + " updates, apply_batch()";
+         report(name.c_str(), seconds, numBatch);
+      }
+   }
+
+   /***************************************
+    * PARALLEL INSERT
+    ***************************************/
+
+   // a batch of new values into a big set: one at a time, and through
+   // insert_parallel() on more and more threads
+   void bench_set_insertParallel()
+   {
+      heading("Parallel insert");
+      std::vector<int> keys = randomKeys(NUM_HUGE + NUM);
+      std::vector<int> batch(keys.begin() + NUM_HUGE, keys.end());
+
+      custom::set<int> s(keys.begin(), keys.begin() + NUM_HUGE);
+      double seconds = time([&]() { s.insert(batch.begin(), batch.end()); });
+      keep(s.size());
+      report("one at a time", seconds, batch.size());
+
+      for (size_t numThreads : { 1, 2, 4, 8 })
+      {
+         custom::set<int> s(keys.begin(), keys.begin() + NUM_HUGE);
+         size_t num = 0;
+         seconds = time([&]()
+         {
+            num = s.insert_parallel(batch.begin(), batch.end(),
+                                    custom::thread_executor(numThreads));
+         });
+         keep(num);
+         std::string name = "insert_parallel(), " + std::to_string(numThreads) + " threads";
+         report(name.c_str(), seconds, batch.size());
+      }
+   }
+
+   /***************************************
+    * RANGE ERASE
+    ***************************************/
+
+   // drop a contiguous tenth of the keys from a big set: one value at
+   // a time, as one range, and extracted to be freed on another thread
+   void bench_set_eraseRange()
+   {
+      heading("Range erase");
+      std::vector<int> keys = randomKeys(NUM_HUGE);
+      std::vector<int> sorted(keys);
+      std::sort(sorted.begin(), sorted.end());
+      int lo = sorted[NUM_HUGE / 2];
+      int hi = sorted[NUM_HUGE / 2 + NUM];
+
+      custom::set<int> s1(keys.begin(), keys.end());
+      double seconds = time([&]()
+      {
+         for (auto it = sorted.begin() + NUM_HUGE / 2; *it != hi; ++it)
+            s1.erase(*it);
+      });
+      keep(s1.size());
+      report("one value at a time", seconds, NUM);
+
+      custom::set<int> s2(keys.begin(), keys.end());
+      size_t num = 0;
+      seconds = time([&]() { num = s2.erase(lo, hi); });
+      keep(num);
+      report("erase(lo, hi)", seconds, NUM);
+
+      custom::set<int> s3(keys.begin(), keys.end());
+      std::thread freer;
+      seconds = time([&]()
+      {
+         auto itBegin = s3.find(lo);
+         auto itEnd = s3.find(hi);
+         freer = std::thread([](custom::set<int> /*s*/) {}, s3.extract(itBegin, itEnd));
+      });
+      freer.join();
+      keep(s3.size());
+      report("extract(), freed on another thread", seconds, NUM);
+   }
+
+   /***************************************
+    * ERASE BY VALUE
+    ***************************************/
+
+   // every value erased in random order, and half the values erased
+   // by a predicate: one erase() per match, and erase_if()
+   void bench_set_eraseValue()
+   {
+      heading("Erase by value");
+      std::vector<int> keys = randomKeys(NUM);
+
+      custom::set<int> s1(keys.begin(), keys.end());
+      double seconds = time([&]()
+      {
+         for (int key : keys)
+            s1.erase(key);
+      });
+      keep(s1.size());
+      report("erase(value), every value", seconds, NUM);
+
+      custom::set<int> s2(keys.begin(), keys.end());
+      seconds = time([&]()
+      {
+         for (int key : keys)
+            if (key % 2)
+               s2.erase(key);
+      });
+      keep(s2.size());
+      report("erase(value), odd values", seconds, NUM);
+
+      custom::set<int> s3(keys.begin(), keys.end());
+      size_t num = 0;
+      seconds = time([&]() { num = s3.erase_if([](int key) { return key % 2 != 0; }); });
+      keep(num);
+      report("erase_if(), odd values", seconds, NUM);
+   }
+
+   /***************************************
+    * ENDS
+    ***************************************/
+
+   // the smallest and largest values of a big set, and a walk
+   // through it backwards
+   void bench_set_ends()
+   {
+      heading("Ends");
+      std::vector<int> keys = randomKeys(NUM);
+      custom::set<int> s(keys.begin(), keys.end());
+
+      long long sum = 0;
+      double seconds = time([&]()
+      {
+         for (size_t i = 0; i < NUM; i++)
+            sum += s.min() + s.max();
+      });
+      keep((size_t)sum);
+      report("min() and max()", seconds, NUM);
+
+      seconds = time([&]()
+      {
+         for (auto it = s.rbegin(); it != s.rend(); ++it)
+            sum += *it;
+      });
+      keep((size_t)sum);
+      report("rbegin() to rend()", seconds, NUM);
+   }
+
+   /***************************************
+    * PRIORITY QUEUE
+    ***************************************/
+
+   // a timer queue: take the earliest deadline, then schedule a new
+   // one a random delay later. Deadlines are made unique with a
+   // sequence number in the low bits.
+   void bench_set_priorityQueue()
+   {
+      heading("Priority queue");
+      std::mt19937 generator(1);
+      std::vector<long long> delays(NUM);
+      for (auto& delay : delays)
+         delay = 1 + generator() % 100000;
+      auto deadline = [&](long long now, size_t i)
+      {
+         return ((now + delays[i]) << 20) | (long long)i;
+      };
+
+      for (size_t numPending : { (size_t)1000, (size_t)100000, NUM })
+      {
+         std::string size = ", " + std::to_string(numPending) + " pending";
+         long long sum = 0;
+
+         custom::set<long long> s;
+         for (size_t i = 0; i < numPending; i++)
+            s.insert(deadline(0, i));
+         double seconds = time([&]()
+         {
+            for (size_t i = 0; i < NUM; i++)
+            {
+               long long next = s.pop_min();
+               sum += next;
+               s.insert(deadline(next >> 20, i));
+            }
+         });
+         keep((size_t)sum);
+         report(("custom::set pop_min()" + size).c_str(), seconds, NUM);
+
+         std::set<long long> stdSet;
+         for (size_t i = 0; i < numPending; i++)
+            stdSet.insert(deadline(0, i));
+         seconds = time([&]()
+         {
+            for (size_t i = 0; i < NUM; i++)
+            {
+               long long next = *stdSet.begin();
+               stdSet.erase(stdSet.begin());
+               sum += next;
+               stdSet.insert(deadline(next >> 20, i));
+            }
+         });
+         keep((size_t)sum);
+         report(("std::set" + size).c_str(), seconds, NUM);
+
+         std::priority_queue<long long, std::vector<long long>, std::greater<long long>> heap;
+         for (size_t i = 0; i < numPending; i++)
+            heap.push(deadline(0, i));
+         seconds = time([&]()
+         {
+            for (size_t i = 0; i < NUM; i++)
+            {
+               long long next = heap.top();
+               heap.pop();
+               sum += next;
+               heap.push(deadline(next >> 20, i));
+            }
+         });
+         keep((size_t)sum);
+         report(("std::priority_queue" + size).c_str(), seconds, NUM);
+      }
+   }
+
+   /***************************************
+    * LEAN SET
+    ***************************************/
+
+   // the same work on a set with parent pointers and one without,
+   // big enough that the node size shows up as cache misses
+   void bench_lean_vsSet()
+   {
+      heading("Lean set vs set");
+      std::vector<int> keys = randomKeys(NUM);
+      std::vector<int> probes = randomKeys(NUM, 2);
+      reportBytes("custom::set node", custom::set<int>().bytes_per_element());
+      reportBytes("custom::lean_set node", custom::lean_set<int>::bytes_per_element());
+
+      custom::set<int> s;
+      custom::lean_set<int> lean;
+      size_t num = 0;
+      report("custom::set insert()", time([&]() { for (int key : keys) s.insert(key); }), NUM);
+      report("custom::lean_set insert()", time([&]() { for (int key : keys) lean.insert(key); }), NUM);
+
+      double seconds = time([&]()
+      {
+         for (int key : probes)
+            num += s.find(key) != s.end();
+      });
+      keep(num);
+      report("custom::set find()", seconds, NUM);
+      seconds = time([&]()
+      {
+         for (int key : probes)
+            num += lean.find(key) != lean.end();
+      });
+      keep(num);
+      report("custom::lean_set find()", seconds, NUM);
+
+      long long sum = 0;
+      seconds = time([&]() { for (int key : s) sum += key; });
+      keep((size_t)sum);
+      report("custom::set begin() to end()", seconds, NUM);
+      seconds = time([&]() { for (int key : lean) sum += key; });
+      keep((size_t)sum);
+      report("custom::lean_set begin() to end()", seconds, NUM);
+
+      report("custom::set erase()", time([&]() { for (int key : probes) s.erase(key); }), NUM);
+      report("custom::lean_set erase()", time([&]() { for (int key : probes) lean.erase(key); }), NUM);
+      keep(s.size() + lean.size());
+   }
+
+   /***************************************
+    * THREADED SET
+    ***************************************/
+
+   // a full scan each way of sets built in random order, so neighbors
+   // in the order are far apart in memory: set climbs parent pointers,
+   // lean_set pops its path, threaded_set follows a thread
+   void bench_threaded_scan()
+   {
+      heading("Full scan");
+      std::vector<int> keys = randomKeys(NUM);
+      custom::set<int> s(keys.begin(), keys.end());
+      custom::lean_set<int> lean(keys.begin(), keys.end());
+      custom::threaded_set<int> threaded(keys.begin(), keys.end());
+      reportBytes("custom::threaded_set node", custom::threaded_set<int>::bytes_per_element());
+
+      long long sum = 0;
+      double seconds = time([&]() { for (int key : s) sum += key; });
+      report("custom::set ++", seconds, NUM);
+      seconds = time([&]() { for (int key : lean) sum += key; });
+      report("custom::lean_set ++", seconds, NUM);
+      seconds = time([&]() { for (int key : threaded) sum += key; });
+      report("custom::threaded_set ++", seconds, NUM);
+
+      seconds = time([&]() { for (auto it = s.rbegin(); it != s.rend(); ++it) sum += *it; });
+      report("custom::set --", seconds, NUM);
+      seconds = time([&]()
+      {
+         for (auto it = threaded.end(); it != threaded.begin(); )
+            sum += *--it;
+      });
+      report("custom::threaded_set --", seconds, NUM);
+      keep((size_t)sum);
+   }
+
+   /***************************************
+    * BTREE SET
+    ***************************************/
+
+   // counts what a std::set asks for, to put a number on its nodes
+   template <class T>
+   struct CountingAllocator
+   {
+      using value_type = T;
+      CountingAllocator(size_t* pBytes) : pBytes(pBytes) {}
+      template <class U>
+      CountingAllocator(const CountingAllocator<U>& rhs) : pBytes(rhs.pBytes) {}
+      T* allocate(size_t n)
+      {
+         *pBytes += n * sizeof(T);
+         return static_cast<T*>(::operator new(n * sizeof(T)));
+      }
+      void deallocate(T* p, size_t n)
+      {
+         *pBytes -= n * sizeof(T);
+         ::operator delete(p);
+      }
+      template <class U>
+      bool operator ==(const CountingAllocator<U>& rhs) const { return pBytes == rhs.pBytes; }
+      template <class U>
+      bool operator !=(const CountingAllocator<U>& rhs) const { return pBytes != rhs.pBytes; }
+      size_t* pBytes;
+   };
+
+   // a million random ints in a red-black tree, a B-tree, and std::set
+   void bench_btree_vsSet()
+   {
+      heading("B-tree set vs set");
+      std::vector<int> keys = randomKeys(NUM);
+      std::vector<int> probes = randomKeys(NUM, 2);
+      size_t stdBytes = 0;
+      using StdSet = std::set<int, std::less<int>, CountingAllocator<int>>;
+
+      custom::set<int> s;
+      custom::btree_set<int> btree;
+      StdSet stdSet{ CountingAllocator<int>(&stdBytes) };
+      report("custom::set insert()", time([&]() { for (int key : keys) s.insert(key); }), NUM);
+      report("custom::btree_set insert()", time([&]() { for (int key : keys) btree.insert(key); }), NUM);
+      report("std::set insert()", time([&]() { for (int key : keys) stdSet.insert(key); }), NUM);
+      double seconds = time([&]() { custom::btree_set<int> bulk(keys.begin(), keys.end()); keep(bulk.size()); });
+      report("custom::btree_set bulk load and free", seconds, NUM);
+
+      reportBytes("custom::set", s.bytes_per_element());
+      reportBytes("custom::btree_set, inserted", btree.bytes_per_element());
+      reportBytes("custom::btree_set, bulk loaded",
+                  custom::btree_set<int>(keys.begin(), keys.end()).bytes_per_element());
+      reportBytes("std::set", stdBytes / NUM);
+
+      size_t num = 0;
+      seconds = time([&]() { for (int key : probes) num += s.find(key) != s.end(); });
+      report("custom::set find()", seconds, NUM);
+      seconds = time([&]() { for (int key : probes) num += btree.find(key) != btree.end(); });
+      report("custom::btree_set find()", seconds, NUM);
+      seconds = time([&]() { for (int key : probes) num += stdSet.find(key) != stdSet.end(); });
+      report("std::set find()", seconds, NUM);
+      keep(num);
+
+      long long sum = 0;
+      report("custom::set scan", time([&]() { for (int key : s) sum += key; }), NUM);
+      report("custom::btree_set scan", time([&]() { for (int key : btree) sum += key; }), NUM);
+      report("std::set scan", time([&]() { for (int key : stdSet) sum += key; }), NUM);
+      keep((size_t)sum);
+   }
+
+   // an int the SIMD search does not recognize, so the B-tree falls
+   // back on a binary search in each node
+   struct PlainInt
+   {
+      int value;
+      bool operator <(const PlainInt& rhs) const { return value < rhs.value; }
+   };
+
+   // searching one full node, at each level the CPU has, against a
+   // binary search; then whole B-tree lookups with and without
+   void bench_btree_nodeSearch()
+   {
+      heading("B-tree node search");
+      const int numKeys = custom::btree_node_keys<int>::value;
+      std::vector<int> node(numKeys);
+      for (int i = 0; i < numKeys; i++)
+         node[i] = i * 2;
+      std::vector<int> probes = randomKeys(NUM);
+      for (int& probe : probes)
+         probe %= numKeys * 2;
+
+      size_t sum = 0;
+      double seconds = time([&]()
+      {
+         for (int probe : probes)
+            sum += std::lower_bound(node.begin(), node.end(), probe) - node.begin();
+      });
+      report("binary search, one node", seconds, NUM);
+      const char* names[] = { "scalar count, one node", "SSE4.2 count, one node", "AVX2 count, one node" };
+      for (custom::simd_level level : { custom::simd_level::SCALAR, custom::simd_level::SSE42, custom::simd_level::AVX2 })
+      {
+         if (level > custom::simdLevel())
+            break;
+         seconds = time([&]()
+         {
+            for (int probe : probes)
+               sum += custom::simdCountBelow(node.data(), numKeys, probe, level);
+         });
+         report(names[(int)level], seconds, NUM);
+      }
+      keep(sum);
+
+      std::vector<int> keys = randomKeys(NUM);
+      probes = randomKeys(NUM, 2);
+      std::vector<PlainInt> plainKeys;
+      for (int key : keys)
+         plainKeys.push_back(PlainInt{ key });
+      custom::btree_set<int> btree(keys.begin(), keys.end());
+      custom::btree_set<PlainInt> plain(plainKeys.begin(), plainKeys.end());
+      seconds = time([&]() { for (int key : probes) sum += btree.find(key) != btree.end(); });
+      report("custom::btree_set<int> find()", seconds, NUM);
+      seconds = time([&]() { for (int key : probes) sum += plain.find(PlainInt{ key }) != plain.end(); });
+      report("custom::btree_set<PlainInt> find()", seconds, NUM);
+      keep(sum);
+   }
+
+   /***************************************
+    * FLAT SET
+    ***************************************/
+
+   // a stream of operations on a set of about num keys: each either a
+   // find, or a write that alternately inserts and erases, so the size
+   // holds steady. Keys are drawn from twice the range held, so half of
+   // the finds miss.
+   template <class Set>
+   double mixedOps(Set& s, size_t num, int percentWrites, size_t numOps)
+   {
+      std::mt19937 generator(3);
+      std::uniform_int_distribution<int> key(0, (int)(2 * num) - 1);
+      std::uniform_int_distribution<int> percent(0, 99);
+      std::vector<std::pair<int, int>> ops(numOps);
+      for (auto& op : ops)
+         op = { percent(generator) < percentWrites ? 1 : 0, key(generator) };
+
+      size_t sum = 0;
+      bool inserting = true;
+      double seconds = time([&]()
+      {
+         for (auto& op : ops)
+            if (op.first == 0)
+               sum += s.find(op.second) != s.end();
+            else if ((inserting = !inserting))
+               sum += s.insert(op.second).second;
+            else
+               sum += s.erase(op.second);
+      });
+      keep(sum);
+      return seconds;
+   }
+
+   // where the sorted array stops beating the tree: sizes from a cache
+   // line to a couple of megabytes, each at several mixes of reads to
+   // writes
+   void bench_flat_crossover()
+   {
+      heading("Flat set vs set, by size and writes");
+      const size_t numOps = 200000;
+      for (size_t num : { 16, 256, 4096, 65536, 262144 })
+      {
+         std::vector<int> keys = randomKeys(2 * num);
+         keys.resize(num);
+         for (int percentWrites : { 0, 1, 10, 50 })
+         {
+            custom::set<int> s(keys.begin(), keys.end());
+            custom::flat_set<int> flat(keys.begin(), keys.end());
+            std::string suffix = ", n=" + std::to_string(num) + ", " +
+                                 std::to_string(percentWrites) + "% writes";
+            report(("custom::set" + suffix).c_str(), mixedOps(s, num, percentWrites, numOps), numOps);
+            report(("custom::flat_set" + suffix).c_str(), mixedOps(flat, num, percentWrites, numOps), numOps);
+         }
+      }
+   }
+
+   /***************************************
+    * BACKENDS
+    ***************************************/
+
+   // one set, so the same probes, on each backend; the rb_tree set
+   // against a bare BST shows what the policy layer costs
+   template <class Backend>
+   void reportBackendFind(const char* name, const std::vector<int>& keys,
+                          const std::vector<int>& probes)
+   {
+      custom::set<int, std::less<int>, Backend> s(keys.begin(), keys.end());
+      size_t num = 0;
+      double seconds = time([&]() { for (int key : probes) num += s.find(key) != s.end(); });
+      keep(num);
+      report(name, seconds, probes.size());
+   }
+
+   void bench_backend_find()
+   {
+      heading("Set find() by backend");
+      std::vector<int> keys = randomKeys(NUM);
+      std::vector<int> probes = randomKeys(NUM, 2);
+
+      custom::BST<int> bst;
+      for (int key : keys)
+         bst.insert(key, true /*keepUnique*/);
+      size_t num = 0;
+      double seconds = time([&]() { for (int key : probes) num += bst.find(key) != bst.end(); });
+      keep(num);
+      report("custom::BST, no set", seconds, NUM);
+      reportBackendFind<custom::rb_tree>("custom::set<rb_tree>", keys, probes);
+      reportBackendFind<custom::btree>("custom::set<btree>", keys, probes);
+      reportBackendFind<custom::flat>("custom::set<flat>", keys, probes);
+      reportBackendFind<custom::frozen>("custom::set<frozen>", keys, probes);
+   }
+
+   /***************************************
+    * ADAPTIVE SET
+    ***************************************/
+
+   // many small sets, then one big one that is written to heavily and
+   // then only read, against the fixed layouts
+   void bench_adaptive_phases()
+   {
+      heading("Adaptive set vs fixed layouts");
+      const size_t numSets = 100000;
+      const size_t numEach = 8;
+      std::vector<int> keys = randomKeys(numSets * numEach);
+      size_t sum = 0;
+      double seconds = time([&]()
+      {
+         std::vector<custom::set<int>> sets(numSets);
+         for (size_t i = 0; i < keys.size(); i++)
+            sets[i / numEach].insert(keys[i]);
+         for (size_t i = 0; i < keys.size(); i++)
+            sum += sets[i / numEach].find(keys[i]) != sets[i / numEach].end();
+      });
+      report("custom::set, 100K sets of 8: build, find, free", seconds, keys.size());
+      seconds = time([&]()
+      {
+         std::vector<custom::adaptive_set<int>> sets(numSets);
+         for (size_t i = 0; i < keys.size(); i++)
+            sets[i / numEach].insert(keys[i]);
+         for (size_t i = 0; i < keys.size(); i++)
+            sum += sets[i / numEach].contains(keys[i]);
+      });
+      report("custom::adaptive_set, 100K sets of 8: ...", seconds, keys.size());
+      keep(sum);
+
+      const size_t num = 262144;
+      const size_t numOps = 200000;
+      std::vector<int> big = randomKeys(2 * num);
+      big.resize(num);
+      custom::set<int> s(big.begin(), big.end());
+      custom::flat_set<int> flat(big.begin(), big.end());
+      custom::adaptive_set<int> adaptive(big.begin(), big.end());
+      report("custom::set, 256K, 50% writes", mixedOps(s, num, 50, numOps), numOps);
+      report("custom::flat_set, 256K, 50% writes", mixedOps(flat, num, 50, numOps), numOps);
+      report("custom::adaptive_set, 256K, 50% writes", mixedOps(adaptive, num, 50, numOps), numOps);
+      report("custom::set, 256K, then reads only", mixedOps(s, num, 0, numOps), numOps);
+      report("custom::flat_set, 256K, then reads only", mixedOps(flat, num, 0, numOps), numOps);
+      report("custom::adaptive_set, 256K, then reads only", mixedOps(adaptive, num, 0, numOps), numOps);
+      adaptive.adapt();
+      report("custom::adaptive_set, 256K, reads after adapt()", mixedOps(adaptive, num, 0, numOps), numOps);
+   }
+
+   /***************************************
+    * SMALL SET
+    ***************************************/
+
+   // millions of sets of 0 to 8 values: the bytes they take, and the
+   // time to build, look through and free them, with and without the
+   // inline array
+   void bench_small_manySets()
+   {
+      heading("Small set: millions of tiny sets");
+      using SmallSet = custom::set<int, std::less<int>, custom::small<8>>;
+      const size_t numSets = 2000000;
+      std::vector<int> keys = randomKeys(numSets * 4);
+      std::mt19937 random(46);
+      std::vector<size_t> sizes(numSets);
+      size_t numElements = 0;
+      for (size_t& size : sizes)
+         numElements += size = random() % 9;
+
+      size_t bytesSet = numSets * sizeof(custom::set<int>);
+      size_t bytesSmall = numSets * sizeof(SmallSet);
+      {
+         std::vector<custom::set<int>> sets(numSets);
+         std::vector<SmallSet> smallSets(numSets);
+         for (size_t i = 0, k = 0; i < numSets; i++)
+            for (size_t j = 0; j < sizes[i]; j++, k++)
+            {
+               sets[i].insert(keys[k]);
+               smallSets[i].insert(keys[k]);
+            }
+         for (size_t i = 0; i < numSets; i++)
+         {
+            bytesSet += sets[i].size() * sets[i].bytes_per_element();
+            if (smallSets[i].size() > custom::small_set<int, 8>::INLINE_MAX)
+               bytesSmall += smallSets[i].size() * smallSets[i].bytes_per_element();
+         }
+      }
+      reportBytes("custom::set, object and nodes", bytesSet / numElements);
+      reportBytes("custom::set<small<8>>, object and nodes", bytesSmall / numElements);
+
+      size_t sum = 0;
+      double seconds = time([&]()
+      {
+         std::vector<custom::set<int>> sets(numSets);
+         for (size_t i = 0, k = 0; i < numSets; i++)
+            for (size_t j = 0; j < sizes[i]; j++)
+               sets[i].insert(keys[k++]);
+         for (size_t i = 0, k = 0; i < numSets; i++)
+            for (size_t j = 0; j < sizes[i]; j++)
+               sum += sets[i].find(keys[k++]) != sets[i].end();
+      });
+      report("custom::set: build, find, free", seconds, numElements);
+      seconds = time([&]()
+      {
+         std::vector<SmallSet> sets(numSets);
+         for (size_t i = 0, k = 0; i < numSets; i++)
+            for (size_t j = 0; j < sizes[i]; j++)
+               sets[i].insert(keys[k++]);
+         for (size_t i = 0, k = 0; i < numSets; i++)
+            for (size_t j = 0; j < sizes[i]; j++)
+               sum += sets[i].find(keys[k++]) != sets[i].end();
+      });
+      report("custom::set<small<8>>: build, find, free", seconds, numElements);
+      keep(sum);
+   }
+
+   /***************************************
+    * STATIC SET
+    ***************************************/
+
+   // a thousand random ints inserted, found and erased over and over:
+   // the nodes of a static_set come and go with no trip to the heap
+   void bench_static_vsSet()
+   {
+      heading("Static set vs set");
+      const size_t num = 1000;
+      const size_t numRounds = 1000;
+      std::vector<int> keys = randomKeys(num);
+      std::vector<int> probes = randomKeys(num, 2);
+      custom::set<int> s;
+      custom::static_set<int, 1024> fixed;
+      custom::set<int, std::less<int>, custom::fixed<1024>> fixedSet;
+
+      reportBytes("custom::set", s.bytes_per_element());
+      reportBytes("custom::static_set<int, 1024>", fixed.bytes_per_element());
+
+      size_t sum = 0;
+      auto rounds = [&](auto& set)
+      {
+         return time([&]()
+         {
+            for (size_t round = 0; round < numRounds; round++)
+            {
+               for (int key : keys)
+                  set.insert(key);
+               for (int key : probes)
+                  sum += set.find(key) != set.end();
+               for (int key : keys)
+                  set.erase(key);
+            }
+         });
+      };
+      report("custom::set insert, find, erase", rounds(s), 3 * num * numRounds);
+      report("custom::static_set insert, find, erase", rounds(fixed), 3 * num * numRounds);
+      report("custom::set<fixed<1024>> insert, find, erase", rounds(fixedSet), 3 * num * numRounds);
+      keep(sum);
+   }
+
+   /***************************************
+    * FROZEN SET
+    ***************************************/
+
+   // a million random probes, half of them misses, into the even numbers
+   // at sizes that fit in L1, in L2, in the last level cache and in none
+   // of them: a set is only built where it fits in memory
+   void bench_frozen_lookup()
+   {
+      heading("Frozen lookup");
+      const size_t numProbes = NUM;
+      for (size_t num : { (size_t)4096, (size_t)131072, (size_t)4194304, (size_t)67108864 })
+      {
+         std::vector<int> sorted(num);
+         for (size_t i = 0; i < num; i++)
+            sorted[i] = 2 * (int)i;
+         std::vector<int> probes(numProbes);
+         std::mt19937 generator((unsigned int)num);
+         std::uniform_int_distribution<int> distribution(0, 2 * (int)num - 1);
+         for (int& probe : probes)
+            probe = distribution(generator);
+         std::string size = (num < 1048576 ? std::to_string(num / 1024) + "K" :
+                             std::to_string(num / 1048576) + "M") + " ints: ";
+         size_t sum = 0;
+
+         custom::frozen_set<int> frozen(sorted.begin(), sorted.end());
+         double seconds = time([&]()
+         {
+            for (int probe : probes)
+               sum += frozen.contains(probe);
+         });
+         report((size + "frozen_set::contains()").c_str(), seconds, numProbes);
+         seconds = time([&]()
+         {
+            for (int probe : probes)
+               sum += *frozen.lower_bound(probe - 1);
+         });
+         report((size + "frozen_set::lower_bound()").c_str(), seconds, numProbes);
+
+         seconds = time([&]()
+         {
+            for (int probe : probes)
+               sum += *std::lower_bound(sorted.begin(), sorted.end(), probe - 1);
+         });
+         report((size + "std::lower_bound() on a vector").c_str(), seconds, numProbes);
+
+         if (num <= NUM_HUGE)
+         {
+            custom::set<int> s(sorted.begin(), sorted.end());
+            seconds = time([&]()
+            {
+               for (int probe : probes)
+                  sum += s.find(probe) != s.end();
+            });
+            report((size + "custom::set::find()").c_str(), seconds, numProbes);
+         }
+         keep(sum);
+      }
+   }
+
+   /***************************************
+    * LAYOUT
+    ***************************************/
+
+   // a million finds in ten million ints, some four times the last level
+   // cache here: nodes where the inserts left them, in key order as a
+   // sorted build leaves them, and in van Emde Boas order
+   void bench_set_optimizeLayout()
+   {
+      heading("Optimize layout");
+      std::vector<int> keys = randomKeys(NUM_HUGE);
+      std::vector<int> probes = randomKeys(NUM_HUGE, 2);
+      probes.resize(NUM);
+      size_t sum = 0;
+      auto finds = [&](custom::set<int>& s)
+      {
+         return time([&]()
+         {
+            for (int probe : probes)
+               sum += s.find(probe) != s.end();
+         });
+      };
+
+      {
+         custom::set<int> s(keys.begin(), keys.end());
+         report("find(), inserted at random", finds(s), NUM);
+         double seconds = time([&]() { s.optimize_layout(); });
+         report("optimize_layout(), per element", seconds, NUM_HUGE);
+         report("find(), van Emde Boas order", finds(s), NUM);
+      }
+      {
+         std::sort(keys.begin(), keys.end());
+         custom::set<int> s(keys.begin(), keys.end());
+         report("find(), inserted in order", finds(s), NUM);
+      }
+      keep(sum);
+   }
+
+   // ten million ints after a million erases and inserts at random: a
+   // scan and a million finds, then again after each kind of compact(),
+   // and the pauses compact_step() takes
+   void bench_set_compact()
+   {
+      heading("Compact");
+      std::vector<int> keys = randomKeys(2 * NUM_HUGE);
+      std::vector<int> probes = randomKeys(NUM_HUGE, 2);
+      probes.resize(NUM);
+      custom::set<int> s(keys.begin(), keys.begin() + NUM_HUGE);
+      for (size_t i = 0; i < NUM; i++)
+      {
+         s.erase(keys[i]);
+         s.insert(keys[NUM_HUGE + i]);
+      }
+      size_t sum = 0;
+      auto measure = [&](const char* nameScan, const char* nameFind)
+      {
+         double seconds = time([&]()
+         {
+            for (auto it = s.begin(); it != s.end(); ++it)
+               sum += *it;
+         });
+         report(nameScan, seconds, s.size());
+         seconds = time([&]()
+         {
+            for (int probe : probes)
+               sum += s.find(probe) != s.end();
+         });
+         report(nameFind, seconds, NUM);
+      };
+
+      measure("scan, after churn", "find(), after churn");
+      double seconds = time([&]() { s.compact(); });
+      report("compact(), per element", seconds, s.size());
+      measure("scan, in order", "find(), in order");
+      s.compact(custom::node_order::BREADTH_FIRST);
+      measure("scan, breadth first", "find(), breadth first");
+
+      // scatter it again, then compact a thousand nodes a call
+      for (size_t i = 0; i < NUM; i++)
+      {
+         s.erase(keys[NUM_HUGE + i]);
+         s.insert(keys[i]);
+      }
+      std::vector<double> pauses;
+      for (bool done = false; !done; )
+         pauses.push_back(time([&]() { done = s.compact_step(1000); }) * 1e9 / 1000.0);
+      reportPercentiles("compact_step(1000), per node", pauses);
+      measure("scan, after compact_step()", "find(), after compact_step()");
+      keep(sum);
+   }
+
+#if defined(__cpp_impl_coroutine)
+   /***************************************
+    * INTERLEAVED LOOKUP
+    ***************************************/
+
+   // a mixed batch of finds and lower bounds in a tree too big for the
+   // cache, sweeping how many coroutines are in flight
+   void bench_interleaved_width()
+   {
+      heading("Interleaved lookup");
+      std::vector<int> keys = randomKeys(NUM_HUGE);
+      custom::BST<int> bst;
+      for (size_t i = 0; i < keys.size(); i += 2)
+         bst.insert(keys[i], true /*keepUnique*/);
+      std::vector<int> queries(keys.begin(), keys.begin() + NUM);
+      size_t numFound = 0;
+
+      double seconds = time([&]()
+      {
+         for (size_t i = 0; i < queries.size(); i++)
+            if (i % 2)
+               numFound += (bst.find(queries[i]) != bst.end()) ? 1 : 0;
+            else
+               numFound += (bst.lower_bound(queries[i]) != bst.end()) ? 1 : 0;
+      });
+      keep(numFound);
+      report("find() / lower_bound() in a loop", seconds, queries.size());
+
+      for (int width = 1; width <= 64; width *= 2)
+      {
+         custom::interleaved_lookup<int> lookup(bst, width);
+         numFound = 0;
+         auto done = [&](custom::BST<int>::iterator /*it*/, bool found) { numFound += found ? 1 : 0; };
+         for (size_t i = 0; i < queries.size(); i++)
+            if (i % 2)
+               lookup.find(queries[i], done);
+            else
+               lookup.lower_bound(queries[i], done);
+         seconds = time([&]() { lookup.run(); });
+         keep(numFound);
+         std::string name = "interleaved_lookup, width " + std::to_string(width);
+         report(name.c_str(), seconds, queries.size());
+      }
+   }
+#endif // __cpp_impl_coroutine
+};
+
+#endif // BENCHMARK
@@ -0,0 +1,117 @@
+/***********************************************************************
+ * Header:
+ *    BENCHMARK
+ * Summary:
+ *    The base class to all the benchmark classes
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef BENCHMARK
+
+#include <iostream>  // for std::cout
+#include <iomanip>   // for std::setw
+#include <chrono>    // for std::chrono::steady_clock
+#include <random>    // for std::mt19937
+#include <vector>    // for std::vector
+#include <algorithm> // for std::shuffle
+
+class Benchmark
+{
+protected:
+   /*************************************************************
+    * TIME
+    * How many seconds it takes to run a chunk of code
+    *************************************************************/
+   template <class Function>
+   double time(Function function)
+   {
+      auto start = std::chrono::steady_clock::now();
+      function();
+      auto finish = std::chrono::steady_clock::now();
+      return std::chrono::duration<double>(finish - start).count();
+   }
+
+   /*************************************************************
+    * REPORT
+    * Display the cost of one operation in nanoseconds
+    *************************************************************/
+   void report(const char* name, double seconds, size_t numOperations)
+   {
+      std::cout << "\t" << std::left << std::setw(48) << name
+                << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+                << (seconds * 1e9 / (double)(numOperations ? numOperations : 1))
+                << " ns/op  (" << numOperations << " ops)\n";
+   }
+
+   /*************************************************************
+    * REPORT PERCENTILES
+    * Display the median and tail of a set of latency samples,
+    * each sample being nanoseconds per operation
+    *************************************************************/
+   void reportPercentiles(const char* name, std::vector<double> samples)
+   {
+      if (samples.empty())
+         return;
+      std::sort(samples.begin(), samples.end());
+      auto at = [&](double fraction)
+      {
+         return samples[(size_t)(fraction * (double)(samples.size() - 1))];
+      };
+      std::cout << "\t" << std::left << std::setw(48) << name
+                << std::right << std::fixed << std::setprecision(1)
+                << " p50 " << std::setw(8) << at(0.50)
+                << " p99 " << std::setw(8) << at(0.99)
+                << " p99.9 " << std::setw(8) << at(0.999) << " ns/op\n";
+   }
+
+   /*************************************************************
+    * REPORT BYTES
+    * Display how much memory each element takes
+    *************************************************************/
+   void reportBytes(const char* name, size_t bytes)
+   {
+      std::cout << "\t" << std::left << std::setw(48) << name
+                << std::right << std::setw(12) << bytes << " bytes/element\n";
+   }
+
+   /*************************************************************
+    * KEEP
+    * Make a result look used so the optimizer cannot throw
+    * away the work that produced it. The sink is read back
+    * too, or it is a variable set but never used.
+    *************************************************************/
+   void keep(size_t value)
+   {
+      static volatile size_t sink;
+      sink = value;
+      (void)sink;
+   }
+
+   /*************************************************************
+    * HEADING
+    * Name the group of measurements that follows
+    *************************************************************/
+   void heading(const char* name)
+   {
+      std::cout << name << ":\n";
+   }
+
+   /*************************************************************
+    * RANDOM KEYS
+    * The numbers 0 ... num-1 in a reproducible random order
+    *************************************************************/
+   std::vector<int> randomKeys(size_t num, unsigned int seed = 1)
+   {
+      std::vector<int> keys(num);
+      for (size_t i = 0; i < num; i++)
+         keys[i] = (int)i;
+      std::mt19937 generator(seed);
+      std::shuffle(keys.begin(), keys.end(), generator);
+      return keys;
+   }
+};
+
+#endif // BENCHMARK
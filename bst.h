@@ -28,8 +28,14 @@
 #include <cassert>
 #include <utility>
 #include <memory>     // for std::allocator
+#include <atomic>     // for std::atomic
+#include <new>        // for placement new
 #include <functional> // for std::less
 #include <utility>    // for std::pair
+#include <vector>     // for std::vector
+#include <algorithm>  // for std::stable_sort
+#include "prefetch.h"
+#include "executor.h"
 
 class TestBST; // forward declaration for unit tests
 class TestSet;
@@ -38,10 +44,15 @@ class TestMap;
 namespace custom
 {
 
-   template <typename TT>
+   template <typename TT, typename CC, typename BB>
    class set;
    template <typename KK, typename VV>
    class map;
+   template <typename TT>
+   class interleaved_lookup;
+
+   // the order compact() puts the nodes in
+   enum class node_order { IN_ORDER, BREADTH_FIRST };
 
 /*****************************************************************
  * BINARY SEARCH TREE
@@ -54,11 +65,14 @@ namespace custom
       friend class ::TestSet;
       friend class ::TestMap;
 
-      template <class TT>
+      template <class TT, class CC, class BB>
       friend class custom::set;
 
       template <class KK, class VV>
       friend class custom::map;
+
+      template <class TT>
+      friend class custom::interleaved_lookup;
    public:
       //
       // Construct
@@ -78,6 +92,8 @@ namespace custom
       BST& operator =(BST&& rhs);
       BST& operator =(const std::initializer_list<T>& il);
       void swap(BST& rhs);
+      template <class Iterator>
+      void assignSorted(Iterator first, Iterator last);
 
       //
       // Iterator
@@ -85,13 +101,16 @@ namespace custom
 
       class iterator;
       iterator begin() const noexcept;
-      iterator end()   const noexcept { return iterator(nullptr); }
+      iterator end()   const noexcept { return iterator(nullptr, this); }
 
       //
       // Access
       //
 
       iterator find(const T& t);
+      iterator lower_bound(const T& t) const;
+      template <class Iterator, class Found>
+      void findMany(Iterator first, Iterator last, Found found) const;
 
       // 
       // Insert
@@ -99,14 +118,50 @@ namespace custom
 
       std::pair<iterator, bool> insert(const T& t, bool keepUnique = false);
       std::pair<iterator, bool> insert(T&& t, bool keepUnique = false);
+      template <class Iterator, class Executor>
+      size_t insertParallel(Iterator first, Iterator last, const Executor& executor);
 
       //
       // Remove
       // 
 
       iterator erase(iterator& it);
+      size_t   erase(iterator first, iterator last);
+      bool     eraseKey(const T& t);
+      void     popFront();
+      void     popBack();
+      T        takeFront();
+      T        takeBack();
+      template <class Pred>
+      size_t   eraseIf(Pred pred);
+      BST<T>   extract(iterator first, iterator last);
       void     clear() noexcept;
 
+      //
+      // Batch: a mix of inserts and erases applied together
+      //
+
+      struct update
+      {
+         T    value;
+         bool erase;              // false to insert value, true to erase it
+      };
+      struct batch_result
+      {
+         size_t inserted = 0;     // inserts of a value not there
+         size_t erased   = 0;     // erases of a value that was there
+         size_t skipped  = 0;     // inserts and erases that changed nothing
+      };
+      batch_result applyBatch(std::vector<update>&& batch);
+
+      //
+      // Layout
+      //
+
+      void optimizeLayout();
+      void compact(node_order order = node_order::IN_ORDER);
+      bool compactStep(size_t maxNodes);
+
       // 
       // Status
       //
@@ -114,11 +169,44 @@ namespace custom
       bool   empty() const noexcept { return size() == 0; }
       size_t size()  const noexcept { return numElements; }
 
+      // heap bytes each element costs: one node
+      static size_t nodeSize() noexcept { return sizeof(BNode); }
+
    private:
 
       class  BNode;
+      struct Arena;
+
+      // ranges with no more than this many values are erased one at a
+      // time: cheaper than the two splits and a join of a detach
+      static const size_t SMALL_RANGE = 32;
+
+      static int  redDepth(size_t num);
+      BNode* detach(iterator first, iterator last);
+      bool   splittable(iterator first, iterator last) const;
+      void   unlink(BNode* pDelete);
+      BNode* unlinkEnd(bool left);
+      void   replace(BNode* pOld, BNode* pNew);
+      void   rotate(BNode* pNode, bool left);
+      void   eraseFixup(BNode* pX, BNode* pXParent);
+      static bool fold(const update* pFirst, const update* pLast, bool present,
+                       batch_result& result, const update*& pInsert);
+      void applyEach(const std::vector<update>& batch, batch_result& result);
+      void applyMerge(std::vector<update>& batch, batch_result& result);
+
+      void   recache() noexcept;
+      void   relayout(const std::vector<size_t>& slots);
+      BNode* relocate(BNode* pOld, BNode* pSlot);
+      static void vebOrder(size_t first, size_t num, int levels,
+                           std::vector<size_t>& slots, size_t& next);
+      static void vebBelow(size_t first, size_t num, int depth, int levels,
+                           std::vector<size_t>& slots, size_t& next);
+
       BNode* root;              // root node of the binary search tree
       size_t numElements;       // number of elements currently in the tree
+      BNode* pLeftmost;         // the smallest node, or null if not known
+      BNode* pRightmost;        // the largest node, or null if not known
+      Arena* arena;             // the block relayout() placed nodes in, or null
    };
 
 
@@ -134,11 +222,11 @@ namespace custom
       // 
       // Construct
       //
-      BNode() : data(T()), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true)
+      BNode() : data(T()), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true), inArena(false)
       {}
-      BNode(const T& t) : data(t), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true)
+      BNode(const T& t) : data(t), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true), inArena(false)
       {}
-      BNode(T&& t) : data(std::move(t)), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true)
+      BNode(T&& t) : data(std::move(t)), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true), inArena(false)
       {}
 
       //
@@ -150,6 +238,22 @@ namespace custom
       // Assign
       //
       static void assign(BNode*& pDest, const BNode* pSrc);
+      template <class Iterator>
+      static BNode* build(Iterator first, size_t num, int depth, int redDepth);
+      static BNode* link(BNode** nodes, size_t num, int depth, int redDepth);
+
+      //
+      // Split and join
+      //
+      static BNode* join(BNode* pLess, BNode* pMiddle, BNode* pGreater);
+      static BNode* join(BNode* pLess, BNode* pGreater);
+      static void   split(BNode* pTree, const T& t, BNode*& pLess, BNode*& pMatch, BNode*& pGreater);
+      static int    blackHeight(const BNode* pNode);
+      static BNode* rotateLeft(BNode* pNode);
+      static BNode* rotateRight(BNode* pNode);
+      static BNode* joinRight(BNode* pLess, int heightLess, BNode* pMiddle, BNode* pGreater, int heightGreater);
+      static BNode* joinLeft(BNode* pLess, int heightLess, BNode* pMiddle, BNode* pGreater, int heightGreater);
+      static void   collectTop(const BNode* pNode, int depth, std::vector<T>& keys);
 
       //
       // Insert
@@ -164,7 +268,9 @@ namespace custom
       //
       // Remove
       //
-      static void clear(BST<T>::BNode*& pNode) noexcept;
+      static size_t clear(BST<T>::BNode*& pNode) noexcept;
+      static size_t count(const BNode* pNode) noexcept;
+      static void   destroy(BNode* pNode) noexcept;
 
       // 
       // Status
@@ -193,6 +299,50 @@ namespace custom
       BNode* pRight;           // Right child - larger
       BNode* pParent;          // Parent
       bool isRed;              // Red-black balancing stuff
+      bool inArena;            // in the tree's arena rather than on its own
+   };
+
+   /*****************************************************************
+    * ARENA
+    * One block of nodes laid out together. Every tree holding a node
+    * in it holds a reference, and the last to let go frees it; the
+    * nodes themselves are destroyed one by one as they leave.
+    *****************************************************************/
+   template <typename T>
+   struct BST<T>::Arena
+   {
+      Arena(size_t num) : numRefs(1), nodes(std::allocator<BNode>().allocate(num)), num(num),
+                          numPlaced(0), isFilling(false), pOlder(nullptr)
+      {}
+      ~Arena()
+      {
+         release(pOlder);
+         std::allocator<BNode>().deallocate(nodes, num);
+      }
+
+      static Arena* share(Arena* pArena) noexcept
+      {
+         if (pArena)
+            pArena->numRefs++;
+         return pArena;
+      }
+      static void release(Arena*& pArena) noexcept
+      {
+         if (pArena && --pArena->numRefs == 0)
+            delete pArena;
+         pArena = nullptr;
+      }
+
+      std::atomic<size_t> numRefs;  // trees that may hold a node in here
+      BNode* nodes;                 // room for num nodes
+      size_t num;
+      size_t numPlaced;             // nodes[0..numPlaced) have been handed out
+
+      // while compactStep() is filling this one: the last value it moved
+      // in, and the arena the nodes it has not reached may still be in
+      bool isFilling;
+      std::unique_ptr<T> pResume;
+      Arena* pOlder;
    };
 
    /**********************************************************
@@ -210,13 +360,14 @@ namespace custom
       friend class custom::map;
    public:
       // constructors and assignment
-      iterator(BNode* p = nullptr) : pNode(p)
+      iterator(BNode* p = nullptr, const BST* pTree = nullptr) : pNode(p), pTree(pTree)
       {}
-      iterator(const iterator& rhs) : pNode(rhs.pNode)
+      iterator(const iterator& rhs) : pNode(rhs.pNode), pTree(rhs.pTree)
       {}
       iterator& operator =(const iterator& rhs)
       {
          pNode = rhs.pNode;
+         pTree = rhs.pTree;
          return *this;
       }
 
@@ -254,11 +405,15 @@ namespace custom
 
       // must give friend status to remove so it can call getNode() from it
       friend BST<T>::iterator BST<T>::erase(iterator& it);
+      friend class custom::BST<T>;
 
    private:
 
       // the node
       BNode* pNode;
+
+      // the tree, so that end() can be decremented; null if not known
+      const BST* pTree;
    };
 
 
@@ -275,7 +430,7 @@ namespace custom
      * BST :: DEFAULT CONSTRUCTOR
      ********************************************/
    template <typename T>
-   BST<T>::BST() : numElements(0), root(nullptr) {}
+   BST<T>::BST() : root(nullptr), numElements(0), pLeftmost(nullptr), pRightmost(nullptr), arena(nullptr) {}
 
    /*********************************************
     * BST :: COPY CONSTRUCTOR
@@ -326,6 +481,7 @@ namespace custom
    {
       BNode::assign(root, rhs.root);
       numElements = rhs.numElements;
+      recache();
       return *this;
    }
 
@@ -363,6 +519,183 @@ namespace custom
    {
       std::swap(root, rhs.root);
       std::swap(numElements, rhs.numElements);
+      std::swap(pLeftmost, rhs.pLeftmost);
+      std::swap(pRightmost, rhs.pRightmost);
+      std::swap(arena, rhs.arena);
+   }
+
+   /*********************************************
+    * BST :: ASSIGN SORTED
+    * Replace the contents with a sorted run of unique values
+    * in O(n), with no comparisons and no rotations. The tree
+    * is perfectly balanced: every level is full except the last,
+    * whose nodes are red so every path has the same black height.
+    * The iterators must be random access.
+    ********************************************/
+   template <typename T>
+   template <class Iterator>
+   void BST<T>::assignSorted(Iterator first, Iterator last)
+   {
+      clear();
+      size_t num = (size_t)(last - first);
+      root = BNode::build(first, num, 0, redDepth(num));
+      numElements = num;
+      recache();
+   }
+
+   /*********************************************
+    * BST :: RED DEPTH
+    * In a perfectly balanced tree of num nodes, the depth of the
+    * one level that may be partly full. The levels above it are full.
+    ********************************************/
+   template <typename T>
+   int BST<T>::redDepth(size_t num)
+   {
+      int depth = 0;
+      while (((size_t)2 << depth) - 1 <= num)
+         depth++;
+      return depth;
+   }
+
+   /*********************************************
+    * BST :: APPLY BATCH
+    * Apply a batch of inserts and erases, sorted first so that the
+    * changes to one value happen together and in the order given.
+    * A small batch is applied one value at a time; the sorted order
+    * keeps each descent close to the last one. A batch that touches a
+    * good part of the tree is merged with it in one in-order pass and
+    * the tree relinked, balanced, from the nodes it already has.
+    ********************************************/
+   template <typename T>
+   typename BST<T>::batch_result BST<T>::applyBatch(std::vector<update>&& batch)
+   {
+      batch_result result;
+      std::stable_sort(batch.begin(), batch.end(), [](const update& lhs, const update& rhs)
+      {
+         return lhs.value < rhs.value;
+      });
+
+      // a descent costs about log n misses, a merge about one per node
+      if (batch.size() * 8 < numElements)
+         applyEach(batch, result);
+      else
+         applyMerge(batch, result);
+      return result;
+   }
+
+   /*********************************************
+    * BST :: FOLD
+    * Run the changes to one value, in order, given whether the value
+    * is in the tree. Returns whether it is there afterwards, and
+    * which insert put it there last.
+    ********************************************/
+   template <typename T>
+   bool BST<T>::fold(const update* pFirst, const update* pLast, bool present,
+                     batch_result& result, const update*& pInsert)
+   {
+      pInsert = nullptr;
+      for (const update* p = pFirst; p != pLast; ++p)
+      {
+         if (p->erase == present)
+         {
+            // insert something missing, or erase something there
+            (present ? result.erased : result.inserted)++;
+            present = !present;
+            if (present)
+               pInsert = p;
+         }
+         else
+            result.skipped++;
+      }
+      return present;
+   }
+
+   /*********************************************
+    * BST :: APPLY EACH
+    * One lookup per distinct value in the batch
+    ********************************************/
+   template <typename T>
+   void BST<T>::applyEach(const std::vector<update>& batch, batch_result& result)
+   {
+      const update* pBatch = batch.data();
+      for (size_t i = 0, j; i < batch.size(); i = j)
+      {
+         for (j = i + 1; j < batch.size() && !(batch[i].value < batch[j].value); j++)
+            ;
+
+         iterator it = find(batch[i].value);
+         bool before = (it != end());
+         const update* pInsert;
+         bool after = fold(pBatch + i, pBatch + j, before, result, pInsert);
+
+         if (before && !after)
+            erase(it);
+         else if (!before && after)
+            insert(pInsert->value);
+      }
+   }
+
+   /*********************************************
+    * BST :: APPLY MERGE
+    * Walk the tree and the batch side by side. Nodes that stay are
+    * kept, erased nodes are reused for new values, and the result is
+    * relinked into a balanced tree.
+    ********************************************/
+   template <typename T>
+   void BST<T>::applyMerge(std::vector<update>& batch, batch_result& result)
+   {
+      std::vector<BNode*> nodes;      // the new tree, in order
+      std::vector<BNode*> spares;     // erased nodes, to reuse
+      nodes.reserve(numElements + batch.size());
+
+      BNode* pNode = begin().pNode;
+      update* pBatch = batch.data();
+      size_t i = 0;
+      while (pNode || i < batch.size())
+      {
+         // nothing in the batch for this node: keep it
+         if (i == batch.size() || (pNode && pNode->data < batch[i].value))
+         {
+            nodes.push_back(pNode);
+            pNode = (++iterator(pNode)).pNode;
+            continue;
+         }
+
+         // all the changes to the next value in the batch
+         size_t j = i + 1;
+         while (j < batch.size() && !(batch[i].value < batch[j].value))
+            j++;
+         bool before = pNode && !(batch[i].value < pNode->data);
+         const update* pInsert;
+         bool after = fold(pBatch + i, pBatch + j, before, result, pInsert);
+
+         if (before)
+         {
+            BNode* pThis = pNode;
+            pNode = (++iterator(pNode)).pNode;
+            (after ? nodes : spares).push_back(pThis);
+         }
+         else if (after)
+         {
+            BNode* pNew;
+            if (spares.empty())
+               pNew = new BNode(std::move(pBatch[pInsert - pBatch].value));
+            else
+            {
+               pNew = spares.back();
+               spares.pop_back();
+               pNew->data = std::move(pBatch[pInsert - pBatch].value);
+            }
+            nodes.push_back(pNew);
+         }
+         i = j;
+      }
+
+      for (BNode* pSpare : spares)
+         BNode::destroy(pSpare);
+      numElements = nodes.size();
+      root = BNode::link(nodes.data(), nodes.size(), 0, redDepth(nodes.size()));
+      recache();
    }
 
    /*****************************************************
@@ -378,7 +711,8 @@ namespace custom
          root = new BNode(t);
          root->balance(root);
          numElements++;
-         return { iterator(root), true };
+         pLeftmost = pRightmost = root;
+         return { iterator(root, this), true };
       }
 
       // Go down the tree until you reach a leaf.
@@ -386,7 +720,7 @@ namespace custom
       while (true)
       {
          if (keepUnique && t == current->data)
-            return { iterator(current), false };  // Don't insert duplicates if keepUnique.
+            return { iterator(current, this), false };  // Don't insert duplicates if keepUnique.
 
          if (t < current->data)  // Left subtree
          {
@@ -394,9 +728,11 @@ namespace custom
             {
                BNode* newNode = new BNode(t);
                current->addLeft(newNode);
+               if (current == pLeftmost)
+                  pLeftmost = newNode;
                newNode->balance(root);
                numElements++;
-               return { iterator(newNode), true };
+               return { iterator(newNode, this), true };
             }
             current = current->pLeft;
          }
@@ -406,9 +742,11 @@ namespace custom
             {
                BNode* newNode = new BNode(t);
                current->addRight(newNode);
+               if (current == pRightmost)
+                  pRightmost = newNode;
                newNode->balance(root);
                numElements++;
-               return { iterator(newNode), true };
+               return { iterator(newNode, this), true };
             }
             current = current->pRight;
          }
@@ -424,7 +762,8 @@ namespace custom
          root = new BNode(std::move(t));
          root->balance(root);
          numElements++;
-         return { iterator(root), true };
+         pLeftmost = pRightmost = root;
+         return { iterator(root, this), true };
       }
 
       // Go down the tree until you reach a leaf.
@@ -432,7 +771,7 @@ namespace custom
       while (true)
       {
          if (keepUnique && t == current->data)
-            return { iterator(current), false };  // Don't insert duplicates if keepUnique.
+            return { iterator(current, this), false };  // Don't insert duplicates if keepUnique.
 
          if (t < current->data)  // Left subtree
          {
@@ -440,9 +779,11 @@ namespace custom
             {
                BNode* newNode = new BNode(std::move(t));
                current->addLeft(newNode);
+               if (current == pLeftmost)
+                  pLeftmost = newNode;
                newNode->balance(root);
                numElements++;
-               return { iterator(newNode), true };
+               return { iterator(newNode, this), true };
             }
             current = current->pLeft;
          }
@@ -452,9 +793,11 @@ namespace custom
             {
                BNode* newNode = new BNode(std::move(t));
                current->addRight(newNode);
+               if (current == pRightmost)
+                  pRightmost = newNode;
                newNode->balance(root);
                numElements++;
-               return { iterator(newNode), true };
+               return { iterator(newNode, this), true };
             }
             current = current->pRight;
          }
@@ -475,101 +818,504 @@ namespace custom
       iterator itReturn = it;  // copy assignment operator
       ++itReturn;  // always return the next node
 
-      BNode* pDelete = it.pNode;
+      unlink(it.pNode);
+      return itReturn;
+   }
 
-      // Case 1: No Children
-      if (!pDelete->pLeft && !pDelete->pRight)
+   /*************************************************
+    * BST :: ERASE KEY
+    * Find t and unlink it on the way down, with no
+    * iterator and no successor to hand back. Returns
+    * whether t was there.
+    ************************************************/
+   template <typename T>
+   bool BST<T>::eraseKey(const T& t)
+   {
+      BNode* pNode = root;
+      while (pNode)
       {
-         // Make parent forget about us
-         if (pDelete->pParent && pDelete->isLeftChild(pDelete->pParent))
-            pDelete->pParent->pLeft = nullptr;
-         else if (pDelete->pParent)
-            // Must be right child if has parent and is not left child
-            pDelete->pParent->pRight = nullptr;
-
-         delete pDelete;
-         numElements--;
-         return itReturn;
+         if (t == pNode->data)
+         {
+            unlink(pNode);
+            return true;
+         }
+         pNode = (t < pNode->data) ? pNode->pLeft : pNode->pRight;
       }
+      return false;
+   }
+
+   /*************************************************
+    * BST :: POP FRONT / POP BACK
+    * Remove the smallest or the largest node, found
+    * through the cache with no descent
+    ************************************************/
+   template <typename T>
+   void BST<T>::popFront()
+   {
+      if (!empty())
+         BNode::destroy(unlinkEnd(true /*left*/));
+   }
 
-      // Case 2: One Child - Replace node with child
-      //   Only left child
-      if (!pDelete->pRight && pDelete->pLeft)
+   template <typename T>
+   void BST<T>::popBack()
+   {
+      if (!empty())
+         BNode::destroy(unlinkEnd(false /*left*/));
+   }
+
+   /*************************************************
+    * BST :: TAKE FRONT / TAKE BACK
+    * Remove the smallest or the largest value and hand
+    * it back. The tree must not be empty.
+    ************************************************/
+   template <typename T>
+   T BST<T>::takeFront()
+   {
+      assert(!empty());
+      BNode* pEnd = unlinkEnd(true /*left*/);
+      T t(std::move(pEnd->data));
+      BNode::destroy(pEnd);
+      return t;
+   }
+
+   template <typename T>
+   T BST<T>::takeBack()
+   {
+      assert(!empty());
+      BNode* pEnd = unlinkEnd(false /*left*/);
+      T t(std::move(pEnd->data));
+      BNode::destroy(pEnd);
+      return t;
+   }
+
+   /*************************************************
+    * BST :: UNLINK END
+    * unlink() made for the smallest (left) or largest node.
+    * It has no child on the outside, and on the inside at
+    * most a red leaf, which takes its place and its black.
+    * Only a black leaf needs eraseFixup(), which then works
+    * up the outside spine. Returns the node, not yet freed.
+    ************************************************/
+   template <typename T>
+   typename BST<T>::BNode* BST<T>::unlinkEnd(bool left)
+   {
+      // the cache is not known for a tree built by hand
+      BNode* pEnd = left ? pLeftmost : pRightmost;
+      if (!pEnd)
+         for (pEnd = root; left ? pEnd->pLeft : pEnd->pRight; )
+            pEnd = left ? pEnd->pLeft : pEnd->pRight;
+
+      BNode* pParent = pEnd->pParent;
+      BNode* pInner = left ? pEnd->pRight : pEnd->pLeft;
+      replace(pEnd, pInner);
+
+      // the new end: the inner child, or else the parent
+      BNode* pNewEnd = pInner ? pInner : pParent;
+      while (pNewEnd && (left ? pNewEnd->pLeft : pNewEnd->pRight))
+         pNewEnd = left ? pNewEnd->pLeft : pNewEnd->pRight;
+      (left ? pLeftmost : pRightmost) = pNewEnd;
+      if (!pNewEnd)
+         pLeftmost = pRightmost = nullptr;
+
+      numElements--;
+      if (pInner)
+         pInner->isRed = false;
+      else if (!pEnd->isRed)
+         eraseFixup(nullptr, pParent);
+      if (root)
+         root->isRed = false;
+      return pEnd;
+   }
+
+   /*************************************************
+    * BST :: ERASE IF
+    * Remove every value pred is true of, in one in-order
+    * pass. A few are unlinked one by one; when many go, the
+    * nodes that stay are relinked into a balanced tree, the
+    * way applyBatch() merges. Returns how many were removed.
+    ************************************************/
+   template <typename T>
+   template <class Pred>
+   size_t BST<T>::eraseIf(Pred pred)
+   {
+      std::vector<BNode*> kept;
+      std::vector<BNode*> doomed;
+      kept.reserve(numElements);
+      for (iterator it = begin(); it != end(); ++it)
+         (pred(*it) ? doomed : kept).push_back(it.pNode);
+
+      // unlinking costs about log n, relinking about one per node
+      if (doomed.size() * 8 < numElements)
       {
-         // Hook up child to parent
-         pDelete->pLeft->pParent = pDelete->pParent;
-         // Hook up parent to child: left
-         if (pDelete->pParent && pDelete->isLeftChild(pDelete->pParent))
-            pDelete->pParent->pLeft = pDelete->pLeft;
-         // Hook up parent to child: right
-         else if (pDelete->pParent)
-            pDelete->pParent->pRight = pDelete->pLeft;
+         for (BNode* pDelete : doomed)
+            unlink(pDelete);
+         return doomed.size();
+      }
+
+      for (BNode* pDelete : doomed)
+         BNode::destroy(pDelete);
+      numElements = kept.size();
+      root = BNode::link(kept.data(), kept.size(), 0, redDepth(kept.size()));
+      recache();
+      return doomed.size();
+   }
 
-         delete pDelete;
-         numElements--;
-         return itReturn;
+   /*************************************************
+    * BST :: UNLINK
+    * Take a node out of the tree and free it. A node with two
+    * children trades places with its in-order successor first,
+    * as in erase(). If a black node left the tree, its path is
+    * one black short, and eraseFixup() makes that good.
+    ************************************************/
+   template <typename T>
+   void BST<T>::unlink(BNode* pDelete)
+   {
+      BNode* pX;               // what moves into the hole
+      BNode* pXParent;         // where the hole is
+      bool removedBlack;
+
+      // the ends move in by one
+      if (pDelete == pLeftmost)
+         pLeftmost = (++iterator(pDelete)).pNode;
+      if (pDelete == pRightmost)
+         pRightmost = (--iterator(pDelete)).pNode;
+
+      if (!pDelete->pLeft || !pDelete->pRight)
+      {
+         pX = pDelete->pLeft ? pDelete->pLeft : pDelete->pRight;
+         pXParent = pDelete->pParent;
+         removedBlack = !pDelete->isRed;
+         replace(pDelete, pX);
       }
-      //   Only right child
-      else if (pDelete->pRight && !pDelete->pLeft)
+      else
       {
-         // Hook up child to parent
-         pDelete->pRight->pParent = pDelete->pParent;
-         // Hook up parent to child: left
-         if (pDelete->pParent && pDelete->isLeftChild(pDelete->pParent))
-            pDelete->pParent->pLeft = pDelete->pRight;
-         // hook up parent to child: right
-         else if (pDelete->pParent)
-            pDelete->pParent->pRight = pDelete->pRight;
+         BNode* pNext = pDelete->pRight;
+         while (pNext->pLeft)
+            pNext = pNext->pLeft;
+
+         removedBlack = !pNext->isRed;
+         pX = pNext->pRight;
+         if (pNext->pParent == pDelete)
+            pXParent = pNext;
+         else
+         {
+            pXParent = pNext->pParent;
+            replace(pNext, pX);
+            pNext->addRight(pDelete->pRight);
+         }
+         replace(pDelete, pNext);
+         pNext->addLeft(pDelete->pLeft);
+         pNext->isRed = pDelete->isRed;
+      }
+
+      BNode::destroy(pDelete);
+      numElements--;
+      if (removedBlack)
+         eraseFixup(pX, pXParent);
+      if (root)
+         root->isRed = false;
+   }
 
-         delete pDelete;
-         numElements--;
-         return itReturn;
+   /*************************************************
+    * BST :: REPLACE
+    * Hang pNew wherever pOld hangs
+    ************************************************/
+   template <typename T>
+   void BST<T>::replace(BNode* pOld, BNode* pNew)
+   {
+      BNode* pParent = pOld->pParent;
+      if (!pParent)
+      {
+         root = pNew;
+         if (pNew)
+            pNew->pParent = nullptr;
       }
+      else if (pParent->pLeft == pOld)
+         pParent->addLeft(pNew);
+      else
+         pParent->addRight(pNew);
+   }
+
+   /*************************************************
+    * BST :: ROTATE
+    * Lift a child of pNode, the right one for a left
+    * rotation, into pNode's place
+    ************************************************/
+   template <typename T>
+   void BST<T>::rotate(BNode* pNode, bool left)
+   {
+      BNode* pParent = pNode->pParent;
+      bool wasLeft = pParent && pParent->pLeft == pNode;
+      BNode* pTop = left ? BNode::rotateLeft(pNode) : BNode::rotateRight(pNode);
+      if (!pParent)
+         root = pTop;
+      else if (wasLeft)
+         pParent->addLeft(pTop);
+      else
+         pParent->addRight(pTop);
+   }
 
-      // Case 3: Two Children - Replace node with in-order successor
-      if (pDelete->pLeft && pDelete->pRight)
+   /*************************************************
+    * BST :: ERASE FIXUP
+    * pX (maybe null) under pXParent is one black short.
+    * Recolor, rotate, or carry the shortage up until it is
+    * gone. Trees built by hand need not be true red-black
+    * trees, so a missing sibling just moves the shortage up.
+    ************************************************/
+   template <typename T>
+   void BST<T>::eraseFixup(BNode* pX, BNode* pXParent)
+   {
+      while (pX != root && (!pX || !pX->isRed) && pXParent)
       {
-         // Find in-order successor
-         BNode* pNext = itReturn.pNode;  // itReturn already points to next node in sequence.
+         bool left = (pXParent->pLeft == pX);
+         BNode* pSibling = left ? pXParent->pRight : pXParent->pLeft;
+         if (pSibling && pSibling->isRed)
+         {
+            // a red sibling: rotate it up so the sibling is black
+            pSibling->isRed = false;
+            pXParent->isRed = true;
+            rotate(pXParent, left);
+            pSibling = left ? pXParent->pRight : pXParent->pLeft;
+         }
+         if (!pSibling)
+         {
+            pX = pXParent;
+            pXParent = pX->pParent;
+            continue;
+         }
 
-         // Part A: Copy the pointers from pDelete to pNext
-         pNext->pLeft = pDelete->pLeft;
-         pNext->pLeft->pParent = pNext;
+         BNode* pNear = left ? pSibling->pLeft : pSibling->pRight;
+         BNode* pFar = left ? pSibling->pRight : pSibling->pLeft;
+         if ((!pNear || !pNear->isRed) && (!pFar || !pFar->isRed))
+         {
+            // a black sibling with black children: make it red and go up
+            pSibling->isRed = true;
+            pX = pXParent;
+            pXParent = pX->pParent;
+            continue;
+         }
 
-         // Special case: if pNext is not pDelete's direct right child
-         if (pNext != pDelete->pRight)
+         if (!pFar || !pFar->isRed)
          {
-            // Hook up pNext's right child to pNext's parent if it exists
-            if (pNext->pRight)
-            {
-               pNext->pRight->pParent = pNext->pParent;
-               pNext->pParent->pLeft = pNext->pRight;  // pNext must be a left child
-            }
-            else
-               pNext->pParent->pLeft = nullptr;
+            // the red nephew is on the near side: move it to the far side
+            pNear->isRed = false;
+            pSibling->isRed = true;
+            rotate(pSibling, !left);
+            pSibling = left ? pXParent->pRight : pXParent->pLeft;
+            pFar = left ? pSibling->pRight : pSibling->pLeft;
+         }
+
+         // a red nephew on the far side: one rotation and we are done
+         pSibling->isRed = pXParent->isRed;
+         pXParent->isRed = false;
+         pFar->isRed = false;
+         rotate(pXParent, left);
+         pX = root;
+         break;
+      }
+      if (pX)
+         pX->isRed = false;
+   }
+
+   /*********************************************
+    * BST :: INSERT PARALLEL
+    * Insert a batch using several threads. The tree is split at
+    * the keys of its own top few levels into subtrees that share
+    * nothing; each subtree gets the part of the sorted batch that
+    * falls in its range, on its own task; then the subtrees are
+    * joined back together around the keys they were split at.
+    * Returns how many values were new.
+    ********************************************/
+   template <typename T>
+   template <class Iterator, class Executor>
+   size_t BST<T>::insertParallel(Iterator first, Iterator last, const Executor& executor)
+   {
+      std::vector<T> batch(first, last);
+      std::sort(batch.begin(), batch.end());
+      batch.erase(std::unique(batch.begin(), batch.end(),
+                              [](const T& lhs, const T& rhs) { return !(lhs < rhs); }),
+                  batch.end());
+
+      // the pivots: every key in the levels above the first one
+      // with enough subtrees to keep each thread busy
+      int depth = 0;
+      while (((size_t)1 << depth) < executor.concurrency())
+         depth++;
+      std::vector<T> pivots;
+      BNode::collectTop(root, depth, pivots);
+
+      // cut the tree into one subtree per range
+      std::vector<BNode*> parts;
+      std::vector<BNode*> middles;
+      BNode* pRest = root;
+      for (const T& pivot : pivots)
+      {
+         BNode* pLess;
+         BNode* pMatch;
+         BNode::split(pRest, pivot, pLess, pMatch, pRest);
+         parts.push_back(pLess);
+         middles.push_back(pMatch);
+      }
+      parts.push_back(pRest);
+      root = nullptr;
+
+      // each range inserts its own part of the batch
+      std::vector<size_t> numAdded(parts.size(), 0);
+      std::vector<std::function<void()>> tasks;
+      auto itBegin = batch.begin();
+      for (size_t i = 0; i < parts.size(); i++)
+      {
+         auto itEnd = (i < pivots.size())
+            ? std::lower_bound(itBegin, batch.end(), pivots[i]) : batch.end();
+         tasks.push_back([&parts, &numAdded, i, itBegin, itEnd]()
+         {
+            BST<T> part;
+            part.root = parts[i];
+            for (auto it = itBegin; it != itEnd; ++it)
+               if (part.insert(*it, true /*keepUnique*/).second)
+                  numAdded[i]++;
+            parts[i] = part.root;
+            part.root = nullptr;
+         });
+
+         // a value equal to the pivot is already there
+         itBegin = itEnd;
+         if (i < pivots.size() && itBegin != batch.end() && !(pivots[i] < *itBegin))
+            ++itBegin;
+      }
+      executor.run(tasks);
+
+      // and back together again
+      root = parts[0];
+      for (size_t i = 0; i < middles.size(); i++)
+         root = BNode::join(root, middles[i], parts[i + 1]);
+
+      size_t num = 0;
+      for (size_t added : numAdded)
+         num += added;
+      numElements += num;
+      recache();
+      return num;
+   }
 
-            // Hook up pDelete's right child to pNext
-            pNext->pRight = pDelete->pRight;
-            pNext->pRight->pParent = pNext;
+   /*****************************************************
+    * BST :: ERASE RANGE
+    * Remove [first, last). A short range goes one node at a
+    * time; anything longer is detached whole in O(log n) and
+    * freed in one sweep, unless an end shares its value with
+    * a neighbor. Returns how many were removed.
+    * The node last points to stays, so last stays good.
+    ****************************************************/
+   template <typename T>
+   size_t BST<T>::erase(iterator first, iterator last)
+   {
+      iterator it = first;
+      size_t num = 0;
+      while (it != last && num <= SMALL_RANGE)
+      {
+         ++it;
+         ++num;
+      }
+      if (it == last || !splittable(first, last))
+      {
+         num = 0;
+         while (first != last)
+         {
+            first = erase(first);
+            ++num;
          }
+         return num;
+      }
 
-         // Hook up pNext to pDelete's parent
-         pNext->pParent = pDelete->pParent;
-         if (pDelete->pParent && pDelete->isLeftChild(pDelete->pParent))
-            pDelete->pParent->pLeft = pNext;
-         else if (pDelete->pParent)
-            pDelete->pParent->pRight = pNext;
-         else  // pDelete was the root
-            root = pNext;
+      BNode* pRange = detach(first, last);
+      num = BNode::clear(pRange);
+      numElements -= num;
+      return num;
+   }
+
+   /*****************************************************
+    * BST :: EXTRACT
+    * Move [first, last) out into a tree of its own, in
+    * O(log n) plus a count of what was moved. Letting the
+    * result go out of scope on another thread frees the
+    * nodes in the background. Nodes in the arena keep it
+    * alive for as long as either tree might hold one.
+    * An end that shares its value with a neighbor cannot
+    * be split at, so then the values are moved one by one.
+    ****************************************************/
+   template <typename T>
+   BST<T> BST<T>::extract(iterator first, iterator last)
+   {
+      BST<T> bst;
+      if (first == last)
+         return bst;
 
-         delete pDelete;
-         numElements--;
-         return itReturn;
+      if (!splittable(first, last))
+      {
+         while (first != last)
+         {
+            bst.insert(*first);
+            first = erase(first);
+         }
+         return bst;
       }
 
-      assert(false && "Unreachable");
+      bst.root = detach(first, last);
+      bst.arena = Arena::share(arena);
+      bst.numElements = BNode::count(bst.root);
+      bst.recache();
+      numElements -= bst.numElements;
+      return bst;
+   }
 
-      return itReturn;
+   /*****************************************************
+    * BST :: DETACH
+    * Split out [first, last), join what is left around it
+    * back together, and return the range as a tree of its
+    * own. numElements is left for the caller to fix.
+    ****************************************************/
+   template <typename T>
+   typename BST<T>::BNode* BST<T>::detach(iterator first, iterator last)
+   {
+      assert(first != end() && first != last);
+
+      // splitting moves nodes around but never their data
+      BNode* pLess;
+      BNode* pFirst;
+      BNode* pRange;
+      BNode::split(root, *first, pLess, pFirst, pRange);
+
+      BNode* pLast = nullptr;
+      BNode* pGreater = nullptr;
+      if (last != end())
+         BNode::split(pRange, *last, pRange, pLast, pGreater);
+
+      root = pLast ? BNode::join(pLess, pLast, pGreater) : BNode::join(pLess, pGreater);
+      recache();
+      return BNode::join(nullptr, pFirst, pRange);
+   }
+
+   /*****************************************************
+    * BST :: SPLITTABLE
+    * detach() splits by value, so it can only cut at a node
+    * whose value no neighbor shares. With duplicates on an
+    * end, the split could land on the wrong copy.
+    ****************************************************/
+   template <typename T>
+   bool BST<T>::splittable(iterator first, iterator last) const
+   {
+      for (iterator it : { first, last })
+      {
+         if (it == end())
+            continue;
+         iterator itPrev = it;
+         if (it != begin() && !(*--itPrev < *it))
+            return false;
+         iterator itNext = it;
+         if (++itNext != end() && !(*it < *itNext))
+            return false;
+      }
+      return true;
    }
 
    /*****************************************************
@@ -581,6 +1327,246 @@ namespace custom
    {
       BNode::clear(root);
       numElements = 0;
+      pLeftmost = pRightmost = nullptr;
+      Arena::release(arena);
+   }
+
+   /*****************************************************
+    * BST :: RECACHE
+    * Find the smallest and largest nodes again after the
+    * tree has been rebuilt or cut up
+    ****************************************************/
+   template <typename T>
+   void BST<T>::recache() noexcept
+   {
+      pLeftmost = pRightmost = root;
+      if (!root)
+         return;
+      while (pLeftmost->pLeft)
+         pLeftmost = pLeftmost->pLeft;
+      while (pRightmost->pRight)
+         pRightmost = pRightmost->pRight;
+   }
+
+   /*****************************************************
+    * BST :: OPTIMIZE LAYOUT
+    * Rebuild the tree perfectly balanced in one block of
+    * nodes in van Emde Boas order: the top half of the
+    * levels first, laid out the same way, then each subtree
+    * hanging below them in turn. A path from the root then
+    * crosses O(log_B n) blocks of B nodes, whatever B is:
+    * a cache line, a page, or anything between. The values
+    * move, so every iterator is invalidated. Nodes inserted
+    * afterwards come from the heap as always.
+    ****************************************************/
+   template <typename T>
+   void BST<T>::optimizeLayout()
+   {
+      int height = 0;
+      while (((size_t)1 << height) <= numElements)
+         height++;
+      std::vector<size_t> slots(numElements);
+      size_t next = 0;
+      vebOrder(0, numElements, height, slots, next);
+      relayout(slots);
+   }
+
+   /*****************************************************
+    * BST :: VEB ORDER
+    * Number, from next on, the nodes in the top levels
+    * levels of the balanced subtree over the values
+    * [first, first + num): slots[i] is where the ith
+    * smallest goes. vebBelow() does the subtrees depth
+    * levels down, left to right.
+    ****************************************************/
+   template <typename T>
+   void BST<T>::vebOrder(size_t first, size_t num, int levels,
+                         std::vector<size_t>& slots, size_t& next)
+   {
+      if (num == 0 || levels == 0)
+         return;
+      if (levels == 1)
+      {
+         slots[first + num / 2] = next++;
+         return;
+      }
+      int top = levels / 2;
+      vebOrder(first, num, top, slots, next);
+      vebBelow(first, num, top, levels - top, slots, next);
+   }
+
+   template <typename T>
+   void BST<T>::vebBelow(size_t first, size_t num, int depth, int levels,
+                         std::vector<size_t>& slots, size_t& next)
+   {
+      if (num == 0)
+         return;
+      if (depth == 0)
+      {
+         vebOrder(first, num, levels, slots, next);
+         return;
+      }
+      size_t middle = num / 2;
+      vebBelow(first, middle, depth - 1, levels, slots, next);
+      vebBelow(first + middle + 1, num - middle - 1, depth - 1, levels, slots, next);
+   }
+
+   /*****************************************************
+    * BST :: RELAYOUT
+    * Move the values into a new block of nodes, the ith
+    * smallest into slots[i], and link them as build() would:
+    * the middle at the top, perfectly balanced. The old
+    * nodes are freed, and the old block with them unless an
+    * extracted tree still holds some of it.
+    ****************************************************/
+   template <typename T>
+   void BST<T>::relayout(const std::vector<size_t>& slots)
+   {
+      if (numElements == 0)
+      {
+         Arena::release(arena);
+         return;
+      }
+
+      std::vector<BNode*> nodes;
+      nodes.reserve(numElements);
+      for (iterator it = begin(); it != end(); ++it)
+         nodes.push_back(it.pNode);
+
+      size_t num = nodes.size();
+      Arena* pArena = new Arena(num);
+      pArena->numPlaced = num;
+      for (size_t i = 0; i < num; i++)
+      {
+         BNode* pNode = new (pArena->nodes + slots[i]) BNode(std::move(nodes[i]->data));
+         pNode->inArena = true;
+         BNode::destroy(nodes[i]);
+         nodes[i] = pNode;
+      }
+
+      root = BNode::link(nodes.data(), num, 0, redDepth(num));
+      Arena::release(arena);
+      arena = pArena;
+      recache();
+   }
+
+   /*****************************************************
+    * BST :: COMPACT
+    * Rebuild the tree perfectly balanced in one fresh block
+    * of nodes, in key order for scans or breadth first for
+    * searches, freeing the nodes scattered by churn. The
+    * values move, so every iterator is invalidated.
+    ****************************************************/
+   template <typename T>
+   void BST<T>::compact(node_order order)
+   {
+      std::vector<size_t> slots(numElements);
+      if (order == node_order::IN_ORDER)
+      {
+         for (size_t i = 0; i < numElements; i++)
+            slots[i] = i;
+      }
+      else
+      {
+         // the values under each node, a level at a time: the
+         // nth range taken off the front is the nth node down
+         std::vector<std::pair<size_t, size_t>> ranges;
+         ranges.reserve(numElements);
+         if (numElements)
+            ranges.push_back(std::make_pair((size_t)0, numElements));
+         for (size_t next = 0; next < ranges.size(); next++)
+         {
+            size_t first = ranges[next].first;
+            size_t num = ranges[next].second;
+            size_t middle = num / 2;
+            slots[first + middle] = next;
+            if (middle)
+               ranges.push_back(std::make_pair(first, middle));
+            if (num - middle - 1)
+               ranges.push_back(std::make_pair(first + middle + 1, num - middle - 1));
+         }
+      }
+      relayout(slots);
+   }
+
+   /*****************************************************
+    * BST :: COMPACT STEP
+    * Compact a little at a time: move up to maxNodes more
+    * nodes, in key order, into a block sized for the tree
+    * when the first step began. Each node takes its old
+    * one's place, so the tree keeps its shape and only the
+    * iterators to the nodes moved are invalidated. The
+    * tree can change between steps; what is inserted behind
+    * the last node moved stays where it is. Returns true
+    * when there is nothing more to move, and the old block,
+    * if every node was moved out of it, is then freed.
+    ****************************************************/
+   template <typename T>
+   bool BST<T>::compactStep(size_t maxNodes)
+   {
+      if (empty())
+      {
+         Arena::release(arena);
+         return true;
+      }
+
+      // carry on only with a block no extracted tree shares
+      if (!arena || !arena->isFilling || arena->numRefs > 1)
+      {
+         Arena* pArena = new Arena(numElements);
+         pArena->isFilling = true;
+         pArena->pOlder = arena;
+         arena = pArena;
+      }
+
+      iterator it = begin();
+      if (arena->pResume)
+      {
+         it = lower_bound(*arena->pResume);
+         if (it != end() && !(*arena->pResume < *it))
+            ++it;
+      }
+
+      BNode* pLast = nullptr;
+      for (size_t i = 0; i < maxNodes && it != end() && arena->numPlaced < arena->num; i++)
+      {
+         pLast = relocate(it.pNode, arena->nodes + arena->numPlaced++);
+         it = ++iterator(pLast, this);
+      }
+      if (pLast && arena->pResume)
+         *arena->pResume = pLast->data;
+      else if (pLast)
+         arena->pResume.reset(new T(pLast->data));
+
+      if (it != end() && arena->numPlaced < arena->num)
+         return false;
+      if (it == end())
+         Arena::release(arena->pOlder);
+      arena->isFilling = false;
+      arena->pResume.reset();
+      return true;
+   }
+
+   /*****************************************************
+    * BST :: RELOCATE
+    * Move a node's value into pSlot and put the new node
+    * where the old one was, links, color and all
+    ****************************************************/
+   template <typename T>
+   typename BST<T>::BNode* BST<T>::relocate(BNode* pOld, BNode* pSlot)
+   {
+      BNode* pNew = new (pSlot) BNode(std::move(pOld->data));
+      pNew->inArena = true;
+      pNew->isRed = pOld->isRed;
+      replace(pOld, pNew);
+      pNew->addLeft(pOld->pLeft);
+      pNew->addRight(pOld->pRight);
+      if (pLeftmost == pOld)
+         pLeftmost = pNew;
+      if (pRightmost == pOld)
+         pRightmost = pNew;
+      BNode::destroy(pOld);
+      return pNew;
    }
 
    /*****************************************************
@@ -593,12 +1579,13 @@ namespace custom
       if (empty())
          return end();
 
-      BST<T>::BNode* p = root;
+      // the cache is not known for a tree built by hand
+      BST<T>::BNode* p = pLeftmost ? pLeftmost : root;
 
       while (p->pLeft)
          p = p->pLeft;
 
-      return iterator(p);
+      return iterator(p, this);
    }
 
 
@@ -617,7 +1604,7 @@ namespace custom
       while (p)
       {
          if (t == p->data)
-            return iterator(p);
+            return iterator(p, this);
          else if (t < p->data)
             p = p->pLeft;
          else
@@ -627,6 +1614,95 @@ namespace custom
       return end();
    }
 
+   /****************************************************
+    * BST :: LOWER BOUND
+    * Return the first node that is not less than a given value
+    ****************************************************/
+   template <typename T>
+   typename BST<T>::iterator BST<T>::lower_bound(const T& t) const
+   {
+      BNode* pFound = nullptr;
+      BNode* p = root;
+
+      // remember the last node where we had to go left
+      while (p)
+      {
+         if (p->data < t)
+            p = p->pRight;
+         else
+         {
+            pFound = p;
+            p = p->pLeft;
+         }
+      }
+
+      return iterator(pFound, this);
+   }
+
+   /****************************************************
+    * BST :: FIND MANY
+    * Look up a run of keys, calling found(i, it) for the i-th.
+    * A lone find() waits on one cache miss per level. Here a
+    * handful of descents run side by side: each step prefetches
+    * a lane's next node and moves on to the other lanes, so by the
+    * time we come back the node is (hopefully) in cache. A lane that
+    * finishes picks up the next key right away.
+    ****************************************************/
+   template <typename T>
+   template <class Iterator, class Found>
+   void BST<T>::findMany(Iterator first, Iterator last, Found found) const
+   {
+      // enough lanes to cover the memory latency, few enough to
+      // keep them all in registers and the prefetches in flight
+      const int LANES = 16;
+      struct Lane
+      {
+         const T* pKey;     // what this lane looks for, null when idle
+         size_t   i;        // which key it is
+         BNode*   p;        // where this lane is in the tree
+      };
+      Lane lanes[LANES];
+      int numBusy = 0;
+      size_t i = 0;
+
+      for (int l = 0; l < LANES; l++)
+         lanes[l].pKey = nullptr;
+
+      do
+      {
+         numBusy = 0;
+         for (int l = 0; l < LANES; l++)
+         {
+            Lane& lane = lanes[l];
+
+            // idle lane: start the next key, if any
+            if (!lane.pKey)
+            {
+               if (first == last)
+                  continue;
+               lane.pKey = &*first;
+               lane.i = i++;
+               lane.p = root;
+               ++first;
+            }
+
+            // one step down. The node was prefetched last time around.
+            BNode* p = lane.p;
+            if (!p || *lane.pKey == p->data)
+            {
+               found(lane.i, iterator(p, this));
+               lane.pKey = nullptr;
+               continue;
+            }
+            lane.p = (*lane.pKey < p->data) ? p->pLeft : p->pRight;
+            if (lane.p)
+               prefetch(lane.p);
+            numBusy++;
+         }
+      }
+      while (numBusy || first != last);
+   }
+
    /******************************************************
     ******************************************************
     ******************************************************
@@ -697,6 +1773,274 @@ namespace custom
       }
    }
 
+   /******************************************************
+    * BINARY NODE :: BUILD
+    * Build a balanced subtree out of num sorted values: the
+    * middle one at the top, each half below it
+    ******************************************************/
+   template <typename T>
+   template <class Iterator>
+   typename BST<T>::BNode* BST<T>::BNode::build(Iterator first, size_t num, int depth, int redDepth)
+   {
+      if (num == 0)
+         return nullptr;
+
+      size_t middle = num / 2;
+      BNode* pNode = new BNode(*(first + middle));
+      pNode->isRed = (depth == redDepth);
+      pNode->addLeft(build(first, middle, depth + 1, redDepth));
+      pNode->addRight(build(first + middle + 1, num - middle - 1, depth + 1, redDepth));
+      return pNode;
+   }
+
+   /******************************************************
+    * BINARY NODE :: LINK
+    * Like build, but out of nodes we already have
+    ******************************************************/
+   template <typename T>
+   typename BST<T>::BNode* BST<T>::BNode::link(BNode** nodes, size_t num, int depth, int redDepth)
+   {
+      if (num == 0)
+         return nullptr;
+
+      size_t middle = num / 2;
+      BNode* pNode = nodes[middle];
+      pNode->pParent = nullptr;
+      pNode->isRed = (depth == redDepth);
+      pNode->addLeft(link(nodes, middle, depth + 1, redDepth));
+      pNode->addRight(link(nodes + middle + 1, num - middle - 1, depth + 1, redDepth));
+      return pNode;
+   }
+
+   /******************************************************
+    * BINARY NODE :: COLLECT TOP
+    * The keys of the top depth levels, in order
+    ******************************************************/
+   template <typename T>
+   void BST<T>::BNode::collectTop(const BNode* pNode, int depth, std::vector<T>& keys)
+   {
+      if (!pNode || depth == 0)
+         return;
+      collectTop(pNode->pLeft, depth - 1, keys);
+      keys.push_back(pNode->data);
+      collectTop(pNode->pRight, depth - 1, keys);
+   }
+
+   /******************************************************
+    * BINARY NODE :: BLACK HEIGHT
+    * How many black nodes on the way down to a leaf,
+    * counting this one. Every way down has the same number.
+    ******************************************************/
+   template <typename T>
+   int BST<T>::BNode::blackHeight(const BNode* pNode)
+   {
+      int height = 0;
+      for (; pNode; pNode = pNode->pLeft)
+         if (!pNode->isRed)
+            height++;
+      return height;
+   }
+
+   /******************************************************
+    * BINARY NODE :: ROTATE LEFT / ROTATE RIGHT
+    * Lift a child into its parent's place. Returns the new
+    * top of the subtree, which the caller hangs from wherever
+    * the old top hung.
+    ******************************************************/
+   template <typename T>
+   typename BST<T>::BNode* BST<T>::BNode::rotateLeft(BNode* pNode)
+   {
+      BNode* pTop = pNode->pRight;
+      pNode->addRight(pTop->pLeft);
+      pTop->addLeft(pNode);
+      pTop->pParent = nullptr;
+      return pTop;
+   }
+
+   template <typename T>
+   typename BST<T>::BNode* BST<T>::BNode::rotateRight(BNode* pNode)
+   {
+      BNode* pTop = pNode->pLeft;
+      pNode->addLeft(pTop->pRight);
+      pTop->addRight(pNode);
+      pTop->pParent = nullptr;
+      return pTop;
+   }
+
+   /******************************************************
+    * BINARY NODE :: JOIN RIGHT
+    * pLess is the taller tree. Go down its right side to the
+    * first black node as tall as pGreater, hang the two of them
+    * from pMiddle, colored red, and rotate away any red-red
+    * pair on the way back up.
+    ******************************************************/
+   template <typename T>
+   typename BST<T>::BNode* BST<T>::BNode::joinRight(BNode* pLess, int heightLess, BNode* pMiddle,
+                                                    BNode* pGreater, int heightGreater)
+   {
+      // a tree built by hand may have uneven black heights:
+      // never walk off the bottom
+      if (!pLess || (!pLess->isRed && heightLess <= heightGreater))
+      {
+         pMiddle->isRed = true;
+         pMiddle->addLeft(pLess);
+         pMiddle->addRight(pGreater);
+         return pMiddle;
+      }
+
+      BNode* pSub = joinRight(pLess->pRight, heightLess - (pLess->isRed ? 0 : 1),
+                              pMiddle, pGreater, heightGreater);
+      pLess->addRight(pSub);
+      if (!pLess->isRed && pSub->isRed && pSub->pRight && pSub->pRight->isRed)
+      {
+         pSub->pRight->isRed = false;
+         return rotateLeft(pLess);
+      }
+      return pLess;
+   }
+
+   /******************************************************
+    * BINARY NODE :: JOIN LEFT
+    * The mirror image: pGreater is the taller tree
+    ******************************************************/
+   template <typename T>
+   typename BST<T>::BNode* BST<T>::BNode::joinLeft(BNode* pLess, int heightLess, BNode* pMiddle,
+                                                   BNode* pGreater, int heightGreater)
+   {
+      if (!pGreater || (!pGreater->isRed && heightGreater <= heightLess))
+      {
+         pMiddle->isRed = true;
+         pMiddle->addLeft(pLess);
+         pMiddle->addRight(pGreater);
+         return pMiddle;
+      }
+
+      BNode* pSub = joinLeft(pLess, heightLess, pMiddle,
+                             pGreater->pLeft, heightGreater - (pGreater->isRed ? 0 : 1));
+      pGreater->addLeft(pSub);
+      if (!pGreater->isRed && pSub->isRed && pSub->pLeft && pSub->pLeft->isRed)
+      {
+         pSub->pLeft->isRed = false;
+         return rotateRight(pGreater);
+      }
+      return pGreater;
+   }
+
+   /******************************************************
+    * BINARY NODE :: JOIN
+    * Everything in pLess is smaller than pMiddle, which is
+    * smaller than everything in pGreater. Make one red-black
+    * tree of the three in O(log n), reusing pMiddle's node.
+    ******************************************************/
+   template <typename T>
+   typename BST<T>::BNode* BST<T>::BNode::join(BNode* pLess, BNode* pMiddle, BNode* pGreater)
+   {
+      // a red root can always be made black
+      if (pLess)
+      {
+         pLess->isRed = false;
+         pLess->pParent = nullptr;
+      }
+      if (pGreater)
+      {
+         pGreater->isRed = false;
+         pGreater->pParent = nullptr;
+      }
+
+      int heightLess = blackHeight(pLess);
+      int heightGreater = blackHeight(pGreater);
+      BNode* pRoot;
+      if (heightLess > heightGreater)
+         pRoot = joinRight(pLess, heightLess, pMiddle, pGreater, heightGreater);
+      else if (heightGreater > heightLess)
+         pRoot = joinLeft(pLess, heightLess, pMiddle, pGreater, heightGreater);
+      else
+      {
+         pMiddle->addLeft(pLess);
+         pMiddle->addRight(pGreater);
+         pRoot = pMiddle;
+      }
+
+      pRoot->isRed = false;
+      pRoot->pParent = nullptr;
+      return pRoot;
+   }
+
+   /******************************************************
+    * BINARY NODE :: JOIN without a middle
+    * Everything in pLess is smaller than everything in
+    * pGreater. The smallest node of pGreater is split out
+    * to stand in the middle.
+    ******************************************************/
+   template <typename T>
+   typename BST<T>::BNode* BST<T>::BNode::join(BNode* pLess, BNode* pGreater)
+   {
+      if (!pLess || !pGreater)
+      {
+         BNode* pRoot = pLess ? pLess : pGreater;
+         if (pRoot)
+         {
+            pRoot->isRed = false;
+            pRoot->pParent = nullptr;
+         }
+         return pRoot;
+      }
+
+      BNode* pMin = pGreater;
+      while (pMin->pLeft)
+         pMin = pMin->pLeft;
+      BNode* pNone;
+      BNode* pMiddle;
+      split(pGreater, pMin->data, pNone, pMiddle, pGreater);
+      return join(pLess, pMiddle, pGreater);
+   }
+
+   /******************************************************
+    * BINARY NODE :: SPLIT
+    * Cut a tree in three: the values less than t, the node
+    * holding t (if any), and the values greater than t. Each
+    * node on the way down is joined back onto one side.
+    ******************************************************/
+   template <typename T>
+   void BST<T>::BNode::split(BNode* pTree, const T& t, BNode*& pLess, BNode*& pMatch, BNode*& pGreater)
+   {
+      if (!pTree)
+      {
+         pLess = pMatch = pGreater = nullptr;
+         return;
+      }
+
+      BNode* pLeft = pTree->pLeft;
+      BNode* pRight = pTree->pRight;
+      pTree->pLeft = pTree->pRight = pTree->pParent = nullptr;
+      if (pLeft)
+         pLeft->pParent = nullptr;
+      if (pRight)
+         pRight->pParent = nullptr;
+
+      BNode* pBetween;
+      if (t < pTree->data)
+      {
+         split(pLeft, t, pLess, pMatch, pBetween);
+         pGreater = join(pBetween, pTree, pRight);
+      }
+      else if (pTree->data < t)
+      {
+         split(pRight, t, pBetween, pMatch, pGreater);
+         pLess = join(pLeft, pTree, pBetween);
+      }
+      else
+      {
+         pLess = pLeft;
+         pMatch = pTree;
+         pGreater = pRight;
+         if (pLess)
+            pLess->isRed = false;
+         if (pGreater)
+            pGreater->isRed = false;
+      }
+   }
+
    /******************************************************
     * BINARY NODE :: ADD LEFT
     * Add a node to the left of the current node
@@ -761,21 +2105,45 @@ namespace custom
       addRight(new BNode(std::move(t)));
    }
 
+   /*****************************************************
+   * BINARY NODE :: DESTROY
+   * Free one node. One in an arena is only destroyed; the
+   * arena is freed whole when no tree holds it any more.
+   ****************************************************/
+   template <typename T>
+   void BST<T>::BNode::destroy(BNode* pNode) noexcept
+   {
+      if (pNode->inArena)
+         pNode->~BNode();
+      else
+         delete pNode;
+   }
+
    /*****************************************************
    * BINARY NODE :: CLEAR RECURSIVE
-   * Removes all the BNodes from a tree
+   * Removes all the BNodes from a tree, returning how many
    ****************************************************/
    template <typename T>
-   inline void BST<T>::BNode::clear(BNode*& pNode) noexcept
+   inline size_t BST<T>::BNode::clear(BNode*& pNode) noexcept
    {
       if (!pNode)
-         return;
+         return 0;
 
-      clear(pNode->pLeft);
-      clear(pNode->pRight);
+      size_t num = 1 + clear(pNode->pLeft) + clear(pNode->pRight);
 
-      delete pNode;
+      destroy(pNode);
       pNode = nullptr;
+      return num;
+   }
+
+   /*****************************************************
+   * BINARY NODE :: COUNT
+   * How many BNodes are in a tree
+   ****************************************************/
+   template <typename T>
+   size_t BST<T>::BNode::count(const BNode* pNode) noexcept
+   {
+      return pNode ? 1 + count(pNode->pLeft) + count(pNode->pRight) : 0;
    }
 
 #ifdef DEBUG
@@ -996,6 +2364,7 @@ namespace custom
             pParent->addRight(this->pLeft);
 
             BNode* pParentTemp = pParent;  // Save pointer to parent
+            this->pParent = pGranny->pParent;
             if (!pGranny->pParent)
                this->pParent = nullptr;
             else if (pGranny->isLeftChild(pGranny->pParent))
@@ -1022,6 +2391,7 @@ namespace custom
             pParent->addLeft(this->pRight);
 
             BNode* pParentTemp = pParent;  // Save pointer to parent
+            this->pParent = pGranny->pParent;
             if (!pGranny->pParent)
                this->pParent = nullptr;
             else if (pGranny->isLeftChild(pGranny->pParent))
@@ -1071,14 +2441,21 @@ namespace custom
          return *this;
       }
 
-      // Case 2: No right child and pCurr is parent's left child
+      // Case 2: No right child and no parent: we were the last
+      if (!pNode->pParent)
+      {
+         pNode = nullptr;
+         return *this;
+      }
+
+      // Case 3: No right child and pCurr is parent's left child
       if (!pNode->pRight && pNode->isLeftChild(pNode->pParent))
       {
          pNode = pNode->pParent;
          return *this;
       }
 
-      // Case 3: No right child and pCurr is parent's right child
+      // Case 4: No right child and pCurr is parent's right child
       if (!pNode->pRight && pNode->isRightChild(pNode->pParent))
       {
          while (pNode->pParent && pNode->isRightChild(pNode->pParent))
@@ -1099,9 +2476,17 @@ namespace custom
    template <typename T>
    typename BST<T>::iterator& BST<T>::iterator::operator --()
    {
-      // Don't increment if we're already at the end
+      // From the end, back up to the last node
       if (!pNode)
+      {
+         if (pTree && pTree->root)
+         {
+            pNode = pTree->pRightmost ? pTree->pRightmost : pTree->root;
+            while (pNode->pRight)
+               pNode = pNode->pRight;
+         }
          return *this;
+      }
 
       // Case 1: Have a left child
       if (pNode->pLeft)
@@ -1112,14 +2497,21 @@ namespace custom
          return *this;
       }
 
-      // Case 2: No left child and pCurr is parent's right child
+      // Case 2: No left child and no parent: we were the first
+      if (!pNode->pParent)
+      {
+         pNode = nullptr;
+         return *this;
+      }
+
+      // Case 3: No left child and pCurr is parent's right child
       if (!pNode->pLeft && pNode->isRightChild(pNode->pParent))
       {
          pNode = pNode->pParent;
          return *this;
       }
 
-      // Case 3: No left child and pCurr is parent's left child
+      // Case 4: No left child and pCurr is parent's left child
       if (!pNode->pLeft && pNode->isLeftChild(pNode->pParent))
       {
          while (pNode->pParent && pNode->isLeftChild(pNode->pParent))
@@ -0,0 +1,990 @@
+/***********************************************************************
+ * Header:
+ *    B-Tree Set
+ * Summary:
+ *    A set for when there are too many keys for a binary tree. A
+ *    red-black tree spends a cache miss on every key it compares; a
+ *    B-tree node holds dozens of keys in a few cache lines, so a
+ *    search of a hundred million ints misses five or six times
+ *    instead of thirty.
+ *
+ *    This is a B+ tree: every key lives in a leaf, the inner nodes
+ *    hold copies of keys to steer by, and the leaves are linked in
+ *    order. An iterator is a leaf and an index, and ++ walks along
+ *    the array and then to the next leaf.
+ *
+ *    Building from a range sorts the keys and packs them into full
+ *    leaves, bottom up, without a single split.
+ *
+ *    Within a node, integer keys are searched with vector compares
+ *    (simd_search.h); other keys with a binary search.
+ *
+ *    This will contain the class definition of:
+ *        btree_set                  : A set of keys in B+ tree nodes
+ *        btree_set::iterator        : An iterator through a B-tree set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <iterator>   // for std::bidirectional_iterator_tag
+#include <utility>    // for std::pair
+#include <vector>     // for std::vector
+#include <algorithm>  // for std::sort
+#include <new>        // for placement new
+#include <type_traits> // for std::true_type
+#include <initializer_list>
+#include "simd_search.h"
+
+class TestBTreeSet;    // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * BTREE NODE KEYS
+    * How many keys a node holds by default: four
+    * cache lines of them, but between 16 and 64
+    ***********************************************/
+   template <typename T>
+   struct btree_node_keys
+   {
+      static const int bytes = 256;
+      static const int value = bytes / sizeof(T) < 16 ? 16 :
+                               bytes / sizeof(T) > 64 ? 64 : (int)(bytes / sizeof(T));
+   };
+
+   /************************************************
+    * BTREE SET
+    * A set of unique keys in a B+ tree of nodes
+    * holding up to N keys each
+    ***********************************************/
+   template <typename T, int N = btree_node_keys<T>::value>
+   class btree_set
+   {
+      friend class ::TestBTreeSet; // give unit tests access to the privates
+      static_assert(N >= 4, "a B-tree node needs room for at least four keys");
+   public:
+      // the fewest keys a node other than the root may hold
+      static const int MIN_KEYS = N / 2;
+
+      // deep enough for any tree that fits in memory
+      static const int MAX_DEPTH = 32;
+
+      //
+      // Construct
+      //
+      btree_set() : root(nullptr), pFirst(nullptr), pLast(nullptr), numElements(0)
+      {}
+      btree_set(const btree_set& rhs) : btree_set()
+      {
+         *this = rhs;
+      }
+      btree_set(btree_set&& rhs) : btree_set()
+      {
+         swap(rhs);
+      }
+      btree_set(const std::initializer_list<T>& il) : btree_set()
+      {
+         insert(il.begin(), il.end());
+      }
+      template <class Iterator>
+      btree_set(Iterator first, Iterator last) : btree_set()
+      {
+         insert(first, last);
+      }
+      ~btree_set()
+      {
+         clear();
+      }
+
+      //
+      // Assign
+      //
+      btree_set& operator =(const btree_set& rhs);
+      btree_set& operator =(btree_set&& rhs)
+      {
+         clear();
+         swap(rhs);
+         return *this;
+      }
+      btree_set& operator =(const std::initializer_list<T>& il)
+      {
+         clear();
+         insert(il.begin(), il.end());
+         return *this;
+      }
+      void swap(btree_set& rhs) noexcept
+      {
+         std::swap(root, rhs.root);
+         std::swap(pFirst, rhs.pFirst);
+         std::swap(pLast, rhs.pLast);
+         std::swap(numElements, rhs.numElements);
+      }
+
+      //
+      // Iterator
+      //
+      class iterator;
+      iterator begin() const noexcept { return iterator(pFirst, 0, this); }
+      iterator end()   const noexcept { return iterator(nullptr, 0, this); }
+
+      //
+      // Access
+      //
+      iterator find(const T& t) const;
+      iterator lower_bound(const T& t) const;
+
+      //
+      // Status
+      //
+      bool   empty() const noexcept { return numElements == 0; }
+      size_t size()  const noexcept { return numElements; }
+
+      // heap bytes each element costs, counting the inner nodes and
+      // the empty slots in every node
+      size_t bytes_per_element() const noexcept;
+
+      //
+      // Insert
+      //
+      std::pair<iterator, bool> insert(const T& t)
+      {
+         return insertKey(t);
+      }
+      std::pair<iterator, bool> insert(T&& t)
+      {
+         return insertKey(std::move(t));
+      }
+      void insert(const std::initializer_list<T>& il)
+      {
+         insert(il.begin(), il.end());
+      }
+      template <class Iterator>
+      void insert(Iterator first, Iterator last);
+
+      //
+      // Remove
+      //
+      size_t   erase(const T& t);
+      iterator erase(iterator& it);
+      iterator erase(iterator& itBegin, iterator& itEnd);
+      void     clear() noexcept
+      {
+         destroy(root);
+         root = nullptr;
+         pFirst = pLast = nullptr;
+         numElements = 0;
+      }
+
+   private:
+
+      class Node;
+      class Leaf;
+      class Inner;
+
+      // a root-to-leaf descent: the nodes, and which child was taken
+      struct Path
+      {
+         Node* nodes[MAX_DEPTH];
+         int   index[MAX_DEPTH];
+         int   depth = 0;
+      };
+
+      template <class U>
+      std::pair<iterator, bool> insertKey(U&& t);
+      Leaf* descend(const T& t, Path* pPath) const;
+      void  removeAt(Path& path, int iKey);
+      void  rebalance(Path& path, int level);
+      void  build(std::vector<T>& sorted);
+      static Node* copy(const Node* pSrc, Leaf*& pPrevLeaf);
+      static void  destroy(Node* pNode) noexcept;
+
+      Node*  root;              // the root, a leaf while the set is small
+      Leaf*  pFirst;            // the leaf holding the smallest keys
+      Leaf*  pLast;             // the leaf holding the largest keys
+      size_t numElements;       // number of keys in the set
+   };
+
+
+   /*****************************************************************
+    * BTREE SET NODE
+    * The keys of a node, in order, in uninitialized storage so a T
+    * need not be default-constructible. One spare slot lets a node
+    * overflow before it is split.
+    *****************************************************************/
+   template <typename T, int N>
+   class btree_set<T, N>::Node
+   {
+   public:
+      explicit Node(bool isLeaf) : numKeys(0), isLeaf(isLeaf)
+      {}
+      ~Node()
+      {
+         for (int i = 0; i < numKeys; i++)
+            key(i).~T();
+      }
+
+      T&       key(int i)       { return reinterpret_cast<T*>(buffer)[i]; }
+      const T& key(int i) const { return reinterpret_cast<const T*>(buffer)[i]; }
+
+      //
+      // Search within the node: counting with vector compares for
+      // integer keys, a binary search for anything else
+      //
+      int lowerBound(const T& t) const     // first key not less than t
+      {
+         return lowerBound(t, simd_searchable<T>());
+      }
+      int upperBound(const T& t) const     // first key greater than t
+      {
+         return upperBound(t, simd_searchable<T>());
+      }
+      int lowerBound(const T& t, std::true_type) const
+      {
+         return simdCountBelow(&key(0), numKeys, t);
+      }
+      int upperBound(const T& t, std::true_type) const
+      {
+         return numKeys - simdCountAbove(&key(0), numKeys, t);
+      }
+      int lowerBound(const T& t, std::false_type) const;
+      int upperBound(const T& t, std::false_type) const;
+
+      //
+      // Add and remove keys, shifting the rest
+      //
+      template <class U>
+      void insertKey(int i, U&& t);
+      void eraseKey(int i);
+
+      // move keys [first, numKeys) onto the end of pDest
+      void moveKeys(int first, Node* pDest);
+
+      alignas(T) unsigned char buffer[(N + 1) * sizeof(T)];
+      int  numKeys;            // how many slots of the buffer hold keys
+      bool isLeaf;             // a Leaf, or an Inner with children
+   };
+
+   /*****************************************************************
+    * BTREE SET LEAF
+    * A node at the bottom, linked to its neighbors for iteration
+    *****************************************************************/
+   template <typename T, int N>
+   class btree_set<T, N>::Leaf : public btree_set<T, N>::Node
+   {
+   public:
+      Leaf() : Node(true), pPrev(nullptr), pNext(nullptr)
+      {}
+
+      Leaf* pPrev;             // the leaf with the next smaller keys
+      Leaf* pNext;             // the leaf with the next larger keys
+   };
+
+   /*****************************************************************
+    * BTREE SET INNER
+    * A node above the leaves. Child i holds the keys below key i,
+    * and child i + 1 those not below it.
+    *****************************************************************/
+   template <typename T, int N>
+   class btree_set<T, N>::Inner : public btree_set<T, N>::Node
+   {
+   public:
+      Inner() : Node(false)
+      {}
+
+      Node* children[N + 2];   // numKeys + 1 of them, and a spare
+   };
+
+   /**********************************************************
+    * BTREE SET ITERATOR
+    * A leaf and a slot in it
+    *********************************************************/
+   template <typename T, int N>
+   class btree_set<T, N>::iterator
+   {
+      friend class ::TestBTreeSet; // give unit tests access to the privates
+      friend class custom::btree_set<T, N>;
+   public:
+      // so std::reverse_iterator and the algorithms can use it
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const T*;
+      using reference         = const T&;
+
+      // constructors and assignment
+      iterator() : pLeaf(nullptr), index(0), pTree(nullptr)
+      {}
+      iterator(Leaf* pLeaf, int index, const btree_set* pTree) :
+         pLeaf(pLeaf), index(index), pTree(pTree)
+      {}
+
+      // compare
+      bool operator ==(const iterator& rhs) const
+      {
+         return pLeaf == rhs.pLeaf && index == rhs.index;
+      }
+      bool operator !=(const iterator& rhs) const
+      {
+         return !(*this == rhs);
+      }
+
+      // de-reference. Cannot change because it will invalidate the tree
+      const T& operator *() const
+      {
+         return pLeaf->key(index);
+      }
+
+      // increment and decrement
+      iterator& operator ++()
+      {
+         if (pLeaf && ++index == pLeaf->numKeys)
+         {
+            pLeaf = pLeaf->pNext;
+            index = 0;
+         }
+         return *this;
+      }
+      iterator  operator ++(int postfix)
+      {
+         iterator temp(*this);
+         ++(*this);
+         return temp;
+      }
+      iterator& operator --()
+      {
+         if (pLeaf && index > 0)
+            index--;
+         else
+         {
+            // from the start of a leaf, or from end(), to the leaf before
+            pLeaf = pLeaf ? pLeaf->pPrev : (pTree ? pTree->pLast : nullptr);
+            index = pLeaf ? pLeaf->numKeys - 1 : 0;
+         }
+         return *this;
+      }
+      iterator  operator --(int postfix)
+      {
+         iterator temp(*this);
+         --(*this);
+         return temp;
+      }
+
+   private:
+      Leaf* pLeaf;                  // the leaf we are in, null for end()
+      int index;                    // the slot in the leaf
+      const btree_set* pTree;       // the set we walk, for --end()
+   };
+
+
+   /*********************************************
+    *********************************************
+    **************** BTREE SET ******************
+    *********************************************
+    *********************************************/
+
+   /*********************************************
+    * BTREE SET :: ASSIGN
+    * Copy every node; the leaves are relinked as they are made
+    ********************************************/
+   template <typename T, int N>
+   btree_set<T, N>& btree_set<T, N>::operator =(const btree_set& rhs)
+   {
+      if (this == &rhs)
+         return *this;
+      clear();
+      Leaf* pPrevLeaf = nullptr;
+      root = copy(rhs.root, pPrevLeaf);
+      pLast = pPrevLeaf;
+      Node* p = root;
+      while (p && !p->isLeaf)
+         p = static_cast<Inner*>(p)->children[0];
+      pFirst = static_cast<Leaf*>(p);
+      numElements = rhs.numElements;
+      return *this;
+   }
+
+   /*********************************************
+    * BTREE SET :: DESCEND
+    * Walk down to the leaf that holds t, or would, recording
+    * the path if asked
+    ********************************************/
+   template <typename T, int N>
+   typename btree_set<T, N>::Leaf* btree_set<T, N>::descend(const T& t, Path* pPath) const
+   {
+      Node* p = root;
+      while (!p->isLeaf)
+      {
+         int i = p->upperBound(t);
+         if (pPath)
+         {
+            assert(pPath->depth < MAX_DEPTH - 1);
+            pPath->nodes[pPath->depth] = p;
+            pPath->index[pPath->depth++] = i;
+         }
+         p = static_cast<Inner*>(p)->children[i];
+      }
+      if (pPath)
+         pPath->nodes[pPath->depth++] = p;
+      return static_cast<Leaf*>(p);
+   }
+
+   /*********************************************
+    * BTREE SET :: FIND
+    * Return the element corresponding to a given value
+    ********************************************/
+   template <typename T, int N>
+   typename btree_set<T, N>::iterator btree_set<T, N>::find(const T& t) const
+   {
+      if (!root)
+         return end();
+      Leaf* pLeaf = descend(t, nullptr);
+      int i = pLeaf->lowerBound(t);
+      if (i < pLeaf->numKeys && !(t < pLeaf->key(i)))
+         return iterator(pLeaf, i, this);
+      return end();
+   }
+
+   /*********************************************
+    * BTREE SET :: LOWER BOUND
+    * The first element not less than t. It may be the
+    * first key of the next leaf.
+    ********************************************/
+   template <typename T, int N>
+   typename btree_set<T, N>::iterator btree_set<T, N>::lower_bound(const T& t) const
+   {
+      if (!root)
+         return end();
+      Leaf* pLeaf = descend(t, nullptr);
+      int i = pLeaf->lowerBound(t);
+      if (i < pLeaf->numKeys)
+         return iterator(pLeaf, i, this);
+      return iterator(pLeaf->pNext, 0, this);
+   }
+
+   /*********************************************
+    * BTREE SET :: BYTES PER ELEMENT
+    * Every node's size over the number of keys
+    ********************************************/
+   template <typename T, int N>
+   size_t btree_set<T, N>::bytes_per_element() const noexcept
+   {
+      if (!numElements)
+         return 0;
+      size_t numLeaves = 0;
+      for (Leaf* p = pFirst; p; p = p->pNext)
+         numLeaves++;
+
+      // the inner nodes, a level at a time
+      size_t numInner = 0;
+      std::vector<Node*> level{ root };
+      while (!level[0]->isLeaf)
+      {
+         numInner += level.size();
+         std::vector<Node*> below;
+         for (Node* p : level)
+            for (int i = 0; i <= p->numKeys; i++)
+               below.push_back(static_cast<Inner*>(p)->children[i]);
+         level.swap(below);
+      }
+      return (numLeaves * sizeof(Leaf) + numInner * sizeof(Inner)) / numElements;
+   }
+
+   /*********************************************
+    * BTREE SET :: INSERT KEY
+    * Put t in its leaf. A leaf that overflows splits in
+    * two and hands its parent a key to steer by, which may
+    * overflow the parent in turn.
+    ********************************************/
+   template <typename T, int N>
+   template <class U>
+   std::pair<typename btree_set<T, N>::iterator, bool> btree_set<T, N>::insertKey(U&& t)
+   {
+      if (!root)
+      {
+         root = pFirst = pLast = new Leaf;
+      }
+
+      Path path;
+      Leaf* pLeaf = descend(t, &path);
+      int i = pLeaf->lowerBound(t);
+      if (i < pLeaf->numKeys && !(t < pLeaf->key(i)))
+         return { iterator(pLeaf, i, this), false };
+
+      pLeaf->insertKey(i, std::forward<U>(t));
+      numElements++;
+      if (pLeaf->numKeys <= N)
+         return { iterator(pLeaf, i, this), true };
+
+      // split the leaf, keeping track of where the new key went
+      Leaf* pRight = new Leaf;
+      pLeaf->moveKeys((N + 1) / 2, pRight);
+      pRight->pPrev = pLeaf;
+      pRight->pNext = pLeaf->pNext;
+      if (pLeaf->pNext)
+         pLeaf->pNext->pPrev = pRight;
+      else
+         pLast = pRight;
+      pLeaf->pNext = pRight;
+      iterator it = (i < pLeaf->numKeys) ?
+         iterator(pLeaf, i, this) : iterator(pRight, i - pLeaf->numKeys, this);
+
+      // hang the new right half beside the old, splitting up the path
+      Node* pNew = pRight;
+      T separator(pRight->key(0));
+      for (int level = path.depth - 2; ; level--)
+      {
+         if (level < 0)
+         {
+            Inner* pRoot = new Inner;
+            pRoot->insertKey(0, std::move(separator));
+            pRoot->children[0] = root;
+            pRoot->children[1] = pNew;
+            root = pRoot;
+            break;
+         }
+
+         Inner* pParent = static_cast<Inner*>(path.nodes[level]);
+         int iChild = path.index[level];
+         pParent->insertKey(iChild, std::move(separator));
+         for (int j = pParent->numKeys; j > iChild + 1; j--)
+            pParent->children[j] = pParent->children[j - 1];
+         pParent->children[iChild + 1] = pNew;
+         if (pParent->numKeys <= N)
+            break;
+
+         // the middle key goes up; the keys after it go right
+         Inner* pSplit = new Inner;
+         int middle = (N + 1) / 2;
+         pParent->moveKeys(middle + 1, pSplit);
+         for (int j = 0; j <= pSplit->numKeys; j++)
+            pSplit->children[j] = pParent->children[middle + 1 + j];
+         separator = std::move(pParent->key(middle));
+         pParent->eraseKey(middle);
+         pNew = pSplit;
+      }
+      return { it, true };
+   }
+
+   /*********************************************
+    * BTREE SET :: INSERT RANGE
+    * Into an empty set, sort and pack the leaves bottom up.
+    * Otherwise one at a time.
+    ********************************************/
+   template <typename T, int N>
+   template <class Iterator>
+   void btree_set<T, N>::insert(Iterator first, Iterator last)
+   {
+      if (!empty())
+      {
+         for (; first != last; ++first)
+            insert(*first);
+         return;
+      }
+
+      std::vector<T> sorted(first, last);
+      std::stable_sort(sorted.begin(), sorted.end());
+      sorted.erase(std::unique(sorted.begin(), sorted.end(),
+                               [](const T& lhs, const T& rhs) { return !(lhs < rhs); }),
+                   sorted.end());
+      build(sorted);
+   }
+
+   /*********************************************
+    * BTREE SET :: BUILD
+    * Pack sorted, unique keys into leaves as full as they
+    * can be while every one has at least MIN_KEYS, then
+    * build each level above from the one below
+    ********************************************/
+   template <typename T, int N>
+   void btree_set<T, N>::build(std::vector<T>& sorted)
+   {
+      assert(!root);
+      if (sorted.empty())
+         return;
+
+      // spread num things over as few groups of at most max as will do
+      auto groups = [](size_t num, size_t max) { return (num + max - 1) / max; };
+
+      std::vector<Node*> level;
+      std::vector<const T*> lowest;      // the smallest key under each node
+      size_t numLeaves = groups(sorted.size(), N);
+      for (size_t i = 0, iKey = 0; i < numLeaves; i++)
+      {
+         Leaf* pLeaf = new Leaf;
+         size_t end = sorted.size() * (i + 1) / numLeaves;
+         for (; iKey < end; iKey++)
+            new (&pLeaf->key(pLeaf->numKeys++)) T(std::move(sorted[iKey]));
+         pLeaf->pPrev = pLast;
+         if (pLast)
+            pLast->pNext = pLeaf;
+         else
+            pFirst = pLeaf;
+         pLast = pLeaf;
+         level.push_back(pLeaf);
+         lowest.push_back(&pLeaf->key(0));
+      }
+
+      while (level.size() > 1)
+      {
+         std::vector<Node*> above;
+         std::vector<const T*> aboveLowest;
+         size_t numInner = groups(level.size(), N + 1);
+         for (size_t i = 0, iChild = 0; i < numInner; i++)
+         {
+            Inner* pInner = new Inner;
+            size_t end = level.size() * (i + 1) / numInner;
+            aboveLowest.push_back(lowest[iChild]);
+            pInner->children[0] = level[iChild++];
+            for (; iChild < end; iChild++)
+            {
+               pInner->insertKey(pInner->numKeys, *lowest[iChild]);
+               pInner->children[pInner->numKeys] = level[iChild];
+            }
+            above.push_back(pInner);
+         }
+         level.swap(above);
+         lowest.swap(aboveLowest);
+      }
+
+      root = level[0];
+      numElements = sorted.size();
+   }
+
+   /*********************************************
+    * BTREE SET :: ERASE
+    * Remove the element with a given value, if there
+    ********************************************/
+   template <typename T, int N>
+   size_t btree_set<T, N>::erase(const T& t)
+   {
+      if (!root)
+         return 0;
+      Path path;
+      Leaf* pLeaf = descend(t, &path);
+      int i = pLeaf->lowerBound(t);
+      if (i == pLeaf->numKeys || t < pLeaf->key(i))
+         return 0;
+      removeAt(path, i);
+      return 1;
+   }
+
+   /*********************************************
+    * BTREE SET :: ERASE ITERATOR
+    * Remove the element an iterator refers to and return
+    * an iterator to the element after it. Rebalancing can
+    * move keys between leaves, so the next one is found
+    * again by the value taken out.
+    ********************************************/
+   template <typename T, int N>
+   typename btree_set<T, N>::iterator btree_set<T, N>::erase(iterator& it)
+   {
+      if (it == end())
+         return end();
+
+      T t(std::move(it.pLeaf->key(it.index)));
+      Path path;
+      Leaf* pLeaf = descend(t, &path);
+      assert(pLeaf == it.pLeaf);
+      removeAt(path, it.index);
+      it = end();
+      return lower_bound(t);
+   }
+
+   /*********************************************
+    * BTREE SET :: ERASE RANGE
+    * Remove [itBegin, itEnd)
+    ********************************************/
+   template <typename T, int N>
+   typename btree_set<T, N>::iterator btree_set<T, N>::erase(iterator& itBegin, iterator& itEnd)
+   {
+      if (itEnd == end())
+      {
+         while (itBegin != end())
+            itBegin = erase(itBegin);
+         return itBegin;
+      }
+
+      // the keys move under the end iterator too, so go by value
+      T tEnd(*itEnd);
+      while (itBegin != end() && *itBegin < tEnd)
+         itBegin = erase(itBegin);
+      return itBegin;
+   }
+
+   /*********************************************
+    * BTREE SET :: REMOVE AT
+    * Take key i out of the leaf at the end of the path
+    ********************************************/
+   template <typename T, int N>
+   void btree_set<T, N>::removeAt(Path& path, int iKey)
+   {
+      Leaf* pLeaf = static_cast<Leaf*>(path.nodes[path.depth - 1]);
+      pLeaf->eraseKey(iKey);
+      numElements--;
+      rebalance(path, path.depth - 1);
+   }
+
+   /*********************************************
+    * BTREE SET :: REBALANCE
+    * A node on the path may be below MIN_KEYS. Borrow a key
+    * from a sibling that can spare one, or else merge with a
+    * sibling, which takes a key from the parent and may leave
+    * it short in turn.
+    ********************************************/
+   template <typename T, int N>
+   void btree_set<T, N>::rebalance(Path& path, int level)
+   {
+      for (; level > 0 && path.nodes[level]->numKeys < MIN_KEYS; level--)
+      {
+         Node* pNode = path.nodes[level];
+         Inner* pParent = static_cast<Inner*>(path.nodes[level - 1]);
+         int iChild = path.index[level - 1];
+         Node* pLeft = iChild > 0 ? pParent->children[iChild - 1] : nullptr;
+         Node* pRight = iChild < pParent->numKeys ? pParent->children[iChild + 1] : nullptr;
+
+         if (pLeft && pLeft->numKeys > MIN_KEYS)
+         {
+            // borrow the largest key of the left sibling
+            if (pNode->isLeaf)
+            {
+               pNode->insertKey(0, std::move(pLeft->key(pLeft->numKeys - 1)));
+               pLeft->eraseKey(pLeft->numKeys - 1);
+               pParent->key(iChild - 1) = pNode->key(0);
+            }
+            else
+            {
+               Inner* pInner = static_cast<Inner*>(pNode);
+               Inner* pFrom = static_cast<Inner*>(pLeft);
+               pInner->insertKey(0, std::move(pParent->key(iChild - 1)));
+               for (int j = pInner->numKeys; j > 0; j--)
+                  pInner->children[j] = pInner->children[j - 1];
+               pInner->children[0] = pFrom->children[pFrom->numKeys];
+               pParent->key(iChild - 1) = std::move(pFrom->key(pFrom->numKeys - 1));
+               pFrom->eraseKey(pFrom->numKeys - 1);
+            }
+            return;
+         }
+
+         if (pRight && pRight->numKeys > MIN_KEYS)
+         {
+            // borrow the smallest key of the right sibling
+            if (pNode->isLeaf)
+            {
+               pNode->insertKey(pNode->numKeys, std::move(pRight->key(0)));
+               pRight->eraseKey(0);
+               pParent->key(iChild) = pRight->key(0);
+            }
+            else
+            {
+               Inner* pInner = static_cast<Inner*>(pNode);
+               Inner* pFrom = static_cast<Inner*>(pRight);
+               pInner->insertKey(pInner->numKeys, std::move(pParent->key(iChild)));
+               pInner->children[pInner->numKeys] = pFrom->children[0];
+               pParent->key(iChild) = std::move(pFrom->key(0));
+               pFrom->eraseKey(0);
+               for (int j = 0; j <= pFrom->numKeys; j++)
+                  pFrom->children[j] = pFrom->children[j + 1];
+            }
+            return;
+         }
+
+         // merge the right one of the pair into the left one
+         int iSeparator = pLeft ? iChild - 1 : iChild;
+         Node* pInto = pLeft ? pLeft : pNode;
+         Node* pFrom = pLeft ? pNode : pRight;
+         if (pInto->isLeaf)
+         {
+            Leaf* pLeafFrom = static_cast<Leaf*>(pFrom);
+            Leaf* pLeafInto = static_cast<Leaf*>(pInto);
+            pLeafFrom->moveKeys(0, pLeafInto);
+            pLeafInto->pNext = pLeafFrom->pNext;
+            if (pLeafFrom->pNext)
+               pLeafFrom->pNext->pPrev = pLeafInto;
+            else
+               pLast = pLeafInto;
+            delete pLeafFrom;
+         }
+         else
+         {
+            Inner* pInnerFrom = static_cast<Inner*>(pFrom);
+            Inner* pInnerInto = static_cast<Inner*>(pInto);
+            int iFirst = pInnerInto->numKeys + 1;
+            pInnerInto->insertKey(pInnerInto->numKeys, std::move(pParent->key(iSeparator)));
+            for (int j = 0; j <= pInnerFrom->numKeys; j++)
+               pInnerInto->children[iFirst + j] = pInnerFrom->children[j];
+            pInnerFrom->moveKeys(0, pInnerInto);
+            delete pInnerFrom;
+         }
+         pParent->eraseKey(iSeparator);
+         for (int j = iSeparator + 1; j <= pParent->numKeys; j++)
+            pParent->children[j] = pParent->children[j + 1];
+      }
+
+      // an inner root left with one child hands over to it
+      if (!root->isLeaf && root->numKeys == 0)
+      {
+         Inner* pOld = static_cast<Inner*>(root);
+         root = pOld->children[0];
+         delete pOld;
+      }
+      else if (root->isLeaf && root->numKeys == 0)
+      {
+         delete static_cast<Leaf*>(root);
+         root = nullptr;
+         pFirst = pLast = nullptr;
+      }
+   }
+
+   /*********************************************
+    * BTREE SET :: COPY
+    * Copy a subtree, linking each copied leaf after the
+    * one copied before it
+    ********************************************/
+   template <typename T, int N>
+   typename btree_set<T, N>::Node* btree_set<T, N>::copy(const Node* pSrc, Leaf*& pPrevLeaf)
+   {
+      if (!pSrc)
+         return nullptr;
+      if (pSrc->isLeaf)
+      {
+         Leaf* pLeaf = new Leaf;
+         for (int i = 0; i < pSrc->numKeys; i++)
+            pLeaf->insertKey(i, pSrc->key(i));
+         pLeaf->pPrev = pPrevLeaf;
+         if (pPrevLeaf)
+            pPrevLeaf->pNext = pLeaf;
+         pPrevLeaf = pLeaf;
+         return pLeaf;
+      }
+
+      const Inner* pFrom = static_cast<const Inner*>(pSrc);
+      Inner* pInner = new Inner;
+      for (int i = 0; i < pFrom->numKeys; i++)
+         pInner->insertKey(i, pFrom->key(i));
+      for (int i = 0; i <= pFrom->numKeys; i++)
+         pInner->children[i] = copy(pFrom->children[i], pPrevLeaf);
+      return pInner;
+   }
+
+   /*********************************************
+    * BTREE SET :: DESTROY
+    * Free a subtree
+    ********************************************/
+   template <typename T, int N>
+   void btree_set<T, N>::destroy(Node* pNode) noexcept
+   {
+      if (!pNode)
+         return;
+      if (pNode->isLeaf)
+      {
+         delete static_cast<Leaf*>(pNode);
+         return;
+      }
+      Inner* pInner = static_cast<Inner*>(pNode);
+      for (int i = 0; i <= pInner->numKeys; i++)
+         destroy(pInner->children[i]);
+      delete pInner;
+   }
+
+
+   /*********************************************
+    *********************************************
+    ************** BTREE SET NODE ***************
+    *********************************************
+    *********************************************/
+
+   /******************************************************
+    * BTREE SET NODE :: LOWER BOUND
+    * Binary search for the first key not less than t
+    ******************************************************/
+   template <typename T, int N>
+   int btree_set<T, N>::Node::lowerBound(const T& t, std::false_type) const
+   {
+      int lo = 0;
+      int hi = numKeys;
+      while (lo < hi)
+      {
+         int mid = (lo + hi) / 2;
+         if (key(mid) < t)
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+      return lo;
+   }
+
+   /******************************************************
+    * BTREE SET NODE :: UPPER BOUND
+    * Binary search for the first key greater than t: the
+    * child of an inner node that t belongs under
+    ******************************************************/
+   template <typename T, int N>
+   int btree_set<T, N>::Node::upperBound(const T& t, std::false_type) const
+   {
+      int lo = 0;
+      int hi = numKeys;
+      while (lo < hi)
+      {
+         int mid = (lo + hi) / 2;
+         if (t < key(mid))
+            hi = mid;
+         else
+            lo = mid + 1;
+      }
+      return lo;
+   }
+
+   /******************************************************
+    * BTREE SET NODE :: INSERT KEY
+    * Make room at slot i and put t there
+    ******************************************************/
+   template <typename T, int N>
+   template <class U>
+   void btree_set<T, N>::Node::insertKey(int i, U&& t)
+   {
+      assert(numKeys <= N);
+      if (i == numKeys)
+         new (&key(i)) T(std::forward<U>(t));
+      else
+      {
+         new (&key(numKeys)) T(std::move(key(numKeys - 1)));
+         for (int j = numKeys - 1; j > i; j--)
+            key(j) = std::move(key(j - 1));
+         key(i) = std::forward<U>(t);
+      }
+      numKeys++;
+   }
+
+   /******************************************************
+    * BTREE SET NODE :: ERASE KEY
+    * Close up slot i
+    ******************************************************/
+   template <typename T, int N>
+   void btree_set<T, N>::Node::eraseKey(int i)
+   {
+      for (int j = i; j < numKeys - 1; j++)
+         key(j) = std::move(key(j + 1));
+      key(--numKeys).~T();
+   }
+
+   /******************************************************
+    * BTREE SET NODE :: MOVE KEYS
+    * Move keys [first, numKeys) onto the end of pDest
+    ******************************************************/
+   template <typename T, int N>
+   void btree_set<T, N>::Node::moveKeys(int first, Node* pDest)
+   {
+      for (int i = first; i < numKeys; i++)
+      {
+         new (&pDest->key(pDest->numKeys++)) T(std::move(key(i)));
+         key(i).~T();
+      }
+      numKeys = first;
+   }
+
+} // namespace custom
@@ -0,0 +1,63 @@
+/***********************************************************************
+ * Header:
+ *    Executor
+ * Summary:
+ *    Where the parallel operations run their tasks. An executor says
+ *    how many tasks it can run at once and runs a list of tasks to
+ *    completion. Anything with the same two methods will do, so a
+ *    caller with a thread pool of its own can pass that instead.
+ *
+ *    This will contain the class definition of:
+ *        thread_executor            : Runs tasks on short-lived threads
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <vector>     // for std::vector
+#include <thread>     // for std::thread
+#include <atomic>     // for std::atomic
+#include <functional> // for std::function
+
+namespace custom
+{
+
+   /************************************************
+    * THREAD EXECUTOR
+    * Start up to numThreads threads for each run(),
+    * each taking tasks until none are left
+    ***********************************************/
+   class thread_executor
+   {
+   public:
+      explicit thread_executor(size_t numThreads = std::thread::hardware_concurrency()) :
+         numThreads(numThreads ? numThreads : 1)
+      {}
+
+      // how many tasks run side by side
+      size_t concurrency() const noexcept { return numThreads; }
+
+      // run every task, returning once they are all done
+      void run(std::vector<std::function<void()>>& tasks) const
+      {
+         std::atomic<size_t> next(0);
+         auto work = [&]()
+         {
+            for (size_t i = next++; i < tasks.size(); i = next++)
+               tasks[i]();
+         };
+
+         std::vector<std::thread> threads;
+         for (size_t i = 1; i < numThreads && i < tasks.size(); i++)
+            threads.push_back(std::thread(work));
+         work();   // this thread helps too
+         for (auto& thread : threads)
+            thread.join();
+      }
+
+   private:
+      size_t numThreads;
+   };
+
+} // namespace custom
@@ -0,0 +1,294 @@
+/***********************************************************************
+ * Header:
+ *    Flat Set
+ * Summary:
+ *    A set kept as one sorted array. No node per element, no pointers:
+ *    a search is a binary search over contiguous memory and a scan is
+ *    a walk down an array. Inserting or erasing one element shifts
+ *    everything after it, so this is for sets that are small, or read
+ *    far more than they are written.
+ *
+ *    Many elements at once are cheap: insert(first, last) appends them,
+ *    sorts just the new ones, and merges the two runs in place.
+ *    extract_sequence() and replace() hand the array out and take one
+ *    back without copying.
+ *
+ *    This will contain the class definition of:
+ *        flat_set                   : A set in a sorted array
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <vector>     // for std::vector
+#include <algorithm>  // for std::upper_bound, std::inplace_merge
+#include <functional> // for std::less
+#include <iterator>   // for std::reverse_iterator
+#include <utility>    // for std::pair
+#include <initializer_list>
+
+class TestFlatSet;    // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * FLAT SET
+    * A set of unique values in a sorted Container
+    ***********************************************/
+   template <typename T, typename Compare = std::less<T>, typename Container = std::vector<T>>
+   class flat_set
+   {
+      friend class ::TestFlatSet; // give unit tests access to the privates
+   public:
+      // the elements cannot change in place: that could unsort them
+      using iterator = typename Container::const_iterator;
+      using reverse_iterator = std::reverse_iterator<iterator>;
+
+      //
+      // Construct
+      //
+      flat_set(const Compare& compare = Compare()) : compare(compare)
+      {}
+      flat_set(const flat_set& rhs) = default;
+      flat_set(flat_set&& rhs) : data(std::move(rhs.data)), compare(rhs.compare)
+      {
+         rhs.data.clear();
+      }
+      flat_set(const std::initializer_list<T>& il, const Compare& compare = Compare()) : compare(compare)
+      {
+         insert(il.begin(), il.end());
+      }
+      template <class Iterator>
+      flat_set(Iterator first, Iterator last, const Compare& compare = Compare()) : compare(compare)
+      {
+         insert(first, last);
+      }
+      ~flat_set()
+      {}
+
+      //
+      // Assign
+      //
+      flat_set& operator =(const flat_set& rhs) = default;
+      flat_set& operator =(flat_set&& rhs)
+      {
+         data = std::move(rhs.data);
+         compare = rhs.compare;
+         rhs.data.clear();
+         return *this;
+      }
+      flat_set& operator =(const std::initializer_list<T>& il)
+      {
+         clear();
+         insert(il.begin(), il.end());
+         return *this;
+      }
+      void swap(flat_set& rhs)
+      {
+         std::swap(data, rhs.data);
+         std::swap(compare, rhs.compare);
+      }
+
+      //
+      // Iterator
+      //
+      iterator begin() const noexcept { return data.cbegin(); }
+      iterator end()   const noexcept { return data.cend(); }
+      reverse_iterator rbegin() const noexcept { return reverse_iterator(end()); }
+      reverse_iterator rend()   const noexcept { return reverse_iterator(begin()); }
+
+      //
+      // Access
+      //
+      iterator find(const T& t) const
+      {
+         iterator it = lower_bound(t);
+         return (it != end() && !compare(t, *it)) ? it : end();
+      }
+      iterator lower_bound(const T& t) const;
+      iterator upper_bound(const T& t) const
+      {
+         return std::upper_bound(data.cbegin(), data.cend(), t, compare);
+      }
+      bool contains(const T& t) const
+      {
+         return find(t) != end();
+      }
+
+      //
+      // Status
+      //
+      bool   empty()    const noexcept { return data.empty(); }
+      size_t size()     const noexcept { return data.size(); }
+      size_t capacity() const noexcept { return data.capacity(); }
+
+      // heap bytes each element costs, counting the unused capacity
+      size_t bytes_per_element() const noexcept
+      {
+         return data.empty() ? 0 : data.capacity() * sizeof(T) / data.size();
+      }
+
+      //
+      // Insert
+      //
+      std::pair<iterator, bool> insert(const T& t)
+      {
+         return insertValue(t);
+      }
+      std::pair<iterator, bool> insert(T&& t)
+      {
+         return insertValue(std::move(t));
+      }
+      void insert(const std::initializer_list<T>& il)
+      {
+         insert(il.begin(), il.end());
+      }
+      template <class Iterator>
+      void insert(Iterator first, Iterator last);
+      void reserve(size_t num)
+      {
+         data.reserve(num);
+      }
+
+      //
+      // Remove
+      //
+      size_t erase(const T& t)
+      {
+         iterator it = find(t);
+         if (it == end())
+            return 0;
+         data.erase(it);
+         return 1;
+      }
+      iterator erase(iterator it)
+      {
+         return data.erase(it);
+      }
+      iterator erase(iterator itBegin, iterator itEnd)
+      {
+         return data.erase(itBegin, itEnd);
+      }
+      void clear() noexcept
+      {
+         data.clear();
+      }
+
+      //
+      // The array itself
+      //
+      Container extract_sequence()
+      {
+         Container out(std::move(data));
+         data.clear();
+         return out;
+      }
+      void replace(Container&& sorted);
+
+   private:
+
+      template <class U>
+      std::pair<iterator, bool> insertValue(U&& t);
+      bool isSortedUnique() const;
+
+      Container data;           // the elements, sorted and unique
+      Compare compare;          // the ordering
+   };
+
+
+   /*********************************************
+    * FLAT SET :: LOWER BOUND
+    * Halve the range every step by moving its base
+    * or not. The move is a conditional add rather than
+    * a branch, so a random probe does not mispredict
+    * half of its steps the way std::lower_bound does.
+    ********************************************/
+   template <typename T, typename Compare, typename Container>
+   typename flat_set<T, Compare, Container>::iterator
+      flat_set<T, Compare, Container>::lower_bound(const T& t) const
+   {
+      size_t num = data.size();
+      if (num == 0)
+         return end();
+      iterator itBase = begin();
+      while (num > 1)
+      {
+         size_t half = num / 2;
+         itBase += compare(itBase[half], t) ? half : 0;
+         num -= half;
+      }
+      return itBase + (compare(*itBase, t) ? 1 : 0);
+   }
+
+   /*********************************************
+    * FLAT SET :: INSERT VALUE
+    * Shift everything after t along by one
+    ********************************************/
+   template <typename T, typename Compare, typename Container>
+   template <class U>
+   std::pair<typename flat_set<T, Compare, Container>::iterator, bool>
+      flat_set<T, Compare, Container>::insertValue(U&& t)
+   {
+      iterator it = lower_bound(t);
+      if (it != end() && !compare(t, *it))
+         return { it, false };
+      return { data.insert(it, std::forward<U>(t)), true };
+   }
+
+   /*********************************************
+    * FLAT SET :: INSERT RANGE
+    * Append the lot, sort and deduplicate the new run,
+    * merge it with the old one in place, then drop the
+    * new values that were already there. The old ones
+    * come first in the merge, so they are the ones kept.
+    ********************************************/
+   template <typename T, typename Compare, typename Container>
+   template <class Iterator>
+   void flat_set<T, Compare, Container>::insert(Iterator first, Iterator last)
+   {
+      size_t numOld = data.size();
+      data.insert(data.end(), first, last);
+      auto itMiddle = data.begin() + numOld;
+      if (itMiddle == data.end())
+         return;
+
+      auto equal = [this](const T& lhs, const T& rhs) { return !compare(lhs, rhs); };
+      std::stable_sort(itMiddle, data.end(), compare);
+      data.erase(std::unique(itMiddle, data.end(), equal), data.end());
+      itMiddle = data.begin() + numOld;
+
+      // nothing to merge if the new run sorts entirely after the old
+      if (numOld && !compare(*(itMiddle - 1), *itMiddle))
+         std::inplace_merge(data.begin(), itMiddle, data.end(), compare);
+      data.erase(std::unique(data.begin(), data.end(), equal), data.end());
+   }
+
+   /*********************************************
+    * FLAT SET :: REPLACE
+    * Take over an array that is already sorted and unique
+    ********************************************/
+   template <typename T, typename Compare, typename Container>
+   void flat_set<T, Compare, Container>::replace(Container&& sorted)
+   {
+      data = std::move(sorted);
+      assert(isSortedUnique());
+   }
+
+   /*********************************************
+    * FLAT SET :: IS SORTED UNIQUE
+    * Every element strictly before the next
+    ********************************************/
+   template <typename T, typename Compare, typename Container>
+   bool flat_set<T, Compare, Container>::isSortedUnique() const
+   {
+      for (size_t i = 1; i < data.size(); i++)
+         if (!compare(data[i - 1], data[i]))
+            return false;
+      return true;
+   }
+
+} // namespace custom
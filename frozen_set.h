@@ -0,0 +1,416 @@
+/***********************************************************************
+ * Header:
+ *    Frozen Set
+ * Summary:
+ *    A set built once and then only read. The keys sit in one array
+ *    in Eytzinger order: the root at [1], the children of [k] at [2k]
+ *    and [2k+1], so the tree is breadth first with no pointers at all.
+ *    A search walks down it with k = 2k + (key < t), a step with no
+ *    branch to mispredict. The top levels of the tree share the first
+ *    few cache lines, and the 2^d descendants d levels below a node
+ *    are neighbors, so a search can prefetch a whole level ahead.
+ *
+ *    Built from sorted input, as from a set, it takes O(n): each key
+ *    goes straight to its slot. Anything else is sorted first.
+ *
+ *    This will contain the class definition of:
+ *        frozen_set                 : A read-only set in Eytzinger order
+ *        frozen_set::iterator       : An in-order walk by index arithmetic
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uintptr_t
+#include <new>          // for placement new
+#include <memory>       // for std::unique_ptr
+#include <vector>       // for std::vector
+#include <algorithm>    // for std::sort, std::unique, std::adjacent_find
+#include <functional>   // for std::less
+#include <iterator>     // for std::reverse_iterator
+#include <utility>      // for std::swap
+#include <initializer_list>
+#include "prefetch.h"
+#if defined(_MSC_VER)
+#include <intrin.h>     // for _BitScanForward
+#endif
+
+class TestFrozenSet;    // forward declaration for unit tests
+
+namespace custom
+{
+
+   /*********************************************
+    * COUNT TRAILING ONES
+    * How many low bits of k are set: how many
+    * levels an Eytzinger index climbs to leave the
+    * right subtrees it is at the end of
+    ********************************************/
+   inline int countTrailingOnes(size_t k) noexcept
+   {
+      size_t bits = ~k;
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+      unsigned long i;
+      _BitScanForward64(&i, bits);
+      return (int)i;
+#elif defined(_MSC_VER)
+      unsigned long i;
+      _BitScanForward(&i, (unsigned long)bits);
+      return (int)i;
+#elif defined(__GNUC__) || defined(__clang__)
+      return __builtin_ctzll((unsigned long long)bits);
+#else
+      int i = 0;
+      for (; bits & 1; bits >>= 1)
+         i++;
+      return i;
+#endif
+   }
+
+   /************************************************
+    * FROZEN SET
+    * A set of unique values in a breadth-first array
+    ***********************************************/
+   template <typename T, typename Compare = std::less<T>>
+   class frozen_set
+   {
+      friend class ::TestFrozenSet; // give unit tests access to the privates
+
+      // the array starts on a cache line, so the 2^d keys d levels
+      // below a node fill whole lines once there are enough of them
+      static const size_t LINE = 64;
+      static const size_t PER_LINE = (sizeof(T) < LINE) ? LINE / sizeof(T) : 1;
+   public:
+      //
+      // Construct
+      //
+      frozen_set(const Compare& compare = Compare()) : keys(nullptr), num(0), compare(compare)
+      {}
+      frozen_set(const frozen_set& rhs) : frozen_set(rhs.compare)
+      {
+         copyFrom(rhs);
+      }
+      frozen_set(frozen_set&& rhs) noexcept : frozen_set(rhs.compare)
+      {
+         swap(rhs);
+      }
+      frozen_set(const std::initializer_list<T>& il, const Compare& compare = Compare())
+         : frozen_set(il.begin(), il.end(), compare)
+      {}
+      template <class Iterator>
+      frozen_set(Iterator itBegin, Iterator itEnd, const Compare& compare = Compare());
+      ~frozen_set()
+      {
+         destroy();
+      }
+
+      //
+      // Assign: the only way to change one
+      //
+      frozen_set& operator =(const frozen_set& rhs)
+      {
+         if (this != &rhs)
+         {
+            frozen_set temp(rhs);
+            swap(temp);
+         }
+         return *this;
+      }
+      frozen_set& operator =(frozen_set&& rhs) noexcept
+      {
+         frozen_set temp(std::move(rhs));
+         swap(temp);
+         return *this;
+      }
+      void swap(frozen_set& rhs) noexcept
+      {
+         std::swap(memory, rhs.memory);
+         std::swap(keys, rhs.keys);
+         std::swap(num, rhs.num);
+         std::swap(compare, rhs.compare);
+      }
+
+      //
+      // Iterator
+      //
+      class iterator;
+      using reverse_iterator = std::reverse_iterator<iterator>;
+      iterator begin() const noexcept { return iterator(this, first()); }
+      iterator end()   const noexcept { return iterator(this, 0);       }
+      reverse_iterator rbegin() const noexcept { return reverse_iterator(end());   }
+      reverse_iterator rend()   const noexcept { return reverse_iterator(begin()); }
+
+      //
+      // Access
+      //
+      iterator lower_bound(const T& t) const
+      {
+         return iterator(this, lowerIndex(t));
+      }
+      iterator find(const T& t) const
+      {
+         size_t k = lowerIndex(t);
+         return (k != 0 && !compare(t, keys[k])) ? iterator(this, k) : end();
+      }
+      bool contains(const T& t) const
+      {
+         size_t k = lowerIndex(t);
+         return k != 0 && !compare(t, keys[k]);
+      }
+
+      //
+      // Status
+      //
+      bool   empty() const noexcept { return num == 0; }
+      size_t size()  const noexcept { return num;      }
+
+      // bytes each element costs: the key, and a share of the unused
+      // [0] and the alignment
+      size_t bytes_per_element() const noexcept
+      {
+         return num ? (bytesFor(num) + num - 1) / num : 0;
+      }
+
+   private:
+
+      size_t lowerIndex(const T& t) const;
+      size_t first() const noexcept;
+      size_t last()  const noexcept;
+      size_t next(size_t k) const noexcept;
+      size_t prev(size_t k) const noexcept;
+      void allocate(size_t numKeys);
+      void copyFrom(const frozen_set& rhs);
+      void destroy() noexcept;
+      static size_t bytesFor(size_t numKeys) noexcept
+      {
+         return (numKeys + 1) * sizeof(T) + LINE;
+      }
+
+      std::unique_ptr<unsigned char[]> memory;  // what keys is carved from
+      T* keys;                  // [1..num] in Eytzinger order; [0] is unused
+      size_t num;               // how many keys
+      Compare compare;          // the ordering
+   };
+
+   /**************************************************
+    * FROZEN SET ITERATOR
+    * An index into the array; 0 is the end
+    *************************************************/
+   template <typename T, typename Compare>
+   class frozen_set<T, Compare>::iterator
+   {
+      friend class ::TestFrozenSet;
+      friend class custom::frozen_set<T, Compare>;
+   public:
+      // so std::reverse_iterator and the algorithms can use it
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const T*;
+      using reference         = const T&;
+
+      iterator() noexcept : pSet(nullptr), k(0)
+      {}
+
+      bool operator ==(const iterator& rhs) const noexcept { return k == rhs.k; }
+      bool operator !=(const iterator& rhs) const noexcept { return k != rhs.k; }
+
+      const T& operator *() const noexcept
+      {
+         assert(k != 0);
+         return pSet->keys[k];
+      }
+
+      iterator& operator ++() noexcept
+      {
+         k = pSet->next(k);
+         return *this;
+      }
+      iterator operator ++(int postfix) noexcept
+      {
+         iterator temp(*this);
+         ++*this;
+         return temp;
+      }
+      // back from end() is the largest
+      iterator& operator --() noexcept
+      {
+         k = (k == 0) ? pSet->last() : pSet->prev(k);
+         return *this;
+      }
+      iterator operator --(int postfix) noexcept
+      {
+         iterator temp(*this);
+         --*this;
+         return temp;
+      }
+
+   private:
+      iterator(const frozen_set* pSet, size_t k) noexcept : pSet(pSet), k(k)
+      {}
+
+      const frozen_set* pSet;     // the set whose array this indexes
+      size_t k;                   // the key, or 0 for end()
+   };
+
+
+   /*********************************************
+    * FROZEN SET :: CONSTRUCT
+    * Sort and deduplicate unless the input already
+    * is, then visit the slots in order, each key
+    * going into the next one
+    ********************************************/
+   template <typename T, typename Compare>
+   template <class Iterator>
+   frozen_set<T, Compare>::frozen_set(Iterator itBegin, Iterator itEnd, const Compare& compare)
+      : frozen_set(compare)
+   {
+      std::vector<T> sorted(itBegin, itEnd);
+      auto isOutOfOrder = [&](const T& lhs, const T& rhs) { return !compare(lhs, rhs); };
+      if (std::adjacent_find(sorted.begin(), sorted.end(), isOutOfOrder) != sorted.end())
+      {
+         std::sort(sorted.begin(), sorted.end(), compare);
+         auto isSame = [&](const T& lhs, const T& rhs) { return !compare(lhs, rhs) && !compare(rhs, lhs); };
+         sorted.erase(std::unique(sorted.begin(), sorted.end(), isSame), sorted.end());
+      }
+      if (sorted.empty())
+         return;
+
+      allocate(sorted.size());
+      size_t k = first();
+      for (T& t : sorted)
+      {
+         new (keys + k) T(std::move(t));
+         k = next(k);
+      }
+      assert(k == 0);
+   }
+
+   /*********************************************
+    * FROZEN SET :: LOWER INDEX
+    * Down the tree with no branch: left or right is
+    * the bit the compare gives, and the descendants
+    * a line's worth of levels below are fetched on
+    * the way. Off the bottom, k has recorded every
+    * turn; the last left turn was at the answer, so
+    * shift off the right turns after it and it.
+    ********************************************/
+   template <typename T, typename Compare>
+   size_t frozen_set<T, Compare>::lowerIndex(const T& t) const
+   {
+      size_t k = 1;
+      while (k <= num)
+      {
+         prefetch(keys + (k * PER_LINE < num ? k * PER_LINE : 0));
+         k = 2 * k + (size_t)compare(keys[k], t);
+      }
+      return k >> (countTrailingOnes(k) + 1);
+   }
+
+   /*********************************************
+    * FROZEN SET :: FIRST and LAST
+    * The leftmost and rightmost slots: down the
+    * left or right edge as far as it goes
+    ********************************************/
+   template <typename T, typename Compare>
+   size_t frozen_set<T, Compare>::first() const noexcept
+   {
+      if (num == 0)
+         return 0;
+      size_t k = 1;
+      while (2 * k <= num)
+         k = 2 * k;
+      return k;
+   }
+   template <typename T, typename Compare>
+   size_t frozen_set<T, Compare>::last() const noexcept
+   {
+      if (num == 0)
+         return 0;
+      size_t k = 1;
+      while (2 * k + 1 <= num)
+         k = 2 * k + 1;
+      return k;
+   }
+
+   /*********************************************
+    * FROZEN SET :: NEXT
+    * Into the right subtree and down its left edge,
+    * or, with none, up past every right child to
+    * the parent it is left of: 0 when there is none
+    ********************************************/
+   template <typename T, typename Compare>
+   size_t frozen_set<T, Compare>::next(size_t k) const noexcept
+   {
+      if (2 * k + 1 <= num)
+      {
+         k = 2 * k + 1;
+         while (2 * k <= num)
+            k = 2 * k;
+         return k;
+      }
+      return k >> (countTrailingOnes(k) + 1);
+   }
+
+   /*********************************************
+    * FROZEN SET :: PREV
+    * The mirror of next(): the trailing zeros are
+    * the left children to climb past
+    ********************************************/
+   template <typename T, typename Compare>
+   size_t frozen_set<T, Compare>::prev(size_t k) const noexcept
+   {
+      if (2 * k <= num)
+      {
+         k = 2 * k;
+         while (2 * k + 1 <= num)
+            k = 2 * k + 1;
+         return k;
+      }
+      return k >> (countTrailingOnes(~k) + 1);
+   }
+
+   /*********************************************
+    * FROZEN SET :: ALLOCATE
+    * Room for [0..numKeys], with [0] on a line boundary
+    ********************************************/
+   template <typename T, typename Compare>
+   void frozen_set<T, Compare>::allocate(size_t numKeys)
+   {
+      num = numKeys;
+      memory.reset(new unsigned char[bytesFor(numKeys)]);
+      uintptr_t address = reinterpret_cast<uintptr_t>(memory.get());
+      keys = reinterpret_cast<T*>((address + LINE - 1) / LINE * LINE);
+   }
+
+   /*********************************************
+    * FROZEN SET :: COPY FROM
+    * Into an empty set: slot for slot
+    ********************************************/
+   template <typename T, typename Compare>
+   void frozen_set<T, Compare>::copyFrom(const frozen_set& rhs)
+   {
+      if (rhs.num == 0)
+         return;
+      allocate(rhs.num);
+      for (size_t k = 1; k <= num; k++)
+         new (keys + k) T(rhs.keys[k]);
+   }
+
+   /*********************************************
+    * FROZEN SET :: DESTROY
+    ********************************************/
+   template <typename T, typename Compare>
+   void frozen_set<T, Compare>::destroy() noexcept
+   {
+      for (size_t k = 1; k <= num; k++)
+         keys[k].~T();
+      memory.reset();
+      keys = nullptr;
+      num = 0;
+   }
+
+} // namespace custom
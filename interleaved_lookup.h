@@ -0,0 +1,254 @@
+/***********************************************************************
+ * Header:
+ *    Interleaved Lookup
+ * Summary:
+ *    A batch of searches through one BST, run as coroutines so their
+ *    cache misses overlap. Each search prefetches the next node and
+ *    suspends; a round-robin scheduler resumes the other searches in
+ *    the meantime, and by the time it comes back the node is in cache.
+ *
+ *    Unlike BST::findMany(), the searches in one batch need not be the
+ *    same kind: finds, lower bounds and insert-position searches can
+ *    be mixed freely.
+ *
+ *    Needs C++20 coroutines. Without them this header is empty.
+ *
+ *    This will contain the class definition of:
+ *        interleaved_lookup         : A batch of interleaved BST searches
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine)
+
+#include <cassert>
+#include <coroutine>  // for std::coroutine_handle
+#include <functional> // for std::function
+#include <vector>     // for std::vector
+#include "bst.h"
+#include "prefetch.h"
+
+class TestInterleavedLookup; // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * INTERLEAVED LOOKUP
+    * Queue up searches, then run() them all with
+    * width of them in flight at once
+    ***********************************************/
+   template <typename T>
+   class interleaved_lookup
+   {
+      friend class ::TestInterleavedLookup; // give unit tests access to the privates
+   public:
+      // called with the answer to a search: the node and whether
+      // the key itself was there
+      using callback = std::function<void(typename BST<T>::iterator it, bool found)>;
+
+      //
+      // Construct
+      //
+      interleaved_lookup(const BST<T>& bst, int width = 16) : bst(bst), width(width)
+      {
+         assert(width > 0);
+      }
+
+      //
+      // Queue a search. Nothing happens until run().
+      //
+      void find(const T& t, callback done)
+      {
+         queries.push_back({ FIND, t, std::move(done) });
+      }
+      void lower_bound(const T& t, callback done)
+      {
+         queries.push_back({ LOWER_BOUND, t, std::move(done) });
+      }
+      // where insert() would hang a new node: its parent, or end()
+      // for an empty tree. If t is already there, the node holding it.
+      void insert_position(const T& t, callback done)
+      {
+         queries.push_back({ INSERT_POSITION, t, std::move(done) });
+      }
+
+      //
+      // Run every queued search. Neither the tree nor the batch may
+      // change meanwhile, so do not queue searches from a callback.
+      //
+      void run();
+      size_t size() const noexcept { return queries.size() - next; }
+
+   private:
+
+      enum Kind { FIND, LOWER_BOUND, INSERT_POSITION };
+      struct Query
+      {
+         Kind     kind;
+         T        key;
+         callback done;
+      };
+
+      class Lane;
+      class Prefetch;
+      Lane lane();
+
+      const BST<T>& bst;              // the tree we search
+      int width;                      // how many searches are in flight
+      std::vector<Query> queries;     // the batch
+      size_t next = 0;                // the first query no lane has taken
+   };
+
+   /**********************************************************
+    * INTERLEAVED LOOKUP LANE
+    * A coroutine that keeps taking queries off the batch until
+    * none are left. One frame per lane, not one per query.
+    *********************************************************/
+   template <typename T>
+   class interleaved_lookup<T>::Lane
+   {
+   public:
+      struct promise_type
+      {
+         Lane get_return_object()
+         {
+            return Lane(std::coroutine_handle<promise_type>::from_promise(*this));
+         }
+         std::suspend_always initial_suspend() noexcept { return {}; }
+         std::suspend_always final_suspend()   noexcept { return {}; }
+         void return_void() {}
+         void unhandled_exception() { throw; }
+      };
+
+      Lane(Lane&& rhs) noexcept : handle(rhs.handle)
+      {
+         rhs.handle = nullptr;
+      }
+      Lane(const Lane& rhs) = delete;
+      Lane& operator =(const Lane& rhs) = delete;
+      ~Lane()
+      {
+         if (handle)
+            handle.destroy();
+      }
+
+      // run until the next node is needed; false once the lane is finished
+      bool step()
+      {
+         handle.resume();
+         return !handle.done();
+      }
+
+   private:
+      explicit Lane(std::coroutine_handle<promise_type> handle) : handle(handle)
+      {}
+
+      std::coroutine_handle<promise_type> handle;
+   };
+
+   /**********************************************************
+    * INTERLEAVED LOOKUP PREFETCH
+    * co_await this: start loading the node and let the other
+    * lanes run while it arrives
+    *********************************************************/
+   template <typename T>
+   class interleaved_lookup<T>::Prefetch
+   {
+   public:
+      explicit Prefetch(const void* p) : p(p)
+      {}
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<>) const noexcept { prefetch(p); }
+      void await_resume() const noexcept {}
+
+   private:
+      const void* p;
+   };
+
+
+   /*********************************************
+    * INTERLEAVED LOOKUP :: LANE
+    * One descent per query, suspending before every node
+    * but the root
+    ********************************************/
+   template <typename T>
+   typename interleaved_lookup<T>::Lane interleaved_lookup<T>::lane()
+   {
+      using BNode = typename BST<T>::BNode;
+      while (next < queries.size())
+      {
+         const Query& query = queries[next++];
+         BNode* p = bst.root;
+         BNode* pFound = nullptr;     // the answer so far
+         bool found = false;
+
+         while (p)
+         {
+            BNode* pNext;
+            if (query.kind == LOWER_BOUND)
+            {
+               if (p->data < query.key)
+                  pNext = p->pRight;
+               else
+               {
+                  pFound = p;
+                  pNext = p->pLeft;
+               }
+            }
+            else
+            {
+               if (query.key == p->data)
+               {
+                  pFound = p;
+                  found = true;
+                  break;
+               }
+               pNext = (query.key < p->data) ? p->pLeft : p->pRight;
+               if (query.kind == INSERT_POSITION)
+                  pFound = p;
+            }
+
+            p = pNext;
+            if (p)
+               co_await Prefetch(p);
+         }
+
+         if (query.kind == LOWER_BOUND)
+            found = pFound && !(query.key < pFound->data);
+         query.done(typename BST<T>::iterator(pFound, &bst), found);
+      }
+   }
+
+   /*********************************************
+    * INTERLEAVED LOOKUP :: RUN
+    * Round-robin over the lanes until every one is out of work
+    ********************************************/
+   template <typename T>
+   void interleaved_lookup<T>::run()
+   {
+      std::vector<Lane> lanes;
+      for (int i = 0; i < width; i++)
+         lanes.push_back(lane());
+
+      size_t numLive = lanes.size();
+      std::vector<bool> live(lanes.size(), true);
+      while (numLive)
+      {
+         for (size_t i = 0; i < lanes.size(); i++)
+            if (live[i] && !lanes[i].step())
+            {
+               live[i] = false;
+               numLive--;
+            }
+      }
+
+      queries.clear();
+      next = 0;
+   }
+
+} // namespace custom
+
+#endif // __cpp_impl_coroutine
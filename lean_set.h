@@ -0,0 +1,734 @@
+/***********************************************************************
+ * Header:
+ *    Lean Set
+ * Summary:
+ *    A red-black tree whose nodes have no parent pointer. That makes
+ *    every node 8 bytes smaller than a BST node and saves the parent
+ *    stores on every relink, which matters more than anything else
+ *    for a set too big for the cache.
+ *
+ *    What the parent pointer did is done by a path instead. An
+ *    iterator keeps the path from the root to its node in a fixed-size
+ *    stack, as persistent_set's does. insert() and erase() record the
+ *    path on the way down and rebalance bottom-up along it.
+ *
+ *    The trade: an iterator is a few hundred bytes instead of one
+ *    pointer, and insert() pays a second descent to build the iterator
+ *    it returns.
+ *
+ *    This will contain the class definition of:
+ *        lean_set                   : A set of parent-free nodes
+ *        lean_set::iterator         : An iterator through a lean set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <iterator>   // for std::bidirectional_iterator_tag
+#include <utility>    // for std::pair
+#include <initializer_list>
+
+class TestLeanSet;    // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * LEAN SET
+    * A red-black tree set without parent pointers
+    ***********************************************/
+   template <typename T>
+   class lean_set
+   {
+      friend class ::TestLeanSet; // give unit tests access to the privates
+   public:
+      // a red-black tree of 2^48 nodes is at most 96 deep
+      static const int MAX_DEPTH = 96;
+
+      //
+      // Construct
+      //
+      lean_set() : root(nullptr), numElements(0)
+      {}
+      lean_set(const lean_set& rhs) : root(LNode::copy(rhs.root)), numElements(rhs.numElements)
+      {}
+      lean_set(lean_set&& rhs) : root(rhs.root), numElements(rhs.numElements)
+      {
+         rhs.root = nullptr;
+         rhs.numElements = 0;
+      }
+      lean_set(const std::initializer_list<T>& il) : lean_set()
+      {
+         insert(il);
+      }
+      template <class Iterator>
+      lean_set(Iterator first, Iterator last) : lean_set()
+      {
+         insert(first, last);
+      }
+      ~lean_set()
+      {
+         clear();
+      }
+
+      //
+      // Assign
+      //
+      lean_set& operator =(const lean_set& rhs)
+      {
+         clear();
+         root = LNode::copy(rhs.root);
+         numElements = rhs.numElements;
+         return *this;
+      }
+      lean_set& operator =(lean_set&& rhs)
+      {
+         clear();
+         swap(rhs);
+         return *this;
+      }
+      lean_set& operator =(const std::initializer_list<T>& il)
+      {
+         clear();
+         insert(il);
+         return *this;
+      }
+      void swap(lean_set& rhs) noexcept
+      {
+         std::swap(root, rhs.root);
+         std::swap(numElements, rhs.numElements);
+      }
+
+      //
+      // Iterator
+      //
+      class iterator;
+      iterator begin() const noexcept;
+      iterator end()   const noexcept { return iterator(this); }
+
+      //
+      // Access
+      //
+      iterator find(const T& t) const;
+      iterator lower_bound(const T& t) const;
+
+      //
+      // Status
+      //
+      bool   empty() const noexcept { return numElements == 0; }
+      size_t size()  const noexcept { return numElements; }
+
+      // heap bytes each element costs: one node, with no parent pointer
+      static size_t bytes_per_element() noexcept { return sizeof(LNode); }
+
+      //
+      // Insert
+      //
+      std::pair<iterator, bool> insert(const T& t)
+      {
+         return insertNode(t);
+      }
+      std::pair<iterator, bool> insert(T&& t)
+      {
+         return insertNode(std::move(t));
+      }
+      void insert(const std::initializer_list<T>& il)
+      {
+         for (const T& t : il)
+            insert(t);
+      }
+      template <class Iterator>
+      void insert(Iterator first, Iterator last)
+      {
+         while (first != last)
+         {
+            insert(*first);
+            ++first;
+         }
+      }
+
+      //
+      // Remove
+      //
+      size_t   erase(const T& t);
+      iterator erase(iterator& it);
+      iterator erase(iterator& itBegin, iterator& itEnd);
+      void     clear() noexcept
+      {
+         LNode::clear(root);
+         root = nullptr;
+         numElements = 0;
+      }
+
+   private:
+
+      class LNode;
+      template <class U>
+      std::pair<iterator, bool> insertNode(U&& t);
+      void unlink(LNode** path, int depth);
+      void hook(LNode** path, int i, LNode* pNode);
+
+      LNode* root;              // root node of the red-black tree
+      size_t numElements;       // number of elements in the tree
+   };
+
+
+   /*****************************************************************
+    * LEAN NODE
+    * A node of a red-black tree that knows its children but not its
+    * parent
+    *****************************************************************/
+   template <typename T>
+   class lean_set<T>::LNode
+   {
+   public:
+      //
+      // Construct
+      //
+      LNode(const T& t) : data(t), pLeft(nullptr), pRight(nullptr), isRed(true)
+      {}
+      LNode(T&& t) : data(std::move(t)), pLeft(nullptr), pRight(nullptr), isRed(true)
+      {}
+
+      //
+      // Whole trees
+      //
+      static LNode* copy(const LNode* pSrc);
+      static void   clear(LNode* pNode) noexcept;
+
+      //
+      // Rotate: lift a child into this node's place and return it.
+      // The caller hangs it wherever this node hung.
+      //
+      LNode* rotateLeft()
+      {
+         LNode* pTop = pRight;
+         pRight = pTop->pLeft;
+         pTop->pLeft = this;
+         return pTop;
+      }
+      LNode* rotateRight()
+      {
+         LNode* pTop = pLeft;
+         pLeft = pTop->pRight;
+         pTop->pRight = this;
+         return pTop;
+      }
+
+      static bool isRedNode(const LNode* p) { return p && p->isRed; }
+
+      //
+      // Data
+      //
+      T data;                  // Actual data stored in the node
+      LNode* pLeft;            // Left child - smaller
+      LNode* pRight;           // Right child - larger
+      bool isRed;              // Red-black balancing stuff
+   };
+
+   /**********************************************************
+    * LEAN SET ITERATOR
+    * Forward and reverse iterator through a lean set. Nodes have
+    * no parent pointer, so the iterator remembers the path from
+    * the root in a fixed-size stack.
+    *********************************************************/
+   template <typename T>
+   class lean_set<T>::iterator
+   {
+      friend class ::TestLeanSet; // give unit tests access to the privates
+      friend class custom::lean_set<T>;
+   public:
+      // so std::reverse_iterator and the algorithms can use it
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const T*;
+      using reference         = const T&;
+
+      // constructors and assignment
+      iterator() : pTree(nullptr), depth(0)
+      {}
+      explicit iterator(const lean_set* pTree) : pTree(pTree), depth(0)
+      {}
+
+      // compare
+      bool operator ==(const iterator& rhs) const
+      {
+         return get() == rhs.get();
+      }
+      bool operator !=(const iterator& rhs) const
+      {
+         return get() != rhs.get();
+      }
+
+      // de-reference. Cannot change because it will invalidate the tree
+      const T& operator *() const
+      {
+         return get()->data;
+      }
+
+      // increment and decrement
+      iterator& operator ++();
+      iterator  operator ++(int postfix)
+      {
+         iterator temp(*this);
+         ++(*this);
+         return temp;
+      }
+      iterator& operator --();
+      iterator  operator --(int postfix)
+      {
+         iterator temp(*this);
+         --(*this);
+         return temp;
+      }
+
+   private:
+
+      LNode* get() const { return depth ? path[depth - 1] : nullptr; }
+      void push(LNode* p)
+      {
+         assert(depth < MAX_DEPTH);
+         path[depth++] = p;
+      }
+
+      const lean_set* pTree;         // the set we walk, for --end()
+      int depth;                     // number of nodes on the path, 0 for end()
+      LNode* path[MAX_DEPTH + 1];    // root ... current node, and a spare for unlink()
+   };
+
+
+   /*********************************************
+    *********************************************
+    ***************** LEAN SET ******************
+    *********************************************
+    *********************************************/
+
+   /*********************************************
+    * LEAN SET :: BEGIN
+    * Walk down the left spine, remembering the path
+    ********************************************/
+   template <typename T>
+   typename lean_set<T>::iterator lean_set<T>::begin() const noexcept
+   {
+      iterator it(this);
+      for (LNode* p = root; p; p = p->pLeft)
+         it.push(p);
+      return it;
+   }
+
+   /*********************************************
+    * LEAN SET :: FIND
+    * Return the element corresponding to a given value
+    ********************************************/
+   template <typename T>
+   typename lean_set<T>::iterator lean_set<T>::find(const T& t) const
+   {
+      // one iterator for every return, so it is built in place
+      iterator it(this);
+      for (LNode* p = root; p; p = (t < p->data) ? p->pLeft : p->pRight)
+      {
+         it.push(p);
+         if (t == p->data)
+            return it;
+      }
+      it.depth = 0;
+      return it;
+   }
+
+   /*********************************************
+    * LEAN SET :: LOWER BOUND
+    * The first element not less than t
+    ********************************************/
+   template <typename T>
+   typename lean_set<T>::iterator lean_set<T>::lower_bound(const T& t) const
+   {
+      // the path to the last node where we went left
+      iterator it(this);
+      int depthFound = 0;
+      for (LNode* p = root; p; )
+      {
+         it.push(p);
+         if (p->data < t)
+            p = p->pRight;
+         else
+         {
+            depthFound = it.depth;
+            p = p->pLeft;
+         }
+      }
+      it.depth = depthFound;
+      return it;
+   }
+
+   /*********************************************
+    * LEAN SET :: INSERT NODE
+    * Record the path down to the new leaf, then recolor and
+    * rotate back up along it
+    ********************************************/
+   template <typename T>
+   template <class U>
+   std::pair<typename lean_set<T>::iterator, bool> lean_set<T>::insertNode(U&& t)
+   {
+      LNode* path[MAX_DEPTH];
+      int depth = 0;
+      for (LNode* p = root; p; p = (t < p->data) ? p->pLeft : p->pRight)
+      {
+         if (t == p->data)
+         {
+            iterator it(this);
+            for (int i = 0; i < depth; i++)
+               it.push(path[i]);
+            it.push(p);
+            return { it, false };
+         }
+         assert(depth + 1 < MAX_DEPTH);
+         path[depth++] = p;
+      }
+
+      LNode* pNew = new LNode(std::forward<U>(t));
+      if (!depth)
+         root = pNew;
+      else if (pNew->data < path[depth - 1]->data)
+         path[depth - 1]->pLeft = pNew;
+      else
+         path[depth - 1]->pRight = pNew;
+      path[depth] = pNew;
+      numElements++;
+
+      // path[i] is red; so, maybe, is its parent
+      for (int i = depth; i >= 2 && path[i - 1]->isRed; )
+      {
+         LNode* pParent = path[i - 1];
+         LNode* pGrandparent = path[i - 2];
+         bool parentLeft = (pGrandparent->pLeft == pParent);
+         LNode* pAunt = parentLeft ? pGrandparent->pRight : pGrandparent->pLeft;
+
+         // a red aunt: push the red up two levels and carry on
+         if (LNode::isRedNode(pAunt))
+         {
+            pParent->isRed = false;
+            pAunt->isRed = false;
+            pGrandparent->isRed = true;
+            i -= 2;
+            continue;
+         }
+
+         // a black aunt: at most two rotations and we are done
+         if (parentLeft && pParent->pRight == path[i])
+         {
+            pGrandparent->pLeft = pParent->rotateLeft();
+            pParent = path[i];
+         }
+         else if (!parentLeft && pParent->pLeft == path[i])
+         {
+            pGrandparent->pRight = pParent->rotateRight();
+            pParent = path[i];
+         }
+         pParent->isRed = false;
+         pGrandparent->isRed = true;
+         hook(path, i - 2, parentLeft ? pGrandparent->rotateRight() : pGrandparent->rotateLeft());
+         break;
+      }
+      root->isRed = false;
+
+      // rotations may have moved it, so find the new node again
+      return { find(pNew->data), true };
+   }
+
+   /*********************************************
+    * LEAN SET :: ERASE
+    * Remove the element with a given value, if there
+    ********************************************/
+   template <typename T>
+   size_t lean_set<T>::erase(const T& t)
+   {
+      iterator it = find(t);
+      if (it == end())
+         return 0;
+      unlink(it.path, it.depth);
+      return 1;
+   }
+
+   /*********************************************
+    * LEAN SET :: ERASE ITERATOR
+    * Remove the element an iterator refers to and return
+    * an iterator to the element after it. The iterator
+    * already has the path, so there is no search to unlink.
+    ********************************************/
+   template <typename T>
+   typename lean_set<T>::iterator lean_set<T>::erase(iterator& it)
+   {
+      if (it == end())
+         return end();
+
+      // rebalancing can move the next node, so find it again after
+      iterator itNext = it;
+      ++itNext;
+      LNode* pNext = itNext.get();
+      unlink(it.path, it.depth);
+      it.depth = 0;
+      return pNext ? find(pNext->data) : end();
+   }
+
+   /*********************************************
+    * LEAN SET :: ERASE RANGE
+    * Remove [itBegin, itEnd)
+    ********************************************/
+   template <typename T>
+   typename lean_set<T>::iterator lean_set<T>::erase(iterator& itBegin, iterator& itEnd)
+   {
+      LNode* pEnd = itEnd.get();
+      while (itBegin.get() != pEnd)
+         itBegin = erase(itBegin);
+      return itBegin;
+   }
+
+   /*********************************************
+    * LEAN SET :: HOOK
+    * Hang pNode where path[i] hangs
+    ********************************************/
+   template <typename T>
+   void lean_set<T>::hook(LNode** path, int i, LNode* pNode)
+   {
+      if (i == 0)
+         root = pNode;
+      else if (path[i - 1]->pLeft == path[i])
+         path[i - 1]->pLeft = pNode;
+      else
+         path[i - 1]->pRight = pNode;
+   }
+
+   /*********************************************
+    * LEAN SET :: UNLINK
+    * Take path[depth - 1] out of the tree and free it. A node
+    * with two children trades places with its in-order
+    * successor first, so no value ever moves. If a black node
+    * left the tree, the path is one black short: recolor,
+    * rotate, or carry the shortage up until it is gone.
+    * The path is used as scratch space.
+    ********************************************/
+   template <typename T>
+   void lean_set<T>::unlink(LNode** path, int depth)
+   {
+      int iDelete = depth - 1;
+      LNode* pDelete = path[iDelete];
+      LNode* pX;                  // what moves into the hole
+      int iX;                     // where the hole is on the path
+      bool removedBlack;
+
+      if (!pDelete->pLeft || !pDelete->pRight)
+      {
+         pX = pDelete->pLeft ? pDelete->pLeft : pDelete->pRight;
+         removedBlack = !pDelete->isRed;
+         hook(path, iDelete, pX);
+         iX = iDelete;
+      }
+      else
+      {
+         // the successor: right once, then left all the way down
+         int iNext = iDelete + 1;
+         path[iNext] = pDelete->pRight;
+         while (path[iNext]->pLeft)
+         {
+            assert(iNext + 2 < MAX_DEPTH);   // room for one rotation below
+            path[iNext + 1] = path[iNext]->pLeft;
+            iNext++;
+         }
+         LNode* pNext = path[iNext];
+         removedBlack = !pNext->isRed;
+         pX = pNext->pRight;
+
+         // lift the successor's right child into its place
+         hook(path, iNext, pX);
+
+         // and the successor into the deleted node's place
+         hook(path, iDelete, pNext);
+         pNext->pLeft = pDelete->pLeft;
+         pNext->pRight = (iNext == iDelete + 1) ? pX : pDelete->pRight;
+         pNext->isRed = pDelete->isRed;
+         path[iDelete] = pNext;
+         iX = iNext;
+      }
+
+      delete pDelete;
+      numElements--;
+
+      // pX, at path[iX], is one black short
+      path[iX] = pX;
+      while (removedBlack && iX > 0 && !LNode::isRedNode(pX))
+      {
+         LNode* pParent = path[iX - 1];
+         bool left = (pParent->pLeft == pX);
+         LNode* pSibling = left ? pParent->pRight : pParent->pLeft;
+         if (LNode::isRedNode(pSibling))
+         {
+            // a red sibling: rotate it up so the sibling is black
+            pSibling->isRed = false;
+            pParent->isRed = true;
+            hook(path, iX - 1, left ? pParent->rotateLeft() : pParent->rotateRight());
+            path[iX - 1] = pSibling;
+            path[iX] = pParent;
+            path[++iX] = pX;
+            pSibling = left ? pParent->pRight : pParent->pLeft;
+         }
+         if (!pSibling)
+         {
+            // only in a tree that was not a true red-black tree
+            pX = pParent;
+            path[--iX] = pX;
+            continue;
+         }
+
+         LNode* pNear = left ? pSibling->pLeft : pSibling->pRight;
+         LNode* pFar = left ? pSibling->pRight : pSibling->pLeft;
+         if (!LNode::isRedNode(pNear) && !LNode::isRedNode(pFar))
+         {
+            // a black sibling with black children: make it red and go up
+            pSibling->isRed = true;
+            pX = pParent;
+            iX--;
+            continue;
+         }
+
+         if (!LNode::isRedNode(pFar))
+         {
+            // the red nephew is on the near side: move it to the far side
+            pNear->isRed = false;
+            pSibling->isRed = true;
+            if (left)
+               pParent->pRight = pSibling->rotateRight();
+            else
+               pParent->pLeft = pSibling->rotateLeft();
+            pSibling = pNear;
+            pFar = left ? pSibling->pRight : pSibling->pLeft;
+         }
+
+         // a red nephew on the far side: one rotation and we are done
+         pSibling->isRed = pParent->isRed;
+         pParent->isRed = false;
+         pFar->isRed = false;
+         hook(path, iX - 1, left ? pParent->rotateLeft() : pParent->rotateRight());
+         pX = root;
+         break;
+      }
+      if (pX)
+         pX->isRed = false;
+      if (root)
+         root->isRed = false;
+   }
+
+
+   /*********************************************
+    *********************************************
+    ***************** LEAN NODE *****************
+    *********************************************
+    *********************************************/
+
+   /******************************************************
+    * LEAN NODE :: COPY
+    * Copy a whole tree, colors and all
+    ******************************************************/
+   template <typename T>
+   typename lean_set<T>::LNode* lean_set<T>::LNode::copy(const LNode* pSrc)
+   {
+      if (!pSrc)
+         return nullptr;
+      LNode* pNode = new LNode(pSrc->data);
+      pNode->isRed = pSrc->isRed;
+      pNode->pLeft = copy(pSrc->pLeft);
+      pNode->pRight = copy(pSrc->pRight);
+      return pNode;
+   }
+
+   /******************************************************
+    * LEAN NODE :: CLEAR
+    * Free a whole tree
+    ******************************************************/
+   template <typename T>
+   void lean_set<T>::LNode::clear(LNode* pNode) noexcept
+   {
+      if (!pNode)
+         return;
+      clear(pNode->pLeft);
+      clear(pNode->pRight);
+      delete pNode;
+   }
+
+
+   /*************************************************
+    *************************************************
+    *************************************************
+    ****************** ITERATOR *********************
+    *************************************************
+    *************************************************
+    *************************************************/
+
+   /**************************************************
+    * LEAN SET ITERATOR :: INCREMENT PREFIX
+    * advance by one
+    *************************************************/
+   template <typename T>
+   typename lean_set<T>::iterator& lean_set<T>::iterator::operator ++()
+   {
+      // Don't increment if we're already at the end
+      if (!depth)
+         return *this;
+
+      // Case 1: Have a right child. Go right then all the way left
+      LNode* p = get();
+      if (p->pRight)
+      {
+         for (p = p->pRight; p; p = p->pLeft)
+            push(p);
+         return *this;
+      }
+
+      // Case 2: Climb until we come up from a left child
+      LNode* pChild;
+      do
+      {
+         pChild = path[--depth];
+      }
+      while (depth && path[depth - 1]->pRight == pChild);
+      return *this;
+   }
+
+   /**************************************************
+    * LEAN SET ITERATOR :: DECREMENT PREFIX
+    * back up by one. Decrementing end() lands on the last element
+    *************************************************/
+   template <typename T>
+   typename lean_set<T>::iterator& lean_set<T>::iterator::operator --()
+   {
+      // Case 1: at the end. Go all the way right
+      if (!depth)
+      {
+         for (LNode* p = pTree ? pTree->root : nullptr; p; p = p->pRight)
+            push(p);
+         return *this;
+      }
+
+      // Case 2: Have a left child. Go left then all the way right
+      LNode* p = get();
+      if (p->pLeft)
+      {
+         for (p = p->pLeft; p; p = p->pRight)
+            push(p);
+         return *this;
+      }
+
+      // Case 3: Climb until we come up from a right child
+      LNode* pChild;
+      do
+      {
+         pChild = path[--depth];
+      }
+      while (depth && path[depth - 1]->pLeft == pChild);
+      return *this;
+   }
+
+} // namespace custom
@@ -0,0 +1,908 @@
+/***********************************************************************
+ * Header:
+ *    Persistent Set
+ * Summary:
+ *    An immutable, path-copying red-black tree. Every version of the
+ *    set stays valid forever: an update copies only the nodes on the
+ *    root-to-leaf path it touches and shares everything else with the
+ *    previous version, so taking a snapshot is just bumping a reference
+ *    count on the root.
+ *
+ *    Copies are copy-on-write: a node owned by exactly one version is
+ *    updated in place, so a set that has never been copied pays nothing
+ *    for persistence and a copy is only separated, one path at a time,
+ *    as it is mutated. Reference counts are atomic so copies may live
+ *    on different threads.
+ *
+ *    This will contain the class definition of:
+ *        persistent_set             : A set with O(1) snapshots
+ *        persistent_set::iterator   : An iterator through a persistent set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <atomic>     // for std::atomic
+#include <utility>    // for std::pair
+#include <cstddef>    // for size_t
+
+class TestPersistentSet; // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * PERSISTENT SET
+    * A set where every version is immutable and shares
+    * structure with the versions around it
+    ***********************************************/
+   template <typename T>
+   class persistent_set
+   {
+      friend class ::TestPersistentSet; // give unit tests access to the privates
+   public:
+
+      //
+      // Construct
+      //
+      persistent_set() : root(nullptr), numElements(0)
+      {}
+      persistent_set(const persistent_set& rhs) : root(PNode::acquire(rhs.root)), numElements(rhs.numElements)
+      {}
+      persistent_set(persistent_set&& rhs) : root(rhs.root), numElements(rhs.numElements)
+      {
+         rhs.root = nullptr;
+         rhs.numElements = 0;
+      }
+      persistent_set(const std::initializer_list<T>& il) : persistent_set()
+      {
+         insert(il);
+      }
+      template <class Iterator>
+      persistent_set(Iterator first, Iterator last) : persistent_set()
+      {
+         insert(first, last);
+      }
+      ~persistent_set()
+      {
+         clear();
+      }
+
+      //
+      // Assign
+      //
+      persistent_set& operator =(const persistent_set& rhs);
+      persistent_set& operator =(persistent_set&& rhs);
+      persistent_set& operator =(const std::initializer_list<T>& il)
+      {
+         clear();
+         insert(il);
+         return *this;
+      }
+      void swap(persistent_set& rhs) noexcept
+      {
+         std::swap(root, rhs.root);
+         std::swap(numElements, rhs.numElements);
+      }
+
+      //
+      // Snapshot: an O(1) frozen copy of the current version
+      //
+      persistent_set snapshot() const
+      {
+         return persistent_set(*this);
+      }
+
+      //
+      // Iterator
+      //
+      class iterator;
+      iterator begin() const noexcept;
+      iterator end()   const noexcept;
+
+      //
+      // Access
+      //
+      iterator find(const T& t) const;
+
+      //
+      // Status
+      //
+      bool   empty() const noexcept { return numElements == 0; }
+      size_t size()  const noexcept { return numElements; }
+
+      //
+      // Insert
+      //
+      std::pair<iterator, bool> insert(const T& t);
+      std::pair<iterator, bool> insert(T&& t);
+      void insert(const std::initializer_list<T>& il)
+      {
+         for (const T& t : il)
+            insert(t);
+      }
+      template <class Iterator>
+      void insert(Iterator first, Iterator last)
+      {
+         while (first != last)
+         {
+            insert(*first);
+            ++first;
+         }
+      }
+
+      //
+      // Remove
+      //
+      size_t   erase(const T& t);
+      iterator erase(iterator& it);
+      iterator erase(iterator& itBegin, iterator& itEnd);
+      void     clear() noexcept
+      {
+         PNode::release(root);
+         root = nullptr;
+         numElements = 0;
+      }
+
+   private:
+
+      iterator upperBound(const T& t) const;
+
+      class PNode;
+      PNode* root;              // root of this version of the tree
+      size_t numElements;       // number of elements in this version
+   };
+
+
+   /*****************************************************************
+    * PERSISTENT NODE
+    * A reference-counted node of a persistent red-black tree. Once a
+    * node is reachable from more than one version it is never changed,
+    * so there is no parent pointer: a node may have many parents.
+    *
+    * Ownership convention: every function that takes a PNode* by value
+    * consumes one reference to it, and every PNode* returned carries
+    * one reference that the caller now owns. A node whose only reference
+    * is the one being consumed is unique: nobody else can see it, so it
+    * is recycled in place instead of copied.
+    *****************************************************************/
+   template <typename T>
+   class persistent_set<T>::PNode
+   {
+   public:
+      //
+      // Construct: adopt one reference to each child
+      //
+      PNode(const T& t, bool isRed, PNode* pLeft, PNode* pRight) :
+         data(t), pLeft(pLeft), pRight(pRight), isRed(isRed), refs(1)
+      {}
+      PNode(T&& t, bool isRed, PNode* pLeft, PNode* pRight) :
+         data(std::move(t)), pLeft(pLeft), pRight(pRight), isRed(isRed), refs(1)
+      {}
+
+      //
+      // Reference counting
+      //
+      static PNode* acquire(PNode* p) noexcept;
+      static void   release(PNode* p) noexcept;
+      bool isUnique() const { return refs.load(std::memory_order_acquire) == 1; }
+
+      //
+      // Path copying: take a child reference out of an owned node and
+      // rebuild an owned node with new children and a new color
+      //
+      static PNode* takeLeft (PNode* p) { return take(p, p->pLeft);  }
+      static PNode* takeRight(PNode* p) { return take(p, p->pRight); }
+      static PNode* take(PNode* p, PNode*& pChild);
+      static PNode* remake(PNode* p, bool isRed, PNode* pLeft, PNode* pRight);
+      static PNode* recolor(PNode* p, bool isRed)
+      {
+         return remake(p, isRed, takeLeft(p), takeRight(p));
+      }
+
+      //
+      // Status
+      //
+      static bool isRedNode  (const PNode* p) { return p && p->isRed;  }
+      static bool isBlackNode(const PNode* p) { return p && !p->isRed; }
+
+      //
+      // Red-black algorithms on owned subtrees
+      //
+      template <class U>
+      static PNode* insert(PNode* p, U&& t, const PNode*& pNew);
+      static PNode* erase(PNode* p, const T& t);
+      static PNode* balance(PNode* pLeft, PNode* p, PNode* pRight);
+      static PNode* balanceLeft(PNode* pLeft, PNode* p, PNode* pRight);
+      static PNode* balanceRight(PNode* pLeft, PNode* p, PNode* pRight);
+      static PNode* append(PNode* pLeft, PNode* pRight);
+
+      //
+      // Data
+      //
+      T data;                      // the value, never changed once shared
+      PNode* pLeft;                // Left child - smaller
+      PNode* pRight;               // Right child - larger
+      bool isRed;                  // Red-black balancing stuff
+      std::atomic<size_t> refs;    // number of parents and versions pointing here
+   };
+
+   /**********************************************************
+    * PERSISTENT SET ITERATOR
+    * Forward and reverse iterator through one version of a
+    * persistent set. Nodes have no parent pointer, so the iterator
+    * remembers the path from the root in a fixed-size stack.
+    *********************************************************/
+   template <typename T>
+   class persistent_set<T>::iterator
+   {
+      friend class ::TestPersistentSet; // give unit tests access to the privates
+      friend class custom::persistent_set<T>;
+   public:
+      // a red-black tree of 2^48 nodes is at most 96 deep
+      static const int MAX_DEPTH = 96;
+
+      // constructors and assignment
+      iterator() : pRoot(nullptr), depth(0)
+      {}
+      iterator(const PNode* pRoot) : pRoot(pRoot), depth(0)
+      {}
+
+      // compare
+      bool operator ==(const iterator& rhs) const
+      {
+         return get() == rhs.get();
+      }
+      bool operator !=(const iterator& rhs) const
+      {
+         return get() != rhs.get();
+      }
+
+      // de-reference. Cannot change because it will invalidate the tree
+      const T& operator *() const
+      {
+         return get()->data;
+      }
+
+      // increment and decrement
+      iterator& operator ++();
+      iterator  operator ++(int postfix)
+      {
+         iterator temp(*this);
+         ++(*this);
+         return temp;
+      }
+      iterator& operator --();
+      iterator  operator --(int postfix)
+      {
+         iterator temp(*this);
+         --(*this);
+         return temp;
+      }
+
+   private:
+
+      const PNode* get() const { return depth ? path[depth - 1] : nullptr; }
+      void push(const PNode* p)
+      {
+         assert(depth < MAX_DEPTH);
+         path[depth++] = p;
+      }
+
+      const PNode* pRoot;            // root of the version we walk
+      int depth;                     // number of nodes on the path, 0 for end()
+      const PNode* path[MAX_DEPTH];  // root ... current node
+   };
+
+
+   /*********************************************
+    *********************************************
+    *************** PERSISTENT SET **************
+    *********************************************
+    *********************************************/
+
+   /*********************************************
+    * PERSISTENT SET :: ASSIGNMENT OPERATOR
+    * Share the other version's tree
+    ********************************************/
+   template <typename T>
+   persistent_set<T>& persistent_set<T>::operator =(const persistent_set<T>& rhs)
+   {
+      PNode* pOld = root;
+      root = PNode::acquire(rhs.root);
+      numElements = rhs.numElements;
+      PNode::release(pOld);
+      return *this;
+   }
+
+   /*********************************************
+    * PERSISTENT SET :: ASSIGN-MOVE OPERATOR
+    ********************************************/
+   template <typename T>
+   persistent_set<T>& persistent_set<T>::operator =(persistent_set<T>&& rhs)
+   {
+      clear();
+      swap(rhs);
+      return *this;
+   }
+
+   /*********************************************
+    * PERSISTENT SET :: BEGIN
+    * Walk down the left spine, remembering the path
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::iterator persistent_set<T>::begin() const noexcept
+   {
+      iterator it(root);
+      for (const PNode* p = root; p; p = p->pLeft)
+         it.push(p);
+      return it;
+   }
+
+   /*********************************************
+    * PERSISTENT SET :: END
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::iterator persistent_set<T>::end() const noexcept
+   {
+      return iterator(root);
+   }
+
+   /*********************************************
+    * PERSISTENT SET :: FIND
+    * Return the element corresponding to a given value
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::iterator persistent_set<T>::find(const T& t) const
+   {
+      iterator it(root);
+      const PNode* p = root;
+      while (p)
+      {
+         it.push(p);
+         if (t == p->data)
+            return it;
+         p = (t < p->data) ? p->pLeft : p->pRight;
+      }
+      return end();
+   }
+
+   /*********************************************
+    * PERSISTENT SET :: INSERT
+    * Build the next version with one more element. Only the
+    * nodes on the path to the new leaf are copied.
+    ********************************************/
+   template <typename T>
+   std::pair<typename persistent_set<T>::iterator, bool> persistent_set<T>::insert(const T& t)
+   {
+      // already here? Then the current version is the next version
+      iterator it = find(t);
+      if (it != end())
+         return { it, false };
+
+      // hand our reference to the tree over so unique nodes are reused
+      const PNode* pNew = nullptr;
+      PNode* pOld = root;
+      root = nullptr;
+      root = PNode::insert(pOld, t, pNew);
+      if (root->isRed)
+         root = PNode::recolor(root, false);
+
+      numElements++;
+      return { find(pNew->data), true };
+   }
+
+   template <typename T>
+   std::pair<typename persistent_set<T>::iterator, bool> persistent_set<T>::insert(T&& t)
+   {
+      iterator it = find(t);
+      if (it != end())
+         return { it, false };
+
+      const PNode* pNew = nullptr;
+      PNode* pOld = root;
+      root = nullptr;
+      root = PNode::insert(pOld, std::move(t), pNew);
+      if (root->isRed)
+         root = PNode::recolor(root, false);
+
+      numElements++;
+      return { find(pNew->data), true };
+   }
+
+   /*********************************************
+    * PERSISTENT SET :: ERASE
+    * Build the next version with one less element
+    ********************************************/
+   template <typename T>
+   size_t persistent_set<T>::erase(const T& t)
+   {
+      if (find(t) == end())
+         return 0;
+
+      PNode* pOld = root;
+      root = nullptr;
+      root = PNode::erase(pOld, t);
+      if (root && root->isRed)
+         root = PNode::recolor(root, false);
+
+      numElements--;
+      return 1;
+   }
+
+   /*********************************************
+    * PERSISTENT SET :: ERASE ITERATOR
+    * Remove the element an iterator refers to and return
+    * an iterator to the element after it
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::iterator persistent_set<T>::erase(iterator& it)
+   {
+      if (it == end())
+         return end();
+
+      // the node may be recycled, so hold on to a copy of the value
+      T t(*it);
+      erase(t);
+      return upperBound(t);
+   }
+
+   /*********************************************
+    * PERSISTENT SET :: ERASE RANGE
+    * Remove [itBegin, itEnd). Erasing can rebuild the path
+    * itEnd sits on, so it is found again afterwards.
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::iterator persistent_set<T>::erase(iterator& itBegin, iterator& itEnd)
+   {
+      if (itEnd == end())
+      {
+         while (itBegin != end())
+            itBegin = erase(itBegin);
+         return end();
+      }
+
+      T last(*itEnd);
+      while (itBegin != end() && *itBegin < last)
+         itBegin = erase(itBegin);
+      return itBegin;
+   }
+
+   /*********************************************
+    * PERSISTENT SET :: UPPER BOUND
+    * The first element greater than t
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::iterator persistent_set<T>::upperBound(const T& t) const
+   {
+      // remember the path to the last node where we went left
+      iterator it(root);
+      int depthFound = 0;
+      for (const PNode* p = root; p; )
+      {
+         it.push(p);
+         if (t < p->data)
+         {
+            depthFound = it.depth;
+            p = p->pLeft;
+         }
+         else
+            p = p->pRight;
+      }
+      it.depth = depthFound;
+      return it;
+   }
+
+
+   /*********************************************
+    *********************************************
+    ******************** PNODE ******************
+    *********************************************
+    *********************************************/
+
+   /*********************************************
+    * PNODE :: ACQUIRE
+    * One more owner for this node
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::PNode* persistent_set<T>::PNode::acquire(PNode* p) noexcept
+   {
+      if (p)
+         p->refs.fetch_add(1, std::memory_order_relaxed);
+      return p;
+   }
+
+   /*********************************************
+    * PNODE :: RELEASE
+    * One less owner. The last owner out frees the node
+    * and drops its references to the children.
+    ********************************************/
+   template <typename T>
+   void persistent_set<T>::PNode::release(PNode* p) noexcept
+   {
+      while (p && p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+         PNode* pRight = p->pRight;
+         release(p->pLeft);
+         delete p;
+         p = pRight;       // walk the right spine without recursing
+      }
+   }
+
+   /*********************************************
+    * PNODE :: TAKE
+    * Get an owned reference to one of p's children. If we are
+    * p's only owner the child's reference simply moves to us,
+    * otherwise the child gains a new owner and stays shared.
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::PNode* persistent_set<T>::PNode::take(PNode* p, PNode*& pChild)
+   {
+      if (p->isUnique())
+      {
+         PNode* pTaken = pChild;
+         pChild = nullptr;
+         return pTaken;
+      }
+      return acquire(pChild);
+   }
+
+   /*********************************************
+    * PNODE :: REMAKE
+    * Produce a node holding p's value with a new color and
+    * new children. A unique p is rewritten in place; a shared
+    * p belongs to other versions too, so this is where the
+    * path gets copied.
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::PNode* persistent_set<T>::PNode::remake(PNode* p, bool isRed,
+                                                                       PNode* pLeft, PNode* pRight)
+   {
+      if (p->isUnique())
+      {
+         // drop whatever children were not taken out already
+         release(p->pLeft);
+         release(p->pRight);
+         p->pLeft = pLeft;
+         p->pRight = pRight;
+         p->isRed = isRed;
+         return p;
+      }
+
+      PNode* pNew = new PNode(p->data, isRed, pLeft, pRight);
+      release(p);
+      return pNew;
+   }
+
+   /*********************************************
+    * PNODE :: INSERT
+    * Insert t below p, which must not already contain it, and
+    * point pNew at the new leaf. The result may have a red root
+    * with a red child; the caller's balance() or the final
+    * recolor will fix that. A fresh leaf is unique, so later
+    * rebalancing recycles it rather than moving it.
+    ********************************************/
+   template <typename T>
+   template <class U>
+   typename persistent_set<T>::PNode* persistent_set<T>::PNode::insert(PNode* p, U&& t, const PNode*& pNew)
+   {
+      if (!p)
+      {
+         PNode* pLeaf = new PNode(std::forward<U>(t), true /*isRed*/, nullptr, nullptr);
+         pNew = pLeaf;
+         return pLeaf;
+      }
+
+      if (t < p->data)
+      {
+         PNode* pLeft = insert(takeLeft(p), std::forward<U>(t), pNew);
+         PNode* pRight = takeRight(p);
+         if (p->isRed)
+            return remake(p, true, pLeft, pRight);
+         return balance(pLeft, p, pRight);
+      }
+      else
+      {
+         PNode* pLeft = takeLeft(p);
+         PNode* pRight = insert(takeRight(p), std::forward<U>(t), pNew);
+         if (p->isRed)
+            return remake(p, true, pLeft, pRight);
+         return balance(pLeft, p, pRight);
+      }
+   }
+
+   /*********************************************
+    * PNODE :: ERASE
+    * Remove t from below p, which must contain it
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::PNode* persistent_set<T>::PNode::erase(PNode* p, const T& t)
+   {
+      if (!p)
+         return nullptr;
+
+      // Case 1: found it. Stitch the two children together
+      if (t == p->data)
+      {
+         PNode* pLeft = takeLeft(p);
+         PNode* pRight = takeRight(p);
+         release(p);
+         return append(pLeft, pRight);
+      }
+
+      // Case 2: go left. Removing from a black subtree shortens it
+      if (t < p->data)
+      {
+         bool wasBlack = isBlackNode(p->pLeft);
+         PNode* pLeft = erase(takeLeft(p), t);
+         PNode* pRight = takeRight(p);
+         if (wasBlack)
+            return balanceLeft(pLeft, p, pRight);
+         return remake(p, true, pLeft, pRight);
+      }
+
+      // Case 3: go right
+      bool wasBlack = isBlackNode(p->pRight);
+      PNode* pLeft = takeLeft(p);
+      PNode* pRight = erase(takeRight(p), t);
+      if (wasBlack)
+         return balanceRight(pLeft, p, pRight);
+      return remake(p, true, pLeft, pRight);
+   }
+
+   /*********************************************
+    * PNODE :: BALANCE
+    * Build a black node with p's value over pLeft and pRight,
+    * rotating away any red node with a red child just below it
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::PNode* persistent_set<T>::PNode::balance(PNode* pLeft, PNode* p, PNode* pRight)
+   {
+      // Case 1: both children red. Push the red up
+      if (isRedNode(pLeft) && isRedNode(pRight))
+         return remake(p, true, recolor(pLeft, false), recolor(pRight, false));
+
+      if (isRedNode(pLeft))
+      {
+         // Case 2a: left child and its left child are red
+         if (isRedNode(pLeft->pLeft))
+         {
+            PNode* pA = takeLeft(pLeft);
+            PNode* pB = takeRight(pLeft);
+            PNode* pNewRight = remake(p, false, pB, pRight);
+            return remake(pLeft, true, recolor(pA, false), pNewRight);
+         }
+
+         // Case 2b: left child and its right child are red
+         if (isRedNode(pLeft->pRight))
+         {
+            PNode* pA = takeLeft(pLeft);
+            PNode* pMid = takeRight(pLeft);
+            PNode* pB = takeLeft(pMid);
+            PNode* pC = takeRight(pMid);
+            PNode* pNewLeft = remake(pLeft, false, pA, pB);
+            PNode* pNewRight = remake(p, false, pC, pRight);
+            return remake(pMid, true, pNewLeft, pNewRight);
+         }
+      }
+
+      if (isRedNode(pRight))
+      {
+         // Case 3a: right child and its right child are red
+         if (isRedNode(pRight->pRight))
+         {
+            PNode* pB = takeLeft(pRight);
+            PNode* pC = takeRight(pRight);
+            PNode* pNewLeft = remake(p, false, pLeft, pB);
+            return remake(pRight, true, pNewLeft, recolor(pC, false));
+         }
+
+         // Case 3b: right child and its left child are red
+         if (isRedNode(pRight->pLeft))
+         {
+            PNode* pMid = takeLeft(pRight);
+            PNode* pC = takeRight(pRight);
+            PNode* pA = takeLeft(pMid);
+            PNode* pB = takeRight(pMid);
+            PNode* pNewLeft = remake(p, false, pLeft, pA);
+            PNode* pNewRight = remake(pRight, false, pB, pC);
+            return remake(pMid, true, pNewLeft, pNewRight);
+         }
+      }
+
+      // Case 4: nothing to fix
+      return remake(p, false, pLeft, pRight);
+   }
+
+   /*********************************************
+    * PNODE :: BALANCE LEFT
+    * pLeft is one black node shorter than pRight. Build
+    * a node with p's value that restores the black height.
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::PNode* persistent_set<T>::PNode::balanceLeft(PNode* pLeft, PNode* p, PNode* pRight)
+   {
+      // Case 1: the short side is red. Paint it black
+      if (isRedNode(pLeft))
+         return remake(p, true, recolor(pLeft, false), pRight);
+
+      // Case 2: the sibling is black. Paint it red and rebalance
+      if (isBlackNode(pRight))
+         return balance(pLeft, p, recolor(pRight, true));
+
+      // Case 3: the sibling is red with a black left child. Rotate
+      assert(isRedNode(pRight) && isBlackNode(pRight->pLeft));
+      PNode* pMid = takeLeft(pRight);
+      PNode* pC = takeRight(pRight);
+      PNode* pA = takeLeft(pMid);
+      PNode* pB = takeRight(pMid);
+      PNode* pNewLeft = remake(p, false, pLeft, pA);
+      PNode* pNewRight = balance(pB, pRight, recolor(pC, true));
+      return remake(pMid, true, pNewLeft, pNewRight);
+   }
+
+   /*********************************************
+    * PNODE :: BALANCE RIGHT
+    * pRight is one black node shorter than pLeft
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::PNode* persistent_set<T>::PNode::balanceRight(PNode* pLeft, PNode* p, PNode* pRight)
+   {
+      // Case 1: the short side is red. Paint it black
+      if (isRedNode(pRight))
+         return remake(p, true, pLeft, recolor(pRight, false));
+
+      // Case 2: the sibling is black. Paint it red and rebalance
+      if (isBlackNode(pLeft))
+         return balance(recolor(pLeft, true), p, pRight);
+
+      // Case 3: the sibling is red with a black right child. Rotate
+      assert(isRedNode(pLeft) && isBlackNode(pLeft->pRight));
+      PNode* pA = takeLeft(pLeft);
+      PNode* pMid = takeRight(pLeft);
+      PNode* pB = takeLeft(pMid);
+      PNode* pC = takeRight(pMid);
+      PNode* pNewLeft = balance(recolor(pA, true), pLeft, pB);
+      PNode* pNewRight = remake(p, false, pC, pRight);
+      return remake(pMid, true, pNewLeft, pNewRight);
+   }
+
+   /*********************************************
+    * PNODE :: APPEND
+    * Join two subtrees of equal black height where every
+    * value in pLeft is smaller than every value in pRight
+    ********************************************/
+   template <typename T>
+   typename persistent_set<T>::PNode* persistent_set<T>::PNode::append(PNode* pLeft, PNode* pRight)
+   {
+      if (!pLeft)
+         return pRight;
+      if (!pRight)
+         return pLeft;
+
+      // Case 1: both red. Append the inner grandchildren
+      if (pLeft->isRed && pRight->isRed)
+      {
+         PNode* pA = takeLeft(pLeft);
+         PNode* pB = takeRight(pLeft);
+         PNode* pC = takeLeft(pRight);
+         PNode* pD = takeRight(pRight);
+         PNode* pMid = append(pB, pC);
+         if (isRedNode(pMid))
+         {
+            PNode* pMidLeft = takeLeft(pMid);
+            PNode* pMidRight = takeRight(pMid);
+            return remake(pMid, true,
+                          remake(pLeft, true, pA, pMidLeft),
+                          remake(pRight, true, pMidRight, pD));
+         }
+         return remake(pLeft, true, pA, remake(pRight, true, pMid, pD));
+      }
+
+      // Case 2: both black. Same, but the result may come up short
+      if (!pLeft->isRed && !pRight->isRed)
+      {
+         PNode* pA = takeLeft(pLeft);
+         PNode* pB = takeRight(pLeft);
+         PNode* pC = takeLeft(pRight);
+         PNode* pD = takeRight(pRight);
+         PNode* pMid = append(pB, pC);
+         if (isRedNode(pMid))
+         {
+            PNode* pMidLeft = takeLeft(pMid);
+            PNode* pMidRight = takeRight(pMid);
+            return remake(pMid, true,
+                          remake(pLeft, false, pA, pMidLeft),
+                          remake(pRight, false, pMidRight, pD));
+         }
+         return balanceLeft(pA, pLeft, remake(pRight, false, pMid, pD));
+      }
+
+      // Case 3: only the right is red. Append into its left side
+      if (pRight->isRed)
+      {
+         PNode* pB = takeLeft(pRight);
+         PNode* pC = takeRight(pRight);
+         return remake(pRight, true, append(pLeft, pB), pC);
+      }
+
+      // Case 4: only the left is red. Append into its right side
+      PNode* pA = takeLeft(pLeft);
+      PNode* pB = takeRight(pLeft);
+      return remake(pLeft, true, pA, append(pB, pRight));
+   }
+
+
+   /*************************************************
+    *************************************************
+    ****************** ITERATOR *********************
+    *************************************************
+    *************************************************/
+
+   /**************************************************
+    * PERSISTENT SET ITERATOR :: INCREMENT PREFIX
+    * advance by one
+    *************************************************/
+   template <typename T>
+   typename persistent_set<T>::iterator& persistent_set<T>::iterator::operator ++()
+   {
+      // Don't increment if we're already at the end
+      if (!depth)
+         return *this;
+
+      // Case 1: Have a right child. Go right then all the way left
+      const PNode* p = get();
+      if (p->pRight)
+      {
+         for (p = p->pRight; p; p = p->pLeft)
+            push(p);
+         return *this;
+      }
+
+      // Case 2: Climb until we come up from a left child
+      const PNode* pChild;
+      do
+      {
+         pChild = path[--depth];
+      }
+      while (depth && path[depth - 1]->pRight == pChild);
+      return *this;
+   }
+
+   /**************************************************
+    * PERSISTENT SET ITERATOR :: DECREMENT PREFIX
+    * back up by one. Decrementing end() lands on the last element
+    *************************************************/
+   template <typename T>
+   typename persistent_set<T>::iterator& persistent_set<T>::iterator::operator --()
+   {
+      // Case 1: at the end. Go all the way right
+      if (!depth)
+      {
+         for (const PNode* p = pRoot; p; p = p->pRight)
+            push(p);
+         return *this;
+      }
+
+      // Case 2: Have a left child. Go left then all the way right
+      const PNode* p = get();
+      if (p->pLeft)
+      {
+         for (p = p->pLeft; p; p = p->pRight)
+            push(p);
+         return *this;
+      }
+
+      // Case 3: Climb until we come up from a right child
+      const PNode* pChild;
+      do
+      {
+         pChild = path[--depth];
+      }
+      while (depth && path[depth - 1]->pLeft == pChild);
+      return *this;
+   }
+
+} // namespace custom
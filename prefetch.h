@@ -0,0 +1,37 @@
+/***********************************************************************
+ * Header:
+ *    Prefetch
+ * Summary:
+ *    Ask the CPU to start loading a cache line we will need soon, so
+ *    the wait for memory overlaps with other work. Only a hint: it
+ *    never faults, even on a bad address, and does nothing where the
+ *    compiler offers no way to say it.
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h> // for _mm_prefetch
+#endif
+
+namespace custom
+{
+
+   /*********************************************
+    * PREFETCH
+    * Bring the line holding p into every level of cache
+    ********************************************/
+   inline void prefetch(const void* p) noexcept
+   {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+      _mm_prefetch((const char*)p, _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+      __builtin_prefetch(p);
+#else
+      (void)p;
+#endif
+   }
+
+} // namespace custom
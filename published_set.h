@@ -0,0 +1,308 @@
+/***********************************************************************
+ * Header:
+ *    Published Set
+ * Summary:
+ *    A set for one writer and many readers. The writer changes a
+ *    private BST and, when it is ready, publishes an immutable sorted
+ *    snapshot. Readers look things up in the latest snapshot without
+ *    taking any lock, so how fast they read does not depend on how
+ *    often the writer writes.
+ *
+ *    Snapshots are reclaimed with epochs: every reader announces the
+ *    epoch it entered in, and a retired snapshot is freed once no
+ *    reader that could have seen it is still inside.
+ *
+ *    This will contain the class definition of:
+ *        published_set              : A writer-owned set with lock-free readers
+ *        published_set::reader      : A reader's view of one snapshot
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <atomic>     // for std::atomic
+#include <vector>     // for std::vector
+#include <thread>     // for std::this_thread
+#include <functional> // for std::hash
+#include <algorithm>  // for std::lower_bound
+#include <cstdint>    // for uint64_t
+#include "bst.h"
+
+class TestPublishedSet; // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * PUBLISHED SET
+    * One writer changes the set, any number of readers
+    * see the last published version
+    ***********************************************/
+   template <typename T>
+   class published_set
+   {
+      friend class ::TestPublishedSet; // give unit tests access to the privates
+   public:
+      // how many readers can be inside at the same time
+      static const int MAX_READERS = 256;
+
+      //
+      // Construct
+      //
+      published_set();
+      published_set(const published_set& rhs) = delete;
+      published_set& operator =(const published_set& rhs) = delete;
+      ~published_set();
+
+      //
+      // Writer: these change the private tree and are only called
+      // from the one writer thread
+      //
+      std::pair<typename BST<T>::iterator, bool> insert(const T& t)
+      {
+         return bst.insert(t, true /*keepUnique*/);
+      }
+      size_t erase(const T& t);
+      void   clear() noexcept { bst.clear(); }
+      size_t size()  const noexcept { return bst.size(); }
+      void   publish();
+      size_t reclaim();
+
+      //
+      // Reader: any thread, any time
+      //
+      class reader;
+      reader read() const;
+      bool contains(const T& t) const;
+
+   private:
+
+      class Snapshot;
+
+      static const size_t LINE = 64;
+
+      // one slot per reader currently inside, padded onto lines of its own
+      // since before C++17 new ignores the alignment of an over-aligned type
+      struct Slot
+      {
+         char padFront[LINE];             // no other reader's slot on these lines
+         std::atomic<bool> inUse;         // claimed by a reader
+         std::atomic<uint64_t> epoch;     // epoch the reader entered in, 0 when idle
+         char padBack[LINE];
+      };
+
+      // a snapshot waiting for its readers to leave
+      struct Retired
+      {
+         Snapshot* pSnapshot;
+         uint64_t  epoch;                 // first epoch that cannot see it
+      };
+
+      BST<T> bst;                                  // the writer's private tree
+      std::atomic<Snapshot*> current;              // what readers see
+      std::atomic<uint64_t> globalEpoch;           // bumped on every publish
+      mutable Slot slots[MAX_READERS];             // the readers inside right now
+      std::vector<Retired> retired;                // writer only
+   };
+
+   /*****************************************************************
+    * SNAPSHOT
+    * An immutable copy of the set, laid out as a sorted array so a
+    * lookup is a binary search through contiguous memory
+    *****************************************************************/
+   template <typename T>
+   class published_set<T>::Snapshot
+   {
+   public:
+      Snapshot() {}
+      Snapshot(const BST<T>& bst)
+      {
+         data.reserve(bst.size());
+         for (auto it = bst.begin(); it != bst.end(); ++it)
+            data.push_back(*it);
+      }
+
+      const T* find(const T& t) const
+      {
+         auto it = std::lower_bound(data.begin(), data.end(), t);
+         if (it == data.end() || t < *it)
+            return nullptr;
+         return &*it;
+      }
+
+      std::vector<T> data;
+   };
+
+   /**********************************************************
+    * PUBLISHED SET READER
+    * While a reader is alive, the snapshot it looks at will
+    * not be freed. Keep readers short: a reader that lingers
+    * holds back the reclamation of every newer snapshot too.
+    *********************************************************/
+   template <typename T>
+   class published_set<T>::reader
+   {
+      friend class custom::published_set<T>;
+   public:
+      reader(reader&& rhs) noexcept : pSlot(rhs.pSlot), pSnapshot(rhs.pSnapshot)
+      {
+         rhs.pSlot = nullptr;
+      }
+      reader(const reader& rhs) = delete;
+      reader& operator =(const reader& rhs) = delete;
+      ~reader()
+      {
+         // leave: we no longer hold anything
+         if (pSlot)
+         {
+            pSlot->epoch.store(0, std::memory_order_release);
+            pSlot->inUse.store(false, std::memory_order_release);
+         }
+      }
+
+      // look things up in the snapshot
+      bool        contains(const T& t) const { return pSnapshot->find(t) != nullptr; }
+      const T*    find(const T& t)     const { return pSnapshot->find(t); }
+      size_t      size()               const { return pSnapshot->data.size(); }
+      bool        empty()              const { return pSnapshot->data.empty(); }
+      const T*    begin()              const { return pSnapshot->data.data(); }
+      const T*    end()                const { return pSnapshot->data.data() + pSnapshot->data.size(); }
+
+   private:
+      reader(Slot* pSlot, const Snapshot* pSnapshot) : pSlot(pSlot), pSnapshot(pSnapshot)
+      {}
+
+      Slot* pSlot;                   // our announcement, released when we leave
+      const Snapshot* pSnapshot;     // what we are looking at
+   };
+
+
+   /*********************************************
+    * PUBLISHED SET :: CONSTRUCTOR
+    * Start with an empty published snapshot so readers
+    * never see a null pointer
+    ********************************************/
+   template <typename T>
+   published_set<T>::published_set() : current(new Snapshot), globalEpoch(1)
+   {
+      for (int i = 0; i < MAX_READERS; i++)
+      {
+         slots[i].inUse.store(false, std::memory_order_relaxed);
+         slots[i].epoch.store(0, std::memory_order_relaxed);
+      }
+   }
+
+   /*********************************************
+    * PUBLISHED SET :: DESTRUCTOR
+    * No reader may outlive the set
+    ********************************************/
+   template <typename T>
+   published_set<T>::~published_set()
+   {
+      for (auto& r : retired)
+         delete r.pSnapshot;
+      delete current.load();
+   }
+
+   /*********************************************
+    * PUBLISHED SET :: ERASE
+    * Remove a value from the writer's tree
+    ********************************************/
+   template <typename T>
+   size_t published_set<T>::erase(const T& t)
+   {
+      auto it = bst.find(t);
+      if (it == bst.end())
+         return 0;
+      bst.erase(it);
+      return 1;
+   }
+
+   /*********************************************
+    * PUBLISHED SET :: PUBLISH
+    * Make the writer's tree visible to readers. The old
+    * snapshot is retired, not freed: readers may still be in it.
+    ********************************************/
+   template <typename T>
+   void published_set<T>::publish()
+   {
+      Snapshot* pNew = new Snapshot(bst);
+      Snapshot* pOld = current.exchange(pNew, std::memory_order_seq_cst);
+
+      // anyone entering from now on sees pNew
+      uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+      retired.push_back({ pOld, epoch });
+      reclaim();
+   }
+
+   /*********************************************
+    * PUBLISHED SET :: RECLAIM
+    * Free every retired snapshot that no reader can still
+    * be looking at. Returns how many are still waiting.
+    ********************************************/
+   template <typename T>
+   size_t published_set<T>::reclaim()
+   {
+      // the oldest epoch any reader is still in
+      uint64_t oldest = UINT64_MAX;
+      for (int i = 0; i < MAX_READERS; i++)
+      {
+         uint64_t epoch = slots[i].epoch.load(std::memory_order_seq_cst);
+         if (epoch && epoch < oldest)
+            oldest = epoch;
+      }
+
+      // a reader in epoch e can only hold snapshots retired after e
+      size_t kept = 0;
+      for (size_t i = 0; i < retired.size(); i++)
+      {
+         if (retired[i].epoch <= oldest)
+            delete retired[i].pSnapshot;
+         else
+            retired[kept++] = retired[i];
+      }
+      retired.resize(kept);
+      return kept;
+   }
+
+   /*********************************************
+    * PUBLISHED SET :: READ
+    * Enter: claim a slot, announce our epoch, then pick up
+    * the current snapshot. No locks, just atomics.
+    ********************************************/
+   template <typename T>
+   typename published_set<T>::reader published_set<T>::read() const
+   {
+      // start looking at a spot that depends on the thread so
+      // readers on different threads rarely fight over a slot
+      size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+      for (size_t i = 0; ; i++)
+      {
+         Slot* pSlot = &slots[(start + i) % MAX_READERS];
+         bool expected = false;
+         if (!pSlot->inUse.load(std::memory_order_relaxed) &&
+             pSlot->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+         {
+            pSlot->epoch.store(globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            return reader(pSlot, current.load(std::memory_order_seq_cst));
+         }
+
+         // every slot is busy: give the other readers a chance to leave
+         if (i && i % MAX_READERS == 0)
+            std::this_thread::yield();
+      }
+   }
+
+   /*********************************************
+    * PUBLISHED SET :: CONTAINS
+    * A one-shot lookup in the current snapshot
+    ********************************************/
+   template <typename T>
+   bool published_set<T>::contains(const T& t) const
+   {
+      return read().contains(t);
+   }
+
+} // namespace custom
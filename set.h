@@ -9,6 +9,10 @@
  *     _| |_   _| |_  | \____) |  / / (_)
  *    |_____| |_____|  \______.' /_/
  *
+ *    The elements live in a storage engine picked at compile time by
+ *    the Backend parameter (see set_backend.h): a red-black tree unless
+ *    asked otherwise.
+ *
  *    This will contain the class definition of:
  *       set                 : A class that represents a Set
  *       set::iterator       : An iterator through Set
@@ -21,22 +25,37 @@
 #include <cassert>
 #include <iostream>
 #include "bst.h"
+#include "set_backend.h"
 #include <memory>     // for std::allocator
 #include <functional> // for std::less
+#include <vector>     // for std::vector
+#include <iterator>   // for std::reverse_iterator
 
 class TestSet;        // forward declaration for unit tests
 
 namespace custom
 {
 
+   template <typename TT>
+   class set_accumulator;
+
    /************************************************
     * SET
     * A class that represents a Set
     ***********************************************/
-   template <typename T>
+   template <typename T, typename Compare = std::less<T>, typename Backend = rb_tree>
    class set
    {
       friend class ::TestSet; // give unit tests access to the privates
+
+      template <class TT>
+      friend class custom::set_accumulator;
+
+      static_assert(Backend::template accepts<T, Compare>::value,
+                    "this backend orders by operator <: use std::less<T>");
+
+      // the container the elements live in
+      using engine = typename Backend::template engine<T, Compare>;
    public:
 
       // 
@@ -50,12 +69,12 @@ namespace custom
       {}
       set(const std::initializer_list<T>& il)
       {
-         insert(il);
+         Backend::build(bst, il.begin(), il.end());
       }
       template <class Iterator>
       set(Iterator first, Iterator last)
       {
-         insert(first, last);
+         Backend::build(bst, first, last);
       }
       ~set()
       {}
@@ -88,13 +107,22 @@ namespace custom
       // Iterator
       //
       class iterator;
+      using reverse_iterator = std::reverse_iterator<iterator>;
       iterator begin() const noexcept
       {
          return set::iterator(bst.begin());
       }
       iterator end() const noexcept
       {
-         return set::iterator(nullptr);
+         return set::iterator(bst.end());
+      }
+      reverse_iterator rbegin() const noexcept
+      {
+         return reverse_iterator(end());
+      }
+      reverse_iterator rend() const noexcept
+      {
+         return reverse_iterator(begin());
       }
 
       //
@@ -104,6 +132,46 @@ namespace custom
       {
          return set::iterator(bst.find(t));
       }
+      iterator lower_bound(const T& t) const
+      {
+         return set::iterator(bst.lower_bound(t));
+      }
+      void find_many(const std::vector<T>& keys, std::vector<iterator>& out) const
+      {
+         out.assign(keys.size(), end());
+         Backend::findMany(bst, keys.begin(), keys.end(), [&](size_t i, typename engine::iterator it)
+         {
+            out[i] = set::iterator(it);
+         });
+      }
+      // the smallest and largest values; the set must not be empty
+      const T& min() const
+      {
+         assert(!empty());
+         return *begin();
+      }
+      const T& max() const
+      {
+         assert(!empty());
+         return *--end();
+      }
+      // the same, for a set used as a priority queue
+      const T& peek_min() const
+      {
+         return min();
+      }
+      const T& peek_max() const
+      {
+         return max();
+      }
+      void contains_many(const std::vector<T>& keys, std::vector<bool>& out) const
+      {
+         out.assign(keys.size(), false);
+         Backend::findMany(bst, keys.begin(), keys.end(), [&](size_t i, typename engine::iterator it)
+         {
+            out[i] = (it != bst.end());
+         });
+      }
 
       //
       // Status
@@ -116,17 +184,22 @@ namespace custom
       {
          return bst.size();
       }
+      // heap bytes each element costs in this backend
+      size_t bytes_per_element() const noexcept
+      {
+         return Backend::bytesPerElement(bst);
+      }
 
       //
       // Insert
       //
       std::pair<iterator, bool> insert(const T& t)
       {
-         return bst.insert(t, true /*keepUnique*/);
+         return Backend::insert(bst, t);
       }
       std::pair<iterator, bool> insert(T&& t)
       {
-         return bst.insert(std::move(t), true /*keepUnique*/);
+         return Backend::insert(bst, std::move(t));
       }
       void insert(const std::initializer_list<T>& il)
       {
@@ -136,11 +209,18 @@ namespace custom
       template <class Iterator>
       void insert(Iterator first, Iterator last)
       {
-         while (first != last)
-         {
-            insert(*first);
-            ++first;
-         }
+         Backend::insertRange(bst, first, last);
+      }
+      // on the executor's threads with rb_tree, on this one otherwise
+      template <class Iterator, class Executor>
+      size_t insert_parallel(Iterator first, Iterator last, const Executor& executor)
+      {
+         return Backend::insertParallel(bst, first, last, executor);
+      }
+      template <class Iterator>
+      size_t insert_parallel(Iterator first, Iterator last)
+      {
+         return Backend::insertParallel(bst, first, last, thread_executor());
       }
 
 
@@ -149,30 +229,107 @@ namespace custom
       //
       void clear() noexcept
       {
-         bst.clear();
+         Backend::clear(bst);
       }
       iterator erase(iterator& it)
       {
-         return iterator(bst.erase(it.it));
+         return iterator(Backend::erase(bst, it.it));
       }
       size_t erase(const T& t)
       {
-         class BST<T>::iterator it = bst.find(t);
-         if (it == bst.end())
-            return 0;
-         bst.erase(it);
-         return 1;
+         return Backend::eraseKey(bst, t);
+      }
+      template <class Pred>
+      size_t erase_if(Pred pred)
+      {
+         return Backend::eraseIf(bst, pred);
       }
       iterator erase(iterator& itBegin, iterator& itEnd)
       {
-         while (itBegin != itEnd)
-            itBegin.it = bst.erase(itBegin.it);
+         itEnd = iterator(Backend::eraseRange(bst, itBegin.it, itEnd.it));
+         itBegin = itEnd;
          return itEnd;
       }
+      // remove the smallest or the largest value, if any
+      void pop_front()
+      {
+         Backend::popFront(bst);
+      }
+      void pop_back()
+      {
+         Backend::popBack(bst);
+      }
+      // remove the smallest or the largest value and return it;
+      // the set must not be empty
+      T pop_min()
+      {
+         return Backend::template takeFront<T>(bst);
+      }
+      T pop_max()
+      {
+         return Backend::template takeBack<T>(bst);
+      }
+      // everything from lo up to but not including hi
+      size_t erase(const T& lo, const T& hi)
+      {
+         if (!Compare()(lo, hi))
+            return 0;
+         size_t numBefore = size();
+         auto itLo = bst.lower_bound(lo);
+         auto itHi = bst.lower_bound(hi);
+         Backend::eraseRange(bst, itLo, itHi);
+         return numBefore - size();
+      }
+      // move [itBegin, itEnd) out into a set of its own
+      set extract(iterator& itBegin, iterator& itEnd)
+      {
+         set s;
+         Backend::extract(bst, s.bst, itBegin.it, itEnd.it);
+         itBegin = itEnd;
+         return s;
+      }
+
+      //
+      // Batch
+      //
+      using update       = typename BST<T>::update;
+      using batch_result = typename BST<T>::batch_result;
+      batch_result apply_batch(std::vector<update> batch)
+      {
+         batch_result result;
+         Backend::applyBatch(bst, std::move(batch), result);
+         return result;
+      }
+
+      //
+      // Layout
+      //
+      // rebuild the tree balanced in one block of nodes in van Emde Boas
+      // order, for fewer cache and TLB misses on the way down. The
+      // elements move, so every iterator is invalidated
+      void optimize_layout()
+      {
+         Backend::optimizeLayout(bst);
+      }
+      // rebuild the tree balanced in one fresh block of nodes, in key order
+      // for scans or breadth first for searches, and free the old ones.
+      // The elements move, so every iterator is invalidated
+      void compact(node_order order = node_order::IN_ORDER)
+      {
+         Backend::compact(bst, order);
+      }
+      // compact in key order a few nodes at a time: move up to maxNodes
+      // and say whether it is done. The tree keeps its shape, and only
+      // iterators to the elements moved are invalidated
+      bool compact_step(size_t maxNodes)
+      {
+         return Backend::compactStep(bst, maxNodes);
+      }
 
    private:
 
-      custom::BST<T> bst;
+      // the elements: named for the BST that was once the only engine
+      engine bst;
 
    }; // class set
 
@@ -181,16 +338,23 @@ namespace custom
     * SET ITERATOR
     * An iterator through Set
     *************************************************/
-   template <typename T>
-   class set<T>::iterator
+   template <typename T, typename Compare, typename Backend>
+   class set<T, Compare, Backend>::iterator
    {
       friend class ::TestSet; // give unit tests access to the privates
-      friend class custom::set<T>;
+      friend class custom::set<T, Compare, Backend>;
    public:
+      // so std::reverse_iterator and the algorithms can use it
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const T*;
+      using reference         = const T&;
+
       // constructors, destructors, and assignment operator
-      iterator() : it(BST<T>::iterator())
+      iterator() : it()
       {}
-      iterator(const typename custom::BST<T>::iterator& itRHS) : it(itRHS)
+      iterator(const typename engine::iterator& itRHS) : it(itRHS)
       {}
       iterator(const iterator& rhs) : it(rhs.it)
       {}
@@ -248,7 +412,7 @@ namespace custom
 
    private:
 
-      typename custom::BST<T>::iterator it;
+      typename engine::iterator it;
 
    }; // class set::iterator
 
@@ -0,0 +1,309 @@
+/***********************************************************************
+ * Header:
+ *    Set Accumulator
+ * Summary:
+ *    Many threads collecting unique values that are wanted together
+ *    in one set at the end. Each thread appends to its own buffer with
+ *    no locks and no shared cache lines. finalize() then sorts the
+ *    buffers in parallel, merges them in parallel by key range, and
+ *    builds the set in linear time from the sorted result.
+ *
+ *    This will contain the class definition of:
+ *        set_accumulator            : Per-thread buffers merged into a set
+ *        set_accumulator::collector : One thread's buffer
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <mutex>      // for std::mutex
+#include <vector>     // for std::vector
+#include <memory>     // for std::unique_ptr
+#include <thread>     // for std::thread
+#include <chrono>     // for std::chrono::steady_clock
+#include <queue>      // for std::priority_queue
+#include <iterator>   // for std::make_move_iterator
+#include <algorithm>  // for std::sort
+#include "set.h"
+
+class TestSetAccumulator; // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * SET ACCUMULATOR
+    * Per-thread collectors combined into one set
+    ***********************************************/
+   template <typename T>
+   class set_accumulator
+   {
+      friend class ::TestSetAccumulator; // give unit tests access to the privates
+   public:
+      // a buffer is sorted and its duplicates dropped when it has
+      // doubled since the last time, and is at least this big
+      static const size_t MIN_COMPACT = 1024;
+
+      // seconds spent in each phase of the last finalize()
+      struct phases
+      {
+         double sort  = 0.0;   // sorting each buffer, in parallel
+         double merge = 0.0;   // merging the buffers, in parallel
+         double build = 0.0;   // building the tree
+      };
+
+      class collector;
+
+      //
+      // Construct
+      //
+      set_accumulator() {}
+      set_accumulator(const set_accumulator& rhs) = delete;
+      set_accumulator& operator =(const set_accumulator& rhs) = delete;
+
+      //
+      // Collect: each thread asks for its own collector once
+      //
+      collector& local();
+
+      //
+      // Combine: only after every thread has stopped collecting.
+      // The collectors are left empty and may be used again.
+      //
+      custom::set<T> finalize();
+      const phases& timing() const noexcept { return lastTiming; }
+
+   private:
+      std::vector<T> merge(std::vector<std::vector<T>*>& runs);
+      static void mergeRange(std::vector<std::vector<T>*>& runs,
+                             const std::vector<size_t>& begins,
+                             const std::vector<size_t>& ends,
+                             std::vector<T>& out);
+
+      std::mutex mutex;                                   // guards collectors
+      std::vector<std::unique_ptr<collector>> collectors; // one per thread
+      phases lastTiming;                                  // of the last finalize()
+   };
+
+   /**********************************************************
+    * SET ACCUMULATOR COLLECTOR
+    * One thread's values, on cache lines of its own: padded
+    * rather than aligned, since before C++17 new ignores the
+    * alignment of an over-aligned type
+    *********************************************************/
+   template <typename T>
+   class set_accumulator<T>::collector
+   {
+      friend class custom::set_accumulator<T>;
+      friend class ::TestSetAccumulator;
+   public:
+      void insert(const T& t)
+      {
+         buffer.push_back(t);
+         compactIfFull();
+      }
+      void insert(T&& t)
+      {
+         buffer.push_back(std::move(t));
+         compactIfFull();
+      }
+
+      // values collected so far, duplicates not yet dropped counted too
+      size_t size() const noexcept { return buffer.size(); }
+
+   private:
+      // sort the buffer and drop the duplicates, but only once it has
+      // doubled so each value is compacted O(log n) times at most
+      void compactIfFull()
+      {
+         if (buffer.size() >= MIN_COMPACT && buffer.size() >= 2 * numCompact)
+         {
+            compact();
+            numCompact = buffer.size();
+         }
+      }
+      void compact()
+      {
+         std::sort(buffer.begin(), buffer.end());
+         buffer.erase(std::unique(buffer.begin(), buffer.end(),
+                                  [](const T& lhs, const T& rhs) { return !(lhs < rhs); }),
+                      buffer.end());
+      }
+
+      static const size_t LINE = 64;
+
+      char padFront[LINE];       // no other thread's data on these lines
+      std::vector<T> buffer;     // what this thread has collected
+      size_t numCompact = 0;     // buffer size after the last compact
+      char padBack[LINE];
+   };
+
+
+   /*********************************************
+    * SET ACCUMULATOR :: LOCAL
+    * Hand out a new collector. The only place a lock is taken:
+    * call it once per thread and keep the reference.
+    ********************************************/
+   template <typename T>
+   typename set_accumulator<T>::collector& set_accumulator<T>::local()
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      collectors.push_back(std::unique_ptr<collector>(new collector));
+      return *collectors.back();
+   }
+
+   /*********************************************
+    * SET ACCUMULATOR :: FINALIZE
+    * Sort every buffer, merge, and build
+    ********************************************/
+   template <typename T>
+   custom::set<T> set_accumulator<T>::finalize()
+   {
+      using clock = std::chrono::steady_clock;
+      std::lock_guard<std::mutex> lock(mutex);
+      lastTiming = phases();
+
+      // 1. sort each buffer on its own thread
+      auto start = clock::now();
+      std::vector<std::vector<T>*> runs;
+      {
+         std::vector<std::thread> sorters;
+         for (auto& pCollector : collectors)
+         {
+            if (pCollector->buffer.empty())
+               continue;
+            runs.push_back(&pCollector->buffer);
+            collector* p = pCollector.get();
+            sorters.push_back(std::thread([p]() { p->compact(); }));
+         }
+         for (auto& thread : sorters)
+            thread.join();
+      }
+      auto sorted = clock::now();
+      lastTiming.sort = std::chrono::duration<double>(sorted - start).count();
+
+      // 2. merge them into one sorted run with no duplicates
+      std::vector<T> merged = merge(runs);
+      for (auto& pCollector : collectors)
+      {
+         std::vector<T>().swap(pCollector->buffer);
+         pCollector->numCompact = 0;
+      }
+      auto mergedTime = clock::now();
+      lastTiming.merge = std::chrono::duration<double>(mergedTime - sorted).count();
+
+      // 3. build the tree bottom-up in linear time
+      custom::set<T> s;
+      s.bst.assignSorted(std::make_move_iterator(merged.begin()),
+                         std::make_move_iterator(merged.end()));
+      lastTiming.build = std::chrono::duration<double>(clock::now() - mergedTime).count();
+      return s;
+   }
+
+   /*********************************************
+    * SET ACCUMULATOR :: MERGE
+    * A k-way merge of sorted unique runs. The key space is cut
+    * into as many ranges as there are runs, using the largest run
+    * to pick the cut points, and each range is merged on its own
+    * thread. Ranges do not overlap so neither do their duplicates.
+    ********************************************/
+   template <typename T>
+   std::vector<T> set_accumulator<T>::merge(std::vector<std::vector<T>*>& runs)
+   {
+      if (runs.empty())
+         return std::vector<T>();
+      if (runs.size() == 1)
+         return std::move(*runs[0]);
+
+      // the cut points, from the largest run
+      const std::vector<T>* pLargest = runs[0];
+      for (auto pRun : runs)
+         if (pRun->size() > pLargest->size())
+            pLargest = pRun;
+      size_t numRanges = std::min(runs.size(), pLargest->size());
+      std::vector<const T*> cuts;
+      for (size_t i = 1; i < numRanges; i++)
+         cuts.push_back(&(*pLargest)[i * pLargest->size() / numRanges]);
+
+      // where each range starts and ends in each run
+      std::vector<std::vector<size_t>> bounds(numRanges + 1, std::vector<size_t>(runs.size()));
+      for (size_t r = 0; r < runs.size(); r++)
+      {
+         bounds[0][r] = 0;
+         for (size_t i = 0; i < cuts.size(); i++)
+            bounds[i + 1][r] = std::lower_bound(runs[r]->begin(), runs[r]->end(), *cuts[i]) - runs[r]->begin();
+         bounds[numRanges][r] = runs[r]->size();
+      }
+
+      // merge the ranges side by side. The cut points live in a run
+      // and are read by the searches above, so elements are only
+      // moved once every search is done.
+      std::vector<std::vector<T>> outs(numRanges);
+      std::vector<std::thread> mergers;
+      for (size_t i = 0; i < numRanges; i++)
+         mergers.push_back(std::thread([&, i]()
+         {
+            mergeRange(runs, bounds[i], bounds[i + 1], outs[i]);
+         }));
+      for (auto& thread : mergers)
+         thread.join();
+
+      // stitch the ranges together
+      size_t num = 0;
+      for (auto& out : outs)
+         num += out.size();
+      std::vector<T> merged;
+      merged.reserve(num);
+      for (auto& out : outs)
+         merged.insert(merged.end(), std::make_move_iterator(out.begin()),
+                                     std::make_move_iterator(out.end()));
+      return merged;
+   }
+
+   /*********************************************
+    * SET ACCUMULATOR :: MERGE RANGE
+    * Merge one slice of every run with a heap of run heads,
+    * dropping a value equal to the one before it
+    ********************************************/
+   template <typename T>
+   void set_accumulator<T>::mergeRange(std::vector<std::vector<T>*>& runs,
+                                       const std::vector<size_t>& begins,
+                                       const std::vector<size_t>& ends,
+                                       std::vector<T>& out)
+   {
+      // a run head: which run, and where in it
+      struct Head
+      {
+         size_t iRun;
+         size_t i;
+      };
+      auto greater = [&](const Head& lhs, const Head& rhs)
+      {
+         return (*runs[rhs.iRun])[rhs.i] < (*runs[lhs.iRun])[lhs.i];
+      };
+      std::priority_queue<Head, std::vector<Head>, decltype(greater)> heads(greater);
+
+      size_t num = 0;
+      for (size_t r = 0; r < runs.size(); r++)
+      {
+         if (begins[r] < ends[r])
+            heads.push({ r, begins[r] });
+         num += ends[r] - begins[r];
+      }
+      out.reserve(num);
+
+      while (!heads.empty())
+      {
+         Head head = heads.top();
+         heads.pop();
+         T& t = (*runs[head.iRun])[head.i];
+         if (out.empty() || out.back() < t)
+            out.push_back(std::move(t));
+         if (++head.i < ends[head.iRun])
+            heads.push(head);
+      }
+   }
+
+} // namespace custom
@@ -0,0 +1,459 @@
+/***********************************************************************
+ * Header:
+ *    Set Backend
+ * Summary:
+ *    The storage engines a set can be built on, chosen at compile time:
+ *    set<T, Compare, Backend>. Each backend names the container that
+ *    holds the elements and says, in static functions, how to do the
+ *    operations on which the containers' interfaces differ. The set
+ *    calls them by type, so there is no virtual call and nothing the
+ *    compiler cannot inline.
+ *
+ *    This will contain:
+ *        backend_generic            : What any set-like engine can do
+ *        rb_tree                    : A red-black BST (the default)
+ *        btree                      : A B+ tree
+ *        flat                       : A sorted array
+ *        frozen                     : An Eytzinger array, built once, read-only
+ *        small<N>                   : Up to N inline, a BST after that
+ *        fixed<N>                   : A red-black tree in N nodes in the object
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>      // for size_t
+#include <algorithm>    // for std::remove_if
+#include <functional>   // for std::less
+#include <type_traits>  // for std::is_same
+#include <utility>      // for std::forward
+#include <vector>       // for std::vector
+#include "bst.h"
+#include "btree_set.h"
+#include "flat_set.h"
+#include "frozen_set.h"
+#include "small_set.h"
+#include "static_set.h"
+
+namespace custom
+{
+
+   /************************************************
+    * BACKEND GENERIC
+    * The operations spelled as std::set spells them,
+    * for an engine with that interface. A backend
+    * replaces any it can do better by declaring its own.
+    ***********************************************/
+   struct backend_generic
+   {
+      // whether the engine can order by Compare
+      template <class T, class Compare>
+      using accepts = std::true_type;
+
+      //
+      // Insert
+      //
+      template <class E, class U>
+      static std::pair<typename E::iterator, bool> insert(E& e, U&& t)
+      {
+         return e.insert(std::forward<U>(t));
+      }
+      template <class E, class Iterator>
+      static void insertRange(E& e, Iterator first, Iterator last)
+      {
+         e.insert(first, last);
+      }
+      // fill an empty engine, for the constructors
+      template <class E, class Iterator>
+      static void build(E& e, Iterator first, Iterator last)
+      {
+         e.insert(first, last);
+      }
+      // one thread: only rb_tree splits the work
+      template <class E, class Iterator, class Executor>
+      static size_t insertParallel(E& e, Iterator first, Iterator last,
+                                   const Executor&)
+      {
+         size_t numBefore = e.size();
+         e.insert(first, last);
+         return e.size() - numBefore;
+      }
+      // the updates one at a time, in order
+      template <class E, class Update, class Result>
+      static void applyBatch(E& e, std::vector<Update>&& batch, Result& result)
+      {
+         for (const Update& u : batch)
+         {
+            bool changed = u.erase ? e.erase(u.value) == 1 : e.insert(u.value).second;
+            if (!changed)
+               result.skipped++;
+            else if (u.erase)
+               result.erased++;
+            else
+               result.inserted++;
+         }
+      }
+
+      //
+      // Access
+      //
+      template <class E, class Iterator, class Found>
+      static void findMany(const E& e, Iterator first, Iterator last, Found found)
+      {
+         for (size_t i = 0; first != last; ++first, ++i)
+            found(i, e.find(*first));
+      }
+
+      //
+      // Remove
+      //
+      template <class E>
+      static typename E::iterator erase(E& e, typename E::iterator& it)
+      {
+         return e.erase(it);
+      }
+      template <class E, class T>
+      static size_t eraseKey(E& e, const T& t)
+      {
+         return e.erase(t);
+      }
+      // hands back where last ended up
+      template <class E>
+      static typename E::iterator eraseRange(E& e, typename E::iterator& first,
+                                             typename E::iterator& last)
+      {
+         return e.erase(first, last);
+      }
+      // copy [first, last) into the empty out, then erase it here
+      template <class E>
+      static void extract(E& e, E& out, typename E::iterator& first,
+                          typename E::iterator& last)
+      {
+         out.insert(first, last);
+         last = e.erase(first, last);
+      }
+      template <class E, class Pred>
+      static size_t eraseIf(E& e, Pred pred)
+      {
+         size_t num = 0;
+         for (auto it = e.begin(); it != e.end(); )
+            if (pred(*it))
+            {
+               it = e.erase(it);
+               num++;
+            }
+            else
+               ++it;
+         return num;
+      }
+      template <class E>
+      static void clear(E& e) noexcept
+      {
+         e.clear();
+      }
+      template <class E>
+      static void popFront(E& e)
+      {
+         if (!e.empty())
+         {
+            auto it = e.begin();
+            e.erase(it);
+         }
+      }
+      template <class E>
+      static void popBack(E& e)
+      {
+         if (!e.empty())
+         {
+            auto it = e.end();
+            --it;
+            e.erase(it);
+         }
+      }
+      template <class T, class E>
+      static T takeFront(E& e)
+      {
+         assert(!e.empty());
+         auto it = e.begin();
+         T t(*it);
+         e.erase(it);
+         return t;
+      }
+      template <class T, class E>
+      static T takeBack(E& e)
+      {
+         assert(!e.empty());
+         auto it = e.end();
+         T t(*--it);
+         e.erase(it);
+         return t;
+      }
+
+      //
+      // Layout
+      //
+      // nothing to do: only rb_tree's nodes are scattered on the heap
+      template <class E>
+      static void optimizeLayout(E&)
+      {}
+      template <class E>
+      static void compact(E&, node_order)
+      {}
+      template <class E>
+      static bool compactStep(E&, size_t)
+      {
+         return true;
+      }
+
+      //
+      // Status
+      //
+      template <class E>
+      static size_t bytesPerElement(const E& e) noexcept
+      {
+         return e.bytes_per_element();
+      }
+   };
+
+   /************************************************
+    * RB TREE
+    * A red-black BST with parent pointers: stable
+    * iterators, and the batch, parallel and extract
+    * operations only it has. Orders by operator <.
+    ***********************************************/
+   struct rb_tree : backend_generic
+   {
+      template <class T, class Compare>
+      using engine = BST<T>;
+      template <class T, class Compare>
+      using accepts = std::is_same<Compare, std::less<T>>;
+
+      template <class E, class U>
+      static std::pair<typename E::iterator, bool> insert(E& e, U&& t)
+      {
+         return e.insert(std::forward<U>(t), true /*keepUnique*/);
+      }
+      template <class E, class Iterator>
+      static void insertRange(E& e, Iterator first, Iterator last)
+      {
+         for (; first != last; ++first)
+            e.insert(*first, true /*keepUnique*/);
+      }
+      template <class E, class Iterator>
+      static void build(E& e, Iterator first, Iterator last)
+      {
+         insertRange(e, first, last);
+      }
+      template <class E, class Iterator, class Executor>
+      static size_t insertParallel(E& e, Iterator first, Iterator last,
+                                   const Executor& executor)
+      {
+         return e.insertParallel(first, last, executor);
+      }
+      template <class E, class Update, class Result>
+      static void applyBatch(E& e, std::vector<Update>&& batch, Result& result)
+      {
+         result = e.applyBatch(std::move(batch));
+      }
+      template <class E, class Iterator, class Found>
+      static void findMany(const E& e, Iterator first, Iterator last, Found found)
+      {
+         e.findMany(first, last, found);
+      }
+      template <class E, class T>
+      static size_t eraseKey(E& e, const T& t)
+      {
+         return e.eraseKey(t) ? 1 : 0;
+      }
+      // erasing leaves the node last refers to where it was
+      template <class E>
+      static typename E::iterator eraseRange(E& e, typename E::iterator& first,
+                                             typename E::iterator& last)
+      {
+         e.erase(first, last);
+         return last;
+      }
+      // splits the subtree off rather than copying it
+      template <class E>
+      static void extract(E& e, E& out, typename E::iterator& first,
+                          typename E::iterator& last)
+      {
+         out = e.extract(first, last);
+      }
+      template <class E, class Pred>
+      static size_t eraseIf(E& e, Pred pred)
+      {
+         return e.eraseIf(pred);
+      }
+      template <class E>
+      static void popFront(E& e)
+      {
+         e.popFront();
+      }
+      template <class E>
+      static void popBack(E& e)
+      {
+         e.popBack();
+      }
+      template <class T, class E>
+      static T takeFront(E& e)
+      {
+         return e.takeFront();
+      }
+      template <class T, class E>
+      static T takeBack(E& e)
+      {
+         return e.takeBack();
+      }
+      template <class E>
+      static void optimizeLayout(E& e)
+      {
+         e.optimizeLayout();
+      }
+      template <class E>
+      static void compact(E& e, node_order order)
+      {
+         e.compact(order);
+      }
+      template <class E>
+      static bool compactStep(E& e, size_t maxNodes)
+      {
+         return e.compactStep(maxNodes);
+      }
+      template <class E>
+      static size_t bytesPerElement(const E&) noexcept
+      {
+         return E::nodeSize();
+      }
+   };
+
+   /************************************************
+    * BTREE
+    * A B+ tree: few cache misses per search, cheap
+    * scans. An insert or erase can move other keys
+    * between nodes, so it invalidates iterators.
+    * Orders by operator <.
+    ***********************************************/
+   struct btree : backend_generic
+   {
+      template <class T, class Compare>
+      using engine = btree_set<T>;
+      template <class T, class Compare>
+      using accepts = std::is_same<Compare, std::less<T>>;
+   };
+
+   /************************************************
+    * FLAT
+    * A sorted array: the fastest reads while the set
+    * is small or seldom written. An insert or erase
+    * shifts the elements after it and invalidates
+    * iterators.
+    ***********************************************/
+   struct flat : backend_generic
+   {
+      template <class T, class Compare>
+      using engine = flat_set<T, Compare>;
+
+      // one pass that closes up the gaps, not a shift per erase
+      template <class E, class Pred>
+      static size_t eraseIf(E& e, Pred pred)
+      {
+         auto sequence = e.extract_sequence();
+         size_t numBefore = sequence.size();
+         sequence.erase(std::remove_if(sequence.begin(), sequence.end(), pred),
+                        sequence.end());
+         size_t num = numBefore - sequence.size();
+         e.replace(std::move(sequence));
+         return num;
+      }
+   };
+
+   /************************************************
+    * FROZEN
+    * A sorted array in Eytzinger order, filled once
+    * by the constructors: branch-free searches.
+    * Assigning a whole set replaces it; everything
+    * that would change it in place is deleted, so a
+    * call to one does not compile.
+    ***********************************************/
+   struct frozen : backend_generic
+   {
+      template <class T, class Compare>
+      using engine = frozen_set<T, Compare>;
+
+      template <class E, class Iterator>
+      static void build(E& e, Iterator first, Iterator last)
+      {
+         e = E(first, last);
+      }
+
+      template <class E, class U>
+      static void insert(E& e, U&& t) = delete;
+      template <class E, class Iterator>
+      static void insertRange(E& e, Iterator first, Iterator last) = delete;
+      template <class E, class Iterator, class Executor>
+      static void insertParallel(E& e, Iterator first, Iterator last,
+                                 const Executor& executor) = delete;
+      template <class E, class Update, class Result>
+      static void applyBatch(E& e, std::vector<Update>&& batch, Result& result) = delete;
+      template <class E>
+      static void erase(E& e, typename E::iterator& it) = delete;
+      template <class E, class T>
+      static void eraseKey(E& e, const T& t) = delete;
+      template <class E>
+      static void eraseRange(E& e, typename E::iterator& first,
+                             typename E::iterator& last) = delete;
+      template <class E>
+      static void extract(E& e, E& out, typename E::iterator& first,
+                          typename E::iterator& last) = delete;
+      template <class E, class Pred>
+      static void eraseIf(E& e, Pred pred) = delete;
+      template <class E>
+      static void clear(E& e) = delete;
+      template <class E>
+      static void popFront(E& e) = delete;
+      template <class E>
+      static void popBack(E& e) = delete;
+      template <class T, class E>
+      static void takeFront(E& e) = delete;
+      template <class T, class E>
+      static void takeBack(E& e) = delete;
+   };
+
+   /************************************************
+    * SMALL
+    * Up to N elements in a sorted array inside the
+    * set object, a red-black BST past that: no heap
+    * allocation for the many sets that stay small.
+    * Spilling to the tree or coming back inline
+    * invalidates iterators. Orders by operator <.
+    ***********************************************/
+   template <int N = 8>
+   struct small : backend_generic
+   {
+      template <class T, class Compare>
+      using engine = small_set<T, N>;
+      template <class T, class Compare>
+      using accepts = std::is_same<Compare, std::less<T>>;
+   };
+
+   /************************************************
+    * FIXED
+    * A red-black tree in an array of N nodes inside
+    * the set object: no allocation, ever. A full set
+    * turns inserts away, handing back end() and false.
+    * Iterators survive inserts and other erases.
+    * Orders by operator <.
+    ***********************************************/
+   template <int N>
+   struct fixed : backend_generic
+   {
+      template <class T, class Compare>
+      using engine = static_set<T, N>;
+      template <class T, class Compare>
+      using accepts = std::is_same<Compare, std::less<T>>;
+   };
+
+} // namespace custom
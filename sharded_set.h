@@ -0,0 +1,625 @@
+/***********************************************************************
+ * Header:
+ *    Sharded Set
+ * Summary:
+ *    A set split by key range into several independent sets, each with
+ *    its own lock, so writers working on different parts of the key
+ *    space never touch the same root or the same mutex.
+ *
+ *    The key ranges start out as one shard holding everything. When a
+ *    shard gets hot it is split at its median into an unused shard, and
+ *    once every shard is in use the two coldest neighbors are merged to
+ *    make room. The boundaries therefore follow the keys actually seen.
+ *
+ *    Old boundaries are reclaimed with epochs, as published_set does its
+ *    snapshots: a thread announces the epoch it started routing in, and
+ *    a replaced routing is freed once nobody who could have seen it is
+ *    still routing.
+ *
+ *    This will contain the class definition of:
+ *        sharded_set                : A set partitioned by key range
+ *        sharded_set::iterator      : An iterator through every shard in order
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <mutex>      // for std::mutex
+#include <atomic>     // for std::atomic
+#include <vector>     // for std::vector
+#include <memory>     // for std::unique_ptr
+#include <algorithm>  // for std::upper_bound
+#include <thread>     // for std::this_thread
+#include <functional> // for std::hash
+#include <cstdint>    // for uint64_t
+#include "set.h"
+
+class TestShardedSet; // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * SHARDED SET
+    * A set partitioned by key range into at most
+    * Shards independently locked sets
+    ***********************************************/
+   template <typename T, int Shards = 16>
+   class sharded_set
+   {
+      friend class ::TestShardedSet; // give unit tests access to the privates
+   public:
+      // a shard smaller than this is never split
+      static const size_t MIN_SPLIT = 1024;
+
+      // how many threads can be routing a value at the same time
+      static const int MAX_ROUTERS = 64;
+
+      //
+      // Construct
+      //
+      sharded_set();
+      explicit sharded_set(const std::vector<T>& boundaries);
+      sharded_set(const sharded_set& rhs) = delete;
+      sharded_set& operator =(const sharded_set& rhs) = delete;
+      ~sharded_set() { delete routing.load(); }
+
+      //
+      // Point operations: safe to call from any thread
+      //
+      bool   insert(const T& t);
+      size_t erase(const T& t);
+      bool   contains(const T& t) const;
+      size_t size() const noexcept;
+      bool   empty() const noexcept { return size() == 0; }
+      void   clear();
+
+      //
+      // Rebalance: split any shard that has grown hot
+      //
+      void rebalance();
+
+      //
+      // Ordered iteration: only while no other thread is writing
+      //
+      class iterator;
+      iterator begin() const;
+      iterator end()   const;
+      iterator lower_bound(const T& t) const;
+
+   private:
+
+      // where the keys go: shard i holds [bounds[i-1], bounds[i])
+      struct Routing
+      {
+         std::vector<T> bounds;
+      };
+
+      static const size_t LINE = 64;
+
+      // one shard, alone on its cache lines: padded rather than aligned,
+      // since before C++17 new ignores the alignment of an over-aligned type
+      struct Shard
+      {
+         char padFront[LINE];                 // no other shard's data on these lines
+         std::mutex mutex;                    // guards everything below
+         custom::set<T> s;                    // the elements in this range
+         const Routing* pRouting = nullptr;   // the routing this shard was laid out under
+         std::atomic<size_t> numElements{ 0 };// s.size(), readable without the lock
+         char padBack[LINE];
+      };
+
+      // one slot per thread routing right now, padded onto lines of its own
+      struct Slot
+      {
+         char padFront[LINE];
+         std::atomic<uint64_t> epoch{ 0 };    // epoch the thread entered in, 0 when free
+         char padBack[LINE];
+      };
+
+      // a routing waiting for the threads that could see it to leave
+      struct Retired
+      {
+         std::unique_ptr<const Routing> pRouting;
+         uint64_t epoch;                      // first epoch that cannot see it
+      };
+
+      class Entry;
+
+      int  route(const Routing* pRouting, const T& t) const;
+      template <class Operation>
+      auto withShard(const T& t, Operation operation) const;
+      bool isHot(int iShard) const;
+      void split(int iShard);
+      void splitLocked(int iShard);
+      void mergeLocked(int iShard);
+      void lockAll() const;
+      void unlockAll() const;
+      void publishLocked(std::vector<T>&& bounds);
+      size_t reclaim();
+
+      mutable Shard shards[Shards];
+      std::atomic<const Routing*> routing;           // the current routing
+      std::atomic<int> numUsed;                      // shards the current routing uses
+      std::atomic<uint64_t> globalEpoch;             // bumped on every publish
+      mutable Slot slots[MAX_ROUTERS];               // the threads routing right now
+      std::vector<Retired> retired;                  // rebalancer only
+      std::mutex rebalanceMutex;                     // one rebalance at a time
+   };
+
+   /**********************************************************
+    * SHARDED SET ENTRY
+    * While an entry is alive, no routing its thread could have
+    * picked up will be freed. Claim a slot, announce the epoch.
+    *********************************************************/
+   template <typename T, int Shards>
+   class sharded_set<T, Shards>::Entry
+   {
+   public:
+      Entry(const sharded_set& set)
+      {
+         // start looking at a spot that depends on the thread so
+         // threads rarely fight over a slot
+         size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+         for (size_t i = 0; ; i++)
+         {
+            pSlot = &set.slots[(start + i) % MAX_ROUTERS];
+            uint64_t expected = 0;
+            if (pSlot->epoch.load(std::memory_order_relaxed) == 0 &&
+                pSlot->epoch.compare_exchange_strong(expected,
+                   set.globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst))
+               return;
+
+            // every slot is busy: give the other threads a chance to leave
+            if (i && i % MAX_ROUTERS == 0)
+               std::this_thread::yield();
+         }
+      }
+      Entry(const Entry& rhs) = delete;
+      Entry& operator =(const Entry& rhs) = delete;
+      ~Entry()
+      {
+         pSlot->epoch.store(0, std::memory_order_release);
+      }
+
+   private:
+      Slot* pSlot;                   // our announcement, released when we leave
+   };
+
+   /**********************************************************
+    * SHARDED SET ITERATOR
+    * Walks each shard in turn, skipping empty ones
+    *********************************************************/
+   template <typename T, int Shards>
+   class sharded_set<T, Shards>::iterator
+   {
+      friend class custom::sharded_set<T, Shards>;
+   public:
+      iterator() : pSet(nullptr), iShard(Shards)
+      {}
+
+      bool operator ==(const iterator& rhs) const
+      {
+         return iShard == rhs.iShard && (iShard == Shards || it == rhs.it);
+      }
+      bool operator !=(const iterator& rhs) const
+      {
+         return !(*this == rhs);
+      }
+
+      const T& operator *() const
+      {
+         return *it;
+      }
+
+      iterator& operator ++()
+      {
+         ++it;
+         skipEmpty();
+         return *this;
+      }
+      iterator operator ++(int postfix)
+      {
+         iterator temp(*this);
+         ++(*this);
+         return temp;
+      }
+
+   private:
+      iterator(const sharded_set* pSet, int iShard, typename custom::set<T>::iterator it) :
+         pSet(pSet), iShard(iShard), it(it)
+      {
+         skipEmpty();
+      }
+
+      // at the end of one shard? Then hop to the start of the next
+      void skipEmpty()
+      {
+         while (iShard < Shards && it == pSet->shards[iShard].s.end())
+         {
+            if (++iShard < Shards)
+               it = pSet->shards[iShard].s.begin();
+         }
+      }
+
+      const sharded_set* pSet;                    // the set we walk through
+      int iShard;                                 // which shard, Shards for end()
+      typename custom::set<T>::iterator it;       // where in the shard
+   };
+
+
+   /*********************************************
+    * SHARDED SET :: DEFAULT CONSTRUCTOR
+    * One shard with everything until it gets hot
+    ********************************************/
+   template <typename T, int Shards>
+   sharded_set<T, Shards>::sharded_set() : routing(nullptr), numUsed(0), globalEpoch(1)
+   {
+      publishLocked(std::vector<T>());
+   }
+
+   /*********************************************
+    * SHARDED SET :: BOUNDARIES CONSTRUCTOR
+    * Start with known split points, sorted, at most Shards-1
+    ********************************************/
+   template <typename T, int Shards>
+   sharded_set<T, Shards>::sharded_set(const std::vector<T>& boundaries) :
+      routing(nullptr), numUsed(0), globalEpoch(1)
+   {
+      assert(boundaries.size() < (size_t)Shards);
+      publishLocked(std::vector<T>(boundaries));
+   }
+
+   /*********************************************
+    * SHARDED SET :: ROUTE
+    * Which shard a value belongs in
+    ********************************************/
+   template <typename T, int Shards>
+   int sharded_set<T, Shards>::route(const Routing* pRouting, const T& t) const
+   {
+      return (int)(std::upper_bound(pRouting->bounds.begin(), pRouting->bounds.end(), t)
+                   - pRouting->bounds.begin());
+   }
+
+   /*********************************************
+    * SHARDED SET :: WITH SHARD
+    * Lock the shard a value belongs in and run an operation on it.
+    * If a rebalance moved the boundaries between routing and locking,
+    * the shard will have been laid out under a different routing, so
+    * go around again. The entry keeps the routings we look at alive.
+    ********************************************/
+   template <typename T, int Shards>
+   template <class Operation>
+   auto sharded_set<T, Shards>::withShard(const T& t, Operation operation) const
+   {
+      Entry entry(*this);
+      while (true)
+      {
+         const Routing* pRouting = routing.load(std::memory_order_seq_cst);
+         int iShard = route(pRouting, t);
+         Shard& shard = shards[iShard];
+         std::lock_guard<std::mutex> lock(shard.mutex);
+         if (shard.pRouting == pRouting)
+            return operation(iShard, shard);
+      }
+   }
+
+   /*********************************************
+    * SHARDED SET :: INSERT
+    * Put a value in its shard, then split the shard if it is hot
+    ********************************************/
+   template <typename T, int Shards>
+   bool sharded_set<T, Shards>::insert(const T& t)
+   {
+      int iHot = -1;
+      bool inserted = withShard(t, [&](int iShard, Shard& shard)
+      {
+         if (!shard.s.insert(t).second)
+            return false;
+         size_t num = shard.numElements.load(std::memory_order_relaxed) + 1;
+         shard.numElements.store(num, std::memory_order_relaxed);
+
+         // only look at the other shards once in a while
+         if (num % 256 == 0 && isHot(iShard))
+            iHot = iShard;
+         return true;
+      });
+
+      if (iHot >= 0)
+         split(iHot);
+      return inserted;
+   }
+
+   /*********************************************
+    * SHARDED SET :: ERASE
+    ********************************************/
+   template <typename T, int Shards>
+   size_t sharded_set<T, Shards>::erase(const T& t)
+   {
+      return withShard(t, [&](int /*iShard*/, Shard& shard)
+      {
+         size_t num = shard.s.erase(t);
+         shard.numElements.store(shard.s.size(), std::memory_order_relaxed);
+         return num;
+      });
+   }
+
+   /*********************************************
+    * SHARDED SET :: CONTAINS
+    ********************************************/
+   template <typename T, int Shards>
+   bool sharded_set<T, Shards>::contains(const T& t) const
+   {
+      return withShard(t, [&](int /*iShard*/, Shard& shard)
+      {
+         return shard.s.find(t) != shard.s.end();
+      });
+   }
+
+   /*********************************************
+    * SHARDED SET :: SIZE
+    * Add up the shards. With writers running this is
+    * only a moment's estimate.
+    ********************************************/
+   template <typename T, int Shards>
+   size_t sharded_set<T, Shards>::size() const noexcept
+   {
+      size_t num = 0;
+      for (int i = 0; i < Shards; i++)
+         num += shards[i].numElements.load(std::memory_order_relaxed);
+      return num;
+   }
+
+   /*********************************************
+    * SHARDED SET :: CLEAR
+    * Empty every shard but keep the boundaries
+    ********************************************/
+   template <typename T, int Shards>
+   void sharded_set<T, Shards>::clear()
+   {
+      lockAll();
+      for (int i = 0; i < Shards; i++)
+      {
+         shards[i].s.clear();
+         shards[i].numElements.store(0, std::memory_order_relaxed);
+      }
+      unlockAll();
+   }
+
+   /*********************************************
+    * SHARDED SET :: IS HOT
+    * Should a shard be split? While there are free shards, any
+    * big one should. After that only one holding more than twice
+    * what the others average, since a merge is needed to make room.
+    * A set of one shard has nowhere to split to.
+    ********************************************/
+   template <typename T, int Shards>
+   bool sharded_set<T, Shards>::isHot(int iShard) const
+   {
+      size_t num = shards[iShard].numElements.load(std::memory_order_relaxed);
+      int numInUse = numUsed.load(std::memory_order_acquire);
+      if (num < MIN_SPLIT)
+         return false;
+      if (numInUse < Shards)
+         return true;
+      if (numInUse == 1)
+         return false;
+      size_t numOthers = size() - num;
+      return num > 2 * numOthers / (size_t)(numInUse - 1);
+   }
+
+   /*********************************************
+    * SHARDED SET :: REBALANCE
+    * Split every shard that has grown hot
+    ********************************************/
+   template <typename T, int Shards>
+   void sharded_set<T, Shards>::rebalance()
+   {
+      for (int i = 0; i < Shards; i++)
+         if (isHot(i))
+            split(i);
+   }
+
+   /*********************************************
+    * SHARDED SET :: SPLIT
+    * Stop the world and split a hot shard in two. If another
+    * thread is already rebalancing, let it do the work.
+    * A set of one shard has nowhere to split to.
+    ********************************************/
+   template <typename T, int Shards>
+   void sharded_set<T, Shards>::split(int iShard)
+   {
+      if (Shards == 1)
+         return;
+
+      std::unique_lock<std::mutex> guard(rebalanceMutex, std::try_to_lock);
+      if (!guard.owns_lock())
+         return;
+
+      lockAll();
+      if (isHot(iShard))
+      {
+         // no shard free? Merge the coldest neighbors to make one
+         int numUsed = (int)routing.load()->bounds.size() + 1;
+         if (numUsed == Shards)
+         {
+            int iCold = -1;
+            size_t coldest = shards[iShard].numElements / 2;
+            for (int i = 0; i + 1 < numUsed; i++)
+            {
+               size_t num = shards[i].numElements + shards[i + 1].numElements;
+               if (i != iShard && i + 1 != iShard && num < coldest)
+               {
+                  coldest = num;
+                  iCold = i;
+               }
+            }
+            if (iCold >= 0)
+            {
+               mergeLocked(iCold);
+               if (iShard > iCold)
+                  iShard--;
+               numUsed--;
+            }
+         }
+
+         if (numUsed < Shards)
+            splitLocked(iShard);
+      }
+      unlockAll();
+   }
+
+   /*********************************************
+    * SHARDED SET :: SPLIT LOCKED
+    * Move the upper half of a shard into the shard above it,
+    * shifting the used shards above up by one. All locks held.
+    ********************************************/
+   template <typename T, int Shards>
+   void sharded_set<T, Shards>::splitLocked(int iShard)
+   {
+      std::vector<T> bounds = routing.load()->bounds;
+      int numUsed = (int)bounds.size() + 1;
+      assert(numUsed < Shards);
+
+      // make room right above the hot shard
+      for (int i = numUsed; i > iShard + 1; i--)
+         shards[i].s.swap(shards[i - 1].s);
+
+      // move everything from the median up
+      custom::set<T>& sLower = shards[iShard].s;
+      custom::set<T>& sUpper = shards[iShard + 1].s;
+      auto itMedian = sLower.begin();
+      for (size_t i = 0; i < sLower.size() / 2; i++)
+         ++itMedian;
+      T median(*itMedian);
+      for (auto it = itMedian; it != sLower.end(); ++it)
+         sUpper.insert(*it);
+      auto itEnd = sLower.end();
+      sLower.erase(itMedian, itEnd);
+
+      bounds.insert(bounds.begin() + iShard, median);
+      publishLocked(std::move(bounds));
+   }
+
+   /*********************************************
+    * SHARDED SET :: MERGE LOCKED
+    * Fold a shard's upper neighbor into it, shifting the used
+    * shards above down by one. All locks held.
+    ********************************************/
+   template <typename T, int Shards>
+   void sharded_set<T, Shards>::mergeLocked(int iShard)
+   {
+      std::vector<T> bounds = routing.load()->bounds;
+      int numUsed = (int)bounds.size() + 1;
+      assert(iShard + 1 < numUsed);
+
+      custom::set<T>& sUpper = shards[iShard + 1].s;
+      shards[iShard].s.insert(sUpper.begin(), sUpper.end());
+      sUpper.clear();
+      for (int i = iShard + 1; i + 1 < numUsed; i++)
+         shards[i].s.swap(shards[i + 1].s);
+
+      bounds.erase(bounds.begin() + iShard);
+      publishLocked(std::move(bounds));
+   }
+
+   /*********************************************
+    * SHARDED SET :: PUBLISH LOCKED
+    * Install new boundaries. Every shard is stamped with the new
+    * routing so a thread that routed with the old one will retry.
+    * The old routing is retired, not freed: a thread may be searching it.
+    ********************************************/
+   template <typename T, int Shards>
+   void sharded_set<T, Shards>::publishLocked(std::vector<T>&& bounds)
+   {
+      Routing* pRouting = new Routing{ std::move(bounds) };
+      for (int i = 0; i < Shards; i++)
+      {
+         shards[i].pRouting = pRouting;
+         shards[i].numElements.store(shards[i].s.size(), std::memory_order_relaxed);
+      }
+      numUsed.store((int)pRouting->bounds.size() + 1, std::memory_order_release);
+      const Routing* pOld = routing.exchange(pRouting, std::memory_order_seq_cst);
+      if (!pOld)
+         return;
+
+      // anyone entering from now on sees pRouting
+      uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+      retired.push_back({ std::unique_ptr<const Routing>(pOld), epoch });
+      reclaim();
+   }
+
+   /*********************************************
+    * SHARDED SET :: RECLAIM
+    * Free every retired routing that no thread can still be
+    * searching. Returns how many are still waiting.
+    ********************************************/
+   template <typename T, int Shards>
+   size_t sharded_set<T, Shards>::reclaim()
+   {
+      // the oldest epoch any thread is still routing in
+      uint64_t oldest = UINT64_MAX;
+      for (int i = 0; i < MAX_ROUTERS; i++)
+      {
+         uint64_t epoch = slots[i].epoch.load(std::memory_order_seq_cst);
+         if (epoch && epoch < oldest)
+            oldest = epoch;
+      }
+
+      // a thread in epoch e can only hold routings retired after e
+      size_t kept = 0;
+      for (size_t i = 0; i < retired.size(); i++)
+         if (retired[i].epoch > oldest)
+            retired[kept++] = std::move(retired[i]);
+      retired.resize(kept);
+      return kept;
+   }
+
+   /*********************************************
+    * SHARDED SET :: LOCK ALL / UNLOCK ALL
+    * Always in shard order so two lockers cannot deadlock
+    ********************************************/
+   template <typename T, int Shards>
+   void sharded_set<T, Shards>::lockAll() const
+   {
+      for (int i = 0; i < Shards; i++)
+         shards[i].mutex.lock();
+   }
+
+   template <typename T, int Shards>
+   void sharded_set<T, Shards>::unlockAll() const
+   {
+      for (int i = Shards - 1; i >= 0; i--)
+         shards[i].mutex.unlock();
+   }
+
+   /*********************************************
+    * SHARDED SET :: BEGIN / END
+    ********************************************/
+   template <typename T, int Shards>
+   typename sharded_set<T, Shards>::iterator sharded_set<T, Shards>::begin() const
+   {
+      return iterator(this, 0, shards[0].s.begin());
+   }
+
+   template <typename T, int Shards>
+   typename sharded_set<T, Shards>::iterator sharded_set<T, Shards>::end() const
+   {
+      return iterator();
+   }
+
+   /*********************************************
+    * SHARDED SET :: LOWER BOUND
+    * Look in the value's own shard; if everything there is
+    * smaller, the answer is the first element of a later shard
+    ********************************************/
+   template <typename T, int Shards>
+   typename sharded_set<T, Shards>::iterator sharded_set<T, Shards>::lower_bound(const T& t) const
+   {
+      int iShard = route(routing.load(std::memory_order_acquire), t);
+      return iterator(this, iShard, shards[iShard].s.lower_bound(t));
+   }
+
+} // namespace custom
@@ -0,0 +1,276 @@
+/***********************************************************************
+ * Header:
+ *    SIMD Search
+ * Summary:
+ *    Find where a key goes among a node's sorted keys without a single
+ *    branch on the data: compare it with eight keys (AVX2) or four
+ *    (SSE4.2) at a time, turn each compare into a bit mask, and count
+ *    the bits. The count of keys below the probe is its lower bound,
+ *    and the child to descend into.
+ *
+ *    Only for 32- and 64-bit integers. The instruction set is checked
+ *    once at run time, so one build runs everywhere; a CPU with
+ *    neither, or a compiler that cannot say them, gets a plain loop
+ *    the optimizer can still vectorize.
+ *
+ *    This will contain:
+ *        simd_level                 : Which kernels this CPU can run
+ *        simd_searchable            : Whether a key type can use them
+ *        simdCountBelow             : How many keys are less than a probe
+ *        simdCountAbove             : How many keys are greater than a probe
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cstdint>      // for int32_t and int64_t
+#include <type_traits>  // for std::is_integral
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define CUSTOM_SIMD_X86
+#include <intrin.h>     // for __cpuidex, __popcnt
+#include <immintrin.h>  // for the AVX2 and SSE4.2 intrinsics
+#define CUSTOM_TARGET_AVX2
+#define CUSTOM_TARGET_SSE42
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CUSTOM_SIMD_X86
+#include <immintrin.h>  // for the AVX2 and SSE4.2 intrinsics
+// let these functions use the instructions the rest of the build may not
+#define CUSTOM_TARGET_AVX2  __attribute__((target("avx2,popcnt")))
+#define CUSTOM_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#endif
+
+namespace custom
+{
+
+   /************************************************
+    * SIMD LEVEL
+    * The widest kernels this CPU runs, best last
+    ***********************************************/
+   enum class simd_level { SCALAR, SSE42, AVX2 };
+
+   /************************************************
+    * SIMD SEARCHABLE
+    * Integers of 32 or 64 bits, signed or not
+    ***********************************************/
+   template <typename T>
+   struct simd_searchable : std::integral_constant<bool,
+      std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+      (sizeof(T) == 4 || sizeof(T) == 8)>
+   {};
+
+   /*********************************************
+    * DETECT SIMD LEVEL
+    * Ask the CPU, and on Windows the OS too: AVX2
+    * is no use if the OS does not save its registers
+    ********************************************/
+   inline simd_level detectSimdLevel() noexcept
+   {
+#if defined(CUSTOM_SIMD_X86) && defined(_MSC_VER)
+      int info[4];
+      __cpuidex(info, 1, 0);
+      bool sse42 = (info[2] & (1 << 20)) && (info[2] & (1 << 23));   // and popcnt
+      bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                   (_xgetbv(0) & 6) == 6;
+      __cpuidex(info, 7, 0);
+      bool avx2 = osAvx && (info[1] & (1 << 5));
+      return avx2 && sse42 ? simd_level::AVX2 : sse42 ? simd_level::SSE42 : simd_level::SCALAR;
+#elif defined(CUSTOM_SIMD_X86)
+      __builtin_cpu_init();
+      bool sse42 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+      if (sse42 && __builtin_cpu_supports("avx2"))
+         return simd_level::AVX2;
+      return sse42 ? simd_level::SSE42 : simd_level::SCALAR;
+#else
+      return simd_level::SCALAR;
+#endif
+   }
+
+   /*********************************************
+    * SIMD LEVEL
+    * Detected the first time it is asked for
+    ********************************************/
+   inline simd_level simdLevel() noexcept
+   {
+      static const simd_level level = detectSimdLevel();
+      return level;
+   }
+
+   namespace simd_detail
+   {
+      /*********************************************
+       * COUNT SCALAR
+       * The fallback, and the tail past the last
+       * full vector. Unsigned keys arrive with their
+       * top bit flipped so a signed compare orders them.
+       ********************************************/
+      template <bool ABOVE, typename S>
+      inline int countScalar(const S* keys, int n, S t, S flip) noexcept
+      {
+         int count = 0;
+         t ^= flip;
+         for (int i = 0; i < n; i++)
+         {
+            S key = keys[i] ^ flip;
+            count += ABOVE ? (key > t) : (key < t);
+         }
+         return count;
+      }
+
+#if defined(CUSTOM_SIMD_X86)
+#if defined(_MSC_VER)
+      inline int popcount(unsigned int bits) noexcept { return (int)__popcnt(bits); }
+#else
+      inline int popcount(unsigned int bits) noexcept { return __builtin_popcount(bits); }
+#endif
+
+      /*********************************************
+       * COUNT 32 AVX2
+       * Eight 32-bit keys per compare
+       ********************************************/
+      template <bool ABOVE>
+      CUSTOM_TARGET_AVX2 int count32Avx2(const int32_t* keys, int n, int32_t t, int32_t flip) noexcept
+      {
+         __m256i vFlip = _mm256_set1_epi32(flip);
+         __m256i vT = _mm256_set1_epi32(t ^ flip);
+         int count = 0;
+         int i = 0;
+         for (; i + 8 <= n; i += 8)
+         {
+            __m256i vKeys = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + i)), vFlip);
+            __m256i vHit = ABOVE ? _mm256_cmpgt_epi32(vKeys, vT) : _mm256_cmpgt_epi32(vT, vKeys);
+            count += popcount((unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(vHit)));
+         }
+         return count + countScalar<ABOVE>(keys + i, n - i, t, flip);
+      }
+
+      /*********************************************
+       * COUNT 64 AVX2
+       * Four 64-bit keys per compare
+       ********************************************/
+      template <bool ABOVE>
+      CUSTOM_TARGET_AVX2 int count64Avx2(const int64_t* keys, int n, int64_t t, int64_t flip) noexcept
+      {
+         __m256i vFlip = _mm256_set1_epi64x(flip);
+         __m256i vT = _mm256_set1_epi64x(t ^ flip);
+         int count = 0;
+         int i = 0;
+         for (; i + 4 <= n; i += 4)
+         {
+            __m256i vKeys = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + i)), vFlip);
+            __m256i vHit = ABOVE ? _mm256_cmpgt_epi64(vKeys, vT) : _mm256_cmpgt_epi64(vT, vKeys);
+            count += popcount((unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(vHit)));
+         }
+         return count + countScalar<ABOVE>(keys + i, n - i, t, flip);
+      }
+
+      /*********************************************
+       * COUNT 32 SSE4.2
+       * Four 32-bit keys per compare
+       ********************************************/
+      template <bool ABOVE>
+      CUSTOM_TARGET_SSE42 int count32Sse42(const int32_t* keys, int n, int32_t t, int32_t flip) noexcept
+      {
+         __m128i vFlip = _mm_set1_epi32(flip);
+         __m128i vT = _mm_set1_epi32(t ^ flip);
+         int count = 0;
+         int i = 0;
+         for (; i + 4 <= n; i += 4)
+         {
+            __m128i vKeys = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), vFlip);
+            __m128i vHit = ABOVE ? _mm_cmpgt_epi32(vKeys, vT) : _mm_cmpgt_epi32(vT, vKeys);
+            count += popcount((unsigned int)_mm_movemask_ps(_mm_castsi128_ps(vHit)));
+         }
+         return count + countScalar<ABOVE>(keys + i, n - i, t, flip);
+      }
+
+      /*********************************************
+       * COUNT 64 SSE4.2
+       * Two 64-bit keys per compare
+       ********************************************/
+      template <bool ABOVE>
+      CUSTOM_TARGET_SSE42 int count64Sse42(const int64_t* keys, int n, int64_t t, int64_t flip) noexcept
+      {
+         __m128i vFlip = _mm_set1_epi64x(flip);
+         __m128i vT = _mm_set1_epi64x(t ^ flip);
+         int count = 0;
+         int i = 0;
+         for (; i + 2 <= n; i += 2)
+         {
+            __m128i vKeys = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), vFlip);
+            __m128i vHit = ABOVE ? _mm_cmpgt_epi64(vKeys, vT) : _mm_cmpgt_epi64(vT, vKeys);
+            count += popcount((unsigned int)_mm_movemask_pd(_mm_castsi128_pd(vHit)));
+         }
+         return count + countScalar<ABOVE>(keys + i, n - i, t, flip);
+      }
+#endif // CUSTOM_SIMD_X86
+
+      /*********************************************
+       * COUNT
+       * Pick the kernel for the width and the level
+       ********************************************/
+      template <bool ABOVE>
+      inline int count(const int32_t* keys, int n, int32_t t, int32_t flip, simd_level level) noexcept
+      {
+#if defined(CUSTOM_SIMD_X86)
+         if (level == simd_level::AVX2)
+            return count32Avx2<ABOVE>(keys, n, t, flip);
+         if (level == simd_level::SSE42)
+            return count32Sse42<ABOVE>(keys, n, t, flip);
+#endif
+         return countScalar<ABOVE>(keys, n, t, flip);
+      }
+      template <bool ABOVE>
+      inline int count(const int64_t* keys, int n, int64_t t, int64_t flip, simd_level level) noexcept
+      {
+#if defined(CUSTOM_SIMD_X86)
+         if (level == simd_level::AVX2)
+            return count64Avx2<ABOVE>(keys, n, t, flip);
+         if (level == simd_level::SSE42)
+            return count64Sse42<ABOVE>(keys, n, t, flip);
+#endif
+         return countScalar<ABOVE>(keys, n, t, flip);
+      }
+
+      /*********************************************
+       * COUNT KEYS
+       * Any 32- or 64-bit integer as the signed integer
+       * of its width; unsigned ones get their top bit
+       * flipped on the way in
+       ********************************************/
+      template <bool ABOVE, typename T>
+      inline int countKeys(const T* keys, int n, const T& t, simd_level level) noexcept
+      {
+         static_assert(simd_searchable<T>::value, "only 32- and 64-bit integers");
+         using S = typename std::conditional<sizeof(T) == 4, int32_t, int64_t>::type;
+         using U = typename std::make_unsigned<S>::type;
+         const S flip = std::is_signed<T>::value ? 0 : (S)((U)1 << (sizeof(S) * 8 - 1));
+         return count<ABOVE>(reinterpret_cast<const S*>(keys), n, (S)t, flip, level);
+      }
+   } // namespace simd_detail
+
+   /*********************************************
+    * SIMD COUNT BELOW
+    * How many of keys[0, n) are less than t: where t
+    * goes in them if they are sorted
+    ********************************************/
+   template <typename T>
+   inline int simdCountBelow(const T* keys, int n, const T& t,
+                             simd_level level = simdLevel()) noexcept
+   {
+      return simd_detail::countKeys<false>(keys, n, t, level);
+   }
+
+   /*********************************************
+    * SIMD COUNT ABOVE
+    * How many of keys[0, n) are greater than t
+    ********************************************/
+   template <typename T>
+   inline int simdCountAbove(const T* keys, int n, const T& t,
+                             simd_level level = simdLevel()) noexcept
+   {
+      return simd_detail::countKeys<true>(keys, n, t, level);
+   }
+
+} // namespace custom
@@ -0,0 +1,503 @@
+/***********************************************************************
+ * Header:
+ *    Small Set
+ * Summary:
+ *    A set that keeps up to N elements in a sorted array inside the
+ *    object, so the many sets that only ever hold a handful cost no
+ *    heap allocation and no pointer chasing. The N+1st element spills
+ *    them all into a BST, built in one pass since they are already
+ *    sorted; when erases bring it down to N/2 they come back inline.
+ *
+ *    It is the engine of the small<N> set backend, which gives it all of
+ *    set's interface: custom::set<T, std::less<T>, custom::small<N>>.
+ *
+ *    Iterators: an insert or erase that spills or comes back inline
+ *    invalidates every iterator; the iterator it returns is valid.
+ *    While inline, the elements live in the object, so moving or
+ *    swapping the set invalidates its iterators too.
+ *
+ *    This will contain the class definition of:
+ *        small_set                  : A set stored inline until it is big
+ *        small_set::iterator        : An iterator through either storage
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <new>        // for placement new
+#include <vector>     // for std::vector
+#include <algorithm>  // for std::lower_bound, std::move_backward
+#include <iterator>   // for std::make_move_iterator
+#include <utility>    // for std::pair
+#include <initializer_list>
+#include "bst.h"
+
+class TestSmallSet;    // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * SMALL SET
+    * A set of unique values, in the object while
+    * there are N or fewer, in a BST after that
+    ***********************************************/
+   template <typename T, int N = 8>
+   class small_set
+   {
+      friend class ::TestSmallSet; // give unit tests access to the privates
+      static_assert(N >= 2, "an inline array needs room for two elements");
+   public:
+      // the most elements kept in the object, and the size they come back at
+      static const size_t INLINE_MAX  = N;
+      static const size_t INLINE_BACK = N / 2;
+
+      //
+      // Construct
+      //
+      small_set() noexcept : numInline(0), isInline(true)
+      {}
+      small_set(const small_set& rhs) : small_set()
+      {
+         copyFrom(rhs);
+      }
+      small_set(small_set&& rhs) : small_set()
+      {
+         moveFrom(rhs);
+      }
+      small_set(const std::initializer_list<T>& il) : small_set()
+      {
+         insert(il.begin(), il.end());
+      }
+      template <class Iterator>
+      small_set(Iterator first, Iterator last) : small_set()
+      {
+         insert(first, last);
+      }
+      ~small_set()
+      {
+         destroy();
+      }
+
+      //
+      // Assign
+      //
+      small_set& operator =(const small_set& rhs)
+      {
+         if (this != &rhs)
+         {
+            destroy();
+            copyFrom(rhs);
+         }
+         return *this;
+      }
+      small_set& operator =(small_set&& rhs)
+      {
+         if (this != &rhs)
+         {
+            destroy();
+            moveFrom(rhs);
+         }
+         return *this;
+      }
+      small_set& operator =(const std::initializer_list<T>& il)
+      {
+         clear();
+         insert(il.begin(), il.end());
+         return *this;
+      }
+      void swap(small_set& rhs)
+      {
+         small_set temp(std::move(rhs));
+         rhs = std::move(*this);
+         *this = std::move(temp);
+      }
+
+      //
+      // Iterator
+      //
+      class iterator;
+      iterator begin() const noexcept
+      {
+         return isInline ? iterator(keys()) : iterator(bst.begin());
+      }
+      iterator end() const noexcept
+      {
+         return isInline ? iterator(keys() + numInline) : iterator(bst.end());
+      }
+
+      //
+      // Access
+      //
+      iterator find(const T& t) const;
+      iterator lower_bound(const T& t) const
+      {
+         return isInline ? iterator(keys() + lowerIndex(t)) : iterator(bst.lower_bound(t));
+      }
+
+      //
+      // Status
+      //
+      bool   empty() const noexcept { return size() == 0; }
+      size_t size()  const noexcept { return isInline ? numInline : bst.size(); }
+      bool   is_inline() const noexcept { return isInline; }
+
+      // bytes each element costs: its share of the object while inline,
+      // a node after the spill
+      size_t bytes_per_element() const noexcept
+      {
+         if (!isInline)
+            return BST<T>::nodeSize();
+         return numInline ? (sizeof(small_set) + numInline - 1) / numInline : sizeof(small_set);
+      }
+
+      //
+      // Insert
+      //
+      std::pair<iterator, bool> insert(const T& t)
+      {
+         return insertValue(t);
+      }
+      std::pair<iterator, bool> insert(T&& t)
+      {
+         return insertValue(std::move(t));
+      }
+      void insert(const std::initializer_list<T>& il)
+      {
+         insert(il.begin(), il.end());
+      }
+      template <class Iterator>
+      void insert(Iterator first, Iterator last)
+      {
+         for (; first != last; ++first)
+            insertValue(*first);
+      }
+
+      //
+      // Remove
+      //
+      size_t   erase(const T& t);
+      iterator erase(iterator& it);
+      iterator erase(iterator& itBegin, iterator& itEnd);
+      void clear() noexcept
+      {
+         destroy();
+      }
+
+   private:
+
+      template <class U>
+      std::pair<iterator, bool> insertValue(U&& t);
+      iterator comeBack(const iterator& itNext);
+      void spill();
+      void copyFrom(const small_set& rhs);
+      void moveFrom(small_set& rhs);
+      void destroy() noexcept;
+      size_t lowerIndex(const T& t) const;
+
+      T*       keys()       noexcept { return reinterpret_cast<T*>(buffer); }
+      const T* keys() const noexcept { return reinterpret_cast<const T*>(buffer); }
+
+      // the elements, in the one isInline says is alive
+      union
+      {
+         alignas(T) unsigned char buffer[N * sizeof(T)];
+         BST<T> bst;
+      };
+      unsigned int numInline;                  // elements in buffer
+      bool isInline;                           // buffer, or bst
+   };
+
+   /**************************************************
+    * SMALL SET ITERATOR
+    * A pointer into the array while inline, a BST
+    * iterator after the spill
+    *************************************************/
+   template <typename T, int N>
+   class small_set<T, N>::iterator
+   {
+      friend class ::TestSmallSet;
+      friend class custom::small_set<T, N>;
+   public:
+      // so std::reverse_iterator and the algorithms can use it
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const T*;
+      using reference         = const T&;
+
+      iterator() : p(nullptr), it(), inTree(false)
+      {}
+
+      bool operator ==(const iterator& rhs) const
+      {
+         return inTree ? it == rhs.it : p == rhs.p;
+      }
+      bool operator !=(const iterator& rhs) const
+      {
+         return !(*this == rhs);
+      }
+
+      const T& operator *() const
+      {
+         return inTree ? *it : *p;
+      }
+
+      iterator& operator ++()
+      {
+         if (inTree)
+            ++it;
+         else
+            ++p;
+         return *this;
+      }
+      iterator operator ++(int postfix)
+      {
+         iterator temp(*this);
+         ++*this;
+         return temp;
+      }
+      iterator& operator --()
+      {
+         if (inTree)
+            --it;
+         else
+            --p;
+         return *this;
+      }
+      iterator operator --(int postfix)
+      {
+         iterator temp(*this);
+         --*this;
+         return temp;
+      }
+
+   private:
+      explicit iterator(const T* p) : p(p), it(), inTree(false)
+      {}
+      explicit iterator(const typename BST<T>::iterator& it) : p(nullptr), it(it), inTree(true)
+      {}
+
+      const T* p;                         // into the array, while inline
+      typename BST<T>::iterator it;       // into the tree, after the spill
+      bool inTree;                        // which of the two
+   };
+
+
+   /*********************************************
+    * SMALL SET :: FIND
+    ********************************************/
+   template <typename T, int N>
+   typename small_set<T, N>::iterator small_set<T, N>::find(const T& t) const
+   {
+      if (!isInline)
+         return iterator(const_cast<BST<T>&>(bst).find(t));   // find() changes nothing
+      size_t i = lowerIndex(t);
+      return (i < numInline && !(t < keys()[i])) ? iterator(keys() + i) : end();
+   }
+
+   /*********************************************
+    * SMALL SET :: INSERT VALUE
+    * Shift along inside the object while there is
+    * room; the element after that spills to the BST
+    ********************************************/
+   template <typename T, int N>
+   template <class U>
+   std::pair<typename small_set<T, N>::iterator, bool> small_set<T, N>::insertValue(U&& t)
+   {
+      if (isInline)
+      {
+         T* pKeys = keys();
+         size_t i = lowerIndex(t);
+         if (i < numInline && !(t < pKeys[i]))
+            return { iterator(pKeys + i), false };
+         if (numInline < INLINE_MAX)
+         {
+            if (i < numInline)
+            {
+               new (pKeys + numInline) T(std::move(pKeys[numInline - 1]));
+               std::move_backward(pKeys + i, pKeys + numInline - 1, pKeys + numInline);
+               pKeys[i] = T(std::forward<U>(t));
+            }
+            else
+               new (pKeys + i) T(std::forward<U>(t));
+            numInline++;
+            return { iterator(pKeys + i), true };
+         }
+         spill();
+      }
+
+      auto result = bst.insert(std::forward<U>(t), true /*keepUnique*/);
+      return { iterator(result.first), result.second };
+   }
+
+   /*********************************************
+    * SMALL SET :: ERASE VALUE
+    ********************************************/
+   template <typename T, int N>
+   size_t small_set<T, N>::erase(const T& t)
+   {
+      iterator it = find(t);
+      if (it == end())
+         return 0;
+      erase(it);
+      return 1;
+   }
+
+   /*********************************************
+    * SMALL SET :: ERASE ITERATOR
+    * Hands back the element after the one erased
+    ********************************************/
+   template <typename T, int N>
+   typename small_set<T, N>::iterator small_set<T, N>::erase(iterator& it)
+   {
+      if (!isInline)
+         return comeBack(iterator(bst.erase(it.it)));
+
+      T* pKeys = keys();
+      T* p = pKeys + (it.p - pKeys);
+      std::move(p + 1, pKeys + numInline, p);
+      pKeys[numInline - 1].~T();
+      numInline--;
+      return iterator(p);
+   }
+
+   /*********************************************
+    * SMALL SET :: ERASE RANGE
+    * Hands back where itEnd ended up
+    ********************************************/
+   template <typename T, int N>
+   typename small_set<T, N>::iterator small_set<T, N>::erase(iterator& itBegin, iterator& itEnd)
+   {
+      if (!isInline)
+      {
+         bst.erase(itBegin.it, itEnd.it);
+         return comeBack(itEnd);
+      }
+
+      T* pKeys = keys();
+      T* pBegin = pKeys + (itBegin.p - pKeys);
+      T* pEnd = pKeys + (itEnd.p - pKeys);
+      T* pLast = std::move(pEnd, pKeys + numInline, pBegin);
+      for (T* p = pLast; p != pKeys + numInline; ++p)
+         p->~T();
+      numInline = (unsigned int)(pLast - pKeys);
+      return iterator(pBegin);
+   }
+
+   /*********************************************
+    * SMALL SET :: COME BACK
+    * After an erase from the BST: back inline if it
+    * is down to INLINE_BACK, carrying the iterator
+    * to the next element across by its offset
+    ********************************************/
+   template <typename T, int N>
+   typename small_set<T, N>::iterator small_set<T, N>::comeBack(const iterator& itNext)
+   {
+      if (bst.size() > INLINE_BACK)
+         return itNext;
+
+      size_t offset = 0;
+      for (auto it = bst.begin(); it != itNext.it; ++it)
+         offset++;
+
+      std::vector<T> sorted;
+      sorted.reserve(bst.size());
+      for (auto it = bst.begin(); it != bst.end(); ++it)
+         sorted.push_back(*it);
+      bst.~BST<T>();
+      for (size_t i = 0; i < sorted.size(); i++)
+         new (keys() + i) T(std::move(sorted[i]));
+      numInline = (unsigned int)sorted.size();
+      isInline = true;
+      return iterator(keys() + offset);
+   }
+
+   /*********************************************
+    * SMALL SET :: SPILL
+    * Move the full array into a BST; it is sorted
+    * already, so the tree is built in one pass
+    ********************************************/
+   template <typename T, int N>
+   void small_set<T, N>::spill()
+   {
+      std::vector<T> sorted(std::make_move_iterator(keys()),
+                            std::make_move_iterator(keys() + numInline));
+      destroy();
+      new (&bst) BST<T>();
+      isInline = false;
+      bst.assignSorted(std::make_move_iterator(sorted.begin()),
+                       std::make_move_iterator(sorted.end()));
+   }
+
+   /*********************************************
+    * SMALL SET :: COPY FROM
+    * Into a set with nothing alive
+    ********************************************/
+   template <typename T, int N>
+   void small_set<T, N>::copyFrom(const small_set& rhs)
+   {
+      if (!rhs.isInline)
+      {
+         new (&bst) BST<T>(rhs.bst);
+         isInline = false;
+         return;
+      }
+      for (size_t i = 0; i < rhs.numInline; i++)
+         new (keys() + i) T(rhs.keys()[i]);
+      numInline = rhs.numInline;
+   }
+
+   /*********************************************
+    * SMALL SET :: MOVE FROM
+    * Into a set with nothing alive; rhs is left
+    * empty and inline
+    ********************************************/
+   template <typename T, int N>
+   void small_set<T, N>::moveFrom(small_set& rhs)
+   {
+      if (!rhs.isInline)
+      {
+         new (&bst) BST<T>(std::move(rhs.bst));
+         isInline = false;
+      }
+      else
+      {
+         for (size_t i = 0; i < rhs.numInline; i++)
+            new (keys() + i) T(std::move(rhs.keys()[i]));
+         numInline = rhs.numInline;
+      }
+      rhs.destroy();
+   }
+
+   /*********************************************
+    * SMALL SET :: DESTROY
+    * End whatever is alive, leaving an empty inline set
+    ********************************************/
+   template <typename T, int N>
+   void small_set<T, N>::destroy() noexcept
+   {
+      if (!isInline)
+         bst.~BST<T>();
+      else
+         for (size_t i = 0; i < numInline; i++)
+            keys()[i].~T();
+      numInline = 0;
+      isInline = true;
+   }
+
+   /*********************************************
+    * SMALL SET :: LOWER INDEX
+    * Where t goes among the inline elements
+    ********************************************/
+   template <typename T, int N>
+   size_t small_set<T, N>::lowerIndex(const T& t) const
+   {
+      const T* pKeys = keys();
+      return std::lower_bound(pKeys, pKeys + numInline, t) - pKeys;
+   }
+
+} // namespace custom
@@ -0,0 +1,821 @@
+/***********************************************************************
+ * Header:
+ *    Static Set
+ * Summary:
+ *    A red-black tree whose nodes are an array of N inside the object,
+ *    linked by index rather than by pointer. Nothing is ever allocated:
+ *    a free node comes off the end of the array or off a free list
+ *    threaded through the nodes erased before. For paths that may not
+ *    touch the heap at all.
+ *
+ *    A full set does not grow: insert() reports the failure by handing
+ *    back end() and false, and insert(first, last) by returning false.
+ *    Nothing throws. The constructor is constexpr, so a static_set of a
+ *    literal type is a literal type.
+ *
+ *    Indexes stay put across inserts and erases, so only erasing an
+ *    element invalidates iterators to it. They point into the object
+ *    itself, so moving or swapping the set invalidates them all.
+ *
+ *    This will contain the class definition of:
+ *        static_set                 : A set in a fixed array of nodes
+ *        static_set::iterator       : An in-order iterator
+ *        static_nodes               : The array and its free list
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>      // for size_t
+#include <new>          // for placement new
+#include <iterator>     // for std::reverse_iterator
+#include <type_traits>  // for std::conditional, std::is_trivially_destructible
+#include <utility>      // for std::pair, std::move, std::declval
+#include <initializer_list>
+
+class TestStaticSet;    // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * STATIC SLOT
+    * Room for one T, built only when a node is in
+    * use. A union so that the array of them costs
+    * no constructor calls and can be constexpr.
+    ***********************************************/
+   template <typename T, bool = std::is_trivially_destructible<T>::value>
+   union static_slot
+   {
+      constexpr static_slot() noexcept : none()
+      {}
+      char none;
+      T    data;
+   };
+   template <typename T>
+   union static_slot<T, false>
+   {
+      constexpr static_slot() noexcept : none()
+      {}
+      ~static_slot()          // the set destroys the elements it built
+      {}
+      char none;
+      T    data;
+   };
+
+   /************************************************
+    * STATIC NODES
+    * N nodes, their links by index, and the list of
+    * free ones. Those past numUsed have never been
+    * used; those on the list are marked FREE.
+    ***********************************************/
+   template <typename T, int N, bool = std::is_trivially_destructible<T>::value>
+   struct static_nodes
+   {
+      // the smallest index that can name N nodes and still have one left for NIL
+      using index = typename std::conditional<(N < 0xFF), unsigned char,
+                    typename std::conditional<(N < 0xFFFF), unsigned short,
+                                              unsigned int>::type>::type;
+      static constexpr index NIL = index(~index(0));
+
+      enum : unsigned char { RED, BLACK, FREE };
+      struct link
+      {
+         index left;
+         index right;
+         index parent;
+         unsigned char color;
+      };
+
+      constexpr static_nodes() noexcept : links{}, slots{}, numUsed(0), freeHead(NIL)
+      {}
+
+      // a node to build an element in, or NIL when all N are in use
+      index allocate() noexcept
+      {
+         if (freeHead != NIL)
+         {
+            index i = freeHead;
+            freeHead = links[i].left;
+            return i;
+         }
+         return numUsed < N ? numUsed++ : NIL;
+      }
+
+      // destroy the element in node i and put the node on the free list
+      void release(index i) noexcept
+      {
+         slots[i].data.~T();
+         links[i].color = FREE;
+         links[i].left = freeHead;
+         freeHead = i;
+      }
+
+      bool isLive(index i) const noexcept
+      {
+         return links[i].color != FREE;
+      }
+
+      // destroy every element and forget the free list
+      void releaseAll() noexcept
+      {
+         for (index i = 0; i < numUsed; i++)
+            if (isLive(i))
+               slots[i].data.~T();
+         numUsed = 0;
+         freeHead = NIL;
+      }
+
+      link           links[N];
+      static_slot<T> slots[N];
+      index numUsed;                  // nodes ever handed out
+      index freeHead;                 // the first erased node, or NIL
+   };
+
+   // a T with a destructor to call: the nodes call it on the way out
+   template <typename T, int N>
+   struct static_nodes<T, N, false> : static_nodes<T, N, true>
+   {
+      ~static_nodes()
+      {
+         this->releaseAll();
+      }
+   };
+
+   template <typename T, int N, bool B>
+   constexpr typename static_nodes<T, N, B>::index static_nodes<T, N, B>::NIL;
+
+   /************************************************
+    * STATIC SET
+    * A set of at most N unique values that never
+    * allocates
+    ***********************************************/
+   template <typename T, int N>
+   class static_set
+   {
+      friend class ::TestStaticSet; // give unit tests access to the privates
+      static_assert(N > 0, "a static set needs room for at least one element");
+
+      using nodes = static_nodes<T, N>;
+      using index = typename nodes::index;
+      using link  = typename nodes::link;
+      static constexpr index NIL = nodes::NIL;
+
+      // whether comparing two elements can throw
+      static constexpr bool NOTHROW_LESS = noexcept(std::declval<const T&>() < std::declval<const T&>());
+   public:
+      //
+      // Construct
+      //
+      constexpr static_set() noexcept : pool(), root(NIL), numElements(0)
+      {}
+      static_set(const static_set& rhs) noexcept(std::is_nothrow_copy_constructible<T>::value)
+         : static_set()
+      {
+         copyFrom(rhs);
+      }
+      static_set(static_set&& rhs) noexcept(std::is_nothrow_move_constructible<T>::value)
+         : static_set()
+      {
+         moveFrom(rhs);
+      }
+      static_set(const std::initializer_list<T>& il) : static_set()
+      {
+         insert(il.begin(), il.end());
+      }
+      template <class Iterator>
+      static_set(Iterator first, Iterator last) : static_set()
+      {
+         insert(first, last);
+      }
+
+      //
+      // Assign
+      //
+      static_set& operator =(const static_set& rhs)
+         noexcept(std::is_nothrow_copy_constructible<T>::value)
+      {
+         if (this != &rhs)
+         {
+            clear();
+            copyFrom(rhs);
+         }
+         return *this;
+      }
+      static_set& operator =(static_set&& rhs)
+         noexcept(std::is_nothrow_move_constructible<T>::value)
+      {
+         if (this != &rhs)
+         {
+            clear();
+            moveFrom(rhs);
+         }
+         return *this;
+      }
+      static_set& operator =(const std::initializer_list<T>& il)
+      {
+         clear();
+         insert(il.begin(), il.end());
+         return *this;
+      }
+      void swap(static_set& rhs) noexcept(std::is_nothrow_move_constructible<T>::value)
+      {
+         static_set temp(std::move(rhs));
+         rhs = std::move(*this);
+         *this = std::move(temp);
+      }
+
+      //
+      // Iterator
+      //
+      class iterator;
+      using reverse_iterator = std::reverse_iterator<iterator>;
+      iterator begin() const noexcept { return iterator(this, minimum(root)); }
+      iterator end()   const noexcept { return iterator(this, NIL);           }
+
+      //
+      // Access
+      //
+      iterator find(const T& t) const noexcept(NOTHROW_LESS);
+      iterator lower_bound(const T& t) const noexcept(NOTHROW_LESS);
+      bool contains(const T& t) const noexcept(NOTHROW_LESS)
+      {
+         return find(t) != end();
+      }
+
+      //
+      // Status
+      //
+      constexpr bool   empty() const noexcept { return numElements == 0; }
+      constexpr size_t size()  const noexcept { return numElements;      }
+      constexpr bool   full()  const noexcept { return numElements == N; }
+      static constexpr size_t capacity() noexcept { return N; }
+
+      // bytes each element costs: its slot and its links, all in the object
+      static constexpr size_t bytes_per_element() noexcept
+      {
+         return sizeof(static_slot<T>) + sizeof(link);
+      }
+
+      //
+      // Insert: end() and false when full
+      //
+      std::pair<iterator, bool> insert(const T& t)
+         noexcept(NOTHROW_LESS && std::is_nothrow_copy_constructible<T>::value)
+      {
+         return insertValue(t);
+      }
+      std::pair<iterator, bool> insert(T&& t)
+         noexcept(NOTHROW_LESS && std::is_nothrow_move_constructible<T>::value)
+      {
+         return insertValue(std::move(t));
+      }
+      // false when some of them did not fit
+      bool insert(const std::initializer_list<T>& il)
+      {
+         return insert(il.begin(), il.end());
+      }
+      template <class Iterator>
+      bool insert(Iterator first, Iterator last)
+      {
+         bool fit = true;
+         for (; first != last; ++first)
+            if (insertValue(*first).first == end())
+               fit = false;
+         return fit;
+      }
+
+      //
+      // Remove
+      //
+      size_t erase(const T& t) noexcept(NOTHROW_LESS)
+      {
+         iterator it = find(t);
+         if (it == end())
+            return 0;
+         erase(it);
+         return 1;
+      }
+      iterator erase(iterator it) noexcept;
+      iterator erase(iterator itBegin, iterator itEnd) noexcept
+      {
+         while (itBegin != itEnd)
+            itBegin = erase(itBegin);
+         return itEnd;
+      }
+      void clear() noexcept
+      {
+         pool.releaseAll();
+         root = NIL;
+         numElements = 0;
+      }
+
+   private:
+
+      template <class U>
+      std::pair<iterator, bool> insertValue(U&& t);
+      void copyFrom(const static_set& rhs);
+      void moveFrom(static_set& rhs);
+
+      // the tree, by index
+      link&       at(index i)       noexcept { return pool.links[i]; }
+      const link& at(index i) const noexcept { return pool.links[i]; }
+      const T& value(index i) const noexcept { return pool.slots[i].data; }
+      bool isRed(index i) const noexcept
+      {
+         return i != NIL && at(i).color == nodes::RED;
+      }
+      index minimum(index i) const noexcept;
+      index maximum(index i) const noexcept;
+      index next(index i) const noexcept;
+      index prev(index i) const noexcept;
+      void rotateLeft(index x) noexcept;
+      void rotateRight(index x) noexcept;
+      void transplant(index u, index v) noexcept;
+      void insertFixup(index z) noexcept;
+      void eraseFixup(index x, index xParent) noexcept;
+
+      nodes  pool;             // the nodes, in use and free
+      index  root;             // the top of the tree, or NIL
+      size_t numElements;      // nodes in the tree
+   };
+
+   template <typename T, int N>
+   constexpr typename static_set<T, N>::index static_set<T, N>::NIL;
+
+   /**************************************************
+    * STATIC SET ITERATOR
+    * A node index and the set it is in
+    *************************************************/
+   template <typename T, int N>
+   class static_set<T, N>::iterator
+   {
+      friend class ::TestStaticSet;
+      friend class custom::static_set<T, N>;
+   public:
+      // so std::reverse_iterator and the algorithms can use it
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const T*;
+      using reference         = const T&;
+
+      constexpr iterator() noexcept : pSet(nullptr), i(NIL)
+      {}
+
+      bool operator ==(const iterator& rhs) const noexcept { return i == rhs.i; }
+      bool operator !=(const iterator& rhs) const noexcept { return i != rhs.i; }
+
+      const T& operator *() const noexcept
+      {
+         assert(i != NIL);
+         return pSet->value(i);
+      }
+
+      iterator& operator ++() noexcept
+      {
+         i = pSet->next(i);
+         return *this;
+      }
+      iterator operator ++(int postfix) noexcept
+      {
+         iterator temp(*this);
+         ++*this;
+         return temp;
+      }
+      // back from end() is the largest
+      iterator& operator --() noexcept
+      {
+         i = (i == NIL) ? pSet->maximum(pSet->root) : pSet->prev(i);
+         return *this;
+      }
+      iterator operator --(int postfix) noexcept
+      {
+         iterator temp(*this);
+         --*this;
+         return temp;
+      }
+
+   private:
+      iterator(const static_set* pSet, index i) noexcept : pSet(pSet), i(i)
+      {}
+
+      const static_set* pSet;     // the set whose nodes these are
+      index i;                    // the node, or NIL for end()
+   };
+
+
+   /*********************************************
+    * STATIC SET :: LOWER BOUND
+    ********************************************/
+   template <typename T, int N>
+   typename static_set<T, N>::iterator static_set<T, N>::lower_bound(const T& t) const
+      noexcept(NOTHROW_LESS)
+   {
+      index iBound = NIL;
+      for (index i = root; i != NIL; )
+         if (value(i) < t)
+            i = at(i).right;
+         else
+         {
+            iBound = i;
+            i = at(i).left;
+         }
+      return iterator(this, iBound);
+   }
+
+   /*********************************************
+    * STATIC SET :: FIND
+    * The only branch is the rarely taken one out at
+    * the match; left or right is a select, so a
+    * random probe does not mispredict at every level
+    ********************************************/
+   template <typename T, int N>
+   typename static_set<T, N>::iterator static_set<T, N>::find(const T& t) const
+      noexcept(NOTHROW_LESS)
+   {
+      for (index i = root; i != NIL; )
+      {
+         bool isLess = t < value(i);
+         bool isMore = value(i) < t;
+         if (isLess == isMore)
+            return iterator(this, i);
+         i = isLess ? at(i).left : at(i).right;
+      }
+      return end();
+   }
+
+   /*********************************************
+    * STATIC SET :: INSERT VALUE
+    * Down to the leaf where t belongs, choosing the
+    * way as find() does, into a node off the free
+    * list, and rebalance. The set is unchanged when
+    * t is already there or it is full.
+    ********************************************/
+   template <typename T, int N>
+   template <class U>
+   std::pair<typename static_set<T, N>::iterator, bool> static_set<T, N>::insertValue(U&& t)
+   {
+      index iParent = NIL;
+      bool isLeft = false;
+      for (index i = root; i != NIL; )
+      {
+         iParent = i;
+         isLeft = t < value(i);
+         bool isMore = value(i) < t;
+         if (isLeft == isMore)
+            return { iterator(this, i), false };
+         i = isLeft ? at(i).left : at(i).right;
+      }
+
+      index z = pool.allocate();
+      if (z == NIL)
+         return { end(), false };
+      new (&pool.slots[z].data) T(std::forward<U>(t));
+      at(z) = link{ NIL, NIL, iParent, nodes::RED };
+      if (iParent == NIL)
+         root = z;
+      else if (isLeft)
+         at(iParent).left = z;
+      else
+         at(iParent).right = z;
+      numElements++;
+
+      insertFixup(z);
+      return { iterator(this, z), true };
+   }
+
+   /*********************************************
+    * STATIC SET :: ERASE
+    * Unlink the node, rebalance, and free it. Other
+    * nodes are relinked, never moved, so the next
+    * one is still where it was.
+    ********************************************/
+   template <typename T, int N>
+   typename static_set<T, N>::iterator static_set<T, N>::erase(iterator it) noexcept
+   {
+      index z = it.i;
+      assert(z != NIL && pool.isLive(z));
+      index iNext = next(z);
+
+      index y = z;
+      bool wasRed = isRed(y);
+      index x;
+      index xParent;
+      if (at(z).left == NIL)
+      {
+         x = at(z).right;
+         xParent = at(z).parent;
+         transplant(z, x);
+      }
+      else if (at(z).right == NIL)
+      {
+         x = at(z).left;
+         xParent = at(z).parent;
+         transplant(z, x);
+      }
+      else
+      {
+         // the successor takes z's place and color
+         y = minimum(at(z).right);
+         wasRed = isRed(y);
+         x = at(y).right;
+         if (at(y).parent == z)
+            xParent = y;
+         else
+         {
+            xParent = at(y).parent;
+            transplant(y, x);
+            at(y).right = at(z).right;
+            at(at(y).right).parent = y;
+         }
+         transplant(z, y);
+         at(y).left = at(z).left;
+         at(at(y).left).parent = y;
+         at(y).color = at(z).color;
+      }
+
+      if (!wasRed)
+         eraseFixup(x, xParent);
+      pool.release(z);
+      numElements--;
+      return iterator(this, iNext);
+   }
+
+   /*********************************************
+    * STATIC SET :: COPY FROM
+    * Into an empty set: the links are indexes, so
+    * they copy as they are, and each element goes
+    * into the same slot it had
+    ********************************************/
+   template <typename T, int N>
+   void static_set<T, N>::copyFrom(const static_set& rhs)
+   {
+      for (index i = 0; i < rhs.pool.numUsed; i++)
+      {
+         pool.links[i] = rhs.pool.links[i];
+         if (rhs.pool.isLive(i))
+            new (&pool.slots[i].data) T(rhs.pool.slots[i].data);
+      }
+      pool.numUsed = rhs.pool.numUsed;
+      pool.freeHead = rhs.pool.freeHead;
+      root = rhs.root;
+      numElements = rhs.numElements;
+   }
+
+   /*********************************************
+    * STATIC SET :: MOVE FROM
+    * Into an empty set, leaving rhs empty
+    ********************************************/
+   template <typename T, int N>
+   void static_set<T, N>::moveFrom(static_set& rhs)
+   {
+      for (index i = 0; i < rhs.pool.numUsed; i++)
+      {
+         pool.links[i] = rhs.pool.links[i];
+         if (rhs.pool.isLive(i))
+            new (&pool.slots[i].data) T(std::move(rhs.pool.slots[i].data));
+      }
+      pool.numUsed = rhs.pool.numUsed;
+      pool.freeHead = rhs.pool.freeHead;
+      root = rhs.root;
+      numElements = rhs.numElements;
+      rhs.clear();
+   }
+
+   /*********************************************
+    * STATIC SET :: MINIMUM and MAXIMUM
+    * The ends of the subtree under i
+    ********************************************/
+   template <typename T, int N>
+   typename static_set<T, N>::index static_set<T, N>::minimum(index i) const noexcept
+   {
+      if (i != NIL)
+         while (at(i).left != NIL)
+            i = at(i).left;
+      return i;
+   }
+   template <typename T, int N>
+   typename static_set<T, N>::index static_set<T, N>::maximum(index i) const noexcept
+   {
+      if (i != NIL)
+         while (at(i).right != NIL)
+            i = at(i).right;
+      return i;
+   }
+
+   /*********************************************
+    * STATIC SET :: NEXT and PREV
+    * In order, by the parent links; NIL off the end
+    ********************************************/
+   template <typename T, int N>
+   typename static_set<T, N>::index static_set<T, N>::next(index i) const noexcept
+   {
+      if (at(i).right != NIL)
+         return minimum(at(i).right);
+      index iParent = at(i).parent;
+      while (iParent != NIL && i == at(iParent).right)
+      {
+         i = iParent;
+         iParent = at(i).parent;
+      }
+      return iParent;
+   }
+   template <typename T, int N>
+   typename static_set<T, N>::index static_set<T, N>::prev(index i) const noexcept
+   {
+      if (at(i).left != NIL)
+         return maximum(at(i).left);
+      index iParent = at(i).parent;
+      while (iParent != NIL && i == at(iParent).left)
+      {
+         i = iParent;
+         iParent = at(i).parent;
+      }
+      return iParent;
+   }
+
+   /*********************************************
+    * STATIC SET :: ROTATE LEFT
+    *       x                y
+    *        \      -->     /
+    *         y            x
+    ********************************************/
+   template <typename T, int N>
+   void static_set<T, N>::rotateLeft(index x) noexcept
+   {
+      index y = at(x).right;
+      at(x).right = at(y).left;
+      if (at(y).left != NIL)
+         at(at(y).left).parent = x;
+      transplant(x, y);
+      at(y).left = x;
+      at(x).parent = y;
+   }
+
+   /*********************************************
+    * STATIC SET :: ROTATE RIGHT
+    *         x            y
+    *        /      -->     \
+    *       y                x
+    ********************************************/
+   template <typename T, int N>
+   void static_set<T, N>::rotateRight(index x) noexcept
+   {
+      index y = at(x).left;
+      at(x).left = at(y).right;
+      if (at(y).right != NIL)
+         at(at(y).right).parent = x;
+      transplant(x, y);
+      at(y).right = x;
+      at(x).parent = y;
+   }
+
+   /*********************************************
+    * STATIC SET :: TRANSPLANT
+    * Hang v where u was under u's parent
+    ********************************************/
+   template <typename T, int N>
+   void static_set<T, N>::transplant(index u, index v) noexcept
+   {
+      index uParent = at(u).parent;
+      if (uParent == NIL)
+         root = v;
+      else if (u == at(uParent).left)
+         at(uParent).left = v;
+      else
+         at(uParent).right = v;
+      if (v != NIL)
+         at(v).parent = uParent;
+   }
+
+   /*********************************************
+    * STATIC SET :: INSERT FIXUP
+    * A red node z may have a red parent: recolor
+    * while the uncle is red, then rotate once or
+    * twice, which settles it
+    ********************************************/
+   template <typename T, int N>
+   void static_set<T, N>::insertFixup(index z) noexcept
+   {
+      while (isRed(at(z).parent))
+      {
+         index p = at(z).parent;
+         index g = at(p).parent;       // p is red, so not the root
+         bool onLeft = (p == at(g).left);
+         index u = onLeft ? at(g).right : at(g).left;
+         if (isRed(u))
+         {
+            at(p).color = nodes::BLACK;
+            at(u).color = nodes::BLACK;
+            at(g).color = nodes::RED;
+            z = g;
+            continue;
+         }
+         if (onLeft)
+         {
+            if (z == at(p).right)
+            {
+               rotateLeft(p);
+               p = z;
+            }
+            rotateRight(g);
+         }
+         else
+         {
+            if (z == at(p).left)
+            {
+               rotateRight(p);
+               p = z;
+            }
+            rotateLeft(g);
+         }
+         at(p).color = nodes::BLACK;
+         at(g).color = nodes::RED;
+         break;
+      }
+      at(root).color = nodes::BLACK;
+   }
+
+   /*********************************************
+    * STATIC SET :: ERASE FIXUP
+    * The path through x is a black short. x may be
+    * NIL, so its parent is passed along with it.
+    ********************************************/
+   template <typename T, int N>
+   void static_set<T, N>::eraseFixup(index x, index xParent) noexcept
+   {
+      while (x != root && !isRed(x))
+      {
+         if (x == at(xParent).left)
+         {
+            index w = at(xParent).right;
+            if (isRed(w))
+            {
+               at(w).color = nodes::BLACK;
+               at(xParent).color = nodes::RED;
+               rotateLeft(xParent);
+               w = at(xParent).right;
+            }
+            if (!isRed(at(w).left) && !isRed(at(w).right))
+            {
+               at(w).color = nodes::RED;
+               x = xParent;
+               xParent = at(x).parent;
+            }
+            else
+            {
+               if (!isRed(at(w).right))
+               {
+                  at(at(w).left).color = nodes::BLACK;
+                  at(w).color = nodes::RED;
+                  rotateRight(w);
+                  w = at(xParent).right;
+               }
+               at(w).color = at(xParent).color;
+               at(xParent).color = nodes::BLACK;
+               at(at(w).right).color = nodes::BLACK;
+               rotateLeft(xParent);
+               x = root;
+            }
+         }
+         else
+         {
+            index w = at(xParent).left;
+            if (isRed(w))
+            {
+               at(w).color = nodes::BLACK;
+               at(xParent).color = nodes::RED;
+               rotateRight(xParent);
+               w = at(xParent).left;
+            }
+            if (!isRed(at(w).left) && !isRed(at(w).right))
+            {
+               at(w).color = nodes::RED;
+               x = xParent;
+               xParent = at(x).parent;
+            }
+            else
+            {
+               if (!isRed(at(w).left))
+               {
+                  at(at(w).right).color = nodes::BLACK;
+                  at(w).color = nodes::RED;
+                  rotateLeft(w);
+                  w = at(xParent).left;
+               }
+               at(w).color = at(xParent).color;
+               at(xParent).color = nodes::BLACK;
+               at(at(w).left).color = nodes::BLACK;
+               rotateRight(xParent);
+               x = root;
+            }
+         }
+      }
+      if (x != NIL)
+         at(x).color = nodes::BLACK;
+   }
+
+} // namespace custom
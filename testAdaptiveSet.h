@@ -0,0 +1,340 @@
+/***********************************************************************
+ * Header:
+ *    TEST ADAPTIVE SET
+ * Summary:
+ *    Unit tests for adaptive_set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "adaptive_set.h"
+#include "unitTest.h"
+#include "spy.h"
+#include <set>
+#include <vector>
+#include <cstdlib>    // for rand
+
+/***********************************************
+ * TEST ADAPTIVE SET
+ * Unit tests for the adaptive_set class
+ ***********************************************/
+class TestAdaptiveSet : public UnitTest
+{
+   using Small  = custom::adaptive_set<int, 8>;
+   using Layout = Small::layout;
+
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructCopy_eachLayout();
+      test_constructMove_empties();
+      test_swap_inlineAndTree();
+
+      // Inline
+      test_insert_inlineSorted();
+      test_insert_inlineDuplicate();
+      test_insert_promotesToFlat();
+      test_erase_demotesAtHalf();
+      test_boundary_noFlapping();
+
+      // Operation mix
+      test_writes_growTree();
+      test_reads_returnToFlat();
+      test_scans_returnToFlat();
+      test_adapt_withoutWrite();
+      test_erase_treeShrinksToFlat();
+
+      // Iterators
+      test_reads_keepIterators();
+      test_eraseIterator_acrossDemotion();
+      test_random_matchesStdSet();
+
+      report("AdaptiveSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // default constructor, empty and inline
+   void test_construct_default()
+   {  // setup
+      Spy::reset();
+      // exercise
+      custom::adaptive_set<Spy> s;
+      // verify
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(s.representation() == custom::adaptive_set<Spy>::layout::INLINE);
+      assertUnit(s.empty());
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // a copy of each layout has the same elements in the same layout
+   void test_constructCopy_eachLayout()
+   {  // setup
+      Small sInline{ 3, 1, 2 };
+      Small sFlat = range<Small>(0, 20);
+      Small sTree = grownTree();
+      // exercise
+      Small sInlineCopy(sInline);
+      Small sFlatCopy(sFlat);
+      Small sTreeCopy(sTree);
+      // verify
+      assertUnit(sInlineCopy.representation() == Layout::INLINE);
+      assertUnit(sFlatCopy.representation() == Layout::FLAT);
+      assertUnit(sTreeCopy.representation() == Layout::TREE);
+      assertUnit(toVector(sInlineCopy) == std::vector<int>({ 1, 2, 3 }));
+      assertUnit(toVector(sFlatCopy) == toVector(sFlat));
+      assertUnit(toVector(sTreeCopy) == toVector(sTree));
+   }  // teardown
+
+   // a move leaves the source empty and inline
+   void test_constructMove_empties()
+   {  // setup
+      Small sSrc = range<Small>(0, 20);
+      // exercise
+      Small sDest(std::move(sSrc));
+      // verify
+      assertUnit(sDest.size() == 20);
+      assertUnit(sDest.representation() == Layout::FLAT);
+      assertUnit(sSrc.empty());
+      assertUnit(sSrc.representation() == Layout::INLINE);
+   }  // teardown
+
+   // swapping trades layouts along with elements
+   void test_swap_inlineAndTree()
+   {  // setup
+      Small s1{ 1, 2 };
+      Small s2 = grownTree();
+      size_t num = s2.size();
+      // exercise
+      s1.swap(s2);
+      // verify
+      assertUnit(s1.representation() == Layout::TREE);
+      assertUnit(s1.size() == num);
+      assertUnit(s2.representation() == Layout::INLINE);
+      assertUnit(toVector(s2) == std::vector<int>({ 1, 2 }));
+   }  // teardown
+
+   /***************************************
+    * INLINE
+    ***************************************/
+
+   // values in the object stay sorted
+   //    [20 50]  -->  [20 30 50]
+   void test_insert_inlineSorted()
+   {  // setup
+      Small s{ 50, 20 };
+      // exercise
+      auto result = s.insert(30);
+      // verify
+      assertUnit(result.second);
+      assertUnit(*result.first == 30);
+      assertUnit(s.representation() == Layout::INLINE);
+      assertUnit(s.numInline == 3);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 50 }));
+   }  // teardown
+
+   // a value already there is not added
+   void test_insert_inlineDuplicate()
+   {  // setup
+      Small s{ 50, 20, 30 };
+      // exercise
+      auto result = s.insert(20);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(*result.first == 20);
+      assertUnit(s.size() == 3);
+   }  // teardown
+
+   // the N+1st value moves everything to a flat array
+   void test_insert_promotesToFlat()
+   {  // setup
+      Small s = range<Small>(0, 8);
+      assertUnit(s.representation() == Layout::INLINE);
+      // exercise
+      auto result = s.insert(100);
+      // verify
+      assertUnit(result.second);
+      assertUnit(*result.first == 100);
+      assertUnit(s.representation() == Layout::FLAT);
+      assertUnit(toVector(s) == std::vector<int>({ 0, 1, 2, 3, 4, 5, 6, 7, 100 }));
+   }  // teardown
+
+   // back inline only at N/2
+   void test_erase_demotesAtHalf()
+   {  // setup
+      Small s = range<Small>(0, 9);
+      // exercise
+      for (int i = 8; i > (int)Small::INLINE_BACK; i--)
+         s.erase(i);
+      Layout layoutBefore = s.representation();
+      s.erase((int)Small::INLINE_BACK);
+      // verify
+      assertUnit(layoutBefore == Layout::FLAT);
+      assertUnit(s.representation() == Layout::INLINE);
+      assertUnit(toVector(s) == toVector(range<Small>(0, (int)Small::INLINE_BACK)));
+   }  // teardown
+
+   // going back and forth over N does not convert each time
+   void test_boundary_noFlapping()
+   {  // setup
+      Small s = range<Small>(0, 9);
+      // exercise and verify
+      for (int i = 0; i < 10; i++)
+      {
+         s.erase(8);
+         assertUnit(s.representation() == Layout::FLAT);
+         s.insert(8);
+         assertUnit(s.representation() == Layout::FLAT);
+      }
+   }  // teardown
+
+   /***************************************
+    * OPERATION MIX
+    ***************************************/
+
+   // a big set being written to becomes a tree
+   void test_writes_growTree()
+   {  // exercise
+      Small s = grownTree();
+      // verify
+      assertUnit(s.representation() == Layout::TREE);
+      assertUnit(s.size() > Small::FLAT_ALWAYS);
+      assertUnit(toVector(s) == toVector(range<Small>(0, (int)s.size())));
+   }  // teardown
+
+   // a window of nothing but finds sends a tree back to flat
+   void test_reads_returnToFlat()
+   {  // setup
+      Small s = grownTree();
+      s.resetCounts();
+      size_t num = 0;
+      // exercise
+      for (unsigned i = 0; i < Small::WINDOW; i++)
+         num += s.contains((int)i);
+      s.insert(0);
+      // verify
+      assertUnit(num == Small::WINDOW);
+      assertUnit(s.representation() == Layout::FLAT);
+   }  // teardown
+
+   // a few full scans count as many reads
+   void test_scans_returnToFlat()
+   {  // setup
+      Small s = grownTree();
+      s.resetCounts();
+      long long sum = 0;
+      // exercise
+      for (unsigned i = 0; i < Small::WINDOW / Small::SCAN_WEIGHT; i++)
+         for (int value : s)
+            sum += value;
+      s.insert(0);
+      // verify
+      assertUnit(sum > 0);
+      assertUnit(s.representation() == Layout::FLAT);
+   }  // teardown
+
+   // asking converts a read-only set without waiting for a write
+   void test_adapt_withoutWrite()
+   {  // setup
+      Small s = grownTree();
+      s.resetCounts();
+      for (unsigned i = 0; i < Small::WINDOW; i++)
+         s.find((int)i);
+      size_t num = s.size();
+      // exercise
+      s.adapt();
+      // verify
+      assertUnit(s.representation() == Layout::FLAT);
+      assertUnit(s.size() == num);
+   }  // teardown
+
+   // a tree that shrinks to half of FLAT_ALWAYS is flat again
+   void test_erase_treeShrinksToFlat()
+   {  // setup
+      Small s = grownTree();
+      int num = (int)s.size();
+      // exercise
+      for (int i = num - 1; i >= (int)Small::FLAT_BACK; i--)
+         s.erase(i);
+      s.erase(-1);
+      // verify
+      assertUnit(s.size() == Small::FLAT_BACK);
+      assertUnit(s.representation() == Layout::FLAT);
+   }  // teardown
+
+   /***************************************
+    * ITERATORS
+    ***************************************/
+
+   // finds never move elements, even past a full window
+   void test_reads_keepIterators()
+   {  // setup
+      Small s = grownTree();
+      auto it = s.find(1000);
+      // exercise
+      for (unsigned i = 0; i < 2 * Small::WINDOW; i++)
+         s.find((int)i);
+      // verify
+      assertUnit(s.representation() == Layout::TREE);
+      assertUnit(*it == 1000);
+      assertUnit(*++it == 1001);
+   }  // teardown
+
+   // the iterator erase hands back survives the move inline
+   void test_eraseIterator_acrossDemotion()
+   {  // setup
+      Small s = range<Small>(0, 9);
+      for (int i = 8; i > (int)Small::INLINE_BACK; i--)
+         s.erase(i);
+      // exercise
+      auto it = s.erase(s.find(1));
+      // verify
+      assertUnit(s.representation() == Layout::INLINE);
+      assertUnit(it != s.end() && *it == 2);
+      assertUnit(toVector(s) == std::vector<int>({ 0, 2, 3, 4 }));
+   }  // teardown
+
+   // a long random mix of everything agrees with std::set
+   void test_random_matchesStdSet()
+   {  // setup
+      Small s;
+      std::set<int> sStd;
+      srand(45);
+      // exercise
+      for (int i = 0; i < 20000; i++)
+      {
+         int value = rand() % 6000;
+         int op = rand() % 10;
+         if (op < 4)
+            assertUnit(s.insert(value).second == sStd.insert(value).second);
+         else if (op < 6)
+            assertUnit(s.erase(value) == sStd.erase(value));
+         else
+            assertUnit(s.contains(value) == (sStd.count(value) == 1));
+      }
+      // verify
+      assertUnit(toVector(s) == std::vector<int>(sStd.begin(), sStd.end()));
+   }  // teardown
+
+   /*************************************************************
+    * GROWN TREE
+    * A set grown by writes alone past FLAT_ALWAYS and through a
+    * full window, so it is a tree
+    *************************************************************/
+   static Small grownTree()
+   {
+      return range<Small>(0, (int)(Small::FLAT_ALWAYS + 2 * Small::WINDOW));
+   }
+};
+
+#endif // DEBUG
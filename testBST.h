@@ -19,6 +19,8 @@
 #include <memory>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <algorithm>  // for std::is_sorted and std::count
 #include <functional> // for std::less and std::greater
 
  /***********************************************
@@ -63,6 +65,9 @@ public:
       test_swap_standardToEmpty();
       test_swap_emptyToStandard();
       test_swap_standardToStandard();
+      test_assignSorted_standardToEmpty();
+      test_assignSorted_partialLevel();
+      test_assignSorted_emptyToStandard();
 
       // Iterator
       test_begin_empty();
@@ -81,6 +86,13 @@ public:
       test_find_standardBegin();
       test_find_standardLast();
       test_find_standardMissing();
+      test_lowerBound_empty();
+      test_lowerBound_standardMatch();
+      test_lowerBound_standardBetween();
+      test_lowerBound_standardPastEnd();
+      test_findMany_empty();
+      test_findMany_standard();
+      test_findMany_manyLanes();
 
       // Insert
       test_insert_oneLeft();
@@ -109,9 +121,68 @@ public:
       test_erase_noChildren();
       test_erase_oneChild();
       test_erase_twoChildren();
+      test_erase_rootRedChild();
       test_clear_empty();
       test_clear_standard();
 
+      // Batch
+      test_applyBatch_emptyTree();
+      test_applyBatch_sameValue();
+      test_applyBatch_mergeReusesNodes();
+      test_applyBatch_each();
+
+      // Split and join
+      test_join_equalHeights();
+      test_join_lessTaller();
+      test_join_greaterTaller();
+      test_split_match();
+      test_split_missing();
+      test_split_joinBack();
+      test_insertParallel_empty();
+      test_insertParallel_standard();
+      test_join_noMiddle();
+      test_eraseRange_short();
+      test_eraseRange_long();
+      test_eraseRange_toEnd();
+      test_eraseRange_unbalanced();
+      test_eraseRange_duplicates();
+      test_extract_standard();
+      test_extract_duplicates();
+
+      // Erase by key
+      test_eraseKey_missing();
+      test_eraseKey_rootBlack();
+      test_eraseKey_keepsRedBlack();
+      test_eraseIf_none();
+      test_eraseIf_few();
+      test_eraseIf_many();
+
+      // Cached ends
+      test_cache_insert();
+      test_cache_erase();
+      test_cache_rebuild();
+      test_decrement_end();
+      test_decrement_endEmpty();
+      test_popFront_standard();
+      test_popBack_standard();
+      test_popFront_drain();
+      test_popBack_drain();
+      test_popFront_byHand();
+      test_takeFront_standard();
+
+      // Layout
+      test_optimizeLayout_empty();
+      test_optimizeLayout_vebOrder();
+      test_optimizeLayout_balanced();
+      test_optimizeLayout_thenChurn();
+      test_optimizeLayout_extractOutlives();
+      test_optimizeLayout_movesValues();
+      test_compact_inOrder();
+      test_compact_breadthFirst();
+      test_compactStep_bounded();
+      test_compactStep_churnBetween();
+      test_compactStep_extractMidway();
+
       // Status
       test_empty_empty();
       test_empty_standard();
@@ -1211,6 +1282,97 @@ public:
       teardownStandardFixture(bst2);
    }
 
+   // a full tree built from sorted values, with no comparisons
+   void test_assignSorted_standardToEmpty()
+   {  // setup
+      std::vector<Spy> v{ Spy(20), Spy(30), Spy(40), Spy(50), Spy(60), Spy(70), Spy(80) };
+      custom::BST <Spy> bst;
+      Spy::reset();
+      // exercise
+      bst.assignSorted(v.begin(), v.end());
+      // verify
+      assertUnit(Spy::numCopy() == 7);
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numLessthan() == 0);
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20b)     (40b) (60b)     (80b)
+      assertUnit(bst.numElements == 7);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+      {
+         assertUnit(bst.root->data == Spy(50));
+         assertUnit(bst.root->pParent == nullptr);
+         assertUnit(bst.root->pLeft->data == Spy(30));
+         assertUnit(bst.root->pRight->data == Spy(70));
+         assertUnit(bst.root->pLeft->pLeft->data == Spy(20));
+         assertUnit(bst.root->pLeft->pRight->data == Spy(40));
+         assertUnit(bst.root->pRight->pLeft->data == Spy(60));
+         assertUnit(bst.root->pRight->pRight->data == Spy(80));
+         assertUnit(bst.root->pRight->pRight->pParent == bst.root->pRight);
+         assertUnit(bst.root->isRed == false);
+         assertUnit(bst.root->pLeft->isRed == false);
+         assertUnit(bst.root->pRight->pRight->isRed == false);
+      }
+      // teardown
+      bst.clear();
+   }
+
+   // the last level is not full: its nodes are red
+   void test_assignSorted_partialLevel()
+   {  // setup
+      std::vector<int> v{ 10, 20, 30, 40, 50, 60 };
+      custom::BST <int> bst;
+      // exercise
+      bst.assignSorted(v.begin(), v.end());
+      // verify
+      //                (40b)
+      //          +-------+-------+
+      //        (20b)           (60b)
+      //     +----+----+     +----+
+      //   (10r)     (30r) (50r)
+      assertUnit(bst.numElements == 6);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+      {
+         auto p40 = bst.root;
+         auto p20 = p40->pLeft;
+         auto p60 = p40->pRight;
+         assertUnit(p40->data == 40 && !p40->isRed);
+         assertUnit(p20->data == 20 && !p20->isRed);
+         assertUnit(p60->data == 60 && !p60->isRed);
+         assertUnit(p20->pLeft->data == 10 && p20->pLeft->isRed);
+         assertUnit(p20->pRight->data == 30 && p20->pRight->isRed);
+         assertUnit(p60->pLeft->data == 50 && p60->pLeft->isRed);
+         assertUnit(p60->pRight == nullptr);
+         assertUnit(p60->pLeft->pParent == p60);
+      }
+      // teardown
+      bst.clear();
+   }
+
+   // the old contents are freed
+   void test_assignSorted_emptyToStandard()
+   {  // setup
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20r)     (40r) (60r)     (80r)
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      std::vector<Spy> v;
+      Spy::reset();
+      // exercise
+      bst.assignSorted(v.begin(), v.end());
+      // verify
+      assertUnit(Spy::numDelete() == 7);
+      assertUnit(bst.numElements == 0);
+      assertUnit(bst.root == nullptr);
+   }  // teardown
+
    /***************************************
     * CLEAR
     *    BST::clear()
@@ -1800,6 +1962,173 @@ public:
 
 
 
+   /***************************************
+    * LOWER BOUND
+    *    BST::lower_bound()
+    ***************************************/
+
+   // lower_bound() in an empty BST
+   void test_lowerBound_empty()
+   {  // setup
+      custom::BST <Spy> bst;
+      custom::BST<Spy>::iterator it;
+      Spy s(50);
+      Spy::reset();
+      // exercise
+      it = bst.lower_bound(s);
+      // verify
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(it == bst.end());
+      assertEmptyFixture(bst);
+   }  // teardown
+
+   // lower_bound() of a value in the tree lands on it
+   void test_lowerBound_standardMatch()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60      [[80]]
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      custom::BST<Spy>::iterator it;
+      Spy s(80);
+      Spy::reset();
+      // exercise
+      it = bst.lower_bound(s);
+      // verify
+      assertUnit(Spy::numLessthan() == 3);    // compare [50][70][80]
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(it != bst.end());
+      if (it != bst.end())
+         assertUnit(*it == Spy(80));
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // lower_bound() of a missing value lands on the next one up
+   void test_lowerBound_standardBetween()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40  [[60]]      80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      custom::BST<Spy>::iterator it;
+      Spy s(55);
+      Spy::reset();
+      // exercise
+      it = bst.lower_bound(s);
+      // verify
+      assertUnit(Spy::numLessthan() == 3);    // compare [50][70][60]
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(it != bst.end());
+      if (it != bst.end())
+         assertUnit(*it == Spy(60));
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // lower_bound() of a value past the largest is end()
+   void test_lowerBound_standardPastEnd()
+   {  // setup
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      custom::BST<Spy>::iterator it;
+      Spy s(85);
+      Spy::reset();
+      // exercise
+      it = bst.lower_bound(s);
+      // verify
+      assertUnit(Spy::numLessthan() == 3);    // compare [50][70][80]
+      assertUnit(it == bst.end());
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // every key in an empty tree is missing
+   void test_findMany_empty()
+   {  // setup
+      custom::BST <int> bst;
+      std::vector<int> keys{ 10, 20, 30 };
+      std::vector<int> calls(keys.size(), 0);
+      // exercise
+      bst.findMany(keys.begin(), keys.end(), [&](size_t i, custom::BST<int>::iterator it)
+      {
+         calls[i]++;
+         assertUnit(it == bst.end());
+      });
+      // verify
+      assertUnit(calls == std::vector<int>({ 1, 1, 1 }));
+   }  // teardown
+
+   // each key is answered once, and with the same node find() gives
+   void test_findMany_standard()
+   {  // setup
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20r)     (40r) (60r)     (80r)
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      std::vector<Spy> keys{ Spy(50), Spy(40), Spy(45), Spy(80), Spy(10) };
+      std::vector<custom::BST<Spy>::iterator> out(keys.size());
+      std::vector<int> calls(keys.size(), 0);
+      Spy::reset();
+      // exercise
+      bst.findMany(keys.begin(), keys.end(), [&](size_t i, custom::BST<Spy>::iterator it)
+      {
+         calls[i]++;
+         out[i] = it;
+      });
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(calls == std::vector<int>({ 1, 1, 1, 1, 1 }));
+      assertUnit(out[0] == custom::BST<Spy>::iterator(bst.root));
+      assertUnit(out[1] == bst.find(Spy(40)));
+      assertUnit(out[2] == bst.end());
+      assertUnit(out[3] == bst.find(Spy(80)));
+      assertUnit(out[4] == bst.end());
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // more keys than lanes: lanes are refilled as they finish
+   void test_findMany_manyLanes()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 200; i += 2)
+         bst.insert(i);
+      std::vector<int> keys;
+      for (int i = 199; i >= 0; i--)
+         keys.push_back(i);
+      std::vector<int> hits(keys.size(), -1);
+      // exercise
+      bst.findMany(keys.begin(), keys.end(), [&](size_t i, custom::BST<int>::iterator it)
+      {
+         hits[i] = (it == bst.end()) ? 0 : 1;
+      });
+      // verify
+      bool right = true;
+      for (size_t i = 0; i < keys.size(); i++)
+         right = right && hits[i] == (keys[i] % 2 == 0 ? 1 : 0);
+      assertUnit(right);
+   }  // teardown
+
+
+
    /***************************************
     * Insert
     *    BST::insert(const T &)
@@ -3582,73 +3911,433 @@ public:
       bst.root = nullptr;
    }
 
-   /**************************************************************
-    * SETUP STANDARD FIXTURE
-    *                (50b)
-    *          +-------+-------+
-    *        (30b)           (70b)
-    *     +----+----+     +----+----+
-    *   (20r)     (40r) (60r)     (80r)
-    *************************************************************/
-   void setupStandardFixture(custom::BST <Spy>& bst)
-   {
-      // make sure that bst is clean
-      assertUnit(bst.numElements == 0);
-      assertUnit(bst.root == nullptr);
-
-      // allocate
-      custom::BST<Spy>::BNode* p20 = new custom::BST<Spy>::BNode(Spy(20));
-      custom::BST<Spy>::BNode* p30 = new custom::BST<Spy>::BNode(Spy(30));
-      custom::BST<Spy>::BNode* p40 = new custom::BST<Spy>::BNode(Spy(40));
-      custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
-      custom::BST<Spy>::BNode* p60 = new custom::BST<Spy>::BNode(Spy(60));
-      custom::BST<Spy>::BNode* p70 = new custom::BST<Spy>::BNode(Spy(70));
-      custom::BST<Spy>::BNode* p80 = new custom::BST<Spy>::BNode(Spy(80));
-
-      // hook up the pointers down
-      p30->pLeft  = p20;
-      p30->pRight = p40;
-      p50->pLeft  = p30;
-      p50->pRight = p70;
-      p70->pLeft  = p60;
-      p70->pRight = p80;
-
-      // hook up the pointers up
-      p20->pParent = p40->pParent = p30;
-      p30->pParent = p70->pParent = p50;
-      p60->pParent = p80->pParent = p70;
+   // the child that takes the root's place becomes black
+   void test_erase_rootRedChild()
+   {  // setup
+      //       [[50]]
+      //          +----+
+      //              60
+      custom::BST <int> bst;
+      auto p50 = new custom::BST<int>::BNode(50);
+      auto p60 = new custom::BST<int>::BNode(60);
+      bst.root = p60->pParent = p50;
+      p50->pRight = p60;
+      p50->isRed = false;
+      p60->isRed = true;
+      bst.numElements = 2;
+      auto it = custom::BST <int> ::iterator(p50);
+      // exercise
+      auto itReturn = bst.erase(it);
+      // verify
+      //         60
+      assertUnit(itReturn == custom::BST <int> ::iterator(p60));
+      assertUnit(bst.numElements == 1);
+      assertUnit(bst.root == p60);
+      assertUnit(p60->pParent == nullptr);
+      assertUnit(p60->isRed == false);
+      // teardown
+      delete p60;
+      bst.numElements = 0;
+      bst.root = nullptr;
+   }
 
-      // color everything
-      p50->isRed = p30->isRed = p70->isRed = false;
-      p20->isRed = p40->isRed = p60->isRed = p80->isRed = true;
+   /***************************************
+    * Batch
+    *    BST::applyBatch(batch)
+    ***************************************/
 
-      // now assign everything to the bst
-      bst.root = p50;
-      bst.numElements = 7;
+   // a batch into an empty tree builds it, dropping duplicates
+   void test_applyBatch_emptyTree()
+   {  // setup
+      custom::BST <int> bst;
+      std::vector<custom::BST<int>::update> batch
+      {
+         { 40, false }, { 10, false }, { 30, false }, { 10, false }, { 20, true }, { 50, false }
+      };
+      // exercise
+      auto result = bst.applyBatch(std::move(batch));
+      // verify
+      //           (40b)
+      //       +-----+-----+
+      //     (30b)       (50b)
+      //    +--+
+      //  (10r)
+      assertUnit(result.inserted == 4);
+      assertUnit(result.erased == 0);
+      assertUnit(result.skipped == 2);
+      assertUnit(bst.numElements == 4);
+      assertUnit(toVector(bst) == std::vector<int>({ 10, 30, 40, 50 }));
+      assertUnit(bst.root && !bst.root->isRed && bst.root->pParent == nullptr);
+      // teardown
+      bst.clear();
    }
 
-   /**************************************************************
-    * VERIFY EMPTY FIXTURE
-    *************************************************************/
-   void assertEmptyFixtureParameters(const custom::BST <Spy>& bst, int line, const char* function)
-   {
-      assertUnit(bst.root == nullptr);
+   // the changes to one value happen in the order given
+   void test_applyBatch_sameValue()
+   {  // setup
+      custom::BST <int> bst;
+      bst.insert(50);
+      std::vector<custom::BST<int>::update> batch
+      {
+         { 50, true }, { 60, false }, { 50, false }, { 60, true }, { 50, true }
+      };
+      // exercise
+      auto result = bst.applyBatch(std::move(batch));
+      // verify
+      assertUnit(result.inserted == 2);   // 50 back in, 60
+      assertUnit(result.erased == 3);     // 50 twice, 60
+      assertUnit(result.skipped == 0);
       assertUnit(bst.numElements == 0);
-   }
+      assertUnit(bst.root == nullptr);
+   }  // teardown
 
-   /**************************************************************
-    * VERIFY STANDARD FIXTURE
-    *                (50b)
-    *          +-------+-------+
-    *        (30b)           (70b)
-    *     +----+----+     +----+----+
-    *   (20r)     (40r) (60r)     (80r)
-    *************************************************************/
-   void assertStandardFixtureParameters(const custom::BST <Spy>& bst, int line, const char* function)
-   {
-      // verify the member variables
-      assertIndirect(bst.numElements == 7);
-      assertIndirect(bst.root != nullptr);
+   // a big batch is merged: an erased node holds the next new value
+   void test_applyBatch_mergeReusesNodes()
+   {  // setup
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20r)     (40r) (60r)     (80r)
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      std::vector<custom::BST<Spy>::update> batch
+      {
+         { Spy(20), true }, { Spy(25), false }, { Spy(70), false }
+      };
+      custom::BST<Spy>::BNode* p20 = bst.root->pLeft->pLeft;
+      Spy::reset();
+      // exercise
+      auto result = bst.applyBatch(std::move(batch));
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(result.inserted == 1);
+      assertUnit(result.erased == 1);
+      assertUnit(result.skipped == 1);
+      assertUnit(bst.numElements == 7);
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (25b)     (40b) (60b)     (80b)
+      std::vector<int> v;
+      for (auto it = bst.begin(); it != bst.end(); ++it)
+         v.push_back((*it).get());
+      assertUnit(v == std::vector<int>({ 25, 30, 40, 50, 60, 70, 80 }));
+      assertUnit(bst.root->pParent == nullptr);
+      assertUnit(bst.root->pLeft->pLeft == p20);      // 25 took 20's node
+      assertUnit(p20->pParent == bst.root->pLeft);
+      // teardown
+      bst.clear();
+   }
+
+   // a small batch into a big tree goes one value at a time
+   void test_applyBatch_each()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      std::vector<custom::BST<int>::update> batch
+      {
+         { 150, false }, { 50, true }, { 50, true }, { 99, false }
+      };
+      // exercise
+      auto result = bst.applyBatch(std::move(batch));
+      // verify
+      assertUnit(result.inserted == 1);
+      assertUnit(result.erased == 1);
+      assertUnit(result.skipped == 2);
+      assertUnit(bst.numElements == 100);
+      assertUnit(bst.find(50) == bst.end());
+      assertUnit(bst.find(150) != bst.end());
+      // teardown
+      bst.clear();
+   }
+
+   /***************************************
+    * Split and join
+    *    BST::BNode::join(pLess, pMiddle, pGreater)
+    *    BST::BNode::split(pTree, t, pLess, pMatch, pGreater)
+    *    BST::insertParallel(first, last, executor)
+    ***************************************/
+
+   // two trees of the same black height under a new root
+   void test_join_equalHeights()
+   {  // setup
+      custom::BST <int> bstLess;
+      custom::BST <int> bstGreater;
+      std::vector<int> less{ 10, 20, 30 };
+      std::vector<int> greater{ 50, 60, 70 };
+      bstLess.assignSorted(less.begin(), less.end());
+      bstGreater.assignSorted(greater.begin(), greater.end());
+      auto pMiddle = new custom::BST<int>::BNode(40);
+      // exercise
+      custom::BST <int> bst;
+      bst.root = custom::BST<int>::BNode::join(bstLess.root, pMiddle, bstGreater.root);
+      bst.numElements = 7;
+      bstLess.root = bstGreater.root = nullptr;
+      // verify
+      //                (40b)
+      //          +-------+-------+
+      //        (20b)           (60b)
+      //     +----+----+     +----+----+
+      //   (10b)     (30b) (50b)     (70b)
+      assertUnit(bst.root == pMiddle);
+      assertUnit(toVector(bst) == std::vector<int>({ 10, 20, 30, 40, 50, 60, 70 }));
+      assertUnit(checkRedBlack(bst.root) == 3);
+      // teardown
+      bst.clear();
+   }
+
+   // a short tree joined onto the right side of a tall one
+   void test_join_lessTaller()
+   {  // setup
+      custom::BST <int> bstLess;
+      custom::BST <int> bstGreater;
+      std::vector<int> less;
+      for (int i = 0; i < 100; i++)
+         less.push_back(i);
+      std::vector<int> greater{ 200, 300 };
+      bstLess.assignSorted(less.begin(), less.end());
+      bstGreater.assignSorted(greater.begin(), greater.end());
+      auto pMiddle = new custom::BST<int>::BNode(150);
+      // exercise
+      custom::BST <int> bst;
+      bst.root = custom::BST<int>::BNode::join(bstLess.root, pMiddle, bstGreater.root);
+      bst.numElements = 103;
+      bstLess.root = bstGreater.root = nullptr;
+      // verify
+      less.push_back(150);
+      less.push_back(200);
+      less.push_back(300);
+      assertUnit(toVector(bst) == less);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // a short tree joined onto the left side of a tall one
+   void test_join_greaterTaller()
+   {  // setup
+      custom::BST <int> bstGreater;
+      std::vector<int> greater;
+      for (int i = 100; i < 200; i++)
+         greater.push_back(i);
+      bstGreater.assignSorted(greater.begin(), greater.end());
+      auto pMiddle = new custom::BST<int>::BNode(50);
+      // exercise
+      custom::BST <int> bst;
+      bst.root = custom::BST<int>::BNode::join(nullptr, pMiddle, bstGreater.root);
+      bst.numElements = 101;
+      bstGreater.root = nullptr;
+      // verify
+      greater.insert(greater.begin(), 50);
+      assertUnit(toVector(bst) == greater);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // cut a tree at a value it holds
+   void test_split_match()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      custom::BST<int>::BNode* pLess;
+      custom::BST<int>::BNode* pMatch;
+      custom::BST<int>::BNode* pGreater;
+      // exercise
+      custom::BST<int>::BNode::split(bst.root, 40, pLess, pMatch, pGreater);
+      bst.root = nullptr;
+      bst.numElements = 0;
+      // verify
+      custom::BST <int> bstLess;
+      custom::BST <int> bstGreater;
+      bstLess.root = pLess;
+      bstLess.numElements = 40;
+      bstGreater.root = pGreater;
+      bstGreater.numElements = 59;
+      assertUnit(pMatch != nullptr && pMatch->data == 40);
+      assertUnit(toVector(bstLess).size() == 40);
+      assertUnit(toVector(bstLess).back() == 39);
+      assertUnit(toVector(bstGreater).size() == 59);
+      assertUnit(toVector(bstGreater).front() == 41);
+      assertUnit(checkRedBlack(pLess) > 0);
+      assertUnit(checkRedBlack(pGreater) > 0);
+      // teardown
+      delete pMatch;
+      bstLess.clear();
+      bstGreater.clear();
+   }
+
+   // cut a tree at a value it does not hold
+   void test_split_missing()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i += 2)
+         bst.insert(i);
+      custom::BST<int>::BNode* pLess;
+      custom::BST<int>::BNode* pMatch;
+      custom::BST<int>::BNode* pGreater;
+      // exercise
+      custom::BST<int>::BNode::split(bst.root, 51, pLess, pMatch, pGreater);
+      bst.root = nullptr;
+      bst.numElements = 0;
+      // verify
+      custom::BST <int> bstLess;
+      custom::BST <int> bstGreater;
+      bstLess.root = pLess;
+      bstLess.numElements = 26;
+      bstGreater.root = pGreater;
+      bstGreater.numElements = 24;
+      assertUnit(pMatch == nullptr);
+      assertUnit(toVector(bstLess).size() == 26);
+      assertUnit(toVector(bstGreater).size() == 24);
+      assertUnit(toVector(bstGreater).front() == 52);
+      assertUnit(checkRedBlack(pLess) > 0);
+      assertUnit(checkRedBlack(pGreater) > 0);
+      // teardown
+      bstLess.clear();
+      bstGreater.clear();
+   }
+
+   // split at every value in turn and join back: still the same tree
+   void test_split_joinBack()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 64; i++)
+         bst.insert((i * 37) % 64);
+      bool valid = true;
+      // exercise
+      for (int i = 0; i < 64; i++)
+      {
+         custom::BST<int>::BNode* pLess;
+         custom::BST<int>::BNode* pMatch;
+         custom::BST<int>::BNode* pGreater;
+         custom::BST<int>::BNode::split(bst.root, (i * 11) % 64, pLess, pMatch, pGreater);
+         bst.root = custom::BST<int>::BNode::join(pLess, pMatch, pGreater);
+         valid = valid && checkRedBlack(bst.root) > 0;
+      }
+      // verify
+      std::vector<int> v = toVector(bst);
+      assertUnit(valid);
+      assertUnit(v.size() == 64);
+      assertUnit(v.front() == 0 && v.back() == 63);
+      // teardown
+      bst.clear();
+   }
+
+   // a parallel insert into an empty tree
+   void test_insertParallel_empty()
+   {  // setup
+      custom::BST <int> bst;
+      std::vector<int> batch{ 30, 10, 20, 10 };
+      // exercise
+      size_t num = bst.insertParallel(batch.begin(), batch.end(), custom::thread_executor(4));
+      // verify
+      assertUnit(num == 3);
+      assertUnit(bst.numElements == 3);
+      assertUnit(toVector(bst) == std::vector<int>({ 10, 20, 30 }));
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // the batch is cut at the tree's own top keys and inserted by
+   // four threads; the tree that comes back is a valid red-black tree
+   void test_insertParallel_standard()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 1000; i += 2)
+         bst.insert(i);
+      std::vector<int> batch;
+      for (int i = 999; i >= 0; i -= 3)
+         batch.push_back(i);
+      // exercise
+      size_t num = bst.insertParallel(batch.begin(), batch.end(), custom::thread_executor(4));
+      // verify
+      size_t numNew = 0;
+      for (int i : batch)
+         numNew += (i % 2) ? 1 : 0;
+      assertUnit(num == numNew);
+      assertUnit(bst.numElements == 500 + numNew);
+      std::vector<int> v = toVector(bst);
+      assertUnit(v.size() == 500 + numNew);
+      assertUnit(std::is_sorted(v.begin(), v.end()));
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   /**************************************************************
+    * SETUP STANDARD FIXTURE
+    *                (50b)
+    *          +-------+-------+
+    *        (30b)           (70b)
+    *     +----+----+     +----+----+
+    *   (20r)     (40r) (60r)     (80r)
+    *************************************************************/
+   void setupStandardFixture(custom::BST <Spy>& bst)
+   {
+      // make sure that bst is clean
+      assertUnit(bst.numElements == 0);
+      assertUnit(bst.root == nullptr);
+
+      // allocate
+      custom::BST<Spy>::BNode* p20 = new custom::BST<Spy>::BNode(Spy(20));
+      custom::BST<Spy>::BNode* p30 = new custom::BST<Spy>::BNode(Spy(30));
+      custom::BST<Spy>::BNode* p40 = new custom::BST<Spy>::BNode(Spy(40));
+      custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
+      custom::BST<Spy>::BNode* p60 = new custom::BST<Spy>::BNode(Spy(60));
+      custom::BST<Spy>::BNode* p70 = new custom::BST<Spy>::BNode(Spy(70));
+      custom::BST<Spy>::BNode* p80 = new custom::BST<Spy>::BNode(Spy(80));
+
+      // hook up the pointers down
+      p30->pLeft  = p20;
+      p30->pRight = p40;
+      p50->pLeft  = p30;
+      p50->pRight = p70;
+      p70->pLeft  = p60;
+      p70->pRight = p80;
+
+      // hook up the pointers up
+      p20->pParent = p40->pParent = p30;
+      p30->pParent = p70->pParent = p50;
+      p60->pParent = p80->pParent = p70;
+
+      // color everything
+      p50->isRed = p30->isRed = p70->isRed = false;
+      p20->isRed = p40->isRed = p60->isRed = p80->isRed = true;
+
+      // now assign everything to the bst
+      bst.root = p50;
+      bst.numElements = 7;
+   }
+
+   /**************************************************************
+    * VERIFY EMPTY FIXTURE
+    *************************************************************/
+   void assertEmptyFixtureParameters(const custom::BST <Spy>& bst, int line, const char* function)
+   {
+      assertUnit(bst.root == nullptr);
+      assertUnit(bst.numElements == 0);
+   }
+
+   /**************************************************************
+    * VERIFY STANDARD FIXTURE
+    *                (50b)
+    *          +-------+-------+
+    *        (30b)           (70b)
+    *     +----+----+     +----+----+
+    *   (20r)     (40r) (60r)     (80r)
+    *************************************************************/
+   void assertStandardFixtureParameters(const custom::BST <Spy>& bst, int line, const char* function)
+   {
+      // verify the member variables
+      assertIndirect(bst.numElements == 7);
+      assertIndirect(bst.root != nullptr);
 
       // verify the pointers down
       assertIndirect(bst.root != nullptr);
@@ -3747,6 +4436,918 @@ public:
    }
 
   
+
+   // two trees joined with nothing between them
+   void test_join_noMiddle()
+   {  // setup
+      custom::BST <int> bstLess;
+      custom::BST <int> bstGreater;
+      std::vector<int> less;
+      for (int i = 0; i < 50; i++)
+         less.push_back(i);
+      std::vector<int> greater{ 60, 70, 80 };
+      bstLess.assignSorted(less.begin(), less.end());
+      bstGreater.assignSorted(greater.begin(), greater.end());
+      // exercise
+      custom::BST <int> bst;
+      bst.root = custom::BST<int>::BNode::join(bstLess.root, bstGreater.root);
+      bst.numElements = 53;
+      bstLess.root = bstGreater.root = nullptr;
+      // verify
+      less.insert(less.end(), greater.begin(), greater.end());
+      assertUnit(toVector(bst) == less);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      assertUnit(custom::BST<int>::BNode::join(nullptr, nullptr) == nullptr);
+      // teardown
+      bst.clear();
+   }
+
+   /***************************************
+    * Erase range
+    *    BST::erase(first, last)
+    *    BST::extract(first, last)
+    ***************************************/
+
+   // a short range is erased one node at a time, leaving
+   // the nodes on either side where they were
+   void test_eraseRange_short()
+   {  // setup
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20r)     (40r) (60r)     (80r)
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(i);
+      auto pRoot = bst.root;
+      // exercise
+      size_t num = bst.erase(bst.find(30), bst.find(50));
+      // verify
+      assertUnit(num == 2);
+      assertUnit(bst.numElements == 5);
+      assertUnit(bst.root == pRoot);
+      assertUnit(toVector(bst) == std::vector<int>({ 20, 50, 60, 70, 80 }));
+      // teardown
+      bst.clear();
+   }
+
+   // a long range is detached in one piece
+   void test_eraseRange_long()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 1000; i++)
+         bst.insert(i);
+      auto it = bst.find(700);
+      auto pLast = it.pNode;
+      // exercise
+      size_t num = bst.erase(bst.find(200), it);
+      // verify
+      assertUnit(num == 500);
+      assertUnit(bst.numElements == 500);
+      std::vector<int> v = toVector(bst);
+      assertUnit(v.size() == 500);
+      assertUnit(v[199] == 199 && v[200] == 700);
+      assertUnit(bst.find(700).pNode == pLast);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // erase everything from a point on
+   void test_eraseRange_toEnd()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      // exercise
+      size_t num = bst.erase(bst.find(10), bst.end());
+      // verify
+      assertUnit(num == 90);
+      assertUnit(bst.numElements == 10);
+      assertUnit(toVector(bst).back() == 9);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // a tree built by hand need not be a true red-black tree, here
+   // with a black root and long red runs; a range erase must still work
+   void test_eraseRange_unbalanced()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 400; i++)
+         bst.insert(i);
+      for (int i = 0; i < 400; i += 3)
+      {
+         auto it = bst.find(i);
+         bst.erase(it);
+      }
+      for (auto it = bst.begin(); it != bst.end(); ++it)
+         it.pNode->isRed = (*it % 5 != 0);
+      // exercise
+      size_t num = bst.erase(bst.lower_bound(50), bst.lower_bound(350));
+      // verify
+      std::vector<int> v = toVector(bst);
+      assertUnit(num == 200);
+      assertUnit(bst.numElements == v.size());
+      assertUnit(v.size() == 66);
+      assertUnit(std::is_sorted(v.begin(), v.end()));
+      // teardown
+      bst.clear();
+   }
+
+   // with duplicates, the range is by position: from the second
+   // 10 up to but not including the second 45
+   void test_eraseRange_duplicates()
+   {  // setup
+      custom::BST <int> bst;
+      for (int copy = 0; copy < 2; copy++)
+         for (int i = 0; i < 100; i++)
+            bst.insert(i);
+      auto first = nth(bst, 21);
+      auto last = nth(bst, 91);
+      auto pLast = last.pNode;
+      // exercise
+      size_t num = bst.erase(first, last);
+      // verify
+      std::vector<int> v = toVector(bst);
+      assertUnit(num == 70);
+      assertUnit(bst.numElements == 130);
+      assertUnit(v.size() == 130);
+      assertUnit(std::count(v.begin(), v.end(), 10) == 1);
+      assertUnit(std::count(v.begin(), v.end(), 11) == 0);
+      assertUnit(std::count(v.begin(), v.end(), 44) == 0);
+      assertUnit(std::count(v.begin(), v.end(), 45) == 1);
+      assertUnit(nth(bst, 21).pNode == pLast);
+      assertUnit(std::is_sorted(v.begin(), v.end()));
+      // teardown
+      bst.clear();
+   }
+
+   // a range moved into a tree of its own
+   void test_extract_standard()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      // exercise
+      custom::BST <int> bstRange = bst.extract(bst.find(20), bst.find(80));
+      // verify
+      assertUnit(bst.numElements == 40);
+      assertUnit(bstRange.numElements == 60);
+      std::vector<int> v = toVector(bstRange);
+      assertUnit(v.size() == 60);
+      assertUnit(v.front() == 20 && v.back() == 79);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      assertUnit(checkRedBlack(bstRange.root) > 0);
+      assertUnit(bst.extract(bst.begin(), bst.begin()).empty());
+      // teardown
+      bst.clear();
+      bstRange.clear();
+   }
+
+   // with duplicates, the range moved out is by position too
+   void test_extract_duplicates()
+   {  // setup
+      custom::BST <int> bst;
+      for (int copy = 0; copy < 2; copy++)
+         for (int i = 0; i < 100; i++)
+            bst.insert(i);
+      // exercise
+      custom::BST <int> bstRange = bst.extract(nth(bst, 21), nth(bst, 91));
+      // verify
+      std::vector<int> v = toVector(bst);
+      std::vector<int> vRange = toVector(bstRange);
+      assertUnit(bst.numElements == 130);
+      assertUnit(bstRange.numElements == 70);
+      assertUnit(vRange.size() == 70);
+      assertUnit(vRange.front() == 10 && vRange.back() == 45);
+      assertUnit(std::count(v.begin(), v.end(), 10) == 1);
+      assertUnit(std::count(v.begin(), v.end(), 45) == 1);
+      assertUnit(std::is_sorted(v.begin(), v.end()));
+      assertUnit(std::is_sorted(vRange.begin(), vRange.end()));
+      // teardown
+      bst.clear();
+      bstRange.clear();
+   }
+
+   /***************************************
+    * Erase by key
+    *    BST::eraseKey(t)
+    *    BST::eraseIf(pred)
+    ***************************************/
+
+   // a key that is not there changes nothing
+   void test_eraseKey_missing()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 70 })
+         bst.insert(i);
+      // exercise
+      bool erased = bst.eraseKey(60);
+      // verify
+      assertUnit(!erased);
+      assertUnit(bst.numElements == 3);
+      assertUnit(toVector(bst) == std::vector<int>({ 30, 50, 70 }));
+      // teardown
+      bst.clear();
+   }
+
+   // taking out a black leaf leaves its path one black short:
+   // the sibling's red child is rotated over to make it good
+   void test_eraseKey_rootBlack()
+   {  // setup
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //                     +----+
+      //                   (60r)
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 70, 60 })
+         bst.insert(i);
+      // exercise
+      bool erased = bst.eraseKey(30);
+      // verify
+      //                (60b)
+      //          +-------+-------+
+      //        (50b)           (70b)
+      assertUnit(erased);
+      assertUnit(bst.numElements == 3);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+      {
+         assertUnit(bst.root->data == 60);
+         assertUnit(bst.root->pLeft && bst.root->pLeft->data == 50);
+         assertUnit(bst.root->pRight && bst.root->pRight->data == 70);
+      }
+      assertUnit(checkRedBlack(bst.root) == 2);
+      // teardown
+      bst.clear();
+   }
+
+   // any order of erases leaves a valid red-black tree
+   void test_eraseKey_keepsRedBlack()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 500; i++)
+         bst.insert((i * 131) % 500);
+      bool valid = true;
+      size_t numErased = 0;
+      // exercise
+      for (int i = 0; i < 500; i += 2)
+      {
+         numErased += bst.eraseKey((i * 77) % 500) ? 1 : 0;
+         valid = valid && checkRedBlack(bst.root) >= 0;
+      }
+      // verify
+      assertUnit(valid);
+      assertUnit(numErased == 250);
+      assertUnit(bst.numElements == 250);
+      assertUnit(toVector(bst).size() == 250);
+      // teardown
+      bst.clear();
+   }
+
+   // nothing matches: the tree is left as it was
+   void test_eraseIf_none()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 70 })
+         bst.insert(i);
+      auto pRoot = bst.root;
+      // exercise
+      size_t num = bst.eraseIf([](int i) { return i > 100; });
+      // verify
+      assertUnit(num == 0);
+      assertUnit(bst.root == pRoot);
+      assertUnit(bst.numElements == 3);
+      // teardown
+      bst.clear();
+   }
+
+   // a few matches are unlinked one at a time
+   void test_eraseIf_few()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 1000; i++)
+         bst.insert(i);
+      // exercise
+      size_t num = bst.eraseIf([](int i) { return i % 100 == 0; });
+      // verify
+      std::vector<int> v = toVector(bst);
+      assertUnit(num == 10);
+      assertUnit(bst.numElements == 990);
+      assertUnit(v.size() == 990);
+      assertUnit(v.front() == 1);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // when many match, what is left is relinked in one go
+   void test_eraseIf_many()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 1000; i++)
+         bst.insert(i);
+      // exercise
+      size_t num = bst.eraseIf([](int i) { return i % 2 == 1; });
+      // verify
+      std::vector<int> v = toVector(bst);
+      assertUnit(num == 500);
+      assertUnit(bst.numElements == 500);
+      assertUnit(v.size() == 500);
+      assertUnit(v.front() == 0 && v.back() == 998);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   /***************************************
+    * Cached ends
+    *    BST::pLeftmost, BST::pRightmost
+    *    BST::iterator::operator--() from end()
+    *    BST::popFront(), BST::popBack()
+    ***************************************/
+
+   // every insert keeps the ends up to date
+   void test_cache_insert()
+   {  // setup
+      custom::BST <int> bst;
+      bool right = true;
+      // exercise
+      for (int i : { 50, 30, 70, 20, 80, 10, 90, 40, 60 })
+      {
+         bst.insert(i);
+         right = right && hasCachedEnds(bst);
+      }
+      // verify
+      assertUnit(right);
+      assertUnit(bst.pLeftmost->data == 10);
+      assertUnit(bst.pRightmost->data == 90);
+      // teardown
+      bst.clear();
+      assertUnit(bst.pLeftmost == nullptr);
+      assertUnit(bst.pRightmost == nullptr);
+   }
+
+   // erasing an end moves it in by one
+   void test_cache_erase()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      bool right = true;
+      // exercise
+      for (int i = 0; i < 50; i++)
+      {
+         bst.eraseKey(i);
+         bst.eraseKey(99 - i);
+         right = right && hasCachedEnds(bst);
+      }
+      // verify
+      assertUnit(right);
+      assertUnit(bst.empty());
+      assertUnit(bst.pLeftmost == nullptr);
+      assertUnit(bst.pRightmost == nullptr);
+   }  // teardown
+
+   // rebuilding or cutting up the tree finds the ends again
+   void test_cache_rebuild()
+   {  // setup
+      custom::BST <int> bst;
+      std::vector<int> v;
+      for (int i = 0; i < 100; i++)
+         v.push_back(i);
+      // exercise
+      bst.assignSorted(v.begin(), v.end());
+      bool afterAssign = hasCachedEnds(bst);
+      bst.erase(bst.find(80), bst.end());
+      bool afterErase = hasCachedEnds(bst);
+      custom::BST <int> bstRange = bst.extract(bst.begin(), bst.find(40));
+      bool afterExtract = hasCachedEnds(bst) && hasCachedEnds(bstRange);
+      bst.eraseIf([](int i) { return i % 2 == 0; });
+      bool afterEraseIf = hasCachedEnds(bst);
+      custom::BST <int> bstCopy(bst);
+      // verify
+      assertUnit(afterAssign);
+      assertUnit(afterErase);
+      assertUnit(afterExtract);
+      assertUnit(afterEraseIf);
+      assertUnit(hasCachedEnds(bstCopy));
+      assertUnit(bst.pLeftmost->data == 41);
+      assertUnit(bst.pRightmost->data == 79);
+      // teardown
+      bst.clear();
+      bstRange.clear();
+      bstCopy.clear();
+   }
+
+   // back up from the end to the last value
+   void test_decrement_end()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(i);
+      auto it = bst.end();
+      std::vector<int> v;
+      // exercise
+      for (int i = 0; i < 7; i++)
+      {
+         --it;
+         v.push_back(*it);
+      }
+      --it;
+      // verify
+      assertUnit(v == std::vector<int>({ 80, 70, 60, 50, 40, 30, 20 }));
+      assertUnit(it == bst.end());
+      // teardown
+      bst.clear();
+   }
+
+   // nothing to back up to in an empty tree
+   void test_decrement_endEmpty()
+   {  // setup
+      custom::BST <int> bst;
+      auto it = bst.end();
+      // exercise
+      --it;
+      // verify
+      assertUnit(it == bst.end());
+      assertUnit(it.pNode == nullptr);
+   }  // teardown
+
+   // the smallest goes, the next smallest takes its place
+   void test_popFront_standard()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(i);
+      // exercise
+      bst.popFront();
+      bst.popFront();
+      // verify
+      assertUnit(bst.numElements == 5);
+      assertUnit(toVector(bst) == std::vector<int>({ 40, 50, 60, 70, 80 }));
+      assertUnit(hasCachedEnds(bst));
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // the largest goes, down to nothing and one more
+   void test_popBack_standard()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 70 })
+         bst.insert(i);
+      // exercise
+      bst.popBack();
+      bool twoLeft = toVector(bst) == std::vector<int>({ 30, 50 });
+      bst.popBack();
+      bst.popBack();
+      bst.popBack();
+      // verify
+      assertUnit(twoLeft);
+      assertUnit(bst.empty());
+      assertUnit(bst.root == nullptr);
+      assertUnit(bst.pLeftmost == nullptr);
+   }  // teardown
+
+   // popping the smallest over and over keeps a valid red-black
+   // tree and the right ends the whole way down
+   void test_popFront_drain()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 300; i++)
+         bst.insert((i * 97) % 300);
+      bool right = true;
+      // exercise
+      for (int i = 0; i < 300; i++)
+      {
+         right = right && *bst.begin() == i;
+         bst.popFront();
+         right = right && checkRedBlack(bst.root) >= 0 && hasCachedEnds(bst);
+      }
+      // verify
+      assertUnit(right);
+      assertUnit(bst.empty());
+      assertUnit(bst.root == nullptr);
+   }  // teardown
+
+   // the same for the largest
+   void test_popBack_drain()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 300; i++)
+         bst.insert((i * 97) % 300);
+      bool right = true;
+      // exercise
+      for (int i = 299; i >= 0; i--)
+      {
+         right = right && *--bst.end() == i;
+         bst.popBack();
+         right = right && checkRedBlack(bst.root) >= 0 && hasCachedEnds(bst);
+      }
+      // verify
+      assertUnit(right);
+      assertUnit(bst.empty());
+   }  // teardown
+
+   // a tree built by hand has no cached ends: walk to them
+   void test_popFront_byHand()
+   {  // setup
+      //          50
+      //     +----+----+
+      //    30        70
+      //     +-+
+      //       40
+      custom::BST <int> bst;
+      auto p30 = new custom::BST<int>::BNode(30);
+      auto p40 = new custom::BST<int>::BNode(40);
+      auto p50 = new custom::BST<int>::BNode(50);
+      auto p70 = new custom::BST<int>::BNode(70);
+      bst.root = p50;
+      p50->addLeft(p30);
+      p50->addRight(p70);
+      p30->addRight(p40);
+      bst.numElements = 4;
+      // exercise
+      bst.popFront();
+      // verify
+      //          50
+      //     +----+----+
+      //    40        70
+      assertUnit(bst.numElements == 3);
+      assertUnit(bst.root == p50);
+      assertUnit(p50->pLeft == p40);
+      assertUnit(p40->pParent == p50);
+      assertUnit(bst.pLeftmost == p40);
+      assertUnit(toVector(bst) == std::vector<int>({ 40, 50, 70 }));
+      // teardown
+      bst.clear();
+   }
+
+   // the value comes back out as the node goes
+   void test_takeFront_standard()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 70 })
+         bst.insert(i);
+      // exercise
+      int front = bst.takeFront();
+      int back = bst.takeBack();
+      // verify
+      assertUnit(front == 30);
+      assertUnit(back == 70);
+      assertUnit(toVector(bst) == std::vector<int>({ 50 }));
+      assertUnit(hasCachedEnds(bst));
+      // teardown
+      bst.clear();
+   }
+
+   /***************************************
+    * Layout
+    *    BST::optimizeLayout()
+    ***************************************/
+
+   // nothing to lay out, and no block for it
+   void test_optimizeLayout_empty()
+   {  // setup
+      custom::BST <int> bst;
+      // exercise
+      bst.optimizeLayout();
+      // verify
+      assertUnit(bst.empty());
+      assertUnit(bst.root == nullptr);
+      assertUnit(bst.arena == nullptr);
+   }  // teardown
+
+   // the top two levels, then each three-node subtree below them,
+   // each laid out top first
+   //                      7
+   //           +----------+----------+
+   //           3                     11
+   //      +----+----+           +----+----+
+   //      1         5           9         13
+   //    +-+-+     +-+-+       +-+-+     +-+-+
+   //    0   2     4   6       8   10   12   14
+   void test_optimizeLayout_vebOrder()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i : { 14, 0, 7, 3, 11, 9, 1, 12, 5, 2, 13, 4, 10, 6, 8 })
+         bst.insert(i);
+      // exercise
+      bst.optimizeLayout();
+      // verify
+      auto pBlock = bst.arena->nodes;
+      std::vector<int> v;
+      for (int i = 0; i < 15; i++)
+         v.push_back(pBlock[i].data);
+      assertUnit(v == std::vector<int>({ 7, 3, 11, 1, 0, 2, 5, 4, 6, 9, 8, 10, 13, 12, 14 }));
+      assertUnit(bst.root == pBlock);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // any size comes out perfectly balanced and still red-black, with
+   // every node in the block
+   void test_optimizeLayout_balanced()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 1000; i++)
+         bst.insert((i * 7919) % 1000);
+      std::vector<int> vBefore = toVector(bst);
+      // exercise
+      bst.optimizeLayout();
+      // verify
+      auto pBlock = bst.arena->nodes;
+      bool allInBlock = true;
+      for (auto it = bst.begin(); it != bst.end(); ++it)
+         allInBlock = allInBlock && it.pNode->inArena &&
+                      it.pNode >= pBlock && it.pNode < pBlock + 1000;
+      assertUnit(allInBlock);
+      assertUnit(toVector(bst) == vBefore);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      assertUnit(height(bst.root) == 10);
+      assertUnit(hasCachedEnds(bst));
+      // teardown
+      bst.clear();
+   }
+
+   // nodes in the block and nodes from the heap mix freely afterwards
+   void test_optimizeLayout_thenChurn()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 200; i++)
+         bst.insert(i);
+      bst.optimizeLayout();
+      // exercise
+      for (int i = 0; i < 200; i += 2)
+         bst.eraseKey(i);
+      for (int i = 200; i < 300; i++)
+         bst.insert(i);
+      bst.popFront();
+      bst.eraseIf([](int i) { return i % 3 == 0; });
+      bst.optimizeLayout();
+      // verify
+      std::vector<int> v = toVector(bst);
+      assertUnit(v.size() == bst.numElements);
+      assertUnit(v.front() == 5 && v.back() == 299);
+      assertUnit(std::is_sorted(v.begin(), v.end()));
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // a tree extracted from one in a block keeps the block alive
+   void test_optimizeLayout_extractOutlives()
+   {  // setup
+      custom::BST <int>* pBst = new custom::BST<int>;
+      for (int i = 0; i < 100; i++)
+         pBst->insert(i);
+      pBst->optimizeLayout();
+      // exercise
+      custom::BST <int> bstRange = pBst->extract(pBst->find(20), pBst->find(80));
+      delete pBst;
+      // verify
+      std::vector<int> v = toVector(bstRange);
+      assertUnit(v.size() == 60);
+      assertUnit(v.front() == 20 && v.back() == 79);
+      assertUnit(bstRange.arena != nullptr);
+      // teardown
+      bstRange.clear();
+      assertUnit(bstRange.arena == nullptr);
+   }
+
+   // the values are moved, not copied, and each destroyed once
+   void test_optimizeLayout_movesValues()
+   {  // setup
+      {
+         custom::BST <Spy> bst;
+         for (int i = 0; i < 20; i++)
+            bst.insert(Spy(i));
+         Spy::reset();
+         // exercise
+         bst.optimizeLayout();
+         // verify
+         assertUnit(Spy::numCopy() == 0);
+         assertUnit(Spy::numCopyMove() == 20);
+         assertUnit(Spy::numLessthan() == 0);
+         bst.eraseKey(Spy(5));
+      }  // teardown
+      assertUnit(Spy::numDestructor() == 20 + 20 + 1);
+   }
+
+   // after churn, the values come back in key order, one after another
+   void test_compact_inOrder()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 500; i++)
+         bst.insert((i * 7919) % 500);
+      for (int i = 0; i < 500; i += 3)
+         bst.eraseKey(i);
+      std::vector<int> vBefore = toVector(bst);
+      // exercise
+      bst.compact();
+      // verify
+      std::vector<int> vBlock;
+      for (size_t i = 0; i < bst.numElements; i++)
+         vBlock.push_back(bst.arena->nodes[i].data);
+      assertUnit(vBlock == vBefore);
+      assertUnit(toVector(bst) == vBefore);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      assertUnit(height(bst.root) == 9);
+      assertUnit(hasCachedEnds(bst));
+      // teardown
+      bst.clear();
+   }
+
+   // breadth first: the root, then each level left to right
+   //            4
+   //        2       6
+   //      1   3   5   7
+   void test_compact_breadthFirst()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 1; i <= 7; i++)
+         bst.insert(i);
+      // exercise
+      bst.compact(custom::node_order::BREADTH_FIRST);
+      // verify
+      std::vector<int> vBlock;
+      for (int i = 0; i < 7; i++)
+         vBlock.push_back(bst.arena->nodes[i].data);
+      assertUnit(vBlock == std::vector<int>({ 4, 2, 6, 1, 3, 5, 7 }));
+      assertUnit(bst.root == bst.arena->nodes);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // each step moves no more than it is allowed, smallest first, and
+   // leaves the shape of the tree alone
+   void test_compactStep_bounded()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert((i * 37) % 100);
+      int rootBefore = bst.root->data;
+      // exercise
+      bool done1 = bst.compactStep(30);
+      size_t numPlaced1 = bst.arena->numPlaced;
+      bool inBlock29 = bst.find(29).pNode->inArena;
+      bool inBlock30 = bst.find(30).pNode->inArena;
+      int numSteps = 1;
+      for (bool done = false; !done; numSteps++)
+         done = bst.compactStep(30);
+      // verify
+      assertUnit(!done1);
+      assertUnit(numPlaced1 == 30);
+      assertUnit(inBlock29 && !inBlock30);
+      assertUnit(numSteps == 4);
+      assertUnit(bst.root->data == rootBefore);
+      assertUnit(bst.arena->pOlder == nullptr);
+      assertUnit(!bst.arena->isFilling);
+      bool inOrder = true;
+      for (int i = 0; i < 100; i++)
+         inOrder = inOrder && bst.arena->nodes[i].data == i;
+      assertUnit(inOrder);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      assertUnit(hasCachedEnds(bst));
+      // teardown
+      bst.clear();
+   }
+
+   // inserts and erases between steps, on both sides of where the
+   // steps have got to and in the old block too
+   void test_compactStep_churnBetween()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 400; i += 2)
+         bst.insert(i);
+      bst.optimizeLayout();
+      bool done = false;
+      bool balanced = true;
+      // exercise
+      for (int step = 0; !done; step++)
+      {
+         done = bst.compactStep(16);
+         bst.eraseKey((step * 31) % 400);
+         bst.insert((step * 17) % 400 + 1, true /*keepUnique*/);
+         balanced = balanced && checkRedBlack(bst.root) > 0 && hasCachedEnds(bst);
+      }
+      while (!bst.compactStep(1000))
+         ;
+      // verify
+      std::vector<int> v = toVector(bst);
+      assertUnit(balanced);
+      assertUnit(v.size() == bst.numElements);
+      assertUnit(std::adjacent_find(v.begin(), v.end(),
+                 std::greater_equal<int>()) == v.end());
+      assertUnit(checkRedBlack(bst.root) > 0);
+      // teardown
+      bst.clear();
+   }
+
+   // a tree extracted halfway shares the block, so the next step on the
+   // tree it came from starts a block of its own. Once that one is done,
+   // the extracted tree has the shared block to itself and carries on
+   // in it
+   void test_compactStep_extractMidway()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      bst.compactStep(50);
+      auto pShared = bst.arena;
+      // exercise
+      custom::BST <int> bstRange = bst.extract(bst.find(20), bst.find(80));
+      bst.compactStep(1000);
+      bstRange.compactStep(1000);
+      // verify
+      assertUnit(bst.arena != pShared);
+      assertUnit(bstRange.arena == pShared);
+      bool allInBlock = true;
+      for (auto it = bstRange.begin(); it != bstRange.end(); ++it)
+         allInBlock = allInBlock && it.pNode->inArena;
+      assertUnit(allInBlock);
+      assertUnit(toVector(bst).size() == 40);
+      assertUnit(toVector(bstRange).size() == 60);
+      assertUnit(checkRedBlack(bst.root) > 0);
+      assertUnit(checkRedBlack(bstRange.root) > 0);
+      // teardown
+      bst.clear();
+      bstRange.clear();
+   }
+
+   /*************************************************************
+    * CHECK RED BLACK
+    * The black height of a subtree, or -1 if it is not a valid
+    * red-black tree: a red node with a red child, two ways down
+    * with different numbers of black nodes, a child that does not
+    * point back to its parent, or values out of order
+    *************************************************************/
+   template <typename T>
+   int checkRedBlack(const typename custom::BST<T>::BNode* pNode)
+   {
+      if (!pNode)
+         return 0;
+      for (auto pChild : { pNode->pLeft, pNode->pRight })
+         if (pChild && (pChild->pParent != pNode || (pNode->isRed && pChild->isRed)))
+            return -1;
+      if ((pNode->pLeft && !(pNode->pLeft->data < pNode->data)) ||
+          (pNode->pRight && !(pNode->data < pNode->pRight->data)))
+         return -1;
+      int left = checkRedBlack<T>(pNode->pLeft);
+      int right = checkRedBlack<T>(pNode->pRight);
+      if (left < 0 || left != right)
+         return -1;
+      return left + (pNode->isRed ? 0 : 1);
+   }
+   int checkRedBlack(const custom::BST<int>::BNode* pNode)
+   {
+      return checkRedBlack<int>(pNode);
+   }
+
+   /*************************************************************
+    * HEIGHT
+    * How many nodes the longest way down passes
+    *************************************************************/
+   int height(const custom::BST<int>::BNode* pNode)
+   {
+      return pNode ? 1 + std::max(height(pNode->pLeft), height(pNode->pRight)) : 0;
+   }
+
+   /*************************************************************
+    * NTH
+    * The iterator n steps in from the beginning
+    *************************************************************/
+   custom::BST<int>::iterator nth(const custom::BST<int>& bst, size_t n)
+   {
+      auto it = bst.begin();
+      for (size_t i = 0; i < n; i++)
+         ++it;
+      return it;
+   }
+
+   /*************************************************************
+    * HAS CACHED ENDS
+    * Whether the tree's cached smallest and largest nodes are
+    * the ones a walk down each side finds
+    *************************************************************/
+   bool hasCachedEnds(const custom::BST<int>& bst)
+   {
+      const custom::BST<int>::BNode* pLeftmost = bst.root;
+      const custom::BST<int>::BNode* pRightmost = bst.root;
+      while (pLeftmost && pLeftmost->pLeft)
+         pLeftmost = pLeftmost->pLeft;
+      while (pRightmost && pRightmost->pRight)
+         pRightmost = pRightmost->pRight;
+      return bst.pLeftmost == pLeftmost && bst.pRightmost == pRightmost;
+   }
 };
 
 #endif // DEBUG
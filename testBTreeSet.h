@@ -0,0 +1,562 @@
+/***********************************************************************
+ * Header:
+ *    TEST BTREE SET
+ * Summary:
+ *    Unit tests for btree_set. Small nodes, four keys each, so a
+ *    handful of values is enough to split and merge.
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "btree_set.h"
+#include "unitTest.h"
+#include "spy.h"
+#include <set>
+#include <vector>
+#include <cstdlib>    // for rand
+
+/***********************************************
+ * TEST BTREE SET
+ * Unit tests for the btree_set class
+ ***********************************************/
+class TestBTreeSet : public UnitTest
+{
+public:
+   using Small = custom::btree_set<int, 4>;
+
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructRange_packsLeaves();
+      test_constructRange_unsortedDuplicates();
+      test_constructCopy_standard();
+      test_constructMove_standard();
+      test_assign_standardToStandard();
+      test_swap_standardToEmpty();
+      test_nodeKeys_default();
+
+      // Iterator
+      test_iterator_walksLeaves();
+      test_iterator_decrementEnd();
+
+      // Access
+      test_find_standard();
+      test_lowerBound_nextLeaf();
+      test_find_unsignedTopBit();
+
+      // Insert
+      test_insert_splitsLeaf();
+      test_insert_splitsRoot();
+      test_insert_duplicate();
+      test_insertMove_noCopies();
+
+      // Remove
+      test_erase_borrows();
+      test_erase_merges();
+      test_erase_toEmpty();
+      test_eraseIterator_returnsNext();
+      test_eraseRange_middle();
+      test_erase_random();
+      test_clear_freesAll();
+
+      report("BTreeSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // default constructor, no allocations
+   void test_construct_default()
+   {  // setup
+      Spy::reset();
+      // exercise
+      custom::btree_set<Spy> s;
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(s.root == nullptr);
+      assertUnit(s.pFirst == nullptr);
+      assertUnit(s.pLast == nullptr);
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // a sorted range fills leaves bottom up, every leaf at least half full
+   //               [ 4 8 ]
+   //       +----------+----------+
+   //   [1 2 3]    [4 5 6 7]  [8 9 10 11]
+   void test_constructRange_packsLeaves()
+   {  // setup
+      std::vector<int> v{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+      // exercise
+      Small s(v.begin(), v.end());
+      // verify
+      assertUnit(s.size() == 11);
+      assertUnit(verify(s));
+      assertUnit(!s.root->isLeaf);
+      assertUnit(s.root->numKeys == 2);
+      assertUnit(s.root->key(0) == 4 && s.root->key(1) == 8);
+      assertUnit(leafSizes(s) == std::vector<int>({ 3, 4, 4 }));
+      assertUnit(toVector(s) == v);
+   }  // teardown
+
+   // an unsorted range with repeats keeps one of each
+   void test_constructRange_unsortedDuplicates()
+   {  // setup
+      std::vector<int> v{ 50, 30, 70, 30, 20, 50, 40, 60, 80, 20 };
+      // exercise
+      Small s(v.begin(), v.end());
+      // verify
+      assertUnit(s.size() == 7);
+      assertUnit(verify(s));
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+   }  // teardown
+
+   // a copy has its own nodes and its own leaf chain
+   void test_constructCopy_standard()
+   {  // setup
+      Small sSrc;
+      for (int i = 0; i < 50; i++)
+         sSrc.insert((i * 7) % 50);
+      // exercise
+      Small sDest(sSrc);
+      // verify
+      assertUnit(sDest.root != sSrc.root);
+      assertUnit(sDest.size() == 50);
+      assertUnit(verify(sDest));
+      assertUnit(toVector(sDest) == toVector(sSrc));
+      sSrc.clear();
+      assertUnit(toVector(sDest).size() == 50);
+   }  // teardown
+
+   // moving takes the nodes
+   void test_constructMove_standard()
+   {  // setup
+      Small sSrc{ 50, 30, 70, 20, 40, 60, 80 };
+      auto pRoot = sSrc.root;
+      // exercise
+      Small sDest(std::move(sSrc));
+      // verify
+      assertUnit(sDest.root == pRoot);
+      assertUnit(sDest.size() == 7);
+      assertUnit(sSrc.root == nullptr);
+      assertUnit(sSrc.begin() == sSrc.end());
+   }  // teardown
+
+   // assignment replaces everything
+   void test_assign_standardToStandard()
+   {  // setup
+      Small sSrc{ 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+      Small sDest{ 50, 60 };
+      // exercise
+      sDest = sSrc;
+      // verify
+      assertUnit(verify(sDest));
+      assertUnit(toVector(sDest) == toVector(sSrc));
+      sDest = { 5, 4 };
+      assertUnit(toVector(sDest) == std::vector<int>({ 4, 5 }));
+   }  // teardown
+
+   // swap trades roots and leaf chains
+   void test_swap_standardToEmpty()
+   {  // setup
+      Small sLeft{ 1, 2, 3, 4, 5, 6 };
+      Small sRight;
+      // exercise
+      sLeft.swap(sRight);
+      // verify
+      assertUnit(sLeft.empty());
+      assertUnit(sLeft.begin() == sLeft.end());
+      assertUnit(toVector(sRight) == std::vector<int>({ 1, 2, 3, 4, 5, 6 }));
+      assertUnit(*--sRight.end() == 6);
+   }  // teardown
+
+   // ints get 64 to a node, big things no fewer than 16
+   void test_nodeKeys_default()
+   {  // verify
+      assertUnit(custom::btree_node_keys<int>::value == 64);
+      assertUnit(custom::btree_node_keys<long long>::value == 32);
+      assertUnit(custom::btree_node_keys<Spy>::value >= 16);
+      assertUnit(custom::btree_node_keys<Spy>::value <= 64);
+   }
+
+   /***************************************
+    * ITERATOR
+    ***************************************/
+
+   // ++ goes along a leaf, then on to the next one
+   void test_iterator_walksLeaves()
+   {  // setup
+      std::vector<int> v{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+      Small s(v.begin(), v.end());
+      auto it = s.begin();
+      auto pFirstLeaf = it.pLeaf;
+      // exercise
+      for (int i = 0; i < pFirstLeaf->numKeys; i++)
+         ++it;
+      // verify
+      assertUnit(it.pLeaf == pFirstLeaf->pNext);
+      assertUnit(it.index == 0);
+      assertUnit(*it == pFirstLeaf->numKeys + 1);
+   }  // teardown
+
+   // --end() is the largest, backwards visits everything
+   void test_iterator_decrementEnd()
+   {  // setup
+      Small s;
+      for (int i = 0; i < 40; i++)
+         s.insert(i);
+      std::vector<int> backward;
+      // exercise
+      for (auto it = s.end(); it != s.begin(); )
+         backward.insert(backward.begin(), *--it);
+      // verify
+      assertUnit(backward == toVector(s));
+      assertUnit(backward.size() == 40);
+   }  // teardown
+
+   /***************************************
+    * ACCESS
+    ***************************************/
+
+   // find answers for every key and nothing else
+   void test_find_standard()
+   {  // setup
+      Small s;
+      for (int i = 0; i < 100; i += 2)
+         s.insert(i);
+      bool right = true;
+      // exercise
+      for (int i = -1; i <= 100; i++)
+      {
+         auto it = s.find(i);
+         right = right && ((i >= 0 && i < 100 && i % 2 == 0) ? (it != s.end() && *it == i) : it == s.end());
+      }
+      // verify
+      assertUnit(right);
+   }  // teardown
+
+   // past the last key of a leaf, the bound is the first of the next
+   void test_lowerBound_nextLeaf()
+   {  // setup
+      std::vector<int> v{ 10, 20, 30, 40, 50, 60, 70, 80, 90, 100, 110 };
+      Small s(v.begin(), v.end());
+      int lastOfFirst = s.pFirst->key(s.pFirst->numKeys - 1);
+      // exercise
+      auto it = s.lower_bound(lastOfFirst + 1);
+      // verify
+      assertUnit(it.pLeaf == s.pFirst->pNext);
+      assertUnit(*it == lastOfFirst + 10);
+      assertUnit(s.lower_bound(111) == s.end());
+      assertUnit(*s.lower_bound(0) == 10);
+   }  // teardown
+
+   // unsigned keys past the top bit sort after the small ones, vector
+   // compares or not
+   void test_find_unsignedTopBit()
+   {  // setup
+      custom::btree_set<unsigned int, 16> s;
+      std::vector<unsigned int> keys;
+      for (unsigned int i = 0; i < 100; i++)
+         keys.push_back(i % 2 ? 0x80000000u + i : i);
+      for (unsigned int key : keys)
+         s.insert(key);
+      bool right = true;
+      // exercise
+      for (unsigned int key : keys)
+         right = right && s.find(key) != s.end() && *s.find(key) == key;
+      // verify
+      assertUnit(right);
+      assertUnit(*s.begin() == 0u);
+      assertUnit(*--s.end() == 0x80000000u + 99);
+      assertUnit(*s.lower_bound(0x7fffffffu) == 0x80000001u);
+      assertUnit(s.find(0x80000000u) == s.end());
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // the fifth key splits the root leaf: two leaves under a new root
+   //   [10 20 30 40] + 25  -->      [ 25 ]
+   //                              +-----+-----+
+   //                           [10 20]   [25 30 40]
+   void test_insert_splitsLeaf()
+   {  // setup
+      Small s{ 10, 20, 30, 40 };
+      assertUnit(s.root->isLeaf);
+      // exercise
+      auto result = s.insert(25);
+      // verify
+      assertUnit(result.second);
+      assertUnit(*result.first == 25);
+      assertUnit(!s.root->isLeaf);
+      assertUnit(s.root->numKeys == 1);
+      assertUnit(s.root->key(0) == 25);
+      assertUnit(leafSizes(s) == std::vector<int>({ 2, 3 }));
+      assertUnit(s.pFirst->pNext == s.pLast);
+      assertUnit(s.pLast->pPrev == s.pFirst);
+      assertUnit(verify(s));
+   }  // teardown
+
+   // ascending inserts split leaves until the root splits too
+   void test_insert_splitsRoot()
+   {  // setup
+      Small s;
+      // exercise
+      for (int i = 0; i < 30; i++)
+         s.insert(i);
+      // verify
+      assertUnit(s.size() == 30);
+      assertUnit(height(s.root) == 3);
+      assertUnit(verify(s));
+   }  // teardown
+
+   // a duplicate changes nothing and points at the one already there
+   void test_insert_duplicate()
+   {  // setup
+      Small s{ 10, 20, 30, 40, 50, 60 };
+      // exercise
+      auto result = s.insert(40);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(result.first == s.find(40));
+      assertUnit(s.size() == 6);
+   }  // teardown
+
+   // an rvalue is moved in, never copied, until a split copies a separator
+   void test_insertMove_noCopies()
+   {  // setup
+      custom::btree_set<Spy, 4> s;
+      Spy::reset();
+      // exercise
+      for (int i : { 50, 30, 70, 20 })
+         s.insert(Spy(i));
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(s.size() == 4);
+      assertUnit(s.root->isLeaf);
+   }  // teardown
+
+   /***************************************
+    * REMOVE
+    ***************************************/
+
+   // a leaf left short takes a key from a sibling that has one to spare
+   //        [ 30 ]                      [ 40 ]
+   //    +-----+-----+      -->      +-----+-----+
+   // [10 20]    [30 40 50]       [10 30]     [40 50]
+   void test_erase_borrows()
+   {  // setup
+      Small s{ 10, 20, 30, 40 };
+      s.insert(50);         // [10 20] [30 40 50]
+      assertUnit(leafSizes(s) == std::vector<int>({ 2, 3 }));
+      // exercise
+      assertUnit(s.erase(20) == 1);
+      // verify
+      assertUnit(leafSizes(s) == std::vector<int>({ 2, 2 }));
+      assertUnit(s.root->key(0) == 40);
+      assertUnit(toVector(s) == std::vector<int>({ 10, 30, 40, 50 }));
+      assertUnit(verify(s));
+   }  // teardown
+
+   // when neither sibling can spare a key, two leaves become one
+   //        [ 25 ]
+   //    +-----+-----+      -->      [10 30 40]
+   // [10 20]     [30 40]
+   void test_erase_merges()
+   {  // setup
+      Small s{ 10, 20, 30, 40 };
+      s.insert(25);
+      s.erase(25);          // [10 20] [30 40]
+      assertUnit(leafSizes(s) == std::vector<int>({ 2, 2 }));
+      // exercise
+      assertUnit(s.erase(20) == 1);
+      // verify
+      assertUnit(s.root->isLeaf);
+      assertUnit(s.pFirst == s.pLast);
+      assertUnit(toVector(s) == std::vector<int>({ 10, 30, 40 }));
+      assertUnit(verify(s));
+   }  // teardown
+
+   // erasing everything frees every node
+   void test_erase_toEmpty()
+   {  // setup
+      Small s;
+      for (int i = 0; i < 100; i++)
+         s.insert(i);
+      // exercise
+      for (int i = 0; i < 100; i++)
+         s.erase(i);
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.root == nullptr);
+      assertUnit(s.pFirst == nullptr && s.pLast == nullptr);
+      assertUnit(s.begin() == s.end());
+      assertUnit(s.erase(5) == 0);
+   }  // teardown
+
+   // erasing through an iterator returns the next one, even across leaves
+   void test_eraseIterator_returnsNext()
+   {  // setup
+      Small s;
+      for (int i = 0; i < 20; i++)
+         s.insert(i);
+      bool right = true;
+      // exercise
+      for (auto it = s.find(3); it != s.end() && *it < 15; )
+      {
+         int before = *it;
+         it = s.erase(it);
+         right = right && it != s.end() && *it == before + 1;
+      }
+      // verify
+      assertUnit(right);
+      assertUnit(toVector(s) == std::vector<int>({ 0, 1, 2, 15, 16, 17, 18, 19 }));
+      assertUnit(verify(s));
+   }  // teardown
+
+   // erase [40, 70) out of the middle
+   void test_eraseRange_middle()
+   {  // setup
+      Small s{ 10, 20, 30, 40, 50, 60, 70, 80, 90 };
+      auto itBegin = s.find(40);
+      auto itEnd = s.find(70);
+      // exercise
+      auto itReturn = s.erase(itBegin, itEnd);
+      // verify
+      assertUnit(itReturn != s.end());
+      if (itReturn != s.end())
+         assertUnit(*itReturn == 70);
+      assertUnit(toVector(s) == std::vector<int>({ 10, 20, 30, 70, 80, 90 }));
+      assertUnit(verify(s));
+   }  // teardown
+
+   // many inserts and erases agree with std::set and stay a B-tree
+   void test_erase_random()
+   {  // setup
+      srand(41);
+      Small s;
+      std::set<int> model;
+      bool valid = true;
+      // exercise
+      for (int i = 0; i < 4000; i++)
+      {
+         int value = rand() % 400;
+         if (rand() % 3)
+         {
+            s.insert(value);
+            model.insert(value);
+         }
+         else
+            assertUnit(s.erase(value) == model.erase(value));
+         if (i % 50 == 0)
+            valid = valid && verify(s);
+      }
+      // verify
+      assertUnit(valid);
+      assertUnit(s.size() == model.size());
+      assertUnit(toVector(s) == std::vector<int>(model.begin(), model.end()));
+   }  // teardown
+
+   // clear destroys every key
+   void test_clear_freesAll()
+   {  // setup
+      custom::btree_set<Spy, 4> s{ Spy(50), Spy(30), Spy(70), Spy(20), Spy(40), Spy(60) };
+      size_t numKeys = s.size() + (s.root->isLeaf ? 0 : s.root->numKeys);
+      Spy::reset();
+      // exercise
+      s.clear();
+      // verify
+      assertUnit((size_t)Spy::numDestructor() == numKeys);
+      assertUnit(s.root == nullptr);
+      assertUnit(s.empty());
+   }  // teardown
+
+   /*************************************************************
+    * LEAF SIZES
+    * How many keys are in each leaf, following the chain
+    *************************************************************/
+   template <typename T, int N>
+   std::vector<int> leafSizes(const custom::btree_set<T, N>& s)
+   {
+      std::vector<int> sizes;
+      for (auto p = s.pFirst; p; p = p->pNext)
+         sizes.push_back(p->numKeys);
+      return sizes;
+   }
+
+   /*************************************************************
+    * HEIGHT
+    * The number of levels, leaves included
+    *************************************************************/
+   template <typename Node>
+   int height(const Node* p)
+   {
+      int levels = 0;
+      for (; p; levels++)
+         p = p->isLeaf ? nullptr : static_cast<const typename Small::Inner*>(p)->children[0];
+      return levels;
+   }
+
+   /*************************************************************
+    * VERIFY
+    * Keys in order and within their parents' bounds, every node
+    * but the root at least half full, every leaf at one depth,
+    * and the leaf chain visiting every leaf in order
+    *************************************************************/
+   bool verify(const Small& s)
+   {
+      if (!s.root)
+         return s.size() == 0 && !s.pFirst && !s.pLast;
+      int leafDepth = -1;
+      size_t numKeys = 0;
+      std::vector<const Small::Leaf*> leaves;
+      if (!verifyNode(s, s.root, 0, nullptr, nullptr, leafDepth, leaves))
+         return false;
+      const Small::Leaf* pPrev = nullptr;
+      for (size_t i = 0; i < leaves.size(); i++)
+      {
+         if (leaves[i]->pPrev != pPrev || (i && pPrev->pNext != leaves[i]))
+            return false;
+         numKeys += leaves[i]->numKeys;
+         pPrev = leaves[i];
+      }
+      return s.pFirst == leaves.front() && s.pLast == leaves.back() &&
+             !s.pLast->pNext && numKeys == s.size();
+   }
+   bool verifyNode(const Small& s, const Small::Node* p, int depth,
+                   const int* pLow, const int* pHigh, int& leafDepth,
+                   std::vector<const Small::Leaf*>& leaves)
+   {
+      if (p != s.root && p->numKeys < Small::MIN_KEYS)
+         return false;
+      for (int i = 0; i < p->numKeys; i++)
+         if ((i && !(p->key(i - 1) < p->key(i))) ||
+             (pLow && p->key(i) < *pLow) || (pHigh && !(p->key(i) < *pHigh)))
+            return false;
+      if (p->isLeaf)
+      {
+         if (leafDepth < 0)
+            leafDepth = depth;
+         leaves.push_back(static_cast<const Small::Leaf*>(p));
+         return leafDepth == depth;
+      }
+      auto pInner = static_cast<const Small::Inner*>(p);
+      for (int i = 0; i <= p->numKeys; i++)
+         if (!verifyNode(s, pInner->children[i], depth + 1,
+                         i ? &p->key(i - 1) : pLow, i < p->numKeys ? &p->key(i) : pHigh,
+                         leafDepth, leaves))
+            return false;
+      return true;
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,338 @@
+/***********************************************************************
+ * Header:
+ *    TEST FLAT SET
+ * Summary:
+ *    Unit tests for flat_set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "flat_set.h"
+#include "unitTest.h"
+#include "spy.h"
+#include <set>
+#include <vector>
+#include <functional> // for std::greater
+#include <utility>    // for std::pair
+#include <cstdlib>    // for rand
+
+/***********************************************
+ * TEST FLAT SET
+ * Unit tests for the flat_set class
+ ***********************************************/
+class TestFlatSet : public UnitTest
+{
+   // a key with a tag the ordering ignores, to tell equal keys apart
+   using Tagged = std::pair<int, char>;
+   struct ByKey
+   {
+      bool operator()(const Tagged& lhs, const Tagged& rhs) const
+      {
+         return lhs.first < rhs.first;
+      }
+   };
+
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_construct_initializerList();
+      test_constructMove_empties();
+      test_construct_compare();
+
+      // Insert
+      test_insert_middle();
+      test_insert_duplicate();
+      test_insertRange_mergesKeepsOld();
+      test_insertRange_appendOnly();
+      test_insertRange_random();
+      test_reserve_noReallocate();
+
+      // Access
+      test_find_standard();
+      test_lowerBound_standard();
+
+      // Remove
+      test_erase_value();
+      test_eraseIterator_returnsNext();
+      test_eraseRange();
+
+      // The array itself
+      test_extractSequence_movesOut();
+      test_replace_takesOver();
+
+      report("FlatSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // default constructor, no allocations
+   void test_construct_default()
+   {  // setup
+      Spy::reset();
+      // exercise
+      custom::flat_set<Spy> s;
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(s.data.empty());
+      assertUnit(s.empty());
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // an initializer list comes out sorted with no repeats
+   void test_construct_initializerList()
+   {  // exercise
+      custom::flat_set<int> s{ 50, 30, 70, 30, 20, 70 };
+      // verify
+      assertUnit(s.data == std::vector<int>({ 20, 30, 50, 70 }));
+      assertUnit(s.size() == 4);
+   }  // teardown
+
+   // moving hands over the array and leaves the source empty
+   void test_constructMove_empties()
+   {  // setup
+      custom::flat_set<int> sSrc{ 1, 2, 3 };
+      const int* pArray = sSrc.data.data();
+      // exercise
+      custom::flat_set<int> sDest(std::move(sSrc));
+      // verify
+      assertUnit(sDest.data.data() == pArray);
+      assertUnit(sDest.size() == 3);
+      assertUnit(sSrc.empty());
+   }  // teardown
+
+   // the comparison decides the order
+   void test_construct_compare()
+   {  // exercise
+      custom::flat_set<int, std::greater<int>> s{ 20, 50, 30, 50 };
+      // verify
+      assertUnit(s.data == std::vector<int>({ 50, 30, 20 }));
+      assertUnit(s.find(30) != s.end());
+      assertUnit(*s.lower_bound(40) == 30);
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // a value in the middle shifts the larger ones along
+   //    [20 30 50 70]  -->  [20 30 40 50 70]
+   void test_insert_middle()
+   {  // setup
+      custom::flat_set<int> s{ 20, 30, 50, 70 };
+      // exercise
+      auto result = s.insert(40);
+      // verify
+      assertUnit(result.second);
+      assertUnit(result.first == s.begin() + 2);
+      assertUnit(s.data == std::vector<int>({ 20, 30, 40, 50, 70 }));
+   }  // teardown
+
+   // a value already there is not copied and not added
+   void test_insert_duplicate()
+   {  // setup
+      custom::flat_set<Spy> s{ Spy(20), Spy(30) };
+      Spy::reset();
+      // exercise
+      auto result = s.insert(Spy(30));
+      // verify
+      assertUnit(!result.second);
+      assertUnit(*result.first == Spy(30));
+      assertUnit(s.size() == 2);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+   }  // teardown
+
+   // a range is sorted, merged, and the old copy of a repeat survives
+   //    [10a 30a 50a] + {40b 30b 20b 40c}  -->  [10a 20b 30a 40b 50a]
+   void test_insertRange_mergesKeepsOld()
+   {  // setup
+      custom::flat_set<Tagged, ByKey> s{ { 10, 'a' }, { 30, 'a' }, { 50, 'a' } };
+      std::vector<Tagged> v{ { 40, 'b' }, { 30, 'b' }, { 20, 'b' }, { 40, 'c' } };
+      // exercise
+      s.insert(v.begin(), v.end());
+      // verify
+      assertUnit(s.data == std::vector<Tagged>(
+         { { 10, 'a' }, { 20, 'b' }, { 30, 'a' }, { 40, 'b' }, { 50, 'a' } }));
+      assertUnit(isSortedUnique(s));
+   }  // teardown
+
+   // values all past the end need no merge
+   void test_insertRange_appendOnly()
+   {  // setup
+      custom::flat_set<int> s{ 10, 20 };
+      std::vector<int> v{ 40, 30, 30 };
+      // exercise
+      s.insert(v.begin(), v.end());
+      // verify
+      assertUnit(s.data == std::vector<int>({ 10, 20, 30, 40 }));
+   }  // teardown
+
+   // many random batches agree with std::set
+   void test_insertRange_random()
+   {  // setup
+      custom::flat_set<int> s;
+      std::set<int> sStd;
+      srand(43);
+      // exercise
+      for (int batch = 0; batch < 20; batch++)
+      {
+         std::vector<int> v;
+         int num = rand() % 50;
+         for (int i = 0; i < num; i++)
+            v.push_back(rand() % 500);
+         s.insert(v.begin(), v.end());
+         sStd.insert(v.begin(), v.end());
+      }
+      // verify
+      assertUnit(isSortedUnique(s));
+      assertUnit(s.data == std::vector<int>(sStd.begin(), sStd.end()));
+   }  // teardown
+
+   // with room reserved, inserting does not move the array
+   void test_reserve_noReallocate()
+   {  // setup
+      custom::flat_set<int> s;
+      s.reserve(100);
+      const int* pArray = s.data.data();
+      // exercise
+      for (int i = 0; i < 100; i++)
+         s.insert((i * 37) % 100);
+      // verify
+      assertUnit(s.data.data() == pArray);
+      assertUnit(s.size() == 100);
+      assertUnit(s.capacity() >= 100);
+      assertUnit(isSortedUnique(s));
+   }  // teardown
+
+   /***************************************
+    * ACCESS
+    ***************************************/
+
+   // every value is found, and nothing else is
+   void test_find_standard()
+   {  // setup
+      custom::flat_set<int> s;
+      for (int i = 0; i < 100; i += 2)
+         s.insert(i);
+      // exercise and verify
+      for (int i = 0; i < 100; i++)
+      {
+         auto it = s.find(i);
+         if (i % 2 == 0)
+            assertUnit(it != s.end() && *it == i);
+         else
+            assertUnit(it == s.end());
+      }
+      assertUnit(s.find(-1) == s.end());
+      assertUnit(s.find(100) == s.end());
+   }  // teardown
+
+   // the first value not less than the one asked for
+   void test_lowerBound_standard()
+   {  // setup
+      custom::flat_set<int> s{ 20, 30, 50, 70 };
+      // exercise and verify
+      assertUnit(*s.lower_bound(10) == 20);
+      assertUnit(*s.lower_bound(30) == 30);
+      assertUnit(*s.lower_bound(31) == 50);
+      assertUnit(s.lower_bound(71) == s.end());
+      assertUnit(*s.upper_bound(30) == 50);
+   }  // teardown
+
+   /***************************************
+    * REMOVE
+    ***************************************/
+
+   // erasing by value says whether it was there
+   void test_erase_value()
+   {  // setup
+      custom::flat_set<int> s{ 20, 30, 50, 70 };
+      // exercise
+      size_t numFound = s.erase(30);
+      size_t numMissing = s.erase(40);
+      // verify
+      assertUnit(numFound == 1);
+      assertUnit(numMissing == 0);
+      assertUnit(s.data == std::vector<int>({ 20, 50, 70 }));
+   }  // teardown
+
+   // erasing at an iterator hands back the one after
+   void test_eraseIterator_returnsNext()
+   {  // setup
+      custom::flat_set<int> s{ 20, 30, 50, 70 };
+      // exercise
+      auto it = s.erase(s.find(30));
+      auto itLast = s.erase(s.find(70));
+      // verify
+      assertUnit(it != s.end() && *it == 50);
+      assertUnit(itLast == s.end());
+      assertUnit(s.data == std::vector<int>({ 20, 50 }));
+   }  // teardown
+
+   // a range goes in one shift
+   void test_eraseRange()
+   {  // setup
+      custom::flat_set<int> s{ 10, 20, 30, 40, 50, 60 };
+      // exercise
+      auto it = s.erase(s.lower_bound(20), s.lower_bound(45));
+      // verify
+      assertUnit(*it == 50);
+      assertUnit(s.data == std::vector<int>({ 10, 50, 60 }));
+   }  // teardown
+
+   /***************************************
+    * THE ARRAY ITSELF
+    ***************************************/
+
+   // the array leaves without a copy and the set is left empty
+   void test_extractSequence_movesOut()
+   {  // setup
+      custom::flat_set<int> s{ 30, 10, 20 };
+      const int* pArray = s.data.data();
+      // exercise
+      std::vector<int> v = s.extract_sequence();
+      // verify
+      assertUnit(v == std::vector<int>({ 10, 20, 30 }));
+      assertUnit(v.data() == pArray);
+      assertUnit(s.empty());
+      s.insert(5);
+      assertUnit(s.size() == 1);
+   }  // teardown
+
+   // a sorted array comes back in without a copy
+   void test_replace_takesOver()
+   {  // setup
+      custom::flat_set<int> s{ 99 };
+      std::vector<int> v{ 10, 20, 30, 40 };
+      const int* pArray = v.data();
+      // exercise
+      s.replace(std::move(v));
+      // verify
+      assertUnit(s.data.data() == pArray);
+      assertUnit(s.size() == 4);
+      assertUnit(s.find(99) == s.end());
+      assertUnit(s.find(30) != s.end());
+   }  // teardown
+
+   /*************************************************************
+    * IS SORTED UNIQUE
+    * Each element strictly less than the next
+    *************************************************************/
+   template <class T, class C>
+   bool isSortedUnique(const custom::flat_set<T, C>& s)
+   {
+      return s.isSortedUnique();
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,279 @@
+/***********************************************************************
+ * Header:
+ *    TEST FROZEN SET
+ * Summary:
+ *    Unit tests for frozen_set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "frozen_set.h"
+#include "set.h"
+#include "unitTest.h"
+#include "spy.h"
+#include <set>
+#include <vector>
+#include <functional> // for std::greater
+#include <cstdint>    // for uintptr_t
+#include <cstdlib>    // for rand
+
+/***********************************************
+ * TEST FROZEN SET
+ * Unit tests for the frozen_set class
+ ***********************************************/
+class TestFrozenSet : public UnitTest
+{
+   using Frozen = custom::frozen_set<int>;
+
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_construct_fromSet();
+      test_construct_sortedNoSort();
+      test_construct_unsortedDuplicates();
+      test_constructCopy_independent();
+      test_constructMove_empties();
+      test_swap_standard();
+
+      // Layout
+      test_layout_breadthFirst();
+      test_layout_aligned();
+
+      // Access
+      test_lowerBound_everyGap();
+      test_find_hitAndMiss();
+      test_compare_greater();
+      test_random_matchesStdSet();
+
+      // Iterators
+      test_iterator_everySize();
+      test_iterator_backward();
+
+      report("FrozenSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // default constructor: nothing to search
+   void test_construct_default()
+   {  // exercise
+      Frozen s;
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.size() == 0);
+      assertUnit(s.begin() == s.end());
+      assertUnit(s.find(3) == s.end());
+      assertUnit(s.lower_bound(3) == s.end());
+      assertUnit(s.memory == nullptr);
+   }  // teardown
+
+   // a set's elements come across in order
+   void test_construct_fromSet()
+   {  // setup
+      custom::set<int> sSrc{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      Frozen s(sSrc.begin(), sSrc.end());
+      // verify
+      assertUnit(s.size() == 7);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+   }  // teardown
+
+   // input already sorted is checked, not sorted: O(n) compares
+   void test_construct_sortedNoSort()
+   {  // setup
+      std::vector<Spy> values;
+      for (int i = 0; i < 100; i++)
+         values.push_back(Spy(i));
+      Spy::reset();
+      // exercise
+      custom::frozen_set<Spy> s(values.begin(), values.end());
+      // verify
+      assertUnit(Spy::numLessthan() == 99);
+      assertUnit(s.size() == 100);
+   }  // teardown
+
+   // anything else is sorted, and a repeat kept once
+   void test_construct_unsortedDuplicates()
+   {  // exercise
+      Frozen s{ 50, 30, 50, 20, 30, 20, 10 };
+      // verify
+      assertUnit(s.size() == 4);
+      assertUnit(toVector(s) == std::vector<int>({ 10, 20, 30, 50 }));
+   }  // teardown
+
+   // a copy is equal and has its own array
+   void test_constructCopy_independent()
+   {  // setup
+      Frozen sSrc{ 3, 1, 2 };
+      // exercise
+      Frozen sDest(sSrc);
+      sSrc = Frozen{ 9 };
+      // verify
+      assertUnit(toVector(sDest) == std::vector<int>({ 1, 2, 3 }));
+      assertUnit(toVector(sSrc) == std::vector<int>({ 9 }));
+   }  // teardown
+
+   // a move takes the array and leaves the source empty
+   void test_constructMove_empties()
+   {  // setup
+      Frozen sSrc{ 3, 1, 2 };
+      const int* pKeys = sSrc.keys;
+      // exercise
+      Frozen sDest(std::move(sSrc));
+      // verify
+      assertUnit(sDest.keys == pKeys);
+      assertUnit(toVector(sDest) == std::vector<int>({ 1, 2, 3 }));
+      assertUnit(sSrc.empty());
+      assertUnit(sSrc.begin() == sSrc.end());
+   }  // teardown
+
+   // swapping trades the arrays
+   void test_swap_standard()
+   {  // setup
+      Frozen s1{ 1, 2 };
+      Frozen s2{ 5, 6, 7 };
+      // exercise
+      s1.swap(s2);
+      // verify
+      assertUnit(toVector(s1) == std::vector<int>({ 5, 6, 7 }));
+      assertUnit(toVector(s2) == std::vector<int>({ 1, 2 }));
+   }  // teardown
+
+   /***************************************
+    * LAYOUT
+    ***************************************/
+
+   // the root first, then each level left to right
+   //            4
+   //        2       6
+   //      1   3   5   7
+   void test_layout_breadthFirst()
+   {  // exercise
+      Frozen s{ 1, 2, 3, 4, 5, 6, 7 };
+      // verify
+      assertUnit(std::vector<int>(s.keys + 1, s.keys + 8) == std::vector<int>({ 4, 2, 6, 1, 3, 5, 7 }));
+   }  // teardown
+
+   // [0] starts a cache line, so the levels fill whole lines
+   void test_layout_aligned()
+   {  // exercise
+      Frozen s = range<Frozen>(0, 1000);
+      // verify
+      assertUnit(reinterpret_cast<uintptr_t>(s.keys) % 64 == 0);
+      assertUnit(s.bytes_per_element() >= sizeof(int));
+   }  // teardown
+
+   /***************************************
+    * ACCESS
+    ***************************************/
+
+   // the lower bound of each key and of each gap between keys
+   void test_lowerBound_everyGap()
+   {  // setup
+      Frozen s{ 10, 20, 30, 40, 50, 60 };
+      // exercise and verify
+      assertUnit(*s.lower_bound(5) == 10);
+      assertUnit(*s.lower_bound(10) == 10);
+      assertUnit(*s.lower_bound(15) == 20);
+      assertUnit(*s.lower_bound(35) == 40);
+      assertUnit(*s.lower_bound(60) == 60);
+      assertUnit(s.lower_bound(65) == s.end());
+   }  // teardown
+
+   // find and contains agree, present or not
+   void test_find_hitAndMiss()
+   {  // setup
+      Frozen s = range<Frozen>(0, 100);
+      // exercise and verify
+      assertUnit(*s.find(0) == 0);
+      assertUnit(*s.find(57) == 57);
+      assertUnit(*s.find(99) == 99);
+      assertUnit(s.find(-1) == s.end());
+      assertUnit(s.find(100) == s.end());
+      assertUnit(s.contains(42));
+      assertUnit(!s.contains(142));
+   }  // teardown
+
+   // the order is Compare's
+   void test_compare_greater()
+   {  // exercise
+      custom::frozen_set<int, std::greater<int>> s{ 1, 3, 2, 5 };
+      // verify
+      assertUnit(std::vector<int>(s.begin(), s.end()) == std::vector<int>({ 5, 3, 2, 1 }));
+      assertUnit(*s.lower_bound(4) == 3);
+      assertUnit(s.lower_bound(0) == s.end());
+   }  // teardown
+
+   // random probes find what std::set finds
+   void test_random_matchesStdSet()
+   {  // setup
+      std::set<int> sStd;
+      srand(48);
+      for (int i = 0; i < 1000; i++)
+         sStd.insert(rand() % 5000);
+      Frozen s(sStd.begin(), sStd.end());
+      bool same = true;
+      // exercise
+      for (int i = 0; i < 5000; i++)
+      {
+         int value = rand() % 5100 - 50;
+         auto itStd = sStd.lower_bound(value);
+         auto it = s.lower_bound(value);
+         same = same && ((itStd == sStd.end()) == (it == s.end()));
+         same = same && (it == s.end() || *it == *itStd);
+         same = same && (s.contains(value) == (sStd.count(value) == 1));
+      }
+      // verify
+      assertUnit(same);
+   }  // teardown
+
+   /***************************************
+    * ITERATORS
+    ***************************************/
+
+   // in order for full trees and every ragged last level
+   void test_iterator_everySize()
+   {  // exercise and verify
+      bool same = true;
+      for (int num = 0; num < 70; num++)
+         same = same && toVector(range<Frozen>(0, num)) == sequence(num);
+      assertUnit(same);
+   }  // teardown
+
+   // back from end() to begin()
+   void test_iterator_backward()
+   {  // setup
+      Frozen s = range<Frozen>(0, 13);
+      std::vector<int> v;
+      // exercise
+      for (auto it = s.end(); it != s.begin(); )
+         v.push_back(*--it);
+      // verify
+      assertUnit(v == std::vector<int>({ 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 }));
+      assertUnit(*s.rbegin() == 12);
+   }  // teardown
+
+   /*************************************************************
+    * SEQUENCE
+    * 0 ... num-1
+    *************************************************************/
+   static std::vector<int> sequence(int num)
+   {
+      std::vector<int> v;
+      for (int i = 0; i < num; i++)
+         v.push_back(i);
+      return v;
+   }
+};
+
+#endif // DEBUG
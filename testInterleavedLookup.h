@@ -0,0 +1,201 @@
+/***********************************************************************
+ * Header:
+ *    TEST INTERLEAVED LOOKUP
+ * Summary:
+ *    Unit tests for interleaved_lookup. Only built with C++20
+ *    coroutines.
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "interleaved_lookup.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#include "unitTest.h"
+#include <vector>
+#include <algorithm>  // for std::sort
+
+/***********************************************
+ * TEST INTERLEAVED LOOKUP
+ * Unit tests for the interleaved_lookup class
+ ***********************************************/
+class TestInterleavedLookup : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Run
+      test_run_empty();
+      test_find_standard();
+      test_lowerBound_standard();
+      test_insertPosition_standard();
+      test_run_mixed();
+      test_run_widths();
+
+      report("InterleavedLookup");
+   }
+
+   /***************************************
+    * RUN
+    ***************************************/
+
+   // searching an empty tree finds nothing and runs every callback
+   void test_run_empty()
+   {  // setup
+      custom::BST<int> bst;
+      custom::interleaved_lookup<int> lookup(bst);
+      int numCalls = 0;
+      auto done = [&](custom::BST<int>::iterator it, bool found)
+      {
+         numCalls++;
+         assertUnit(it == bst.end());
+         assertUnit(!found);
+      };
+      lookup.find(10, done);
+      lookup.lower_bound(10, done);
+      lookup.insert_position(10, done);
+      // exercise
+      lookup.run();
+      // verify
+      assertUnit(numCalls == 3);
+      assertUnit(lookup.size() == 0);
+   }  // teardown
+
+   // finds answer the same as BST::find
+   void test_find_standard()
+   {  // setup
+      //                 50
+      //          +-------+-------+
+      //         30              70
+      //     +----+----+     +----+----+
+      //    20        40    60        80
+      custom::BST<int> bst;
+      setupStandard(bst);
+      custom::interleaved_lookup<int> lookup(bst, 2);
+      std::vector<custom::BST<int>::iterator> out(3);
+      std::vector<bool> found(3);
+      for (int i : { 0, 1, 2 })
+         lookup.find(std::vector<int>({ 40, 45, 80 })[i], [&, i](custom::BST<int>::iterator it, bool f)
+         {
+            out[i] = it;
+            found[i] = f;
+         });
+      // exercise
+      lookup.run();
+      // verify
+      assertUnit(out[0] == bst.find(40));
+      assertUnit(out[1] == bst.end());
+      assertUnit(out[2] == bst.find(80));
+      assertUnit(found == std::vector<bool>({ true, false, true }));
+   }  // teardown
+
+   // lower bounds answer the same as BST::lower_bound
+   void test_lowerBound_standard()
+   {  // setup
+      custom::BST<int> bst;
+      setupStandard(bst);
+      custom::interleaved_lookup<int> lookup(bst);
+      std::vector<int> keys{ 10, 35, 60, 85 };
+      std::vector<custom::BST<int>::iterator> out(keys.size());
+      std::vector<bool> found(keys.size());
+      for (size_t i = 0; i < keys.size(); i++)
+         lookup.lower_bound(keys[i], [&, i](custom::BST<int>::iterator it, bool f)
+         {
+            out[i] = it;
+            found[i] = f;
+         });
+      // exercise
+      lookup.run();
+      // verify
+      for (size_t i = 0; i < keys.size(); i++)
+         assertUnit(out[i] == bst.lower_bound(keys[i]));
+      assertUnit(found == std::vector<bool>({ false, false, true, false }));
+   }  // teardown
+
+   // the insert position is the parent a new node would hang from
+   void test_insertPosition_standard()
+   {  // setup
+      //                 50
+      //          +-------+-------+
+      //         30              70
+      //     +----+----+     +----+----+
+      //    20        40    60        80
+      custom::BST<int> bst;
+      setupStandard(bst);
+      custom::interleaved_lookup<int> lookup(bst);
+      custom::BST<int>::iterator itNew;
+      custom::BST<int>::iterator itOld;
+      bool foundNew = true;
+      bool foundOld = false;
+      lookup.insert_position(65, [&](custom::BST<int>::iterator it, bool f) { itNew = it; foundNew = f; });
+      lookup.insert_position(30, [&](custom::BST<int>::iterator it, bool f) { itOld = it; foundOld = f; });
+      // exercise
+      lookup.run();
+      // verify
+      assertUnit(itNew == bst.find(60));
+      assertUnit(!foundNew);
+      assertUnit(itOld == bst.find(30));
+      assertUnit(foundOld);
+   }  // teardown
+
+   // different kinds of searches in one batch
+   void test_run_mixed()
+   {  // setup
+      custom::BST<int> bst;
+      setupStandard(bst);
+      custom::interleaved_lookup<int> lookup(bst, 3);
+      std::vector<int> order;
+      lookup.find(20, [&](custom::BST<int>::iterator it, bool f) { order.push_back(f ? *it : -1); });
+      lookup.lower_bound(55, [&](custom::BST<int>::iterator it, bool) { order.push_back(*it); });
+      lookup.insert_position(85, [&](custom::BST<int>::iterator it, bool) { order.push_back(*it); });
+      lookup.find(25, [&](custom::BST<int>::iterator it, bool f) { order.push_back(f ? *it : -1); });
+      // exercise
+      lookup.run();
+      // verify
+      assertUnit(order.size() == 4);
+      std::sort(order.begin(), order.end());
+      assertUnit(order == std::vector<int>({ -1, 20, 60, 80 }));
+   }  // teardown
+
+   // any width gives the same answers, many more queries than lanes
+   void test_run_widths()
+   {  // setup
+      custom::BST<int> bst;
+      for (int i = 0; i < 300; i += 3)
+         bst.insert(i);
+      bool right = true;
+      for (int width : { 1, 4, 64, 1000 })
+      {
+         custom::interleaved_lookup<int> lookup(bst, width);
+         for (int i = 0; i < 300; i++)
+            lookup.find(i, [&, i](custom::BST<int>::iterator it, bool f)
+            {
+               right = right && f == (i % 3 == 0) && (!f || *it == i);
+            });
+         // exercise
+         lookup.run();
+      }
+      // verify
+      assertUnit(right);
+   }  // teardown
+
+   /*************************************************************
+    * SETUP STANDARD
+    * 20 30 40 50 60 70 80, balanced around 50
+    *************************************************************/
+   void setupStandard(custom::BST<int>& bst)
+   {
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(i);
+   }
+};
+
+#endif // __cpp_impl_coroutine
+#endif // DEBUG
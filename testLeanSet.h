@@ -0,0 +1,338 @@
+/***********************************************************************
+ * Header:
+ *    TEST LEAN SET
+ * Summary:
+ *    Unit tests for lean_set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "lean_set.h"
+#include "unitTest.h"
+#include "spy.h"
+#include <set>
+#include <vector>
+#include <iterator>   // for std::reverse_iterator
+#include <cstdlib>    // for rand
+
+/***********************************************
+ * TEST LEAN SET
+ * Unit tests for the lean_set class
+ ***********************************************/
+class TestLeanSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructCopy_standard();
+      test_constructMove_standard();
+      test_node_smallerThanBST();
+
+      // Insert
+      test_insert_ascending();
+      test_insert_duplicate();
+      test_insertMove_noCopies();
+
+      // Iterator
+      test_iterator_bothWays();
+      test_iterator_decrementEnd();
+      test_lowerBound_standard();
+
+      // Remove
+      test_erase_random();
+      test_eraseIterator_returnsNext();
+      test_eraseRange_middle();
+      test_clear_freesAll();
+
+      report("LeanSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // default constructor, no allocations
+   void test_construct_default()
+   {  // setup
+      Spy::reset();
+      // exercise
+      custom::lean_set<Spy> s;
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(s.root == nullptr);
+      assertUnit(s.numElements == 0);
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // a copy has its own nodes in the same shape and colors
+   void test_constructCopy_standard()
+   {  // setup
+      custom::lean_set<int> sSrc{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      custom::lean_set<int> sDest(sSrc);
+      // verify
+      assertUnit(sDest.root != sSrc.root);
+      assertUnit(sDest.size() == 7);
+      assertUnit(toVector(sDest) == toVector(sSrc));
+      assertUnit(verifyRedBlack(sDest.root) == verifyRedBlack(sSrc.root));
+      sSrc.erase(50);
+      assertUnit(sDest.find(50) != sDest.end());
+   }  // teardown
+
+   // moving takes the nodes
+   void test_constructMove_standard()
+   {  // setup
+      custom::lean_set<int> sSrc{ 50, 30, 70 };
+      auto pRoot = sSrc.root;
+      // exercise
+      custom::lean_set<int> sDest(std::move(sSrc));
+      // verify
+      assertUnit(sDest.root == pRoot);
+      assertUnit(sDest.size() == 3);
+      assertUnit(sSrc.root == nullptr);
+      assertUnit(sSrc.size() == 0);
+   }  // teardown
+
+   // the whole point: an int, two children and a color, and no parent.
+   // A BST node is one pointer bigger.
+   void test_node_smallerThanBST()
+   {  // verify
+      assertUnit(sizeof(custom::lean_set<int>::LNode) == 4 * sizeof(void*));
+   }
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // ascending inserts stay balanced
+   void test_insert_ascending()
+   {  // setup
+      custom::lean_set<int> s;
+      bool right = true;
+      // exercise
+      for (int i = 0; i < 1000; i++)
+      {
+         auto result = s.insert(i);
+         right = right && result.second && result.first != s.end() && *result.first == i;
+      }
+      // verify
+      assertUnit(right);
+      assertUnit(s.size() == 1000);
+      assertUnit(verifyRedBlack(s.root) > 0);
+      assertUnit(height(s.root) <= 20);
+      std::vector<int> v;
+      for (int i = 0; i < 1000; i++)
+         v.push_back(i);
+      assertUnit(toVector(s) == v);
+   }  // teardown
+
+   // a duplicate changes nothing and points at the one already there
+   void test_insert_duplicate()
+   {  // setup
+      custom::lean_set<int> s{ 50, 30, 70, 20, 40 };
+      // exercise
+      auto result = s.insert(40);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(result.first != s.end());
+      if (result.first != s.end())
+         assertUnit(*result.first == 40);
+      assertUnit(s.size() == 5);
+      ++result.first;
+      assertUnit(result.first != s.end());
+      if (result.first != s.end())
+         assertUnit(*result.first == 50);
+   }  // teardown
+
+   // an rvalue is moved in, never copied
+   void test_insertMove_noCopies()
+   {  // setup
+      custom::lean_set<Spy> s;
+      Spy::reset();
+      // exercise
+      for (int i : { 50, 30, 70, 20, 40 })
+         s.insert(Spy(i));
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 5);
+      assertUnit(s.size() == 5);
+   }  // teardown
+
+   /***************************************
+    * ITERATOR
+    ***************************************/
+
+   // forward and backward visit the same elements
+   void test_iterator_bothWays()
+   {  // setup
+      custom::lean_set<int> s;
+      for (int i = 0; i < 200; i += 2)
+         s.insert((i * 37) % 200);
+      std::vector<int> forward = toVector(s);
+      std::vector<int> backward;
+      // exercise
+      for (auto it = std::reverse_iterator<custom::lean_set<int>::iterator>(s.end());
+           it != std::reverse_iterator<custom::lean_set<int>::iterator>(s.begin()); ++it)
+         backward.insert(backward.begin(), *it);
+      // verify
+      assertUnit(forward.size() == 100);
+      assertUnit(backward == forward);
+   }  // teardown
+
+   // --end() is the largest, even with no parent pointers to climb
+   void test_iterator_decrementEnd()
+   {  // setup
+      custom::lean_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto it = s.end();
+      // exercise
+      --it;
+      // verify
+      assertUnit(it != s.end());
+      if (it != s.end())
+         assertUnit(*it == 80);
+      ++it;
+      assertUnit(it == s.end());
+   }  // teardown
+
+   // lower_bound lands on the key or the next one up
+   void test_lowerBound_standard()
+   {  // setup
+      custom::lean_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise and verify
+      assertUnit(*s.lower_bound(10) == 20);
+      assertUnit(*s.lower_bound(40) == 40);
+      assertUnit(*s.lower_bound(45) == 50);
+      assertUnit(*s.lower_bound(80) == 80);
+      assertUnit(s.lower_bound(85) == s.end());
+      auto it = s.lower_bound(55);
+      ++it;
+      assertUnit(*it == 70);
+   }  // teardown
+
+   /***************************************
+    * REMOVE
+    ***************************************/
+
+   // many inserts and erases agree with std::set and stay red-black
+   void test_erase_random()
+   {  // setup
+      srand(39);
+      custom::lean_set<int> s;
+      std::set<int> model;
+      bool valid = true;
+      // exercise
+      for (int i = 0; i < 4000; i++)
+      {
+         int value = rand() % 400;
+         if (rand() % 3)
+         {
+            s.insert(value);
+            model.insert(value);
+         }
+         else
+            assertUnit(s.erase(value) == model.erase(value));
+         if (i % 50 == 0)
+            valid = valid && verifyRedBlack(s.root) > 0;
+      }
+      // verify
+      assertUnit(valid);
+      assertUnit(s.size() == model.size());
+      assertUnit(toVector(s) == std::vector<int>(model.begin(), model.end()));
+      assertUnit(verifyRedBlack(s.root) > 0);
+   }  // teardown
+
+   // erasing through an iterator returns the next one
+   void test_eraseIterator_returnsNext()
+   {  // setup
+      custom::lean_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto it = s.find(50);
+      // exercise
+      auto itNext = s.erase(it);
+      // verify
+      assertUnit(itNext != s.end());
+      if (itNext != s.end())
+         assertUnit(*itNext == 60);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 40, 60, 70, 80 }));
+      it = s.find(80);
+      itNext = s.erase(it);
+      assertUnit(itNext == s.end());
+      assertUnit(verifyRedBlack(s.root) > 0);
+   }  // teardown
+
+   // erase [40, 70) out of the middle
+   void test_eraseRange_middle()
+   {  // setup
+      custom::lean_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto itBegin = s.find(40);
+      auto itEnd = s.find(70);
+      // exercise
+      auto itReturn = s.erase(itBegin, itEnd);
+      // verify
+      assertUnit(itReturn != s.end());
+      if (itReturn != s.end())
+         assertUnit(*itReturn == 70);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 70, 80 }));
+      assertUnit(verifyRedBlack(s.root) > 0);
+   }  // teardown
+
+   // clear frees every node
+   void test_clear_freesAll()
+   {  // setup
+      custom::lean_set<Spy> s{ Spy(50), Spy(30), Spy(70), Spy(20) };
+      Spy::reset();
+      // exercise
+      s.clear();
+      // verify
+      assertUnit(Spy::numDestructor() == 4);
+      assertUnit(s.root == nullptr);
+      assertUnit(s.empty());
+   }  // teardown
+
+   /*************************************************************
+    * HEIGHT
+    * The number of nodes on the longest path down
+    *************************************************************/
+   template <typename LNode>
+   int height(const LNode* p)
+   {
+      if (!p)
+         return 0;
+      int left = height(p->pLeft);
+      int right = height(p->pRight);
+      return 1 + (left > right ? left : right);
+   }
+
+   /*************************************************************
+    * VERIFY RED BLACK
+    * Return the black height of a subtree, or -1 if it breaks
+    * ordering or any of the red-black rules
+    *************************************************************/
+   template <typename LNode>
+   int verifyRedBlack(const LNode* p)
+   {
+      if (!p)
+         return 1;
+      if (p->isRed && ((p->pLeft && p->pLeft->isRed) || (p->pRight && p->pRight->isRed)))
+         return -1;
+      if (p->pLeft && !(p->pLeft->data < p->data))
+         return -1;
+      if (p->pRight && !(p->data < p->pRight->data))
+         return -1;
+      int left = verifyRedBlack(p->pLeft);
+      int right = verifyRedBlack(p->pRight);
+      if (left < 0 || left != right)
+         return -1;
+      return left + (p->isRed ? 0 : 1);
+   }
+};
+
+#endif // DEBUG
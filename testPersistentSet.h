@@ -0,0 +1,480 @@
+/***********************************************************************
+ * Header:
+ *    TEST PERSISTENT SET
+ * Summary:
+ *    Unit tests for persistent_set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "persistent_set.h"
+#include "unitTest.h"
+#include "spy.h"
+#include <set>
+#include <vector>
+#include <cstdlib>    // for rand
+#include <thread>     // for std::thread
+
+/***********************************************
+ * TEST PERSISTENT SET
+ * Unit tests for the persistent_set class
+ ***********************************************/
+class TestPersistentSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructCopy_shares();
+
+      // Snapshot
+      test_snapshot_noCopies();
+      test_snapshot_unchangedByInsert();
+      test_snapshot_unchangedByErase();
+      test_snapshot_unchangedByClear();
+
+      // Insert
+      test_insert_standard();
+      test_insert_duplicate();
+      test_insert_copiesOnlyPath();
+      test_insert_uniqueInPlace();
+      test_insert_copySeparatesPath();
+      test_insertMove_standard();
+
+      // Iterator
+      test_iterator_decrementEnd();
+
+      // Remove
+      test_erase_missing();
+      test_erase_random();
+      test_eraseIterator_returnsNext();
+      test_eraseRange_middle();
+
+      // Threads
+      test_copies_onThreads();
+
+      report("PersistentSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // default constructor, no allocations
+   void test_construct_default()
+   {  // setup
+      Spy::reset();
+      // exercise
+      custom::persistent_set<Spy> s;
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(s.root == nullptr);
+      assertUnit(s.numElements == 0);
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // copying a set shares the root instead of copying the nodes
+   void test_constructCopy_shares()
+   {  // setup
+      custom::persistent_set<Spy> sSrc{ Spy(50), Spy(30), Spy(70) };
+      Spy::reset();
+      // exercise
+      custom::persistent_set<Spy> sDest(sSrc);
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(sDest.root == sSrc.root);
+      assertUnit(sDest.numElements == 3);
+      if (sSrc.root)
+         assertUnit(sSrc.root->refs == 2);
+   }  // teardown
+
+   /***************************************
+    * SNAPSHOT
+    ***************************************/
+
+   // a snapshot costs nothing, no matter how big the set
+   void test_snapshot_noCopies()
+   {  // setup
+      custom::persistent_set<Spy> s;
+      for (int i = 0; i < 100; i++)
+         s.insert(Spy(i));
+      Spy::reset();
+      // exercise
+      custom::persistent_set<Spy> snap = s.snapshot();
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(snap.root == s.root);
+      assertUnit(snap.size() == 100);
+   }  // teardown
+
+   // inserting into the set does not change the snapshot
+   void test_snapshot_unchangedByInsert()
+   {  // setup
+      custom::persistent_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      custom::persistent_set<int> snap = s.snapshot();
+      // exercise
+      s.insert(10);
+      s.insert(45);
+      s.insert(90);
+      // verify
+      assertUnit(s.size() == 10);
+      assertUnit(snap.size() == 7);
+      assertUnit(snap.find(10) == snap.end());
+      assertUnit(snap.find(45) == snap.end());
+      assertUnit(s.find(45) != s.end());
+      assertUnit(toVector(snap) == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+      assertUnit(verifyRedBlack(snap.root) > 0);
+      assertUnit(verifyRedBlack(s.root) > 0);
+   }  // teardown
+
+   // erasing from the set does not change the snapshot
+   void test_snapshot_unchangedByErase()
+   {  // setup
+      custom::persistent_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      custom::persistent_set<int> snap = s.snapshot();
+      // exercise
+      s.erase(50);
+      s.erase(20);
+      // verify
+      assertUnit(toVector(s) == std::vector<int>({ 30, 40, 60, 70, 80 }));
+      assertUnit(toVector(snap) == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+      assertUnit(verifyRedBlack(snap.root) > 0);
+      assertUnit(verifyRedBlack(s.root) > 0);
+   }  // teardown
+
+   // clearing the set leaves the snapshot intact
+   void test_snapshot_unchangedByClear()
+   {  // setup
+      custom::persistent_set<Spy> s{ Spy(50), Spy(30), Spy(70) };
+      custom::persistent_set<Spy> snap = s.snapshot();
+      Spy::reset();
+      // exercise
+      s.clear();
+      // verify
+      assertUnit(Spy::numDelete() == 0);
+      assertUnit(s.empty());
+      assertUnit(snap.size() == 3);
+      assertUnit(snap.find(Spy(30)) != snap.end());
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // build the standard fixture by inserting
+   void test_insert_standard()
+   {  // setup
+      custom::persistent_set<int> s;
+      // exercise
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         s.insert(i);
+      // verify
+      assertUnit(s.size() == 7);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+      assertUnit(verifyRedBlack(s.root) > 0);
+      assertUnit(s.root && s.root->data == 50 && !s.root->isRed);
+   }  // teardown
+
+   // a duplicate leaves the version alone
+   void test_insert_duplicate()
+   {  // setup
+      custom::persistent_set<Spy> s{ Spy(50), Spy(30), Spy(70) };
+      auto pRoot = s.root;
+      Spy::reset();
+      // exercise
+      auto result = s.insert(Spy(30));
+      // verify
+      assertUnit(result.second == false);
+      assertUnit(result.first != s.end());
+      assertUnit(Spy::numAlloc() == 1);    // just the Spy(30) argument
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(s.root == pRoot);
+      assertUnit(s.size() == 3);
+   }  // teardown
+
+   // only the nodes on the path to the new leaf get copied
+   void test_insert_copiesOnlyPath()
+   {  // setup
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20b)     (40b) (60b)     (80b)
+      custom::persistent_set<Spy> s{ Spy(50), Spy(30), Spy(70), Spy(20), Spy(40), Spy(60), Spy(80) };
+      custom::persistent_set<Spy> snap = s.snapshot();
+      Spy::reset();
+      // exercise
+      s.insert(Spy(85));
+      // verify
+      assertUnit(Spy::numCopy() <= 6);     // [50][70][80] plus recoloring, never [20][30][40][60]
+      assertUnit(s.root != snap.root);
+      if (s.root && snap.root)
+         assertUnit(s.root->pLeft == snap.root->pLeft); // left half is shared
+      assertUnit(verifyRedBlack(s.root) > 0);
+      assertUnit(s.size() == 8);
+      assertUnit(snap.size() == 7);
+   }  // teardown
+
+   // a set nobody else shares is updated in place: no node is copied
+   void test_insert_uniqueInPlace()
+   {  // setup
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20b)     (40b) (60b)     (80b)
+      custom::persistent_set<Spy> s{ Spy(50), Spy(30), Spy(70), Spy(20), Spy(40), Spy(60), Spy(80) };
+      auto pRoot = s.root;
+      auto p70 = s.root ? s.root->pRight : nullptr;
+      Spy s85(85);
+      Spy::reset();
+      // exercise
+      s.insert(s85);
+      // verify
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20b)     (40b) (60b)     (80b)
+      //                                +----+
+      //                                   (85r)
+      assertUnit(Spy::numCopy() == 1);     // just the new [85]
+      assertUnit(Spy::numAlloc() == 1);
+      assertUnit(s.root == pRoot);
+      if (s.root)
+      {
+         assertUnit(s.root->pRight == p70);
+         assertUnit(s.root->refs == 1);
+      }
+      if (p70)
+      {
+         assertUnit(p70->pRight != nullptr);
+         if (p70->pRight)
+            assertUnit(p70->pRight->pRight != nullptr);
+      }
+      assertUnit(verifyRedBlack(s.root) > 0);
+      assertUnit(s.size() == 8);
+   }  // teardown
+
+   // the first change to a copy separates only the path it changes
+   void test_insert_copySeparatesPath()
+   {  // setup
+      custom::persistent_set<int> sSrc{ 50, 30, 70, 20, 40, 60, 80 };
+      custom::persistent_set<int> sDest(sSrc);
+      // exercise
+      sDest.insert(10);
+      // verify
+      assertUnit(sSrc.root != sDest.root);
+      if (sSrc.root && sDest.root)
+      {
+         assertUnit(sSrc.root->refs == 1);
+         assertUnit(sDest.root->refs == 1);
+         assertUnit(sSrc.root->pRight == sDest.root->pRight);  // [70] subtree shared
+         if (sSrc.root->pRight)
+            assertUnit(sSrc.root->pRight->refs == 2);
+         assertUnit(sSrc.root->pLeft != sDest.root->pLeft);
+      }
+      assertUnit(toVector(sSrc) == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+      assertUnit(toVector(sDest) == std::vector<int>({ 10, 20, 30, 40, 50, 60, 70, 80 }));
+      assertUnit(verifyRedBlack(sDest.root) > 0);
+   }  // teardown
+
+   // insert by move does not copy the element
+   void test_insertMove_standard()
+   {  // setup
+      custom::persistent_set<Spy> s{ Spy(50), Spy(30), Spy(70) };
+      Spy s40(40);
+      Spy::reset();
+      // exercise
+      auto result = s.insert(std::move(s40));
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(result.second == true);
+      assertUnit(result.first != s.end());
+      if (result.first != s.end())
+         assertUnit(*result.first == Spy(40));
+      assertUnit(s.size() == 4);
+   }  // teardown
+
+   /***************************************
+    * ITERATOR
+    ***************************************/
+
+   // walk backwards from end()
+   void test_iterator_decrementEnd()
+   {  // setup
+      custom::persistent_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      std::vector<int> v;
+      // exercise
+      auto it = s.end();
+      for (size_t i = 0; i < s.size(); i++)
+         v.push_back(*--it);
+      // verify
+      assertUnit(v == std::vector<int>({ 80, 70, 60, 50, 40, 30, 20 }));
+      assertUnit(it == s.begin());
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // erase something that is not there
+   void test_erase_missing()
+   {  // setup
+      custom::persistent_set<Spy> s{ Spy(50), Spy(30), Spy(70) };
+      auto pRoot = s.root;
+      // exercise
+      size_t count = s.erase(Spy(45));
+      // verify
+      assertUnit(count == 0);
+      assertUnit(s.root == pRoot);
+      assertUnit(s.size() == 3);
+   }  // teardown
+
+   // random inserts and erases, checking every old version survives
+   void test_erase_random()
+   {  // setup
+      srand(26);
+      custom::persistent_set<int> s;
+      std::set<int> model;
+      std::vector<custom::persistent_set<int>> versions;
+      std::vector<std::set<int>> models;
+      // exercise
+      for (int i = 0; i < 2000; i++)
+      {
+         int value = rand() % 300;
+         if (rand() % 3)
+         {
+            s.insert(value);
+            model.insert(value);
+         }
+         else
+            assertUnit(s.erase(value) == model.erase(value));
+         if (i % 100 == 0)
+         {
+            versions.push_back(s.snapshot());
+            models.push_back(model);
+         }
+      }
+      // verify
+      assertUnit(s.size() == model.size());
+      assertUnit(toVector(s) == std::vector<int>(model.begin(), model.end()));
+      assertUnit(verifyRedBlack(s.root) > 0);
+      for (size_t i = 0; i < versions.size(); i++)
+      {
+         assertUnit(versions[i].size() == models[i].size());
+         assertUnit(toVector(versions[i]) == std::vector<int>(models[i].begin(), models[i].end()));
+         assertUnit(verifyRedBlack(versions[i].root) > 0);
+      }
+   }  // teardown
+
+   // erasing by iterator hands back the next element
+   void test_eraseIterator_returnsNext()
+   {  // setup
+      custom::persistent_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto it = s.find(50);
+      // exercise
+      auto itNext = s.erase(it);
+      // verify
+      assertUnit(itNext != s.end());
+      if (itNext != s.end())
+         assertUnit(*itNext == 60);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 40, 60, 70, 80 }));
+      it = s.find(80);
+      itNext = s.erase(it);
+      assertUnit(itNext == s.end());
+      assertUnit(verifyRedBlack(s.root) > 0);
+   }  // teardown
+
+   // erase [40, 70) out of the middle
+   void test_eraseRange_middle()
+   {  // setup
+      custom::persistent_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      custom::persistent_set<int> snap = s.snapshot();
+      auto itBegin = s.find(40);
+      auto itEnd = s.find(70);
+      // exercise
+      auto itReturn = s.erase(itBegin, itEnd);
+      // verify
+      assertUnit(itReturn != s.end());
+      if (itReturn != s.end())
+         assertUnit(*itReturn == 70);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 70, 80 }));
+      assertUnit(snap.size() == 7);
+      assertUnit(verifyRedBlack(s.root) > 0);
+   }  // teardown
+
+   /***************************************
+    * THREADS
+    ***************************************/
+
+   // copies of one set changed on different threads stay independent
+   void test_copies_onThreads()
+   {  // setup
+      custom::persistent_set<int> sShared;
+      for (int i = 0; i < 1000; i += 2)
+         sShared.insert(i);
+      const int numThreads = 4;
+      std::vector<custom::persistent_set<int>> copies(numThreads, sShared);
+      std::vector<std::thread> threads;
+      // exercise
+      for (int id = 0; id < numThreads; id++)
+         threads.push_back(std::thread([&copies, id]()
+         {
+            for (int i = id; i < 500; i += numThreads)
+            {
+               copies[id].insert(2 * i + 1);
+               copies[id].erase(2 * i);
+               custom::persistent_set<int> temp(copies[id]);   // shares and lets go
+            }
+         }));
+      for (auto& thread : threads)
+         thread.join();
+      // verify
+      assertUnit(sShared.size() == 500);
+      assertUnit(verifyRedBlack(sShared.root) > 0);
+      for (int id = 0; id < numThreads; id++)
+      {
+         assertUnit(verifyRedBlack(copies[id].root) > 0);
+         assertUnit(copies[id].size() == 500);
+         assertUnit(copies[id].find(2 * id + 1) != copies[id].end());
+      }
+   }  // teardown
+
+   /*************************************************************
+    * VERIFY RED BLACK
+    * Return the black height of a subtree, or -1 if it breaks
+    * ordering or any of the red-black rules
+    *************************************************************/
+   template <typename PNode>
+   int verifyRedBlack(const PNode* p)
+   {
+      if (!p)
+         return 1;
+      if (p->isRed && ((p->pLeft && p->pLeft->isRed) || (p->pRight && p->pRight->isRed)))
+         return -1;
+      if (p->pLeft && !(p->pLeft->data < p->data))
+         return -1;
+      if (p->pRight && !(p->data < p->pRight->data))
+         return -1;
+      int left = verifyRedBlack(p->pLeft);
+      int right = verifyRedBlack(p->pRight);
+      if (left < 0 || left != right)
+         return -1;
+      return left + (p->isRed ? 0 : 1);
+   }
+};
+
+#endif // DEBUG
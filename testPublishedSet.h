@@ -0,0 +1,211 @@
+/***********************************************************************
+ * Header:
+ *    TEST PUBLISHED SET
+ * Summary:
+ *    Unit tests for published_set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "published_set.h"
+#include "unitTest.h"
+#include <vector>
+#include <thread>     // for std::thread
+#include <atomic>     // for std::atomic
+
+/***********************************************
+ * TEST PUBLISHED SET
+ * Unit tests for the published_set class
+ ***********************************************/
+class TestPublishedSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+
+      // Publish
+      test_publish_unpublishedInvisible();
+      test_publish_visible();
+      test_publish_erase();
+
+      // Reclaim
+      test_reclaim_noReaders();
+      test_reclaim_readerHoldsSnapshot();
+      test_reclaim_readerLeaves();
+
+      // Threads
+      test_read_whilePublishing();
+
+      report("PublishedSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // a new set publishes an empty snapshot
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::published_set<int> s;
+      // verify
+      assertUnit(s.size() == 0);
+      assertUnit(s.current.load() != nullptr);
+      assertUnit(s.read().empty());
+      assertUnit(s.retired.empty());
+   }  // teardown
+
+   /***************************************
+    * PUBLISH
+    ***************************************/
+
+   // readers do not see what the writer has not published
+   void test_publish_unpublishedInvisible()
+   {  // setup
+      custom::published_set<int> s;
+      // exercise
+      s.insert(50);
+      s.insert(30);
+      // verify
+      assertUnit(s.size() == 2);
+      assertUnit(!s.contains(50));
+      assertUnit(s.read().size() == 0);
+   }  // teardown
+
+   // after publish the readers see everything in order
+   void test_publish_visible()
+   {  // setup
+      custom::published_set<int> s;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         s.insert(i);
+      // exercise
+      s.publish();
+      // verify
+      auto r = s.read();
+      assertUnit(r.size() == 7);
+      assertUnit(r.contains(20));
+      assertUnit(r.contains(80));
+      assertUnit(!r.contains(45));
+      assertUnit(std::vector<int>(r.begin(), r.end()) == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+   }  // teardown
+
+   // an erase shows up on the next publish
+   void test_publish_erase()
+   {  // setup
+      custom::published_set<int> s;
+      for (int i : { 50, 30, 70 })
+         s.insert(i);
+      s.publish();
+      // exercise
+      size_t count = s.erase(30);
+      bool before = s.contains(30);
+      s.publish();
+      // verify
+      assertUnit(count == 1);
+      assertUnit(s.erase(45) == 0);
+      assertUnit(before == true);
+      assertUnit(s.contains(30) == false);
+      assertUnit(s.read().size() == 2);
+   }  // teardown
+
+   /***************************************
+    * RECLAIM
+    ***************************************/
+
+   // with nobody reading, the old snapshot goes away immediately
+   void test_reclaim_noReaders()
+   {  // setup
+      custom::published_set<int> s;
+      s.insert(50);
+      // exercise
+      s.publish();
+      s.publish();
+      // verify
+      assertUnit(s.retired.empty());
+   }  // teardown
+
+   // a reader keeps its snapshot, unchanged, across a publish
+   void test_reclaim_readerHoldsSnapshot()
+   {  // setup
+      custom::published_set<int> s;
+      s.insert(50);
+      s.publish();
+      auto r = s.read();
+      // exercise
+      s.insert(30);
+      s.publish();
+      // verify
+      assertUnit(s.retired.size() == 1);
+      assertUnit(r.size() == 1);
+      assertUnit(r.contains(50));
+      assertUnit(!r.contains(30));
+      assertUnit(s.contains(30));     // a new reader sees the new snapshot
+   }  // teardown
+
+   // once the last reader leaves, the old snapshot is freed
+   void test_reclaim_readerLeaves()
+   {  // setup
+      custom::published_set<int> s;
+      s.insert(50);
+      s.publish();
+      {
+         auto r = s.read();
+         s.insert(30);
+         s.publish();
+         assertUnit(s.retired.size() == 1);
+      }
+      // exercise
+      size_t waiting = s.reclaim();
+      // verify
+      assertUnit(waiting == 0);
+      assertUnit(s.retired.empty());
+   }  // teardown
+
+   /***************************************
+    * THREADS
+    ***************************************/
+
+   // the writer publishes 0, 1, 2, ... in order. Every snapshot a
+   // reader sees must be some prefix 0 ... n-1 of that sequence
+   void test_read_whilePublishing()
+   {  // setup
+      custom::published_set<int> s;
+      std::atomic<bool> done(false);
+      std::atomic<int> numBad(0);
+      std::vector<std::thread> readers;
+      for (int id = 0; id < 4; id++)
+         readers.push_back(std::thread([&]()
+         {
+            while (!done.load())
+            {
+               auto r = s.read();
+               int n = (int)r.size();
+               if (n && (!r.contains(0) || !r.contains(n - 1) || r.contains(n)))
+                  numBad++;
+            }
+         }));
+      // exercise
+      for (int i = 0; i < 2000; i++)
+      {
+         s.insert(i);
+         s.publish();
+      }
+      done = true;
+      for (auto& thread : readers)
+         thread.join();
+      // verify
+      assertUnit(numBad == 0);
+      assertUnit(s.read().size() == 2000);
+      assertUnit(s.reclaim() == 0);
+   }  // teardown
+};
+
+#endif // DEBUG
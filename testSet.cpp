@@ -11,10 +11,27 @@
 #define DEBUG   
 #endif
  //#undef DEBUG  // Remove this comment to disable unit tests
+//#define BENCHMARK  // Remove this comment to run the benchmarks
 
 #include "testSet.h"        // for the set unit tests
 #include "testBST.h"        // for the BST unit tests
 #include "testSpy.h"        // for the spy unit tests
+#include "testPersistentSet.h" // for the persistent set unit tests
+#include "testPublishedSet.h"  // for the published set unit tests
+#include "testShardedSet.h"    // for the sharded set unit tests
+#include "testSetAccumulator.h" // for the set accumulator unit tests
+#include "testLeanSet.h"       // for the lean set unit tests
+#include "testThreadedSet.h"   // for the threaded set unit tests
+#include "testBTreeSet.h"      // for the B-tree set unit tests
+#include "testSimdSearch.h"    // for the SIMD search unit tests
+#include "testFlatSet.h"       // for the flat set unit tests
+#include "testSetBackends.h"   // for the set tests on each backend
+#include "testAdaptiveSet.h"    // for the adaptive set unit tests
+#include "testSmallSet.h"      // for the small set unit tests
+#include "testStaticSet.h"     // for the static set unit tests
+#include "testFrozenSet.h"     // for the frozen set unit tests
+#include "testInterleavedLookup.h" // for the interleaved lookup unit tests
+#include "benchSet.h"       // for the set benchmarks
 int Spy::counters[] = {};
 
 /**********************************************************************
@@ -28,7 +45,34 @@ int main()
    TestSpy().run();
    TestBST().run();
    TestSet().run();
+   TestPersistentSet().run();
+   TestPublishedSet().run();
+   TestShardedSet().run();
+   TestSetAccumulator().run();
+   TestLeanSet().run();
+   TestThreadedSet().run();
+   TestBTreeSet().run();
+   TestSimdSearch().run();
+   TestFlatSet().run();
+   TestSetBackend<custom::rb_tree>().run("Set<rb_tree>");
+   TestSetBackend<custom::btree>().run("Set<btree>");
+   TestSetBackend<custom::flat>().run("Set<flat>");
+   TestSetBackend<custom::frozen>().run("Set<frozen>");
+   TestAdaptiveSet().run();
+   TestSmallSet().run();
+   TestSetBackend<custom::small<8>>().run("Set<small>");
+   TestStaticSet().run();
+   TestSetBackend<custom::fixed<512>>().run("Set<fixed>");
+   TestFrozenSet().run();
+#if defined(__cpp_impl_coroutine)
+   TestInterleavedLookup().run();
+#endif // __cpp_impl_coroutine
 #endif // DEBUG
+
+#ifdef BENCHMARK
+   // timing measurements
+   BenchSet().run();
+#endif // BENCHMARK
    
    return 0;
 }
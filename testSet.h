@@ -82,12 +82,20 @@ public:
       test_iterator_increment_standardToDone();
       test_iterator_increment_standardEnd();
       test_iterator_dereference_standardRead();
+      test_iterator_decrement_end();
+      test_rbegin_standard();
+      test_rbegin_empty();
 
       // Access
       test_find_empty();
       test_find_standardBegin();
       test_find_standardLast();
       test_find_standardMissing();
+      test_lowerBound_standardBetween();
+      test_findMany_standard();
+      test_containsMany_standard();
+      test_applyBatch_standard();
+      test_insertParallel_standard();
 
       // Insert
       test_insert_empty();
@@ -125,6 +133,15 @@ public:
       test_eraseRange_standardMany();
       test_eraseRange_oneChild();
       test_eraseRange_twoChildren();
+      test_eraseRange_long();
+      test_eraseKeys_standard();
+      test_eraseKeys_empty();
+      test_extract_standard();
+      test_eraseIf_standard();
+      test_popFront_standard();
+      test_popBack_empty();
+      test_popMin_standard();
+      test_popMax_standard();
 
       // Status
       test_empty_empty();
@@ -1970,6 +1987,54 @@ public:
       teardownStandardFixture(s);
    }
 
+   // back up from the end to the largest value
+   void test_iterator_decrement_end()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60      [[80]]
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      auto it = s.end();
+      Spy::reset();
+      // exercise
+      --it;
+      // verify
+      assertUnit(Spy::numLessthan() == 0);    // does not look at any element
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(it.it.pNode == s.bst.root->pRight->pRight);
+      assertUnit(*it == Spy(80));
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // reverse iteration visits everything largest first
+   void test_rbegin_standard()
+   {  // setup
+      custom::set <int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      std::vector<int> v;
+      // exercise
+      for (auto it = s.rbegin(); it != s.rend(); ++it)
+         v.push_back(*it);
+      // verify
+      assertUnit(v == std::vector<int>({ 80, 70, 60, 50, 40, 30, 20 }));
+      assertUnit(s.min() == 20);
+      assertUnit(s.max() == 80);
+   }  // teardown
+
+   // nothing to visit backwards in an empty set
+   void test_rbegin_empty()
+   {  // setup
+      custom::set <int> s;
+      // exercise
+      auto it = s.rbegin();
+      // verify
+      assertUnit(it == s.rend());
+   }  // teardown
+
    /***************************************
     * Find
     *    set::find(const T &)
@@ -2119,6 +2184,138 @@ public:
       teardownStandardFixture(s);
    }
 
+   // lower_bound() of a missing value lands on the next one up
+   void test_lowerBound_standardBetween()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20      [[40]]  60        80  
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      custom::set<Spy>::iterator it;
+      Spy spy(35);
+      Spy::reset();
+      // exercise
+      it = s.lower_bound(spy);
+      // verify
+      assertUnit(Spy::numLessthan() == 3);    // compare [50][30][40]
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(it != s.end());
+      if (s.bst.root && s.bst.root->pLeft)
+         assertUnit(it.it.pNode == s.bst.root->pLeft->pRight);
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // a batch of lookups, some there and some not
+   void test_findMany_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      std::vector<Spy> keys{ Spy(60), Spy(65), Spy(20) };
+      std::vector<custom::set<Spy>::iterator> out;
+      Spy::reset();
+      // exercise
+      s.find_many(keys, out);
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(out.size() == 3);
+      if (out.size() == 3)
+      {
+         assertUnit(out[0] != s.end() && *out[0] == Spy(60));
+         assertUnit(out[1] == s.end());
+         assertUnit(out[2] != s.end() && *out[2] == Spy(20));
+      }
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // one bit per key
+   void test_containsMany_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      std::vector<Spy> keys{ Spy(10), Spy(50), Spy(80), Spy(75) };
+      std::vector<bool> out;
+      // exercise
+      s.contains_many(keys, out);
+      // verify
+      assertUnit(out == std::vector<bool>({ false, true, true, false }));
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // inserts and erases together, with a count of what they did
+   void test_applyBatch_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      std::vector<custom::set<Spy>::update> batch
+      {
+         { Spy(90), false }, { Spy(30), true }, { Spy(35), true }, { Spy(10), false }
+      };
+      // exercise
+      auto result = s.apply_batch(std::move(batch));
+      // verify
+      assertUnit(result.inserted == 2);
+      assertUnit(result.erased == 1);
+      assertUnit(result.skipped == 1);
+      assertUnit(s.size() == 8);
+      std::vector<int> v;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         v.push_back((*it).get());
+      assertUnit(v == std::vector<int>({ 10, 20, 40, 50, 60, 70, 80, 90 }));
+      // teardown
+      s.clear();
+   }
+
+   // a batch inserted on two threads, some of it already there
+   void test_insertParallel_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      std::vector<Spy> batch{ Spy(65), Spy(30), Spy(10), Spy(85), Spy(10) };
+      // exercise
+      size_t num = s.insert_parallel(batch.begin(), batch.end(), custom::thread_executor(2));
+      // verify
+      assertUnit(num == 3);
+      assertUnit(s.size() == 10);
+      std::vector<int> v;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         v.push_back((*it).get());
+      assertUnit(v == std::vector<int>({ 10, 20, 30, 40, 50, 60, 65, 70, 80, 85 }));
+      // teardown
+      s.clear();
+   }
+
 
    /***************************************
     * INSERT
@@ -3441,6 +3638,204 @@ public:
 
    }
 
+   // a range too long to erase one at a time is detached whole
+   void test_eraseRange_long()
+   {  // setup
+      custom::set <Spy> s;
+      for (int i = 0; i < 200; i++)
+         s.insert(Spy(i));
+      auto itBegin = s.find(Spy(50));
+      auto itEnd = s.find(Spy(150));
+      Spy::reset();
+      // exercise
+      auto itReturn = s.erase(itBegin, itEnd);
+      // verify
+      assertUnit(Spy::numDestructor() == 100);
+      assertUnit(Spy::numDelete() == 100);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(itReturn == itEnd);
+      assertUnit(itBegin == itEnd);
+      assertUnit(s.size() == 100);
+      assertUnit((*itReturn).get() == 150);
+      std::vector<int> v;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         v.push_back((*it).get());
+      assertUnit(v.size() == 100);
+      assertUnit(v[49] == 49 && v[50] == 150);
+      // teardown
+      s.clear();
+   }
+
+   // erase by key: from lo up to but not including hi
+   void test_eraseKeys_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      // exercise
+      size_t num = s.erase(Spy(35), Spy(70));
+      // verify
+      assertUnit(num == 3);   // 40 50 60
+      assertUnit(s.size() == 4);
+      std::vector<int> v;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         v.push_back((*it).get());
+      assertUnit(v == std::vector<int>({ 20, 30, 70, 80 }));
+      // teardown
+      s.clear();
+   }
+
+   // erase by key: nothing in range, or a backwards range
+   void test_eraseKeys_empty()
+   {  // setup
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      // exercise
+      size_t numBetween = s.erase(Spy(41), Spy(49));
+      size_t numBackwards = s.erase(Spy(70), Spy(30));
+      // verify
+      assertUnit(numBetween == 0);
+      assertUnit(numBackwards == 0);
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // erase every value that matches
+   void test_eraseIf_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      Spy::reset();
+      // exercise
+      size_t num = s.erase_if([](const Spy& spy) { return spy.get() % 20 == 0; });
+      // verify
+      assertUnit(Spy::numDestructor() == 4);  // destroy [20][40][60][80]
+      assertUnit(Spy::numDelete() == 4);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(num == 4);
+      assertUnit(s.size() == 3);
+      std::vector<int> v;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         v.push_back((*it).get());
+      assertUnit(v == std::vector<int>({ 30, 50, 70 }));
+      // teardown
+      s.clear();
+   }
+
+   // take the smallest, then the largest
+   void test_popFront_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      Spy::reset();
+      // exercise
+      s.pop_front();
+      s.pop_back();
+      // verify
+      assertUnit(Spy::numDestructor() == 2);  // destroy [20][80]
+      assertUnit(Spy::numDelete() == 2);
+      assertUnit(Spy::numLessthan() == 0);    // no searching
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(s.size() == 5);
+      assertUnit(s.min().get() == 30);
+      assertUnit(s.max().get() == 70);
+      // teardown
+      s.clear();
+   }
+
+   // nothing to take from an empty set
+   void test_popBack_empty()
+   {  // setup
+      custom::set <Spy> s;
+      Spy::reset();
+      // exercise
+      s.pop_back();
+      s.pop_front();
+      // verify
+      assertUnit(Spy::numDelete() == 0);
+      assertUnit(s.empty());
+   }  // teardown
+
+   // the smallest value is moved out, not copied
+   void test_popMin_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //  [[20]]      40    60        80  
+      custom::set <Spy> s;
+      setupStandardFixture(s);
+      Spy::reset();
+      // exercise
+      Spy spy = s.pop_min();
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numLessthan() == 0);    // no searching
+      assertUnit(Spy::numAlloc() == 0);       // [20]'s buffer moves out
+      assertUnit(Spy::numDelete() == 0);
+      assertUnit(spy == Spy(20));
+      assertUnit(s.size() == 6);
+      assertUnit(s.peek_min() == Spy(30));
+      assertUnit(s.peek_max() == Spy(80));
+      // teardown
+      s.clear();
+   }
+
+   // the set as a queue, largest first
+   void test_popMax_standard()
+   {  // setup
+      custom::set <int> s{ 5, 1, 4, 2, 3 };
+      std::vector<int> v;
+      // exercise
+      while (!s.empty())
+         v.push_back(s.pop_max());
+      // verify
+      assertUnit(v == std::vector<int>({ 5, 4, 3, 2, 1 }));
+   }  // teardown
+
+   // a range moved out whole into a set of its own
+   void test_extract_standard()
+   {  // setup
+      custom::set <Spy> s;
+      for (int i = 0; i < 100; i++)
+         s.insert(Spy(i));
+      auto itBegin = s.find(Spy(10));
+      auto itEnd = s.find(Spy(90));
+      Spy::reset();
+      // exercise
+      custom::set <Spy> sRange = s.extract(itBegin, itEnd);
+      // verify
+      assertUnit(Spy::numDestructor() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(s.size() == 20);
+      assertUnit(sRange.size() == 80);
+      assertUnit((*sRange.begin()).get() == 10);
+      assertUnit(s.find(Spy(50)) == s.end());
+      assertUnit(sRange.find(Spy(50)) != sRange.end());
+      // teardown
+      s.clear();
+      sRange.clear();
+   }
+
    /*************************************************************
     * SETUP STANDARD FIXTURE
     *                (50b)
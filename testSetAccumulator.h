@@ -0,0 +1,193 @@
+/***********************************************************************
+ * Header:
+ *    TEST SET ACCUMULATOR
+ * Summary:
+ *    Unit tests for set_accumulator
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "set_accumulator.h"
+#include "unitTest.h"
+#include <vector>
+#include <thread>     // for std::thread
+
+/***********************************************
+ * TEST SET ACCUMULATOR
+ * Unit tests for the set_accumulator class
+ ***********************************************/
+class TestSetAccumulator : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Collect
+      test_local_separate();
+      test_collect_compacts();
+
+      // Finalize
+      test_finalize_empty();
+      test_finalize_one();
+      test_finalize_overlapping();
+      test_finalize_again();
+      test_finalize_balanced();
+
+      // Threads
+      test_collect_fromThreads();
+
+      report("SetAccumulator");
+   }
+
+   /***************************************
+    * COLLECT
+    ***************************************/
+
+   // every call to local() gets a buffer of its own
+   void test_local_separate()
+   {  // setup
+      custom::set_accumulator<int> acc;
+      // exercise
+      auto& a = acc.local();
+      auto& b = acc.local();
+      a.insert(1);
+      // verify
+      assertUnit(&a != &b);
+      assertUnit(a.size() == 1);
+      assertUnit(b.size() == 0);
+      assertUnit(acc.collectors.size() == 2);
+   }  // teardown
+
+   // a buffer full of duplicates does not keep growing
+   void test_collect_compacts()
+   {  // setup
+      custom::set_accumulator<int> acc;
+      auto& c = acc.local();
+      // exercise
+      for (int i = 0; i < 100000; i++)
+         c.insert(i % 10);
+      // verify
+      assertUnit(c.size() < 2 * custom::set_accumulator<int>::MIN_COMPACT);
+   }  // teardown
+
+   /***************************************
+    * FINALIZE
+    ***************************************/
+
+   // nothing collected, nothing in the set
+   void test_finalize_empty()
+   {  // setup
+      custom::set_accumulator<int> acc;
+      acc.local();
+      // exercise
+      custom::set<int> s = acc.finalize();
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // one collector: sorted, duplicates gone
+   void test_finalize_one()
+   {  // setup
+      custom::set_accumulator<int> acc;
+      auto& c = acc.local();
+      for (int i : { 50, 30, 70, 30, 20, 50 })
+         c.insert(i);
+      // exercise
+      custom::set<int> s = acc.finalize();
+      // verify
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 50, 70 }));
+      assertUnit(s.size() == 4);
+   }  // teardown
+
+   // several collectors sharing some values
+   void test_finalize_overlapping()
+   {  // setup
+      custom::set_accumulator<int> acc;
+      auto& a = acc.local();
+      auto& b = acc.local();
+      auto& c = acc.local();
+      for (int i : { 10, 40, 70, 90 })
+         a.insert(i);
+      for (int i : { 90, 20, 40, 60 })
+         b.insert(i);
+      for (int i : { 5, 70, 95 })
+         c.insert(i);
+      // exercise
+      custom::set<int> s = acc.finalize();
+      // verify
+      assertUnit(toVector(s) == std::vector<int>({ 5, 10, 20, 40, 60, 70, 90, 95 }));
+      assertUnit(a.size() == 0);
+      assertUnit(acc.timing().sort >= 0.0);
+      assertUnit(acc.timing().merge >= 0.0);
+      assertUnit(acc.timing().build >= 0.0);
+   }  // teardown
+
+   // the collectors are reused after a finalize
+   void test_finalize_again()
+   {  // setup
+      custom::set_accumulator<int> acc;
+      auto& c = acc.local();
+      c.insert(1);
+      acc.finalize();
+      // exercise
+      c.insert(2);
+      custom::set<int> s = acc.finalize();
+      // verify
+      assertUnit(toVector(s) == std::vector<int>({ 2 }));
+   }  // teardown
+
+   // the set that comes out works like any other set
+   void test_finalize_balanced()
+   {  // setup
+      custom::set_accumulator<int> acc;
+      auto& a = acc.local();
+      auto& b = acc.local();
+      for (int i = 0; i < 1000; i++)
+         (i % 3 ? a : b).insert(i);
+      // exercise
+      custom::set<int> s = acc.finalize();
+      s.insert(-1);
+      s.erase(500);
+      // verify
+      assertUnit(s.size() == 1000);
+      assertUnit(s.find(999) != s.end());
+      assertUnit(s.find(500) == s.end());
+      assertUnit(*s.begin() == -1);
+   }  // teardown
+
+   /***************************************
+    * THREADS
+    ***************************************/
+
+   // four threads with overlapping ranges of values
+   void test_collect_fromThreads()
+   {  // setup
+      custom::set_accumulator<int> acc;
+      std::vector<std::thread> threads;
+      // exercise
+      for (int id = 0; id < 4; id++)
+         threads.push_back(std::thread([&, id]()
+         {
+            auto& c = acc.local();
+            for (int i = id * 1000; i < id * 1000 + 3000; i++)
+               c.insert(i);
+         }));
+      for (auto& thread : threads)
+         thread.join();
+      custom::set<int> s = acc.finalize();
+      // verify
+      std::vector<int> v = toVector(s);
+      bool complete = v.size() == 6000;
+      for (size_t i = 0; complete && i < v.size(); i++)
+         complete = v[i] == (int)i;
+      assertUnit(complete);
+   }  // teardown
+};
+
+#endif // DEBUG
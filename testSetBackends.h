@@ -0,0 +1,642 @@
+/***********************************************************************
+ * Header:
+ *    TEST SET BACKENDS
+ * Summary:
+ *    The set interface tests, run once on each storage engine. The
+ *    tests in testSet.h build and inspect red-black trees node by
+ *    node; these stay above the interface so any backend must pass them.
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "set.h"
+#include "set_backend.h"
+#include "unitTest.h"
+#include "spy.h"
+#include <set>
+#include <vector>
+#include <functional>  // for std::less
+#include <type_traits> // for std::integral_constant
+#include <utility>     // for std::declval
+#include <cstdlib>     // for rand
+
+/***********************************************
+ * TEST SET BACKEND
+ * Unit tests for set on one Backend
+ ***********************************************/
+template <class Backend>
+class TestSetBackend : public UnitTest
+{
+   using Set = custom::set<int, std::less<int>, Backend>;
+
+   // every backend but frozen can be changed in place
+   using Writable = std::integral_constant<bool, !std::is_same<Backend, custom::frozen>::value>;
+
+   // whether the backend has an insert that can be called
+   template <class B, class = void>
+   struct CanInsert : std::false_type {};
+   template <class B>
+   struct CanInsert<B, decltype((void)B::insert(
+      std::declval<typename B::template engine<int, std::less<int>>&>(), 1))> : std::true_type {};
+
+public:
+   void run(const char* name)
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructInit_standard();
+      test_constructRange_duplicates();
+      test_constructCopy_standard();
+      test_constructMove_standard();
+
+      // Assign
+      test_assign_standardToStandard();
+      test_assignMove_standardToStandard();
+      test_swap_standardToStandard();
+
+      // Iterator
+      test_begin_empty();
+      test_iterator_increment_standard();
+      test_iterator_decrement_end();
+      test_rbegin_standard();
+
+      // Access
+      test_find_standard();
+      test_find_standardMissing();
+      test_lowerBound_standardBetween();
+      test_findMany_standard();
+      test_containsMany_standard();
+      test_minMax_standard();
+
+      // Status
+      test_size_standard();
+      test_bytesPerElement_standard();
+      test_optimizeLayout_sameElements();
+      test_compact_sameElements();
+      test_insert_availability();
+
+      runWrites(Writable());
+
+      report(name);
+   }
+
+   void runWrites(std::false_type)
+   {}
+   void runWrites(std::true_type)
+   {
+      // Insert
+      test_insert_empty();
+      test_insert_standardDuplicate();
+      test_insertMove_standardMiddle();
+      test_insertInit_manyInsertMany();
+      test_assignInit_standardToStandard();
+      test_insertParallel_standard();
+      test_applyBatch_inOrder();
+
+      // Remove
+      test_clear_standard();
+      test_eraseIterator_returnsNext();
+      test_eraseValue_standard();
+      test_eraseValue_standardMissing();
+      test_eraseRange_iterators();
+      test_eraseRange_values();
+      test_eraseIf_standard();
+      test_popFrontBack_standard();
+      test_popMinMax_standard();
+      test_extract_middle();
+      test_random_matchesStdSet();
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // default constructor, no allocations
+   void test_construct_default()
+   {  // setup
+      Spy::reset();
+      // exercise
+      custom::set<Spy, std::less<Spy>, Backend> s;
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(s.empty());
+      assertUnit(s.size() == 0);
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // an initializer list comes out in order
+   void test_constructInit_standard()
+   {  // exercise
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // verify
+      assertUnit(toVector(s) == standard());
+   }  // teardown
+
+   // a range with repeats keeps one of each
+   void test_constructRange_duplicates()
+   {  // setup
+      std::vector<int> v{ 50, 30, 50, 20, 30, 20 };
+      // exercise
+      Set s(v.begin(), v.end());
+      // verify
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 50 }));
+   }  // teardown
+
+   // a copy is equal and independent
+   void test_constructCopy_standard()
+   {  // setup
+      Set sSrc{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      Set sDest(sSrc);
+      // verify
+      assertUnit(toVector(sDest) == standard());
+      sSrc = Set{ 1 };
+      assertUnit(toVector(sDest) == standard());
+   }  // teardown
+
+   // a move leaves the source empty
+   void test_constructMove_standard()
+   {  // setup
+      Set sSrc{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      Set sDest(std::move(sSrc));
+      // verify
+      assertUnit(toVector(sDest) == standard());
+      assertUnit(sSrc.empty());
+   }  // teardown
+
+   /***************************************
+    * ASSIGN
+    ***************************************/
+
+   // copy assignment replaces what was there
+   void test_assign_standardToStandard()
+   {  // setup
+      Set sSrc{ 50, 30, 70, 20, 40, 60, 80 };
+      Set sDest{ 1, 2, 3 };
+      // exercise
+      sDest = sSrc;
+      // verify
+      assertUnit(toVector(sDest) == standard());
+      assertUnit(toVector(sSrc) == standard());
+   }  // teardown
+
+   // move assignment takes the source's elements
+   void test_assignMove_standardToStandard()
+   {  // setup
+      Set sSrc{ 50, 30, 70, 20, 40, 60, 80 };
+      Set sDest{ 1, 2, 3 };
+      // exercise
+      sDest = std::move(sSrc);
+      // verify
+      assertUnit(toVector(sDest) == standard());
+      assertUnit(sSrc.empty());
+   }  // teardown
+
+   // swapping trades the elements
+   void test_swap_standardToStandard()
+   {  // setup
+      Set s1{ 50, 30, 70, 20, 40, 60, 80 };
+      Set s2{ 1, 2 };
+      // exercise
+      s1.swap(s2);
+      // verify
+      assertUnit(toVector(s1) == std::vector<int>({ 1, 2 }));
+      assertUnit(toVector(s2) == standard());
+   }  // teardown
+
+   /***************************************
+    * ITERATOR
+    ***************************************/
+
+   // an empty set begins at its end
+   void test_begin_empty()
+   {  // setup
+      Set s;
+      // exercise and verify
+      assertUnit(s.begin() == s.end());
+      assertUnit(s.rbegin() == s.rend());
+   }  // teardown
+
+   // ++ walks the values in order
+   void test_iterator_increment_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto it = s.begin();
+      // exercise
+      ++it;
+      auto itPrev = it++;
+      // verify
+      assertUnit(*itPrev == 30);
+      assertUnit(*it == 40);
+   }  // teardown
+
+   // -- from the end reaches the largest
+   void test_iterator_decrement_end()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto it = s.end();
+      // exercise
+      --it;
+      // verify
+      assertUnit(*it == 80);
+      --it;
+      assertUnit(*it == 70);
+   }  // teardown
+
+   // a reverse walk is the forward walk backwards
+   void test_rbegin_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      std::vector<int> v;
+      // exercise
+      for (auto it = s.rbegin(); it != s.rend(); ++it)
+         v.push_back(*it);
+      // verify
+      assertUnit(v == std::vector<int>({ 80, 70, 60, 50, 40, 30, 20 }));
+   }  // teardown
+
+   /***************************************
+    * ACCESS
+    ***************************************/
+
+   // every value is found
+   void test_find_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise and verify
+      for (int value : standard())
+      {
+         auto it = s.find(value);
+         assertUnit(it != s.end() && *it == value);
+      }
+   }  // teardown
+
+   // a value not there is not found
+   void test_find_standardMissing()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise and verify
+      assertUnit(s.find(45) == s.end());
+      assertUnit(s.find(10) == s.end());
+      assertUnit(s.find(90) == s.end());
+   }  // teardown
+
+   // the first value not less than the one asked for
+   void test_lowerBound_standardBetween()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise and verify
+      assertUnit(*s.lower_bound(45) == 50);
+      assertUnit(*s.lower_bound(20) == 20);
+      assertUnit(*s.lower_bound(10) == 20);
+      assertUnit(s.lower_bound(81) == s.end());
+   }  // teardown
+
+   // a batch of finds lines up with its keys
+   void test_findMany_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      std::vector<int> keys{ 40, 45, 80, 20 };
+      std::vector<typename Set::iterator> out;
+      // exercise
+      s.find_many(keys, out);
+      // verify
+      assertUnit(out.size() == 4);
+      assertUnit(out[0] != s.end() && *out[0] == 40);
+      assertUnit(out[1] == s.end());
+      assertUnit(out[2] != s.end() && *out[2] == 80);
+      assertUnit(out[3] != s.end() && *out[3] == 20);
+   }  // teardown
+
+   // a batch of membership tests lines up with its keys
+   void test_containsMany_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      std::vector<int> keys{ 40, 45, 80 };
+      std::vector<bool> out;
+      // exercise
+      s.contains_many(keys, out);
+      // verify
+      assertUnit(out == std::vector<bool>({ true, false, true }));
+   }  // teardown
+
+   // the ends of the set
+   void test_minMax_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise and verify
+      assertUnit(s.min() == 20);
+      assertUnit(s.max() == 80);
+      assertUnit(s.peek_min() == 20);
+      assertUnit(s.peek_max() == 80);
+   }  // teardown
+
+   /***************************************
+    * STATUS
+    ***************************************/
+
+   // size counts each value once
+   void test_size_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise and verify
+      assertUnit(s.size() == 7);
+      assertUnit(!s.empty());
+   }  // teardown
+
+   // every backend spends at least the element itself
+   void test_bytesPerElement_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise and verify
+      assertUnit(s.bytes_per_element() >= sizeof(int));
+   }  // teardown
+
+   // a new layout, where the backend has one, changes nothing visible
+   void test_optimizeLayout_sameElements()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      s.optimize_layout();
+      // verify
+      assertUnit(toVector(s) == standard());
+      assertUnit(*s.find(40) == 40);
+      assertUnit(s.find(45) == s.end());
+   }  // teardown
+
+   // compacting, all at once or a step at a time, changes nothing visible
+   void test_compact_sameElements()
+   {  // setup
+      Set s1{ 50, 30, 70, 20, 40, 60, 80 };
+      Set s2{ 50, 30, 70, 20, 40, 60, 80 };
+      int numSteps = 0;
+      // exercise
+      s1.compact(custom::node_order::BREADTH_FIRST);
+      while (!s2.compact_step(2))
+         numSteps++;
+      // verify
+      assertUnit(toVector(s1) == standard());
+      assertUnit(toVector(s2) == standard());
+      assertUnit(numSteps <= 3);
+   }  // teardown
+
+   // frozen, alone, has no insert to call
+   void test_insert_availability()
+   {  // verify
+      assertUnit(CanInsert<Backend>::value == Writable::value);
+   }
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // the first value in
+   void test_insert_empty()
+   {  // setup
+      Set s;
+      // exercise
+      auto result = s.insert(50);
+      // verify
+      assertUnit(result.second);
+      assertUnit(*result.first == 50);
+      assertUnit(s.size() == 1);
+   }  // teardown
+
+   // a value already there is not added
+   void test_insert_standardDuplicate()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      auto result = s.insert(40);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(*result.first == 40);
+      assertUnit(toVector(s) == standard());
+   }  // teardown
+
+   // a moved value lands in order
+   void test_insertMove_standardMiddle()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      int value = 45;
+      // exercise
+      auto result = s.insert(std::move(value));
+      // verify
+      assertUnit(result.second);
+      assertUnit(*result.first == 45);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 40, 45, 50, 60, 70, 80 }));
+   }  // teardown
+
+   // a list inserted into a set merges with it
+   void test_insertInit_manyInsertMany()
+   {  // setup
+      Set s{ 50, 30, 70 };
+      // exercise
+      s.insert({ 20, 30, 80, 20 });
+      // verify
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 50, 70, 80 }));
+   }  // teardown
+
+   // assigning a list replaces what was there
+   void test_assignInit_standardToStandard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      s = { 3, 1, 2 };
+      // verify
+      assertUnit(toVector(s) == std::vector<int>({ 1, 2, 3 }));
+   }  // teardown
+
+   // values already there are not counted
+   void test_insertParallel_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      std::vector<int> values{ 10, 30, 55, 90, 55 };
+      // exercise
+      size_t num = s.insert_parallel(values.begin(), values.end());
+      // verify
+      assertUnit(num == 3);
+      assertUnit(toVector(s) == std::vector<int>({ 10, 20, 30, 40, 50, 55, 60, 70, 80, 90 }));
+   }  // teardown
+
+   // a batch ends as if its updates were made one at a time
+   void test_applyBatch_inOrder()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      std::vector<typename Set::update> batch{
+         { 25, false }, { 30, true }, { 25, true }, { 99, true }, { 25, false }, { 50, false } };
+      // exercise
+      auto result = s.apply_batch(batch);
+      // verify
+      assertUnit(result.inserted == 2);
+      assertUnit(result.erased == 2);
+      assertUnit(result.skipped == 2);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 25, 40, 50, 60, 70, 80 }));
+   }  // teardown
+
+   /***************************************
+    * REMOVE
+    ***************************************/
+
+   // clear leaves nothing
+   void test_clear_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      s.clear();
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // erasing at an iterator hands back the next value
+   void test_eraseIterator_returnsNext()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto it = s.find(40);
+      // exercise
+      auto itNext = s.erase(it);
+      // verify
+      assertUnit(itNext != s.end() && *itNext == 50);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 50, 60, 70, 80 }));
+   }  // teardown
+
+   // erasing by value says whether it was there
+   void test_eraseValue_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      size_t num = s.erase(50);
+      // verify
+      assertUnit(num == 1);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 40, 60, 70, 80 }));
+   }  // teardown
+
+   // erasing a value not there changes nothing
+   void test_eraseValue_standardMissing()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      size_t num = s.erase(45);
+      // verify
+      assertUnit(num == 0);
+      assertUnit(toVector(s) == standard());
+   }  // teardown
+
+   // erasing between two iterators leaves both at what follows
+   void test_eraseRange_iterators()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto itBegin = s.find(30);
+      auto itEnd = s.find(60);
+      // exercise
+      auto it = s.erase(itBegin, itEnd);
+      // verify
+      assertUnit(*it == 60);
+      assertUnit(itBegin == it && itEnd == it);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 60, 70, 80 }));
+   }  // teardown
+
+   // erasing from one value up to another
+   void test_eraseRange_values()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      size_t num = s.erase(35, 65);
+      size_t numNone = s.erase(65, 35);
+      // verify
+      assertUnit(num == 3);
+      assertUnit(numNone == 0);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 70, 80 }));
+   }  // teardown
+
+   // every value the predicate picks goes
+   void test_eraseIf_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      size_t num = s.erase_if([](int value) { return value % 20 == 0; });
+      // verify
+      assertUnit(num == 4);
+      assertUnit(toVector(s) == std::vector<int>({ 30, 50, 70 }));
+   }  // teardown
+
+   // the ends come off, and nothing happens when it is empty
+   void test_popFrontBack_standard()
+   {  // setup
+      Set s{ 50, 30, 70 };
+      // exercise
+      s.pop_front();
+      s.pop_back();
+      // verify
+      assertUnit(toVector(s) == std::vector<int>({ 50 }));
+      s.pop_front();
+      s.pop_back();
+      assertUnit(s.empty());
+   }  // teardown
+
+   // the ends come off and back out
+   void test_popMinMax_standard()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      int valueMin = s.pop_min();
+      int valueMax = s.pop_max();
+      // verify
+      assertUnit(valueMin == 20);
+      assertUnit(valueMax == 80);
+      assertUnit(toVector(s) == std::vector<int>({ 30, 40, 50, 60, 70 }));
+   }  // teardown
+
+   // a range moves out to a set of its own
+   void test_extract_middle()
+   {  // setup
+      Set s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto itBegin = s.find(30);
+      auto itEnd = s.find(60);
+      // exercise
+      Set sOut = s.extract(itBegin, itEnd);
+      // verify
+      assertUnit(toVector(sOut) == std::vector<int>({ 30, 40, 50 }));
+      assertUnit(toVector(s) == std::vector<int>({ 20, 60, 70, 80 }));
+      assertUnit(itBegin == itEnd && *itEnd == 60);
+   }  // teardown
+
+   // a long random mix of inserts and erases agrees with std::set
+   void test_random_matchesStdSet()
+   {  // setup
+      Set s;
+      std::set<int> sStd;
+      srand(44);
+      // exercise
+      for (int i = 0; i < 5000; i++)
+      {
+         int value = rand() % 500;
+         if (rand() % 3)
+            assertUnit(s.insert(value).second == sStd.insert(value).second);
+         else
+            assertUnit(s.erase(value) == sStd.erase(value));
+      }
+      // verify
+      assertUnit(s.size() == sStd.size());
+      assertUnit(toVector(s) == std::vector<int>(sStd.begin(), sStd.end()));
+   }  // teardown
+
+   /*************************************************************
+    * STANDARD
+    * The values of the standard fixture, in order
+    *************************************************************/
+   static std::vector<int> standard()
+   {
+      return std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 });
+   }
+};
+
+#endif // DEBUG
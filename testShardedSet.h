@@ -0,0 +1,317 @@
+/***********************************************************************
+ * Header:
+ *    TEST SHARDED SET
+ * Summary:
+ *    Unit tests for sharded_set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "sharded_set.h"
+#include "unitTest.h"
+#include <vector>
+#include <thread>     // for std::thread
+
+/***********************************************
+ * TEST SHARDED SET
+ * Unit tests for the sharded_set class
+ ***********************************************/
+class TestShardedSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_construct_boundaries();
+
+      // Point operations
+      test_insert_routes();
+      test_insert_duplicate();
+      test_erase_routes();
+
+      // Iterate
+      test_iterate_acrossShards();
+      test_lowerBound_sameShard();
+      test_lowerBound_nextShard();
+
+      // Rebalance
+      test_split_hotShard();
+      test_split_mergesWhenFull();
+      test_insert_oneShardNeverSplits();
+      test_publish_reclaimsRoutings();
+      test_publish_keepsRoutingInUse();
+
+      // Threads
+      test_insert_fromThreads();
+
+      report("ShardedSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // a new set starts with one shard holding everything
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::sharded_set<int> s;
+      // verify
+      assertUnit(s.size() == 0);
+      assertUnit(s.empty());
+      assertUnit(s.routing.load()->bounds.empty());
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // the boundaries given up front are used as they are
+   void test_construct_boundaries()
+   {  // setup
+      // exercise
+      custom::sharded_set<int> s(std::vector<int>({ 10, 20 }));
+      // verify
+      assertUnit(s.routing.load()->bounds == std::vector<int>({ 10, 20 }));
+      assertUnit(s.route(s.routing.load(), 9) == 0);
+      assertUnit(s.route(s.routing.load(), 10) == 1);
+      assertUnit(s.route(s.routing.load(), 19) == 1);
+      assertUnit(s.route(s.routing.load(), 20) == 2);
+   }  // teardown
+
+   /***************************************
+    * POINT OPERATIONS
+    ***************************************/
+
+   // each value lands in the shard covering it
+   void test_insert_routes()
+   {  // setup
+      custom::sharded_set<int> s(std::vector<int>({ 10, 20 }));
+      // exercise
+      bool inserted = s.insert(5);
+      s.insert(15);
+      s.insert(25);
+      s.insert(20);
+      // verify
+      assertUnit(inserted);
+      assertUnit(s.size() == 4);
+      assertUnit(s.shards[0].s.size() == 1);
+      assertUnit(s.shards[1].s.size() == 1);
+      assertUnit(s.shards[2].s.size() == 2);
+      assertUnit(s.contains(20));
+      assertUnit(!s.contains(10));
+   }  // teardown
+
+   // inserting twice keeps one copy
+   void test_insert_duplicate()
+   {  // setup
+      custom::sharded_set<int> s(std::vector<int>({ 10 }));
+      s.insert(15);
+      // exercise
+      bool inserted = s.insert(15);
+      // verify
+      assertUnit(!inserted);
+      assertUnit(s.size() == 1);
+   }  // teardown
+
+   // erase finds the value in its own shard
+   void test_erase_routes()
+   {  // setup
+      custom::sharded_set<int> s(std::vector<int>({ 10, 20 }));
+      for (int i : { 5, 15, 25 })
+         s.insert(i);
+      // exercise
+      size_t count = s.erase(15);
+      // verify
+      assertUnit(count == 1);
+      assertUnit(s.erase(15) == 0);
+      assertUnit(s.size() == 2);
+      assertUnit(s.shards[1].s.size() == 0);
+      assertUnit(!s.contains(15));
+   }  // teardown
+
+   /***************************************
+    * ITERATE
+    ***************************************/
+
+   // iteration walks the shards in key order, skipping empty ones
+   void test_iterate_acrossShards()
+   {  // setup
+      custom::sharded_set<int> s(std::vector<int>({ 10, 20, 30 }));
+      for (int i : { 35, 5, 25, 1, 31 })
+         s.insert(i);
+      // exercise
+      std::vector<int> v = toVector(s);
+      // verify
+      assertUnit(v == std::vector<int>({ 1, 5, 25, 31, 35 }));
+   }  // teardown
+
+   // the answer is in the value's own shard
+   void test_lowerBound_sameShard()
+   {  // setup
+      custom::sharded_set<int> s(std::vector<int>({ 10, 20 }));
+      for (int i : { 5, 12, 18, 25 })
+         s.insert(i);
+      // exercise
+      auto it = s.lower_bound(13);
+      // verify
+      assertUnit(it != s.end());
+      assertUnit(*it == 18);
+   }  // teardown
+
+   // everything in the value's shard is smaller: go on to the next
+   // shard that has anything in it
+   void test_lowerBound_nextShard()
+   {  // setup
+      custom::sharded_set<int> s(std::vector<int>({ 10, 20, 30 }));
+      for (int i : { 5, 12, 35 })
+         s.insert(i);
+      // exercise
+      auto it = s.lower_bound(13);
+      // verify
+      assertUnit(it != s.end());
+      assertUnit(*it == 35);
+      assertUnit(s.lower_bound(36) == s.end());
+   }  // teardown
+
+   /***************************************
+    * REBALANCE
+    ***************************************/
+
+   // one shard getting every insert is split at its median
+   void test_split_hotShard()
+   {  // setup
+      custom::sharded_set<int, 4> s;
+      size_t num = 4 * custom::sharded_set<int, 4>::MIN_SPLIT;
+      // exercise
+      for (size_t i = 0; i < num; i++)
+         s.insert((int)i);
+      // verify
+      assertUnit(s.size() == num);
+      assertUnit(s.routing.load()->bounds.size() > 0);
+      std::vector<int> v = toVector(s);
+      assertUnit(v.size() == num);
+      bool sorted = true;
+      for (size_t i = 0; i < v.size(); i++)
+         sorted = sorted && v[i] == (int)i;
+      assertUnit(sorted);
+      for (int i = 0; i < 4; i++)
+         assertUnit(s.shards[i].numElements.load() == s.shards[i].s.size());
+   }  // teardown
+
+   // with every shard in use, the two coldest neighbors are
+   // merged to free one for the split
+   void test_split_mergesWhenFull()
+   {  // setup
+      custom::sharded_set<int, 3> s(std::vector<int>({ 10, 20 }));
+      s.insert(1);
+      s.insert(15);
+      size_t num = 2 * custom::sharded_set<int, 3>::MIN_SPLIT;
+      for (size_t i = 0; i < num; i++)
+         s.shards[2].s.insert(20 + (int)i);
+      s.shards[2].numElements = num;
+      // exercise
+      s.split(2);
+      // verify
+      auto bounds = s.routing.load()->bounds;
+      assertUnit(bounds.size() == 2);
+      assertUnit(bounds[0] == 20);
+      assertUnit(bounds[1] == 20 + (int)num / 2);
+      assertUnit(s.shards[0].s.size() == 2);
+      assertUnit(s.shards[1].s.size() == num / 2);
+      assertUnit(s.shards[2].s.size() == num / 2);
+      assertUnit(s.contains(1));
+      assertUnit(s.contains(15));
+      assertUnit(s.contains(20 + (int)num - 1));
+   }  // teardown
+
+   // a set of one shard keeps everything in it, however big
+   void test_insert_oneShardNeverSplits()
+   {  // setup
+      custom::sharded_set<int, 1> s;
+      size_t num = 4 * custom::sharded_set<int, 1>::MIN_SPLIT;
+      // exercise
+      for (size_t i = 0; i < num; i++)
+         s.insert((int)i);
+      s.rebalance();
+      // verify
+      assertUnit(s.size() == num);
+      assertUnit(s.routing.load()->bounds.empty());
+      assertUnit(s.shards[0].s.size() == num);
+      assertUnit(s.contains((int)num - 1));
+   }  // teardown
+
+   // once nobody is routing, every replaced routing is freed
+   void test_publish_reclaimsRoutings()
+   {  // setup
+      custom::sharded_set<int, 4> s;
+      size_t num = 8 * custom::sharded_set<int, 4>::MIN_SPLIT;
+      // exercise
+      for (size_t i = 0; i < num; i++)
+         s.insert((int)i);
+      // verify
+      assertUnit(s.routing.load()->bounds.size() == 3);
+      assertUnit(s.retired.empty());
+      assertUnit(s.size() == num);
+   }  // teardown
+
+   // a routing a thread may still be searching outlives the publish
+   void test_publish_keepsRoutingInUse()
+   {  // setup
+      custom::sharded_set<int, 4> s;
+      auto pFirst = s.routing.load();
+      bool keptFirst;
+      // exercise
+      {
+         custom::sharded_set<int, 4>::Entry entry(s);
+         s.lockAll();
+         s.publishLocked(std::vector<int>({ 10 }));
+         s.unlockAll();
+         keptFirst = s.retired.size() == 1 && s.retired[0].pRouting.get() == pFirst;
+      }
+      s.lockAll();
+      s.publishLocked(std::vector<int>({ 20 }));
+      s.unlockAll();
+      // verify
+      assertUnit(keptFirst);
+      assertUnit(s.retired.empty());
+      assertUnit(s.routing.load()->bounds == std::vector<int>({ 20 }));
+   }  // teardown
+
+   /***************************************
+    * THREADS
+    ***************************************/
+
+   // four writers, each with its own stripe of keys, while the
+   // shards split underneath them
+   void test_insert_fromThreads()
+   {  // setup
+      custom::sharded_set<int, 8> s;
+      const int numThreads = 4;
+      const int numEach = 5000;
+      std::vector<std::thread> writers;
+      // exercise
+      for (int id = 0; id < numThreads; id++)
+         writers.push_back(std::thread([&, id]()
+         {
+            for (int i = 0; i < numEach; i++)
+               s.insert(i * numThreads + id);
+         }));
+      for (auto& thread : writers)
+         thread.join();
+      // verify
+      assertUnit(s.size() == numThreads * numEach);
+      assertUnit(s.routing.load()->bounds.size() > 0);
+      std::vector<int> v = toVector(s);
+      bool complete = v.size() == numThreads * numEach;
+      for (size_t i = 0; complete && i < v.size(); i++)
+         complete = v[i] == (int)i;
+      assertUnit(complete);
+   }  // teardown
+};
+
+#endif // DEBUG
@@ -0,0 +1,197 @@
+/***********************************************************************
+ * Header:
+ *    TEST SIMD SEARCH
+ * Summary:
+ *    Unit tests for the in-node key search kernels. Every kernel the
+ *    CPU can run is checked against a plain count.
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "simd_search.h"
+#include "unitTest.h"
+#include <vector>
+#include <algorithm>  // for std::sort
+#include <limits>     // for std::numeric_limits
+#include <cstdint>    // for uint32_t and friends
+#include <cstdlib>    // for rand
+
+/***********************************************
+ * TEST SIMD SEARCH
+ * Unit tests for simdCountBelow and simdCountAbove
+ ***********************************************/
+class TestSimdSearch : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Level
+      test_level_detectedOnce();
+      test_searchable_types();
+
+      // Count
+      test_count_empty();
+      test_count_int32();
+      test_count_uint32();
+      test_count_int64();
+      test_count_uint64();
+      test_count_everyLength();
+
+      report("SimdSearch");
+   }
+
+   /***************************************
+    * LEVEL
+    ***************************************/
+
+   // the level is asked for once and stays put
+   void test_level_detectedOnce()
+   {  // exercise
+      custom::simd_level level = custom::simdLevel();
+      // verify
+      assertUnit(level == custom::detectSimdLevel());
+      assertUnit(level == custom::simdLevel());
+   }
+
+   // 32- and 64-bit integers only
+   void test_searchable_types()
+   {  // verify
+      assertUnit(custom::simd_searchable<int>::value);
+      assertUnit(custom::simd_searchable<unsigned int>::value);
+      assertUnit(custom::simd_searchable<long long>::value);
+      assertUnit(custom::simd_searchable<uint64_t>::value);
+      assertUnit(!custom::simd_searchable<bool>::value);
+      assertUnit(!custom::simd_searchable<short>::value);
+      assertUnit(!custom::simd_searchable<char>::value);
+      assertUnit(!custom::simd_searchable<float>::value);
+      assertUnit(!custom::simd_searchable<double>::value);
+   }
+
+   /***************************************
+    * COUNT
+    ***************************************/
+
+   // no keys, nothing below or above
+   void test_count_empty()
+   {  // setup
+      int keys[1] = { 5 };
+      // exercise and verify
+      for (custom::simd_level level : levels())
+      {
+         assertUnit(custom::simdCountBelow(keys, 0, 10, level) == 0);
+         assertUnit(custom::simdCountAbove(keys, 0, 0, level) == 0);
+      }
+   }  // teardown
+
+   // negative numbers, and both ends of the range
+   void test_count_int32()
+   {  // exercise and verify
+      assertUnit(check<int32_t>({ std::numeric_limits<int32_t>::min(), -1000, -1, 0, 1, 7, 1000,
+                       std::numeric_limits<int32_t>::max() }));
+   }
+
+   // keys on both sides of the top bit, which a signed compare would misorder
+   void test_count_uint32()
+   {  // exercise and verify
+      assertUnit(check<uint32_t>({ 0u, 1u, 0x7ffffffeu, 0x7fffffffu, 0x80000000u, 0x80000001u,
+                        0xfffffff0u, 0xffffffffu, 12345u }));
+   }
+
+   // the same, 64 bits wide
+   void test_count_int64()
+   {  // exercise and verify
+      assertUnit(check<int64_t>({ std::numeric_limits<int64_t>::min(), -(1LL << 40), -1, 0, 3,
+                       1LL << 33, std::numeric_limits<int64_t>::max() }));
+   }
+
+   // and unsigned
+   void test_count_uint64()
+   {  // exercise and verify
+      assertUnit(check<uint64_t>({ 0ull, 5ull, 0x7fffffffffffffffull, 0x8000000000000000ull,
+                        0x8000000000000001ull, 0xffffffffffffffffull, 1ull << 32 }));
+   }
+
+   // every length from empty to more than a 64-key node, so every
+   // kernel's tail loop is exercised
+   void test_count_everyLength()
+   {  // setup
+      srand(42);
+      bool right = true;
+      for (int n = 0; n <= 70; n++)
+      {
+         std::vector<int> keys(n);
+         for (int& key : keys)
+            key = rand() % 200 - 100;
+         std::sort(keys.begin(), keys.end());
+         // exercise
+         for (int t = -105; t <= 105; t += 3)
+            for (custom::simd_level level : levels())
+               right = right &&
+                  custom::simdCountBelow(keys.data(), n, t, level) == scalarBelow(keys, t) &&
+                  custom::simdCountAbove(keys.data(), n, t, level) == scalarAbove(keys, t);
+      }
+      // verify
+      assertUnit(right);
+   }  // teardown
+
+   /*************************************************************
+    * LEVELS
+    * Every level this CPU can run, scalar first
+    *************************************************************/
+   std::vector<custom::simd_level> levels()
+   {
+      std::vector<custom::simd_level> all{ custom::simd_level::SCALAR };
+      if (custom::simdLevel() >= custom::simd_level::SSE42)
+         all.push_back(custom::simd_level::SSE42);
+      if (custom::simdLevel() >= custom::simd_level::AVX2)
+         all.push_back(custom::simd_level::AVX2);
+      return all;
+   }
+
+   /*************************************************************
+    * CHECK
+    * Count below and above every value, and its neighbors, in
+    * the sorted values, at every level. True if every kernel
+    * agrees with a plain count.
+    *************************************************************/
+   template <typename T>
+   bool check(std::vector<T> keys)
+   {
+      std::sort(keys.begin(), keys.end());
+      std::vector<T> probes;
+      for (T key : keys)
+      {
+         probes.push_back(key);
+         if (key != std::numeric_limits<T>::min())
+            probes.push_back(key - 1);
+         if (key != std::numeric_limits<T>::max())
+            probes.push_back(key + 1);
+      }
+      bool right = true;
+      for (T t : probes)
+         for (custom::simd_level level : levels())
+            right = right &&
+               custom::simdCountBelow(keys.data(), (int)keys.size(), t, level) == scalarBelow(keys, t) &&
+               custom::simdCountAbove(keys.data(), (int)keys.size(), t, level) == scalarAbove(keys, t);
+      return right;
+   }
+
+   template <typename T>
+   int scalarBelow(const std::vector<T>& keys, T t)
+   {
+      return (int)std::count_if(keys.begin(), keys.end(), [t](T key) { return key < t; });
+   }
+   template <typename T>
+   int scalarAbove(const std::vector<T>& keys, T t)
+   {
+      return (int)std::count_if(keys.begin(), keys.end(), [t](T key) { return t < key; });
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,319 @@
+/***********************************************************************
+ * Header:
+ *    TEST SMALL SET
+ * Summary:
+ *    Unit tests for small_set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "small_set.h"
+#include "unitTest.h"
+#include "spy.h"
+#include <set>
+#include <vector>
+#include <cstdlib>    // for rand
+
+/***********************************************
+ * TEST SMALL SET
+ * Unit tests for the small_set class
+ ***********************************************/
+class TestSmallSet : public UnitTest
+{
+   using Small = custom::small_set<int, 4>;
+
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructCopy_inlineAndSpilled();
+      test_constructMove_empties();
+      test_swap_inlineAndSpilled();
+      test_sizeof_noBigger();
+
+      // Inline
+      test_insert_inlineSorted();
+      test_insert_inlineDuplicate();
+      test_insert_spills();
+      test_erase_comesBackAtHalf();
+      test_boundary_noFlapping();
+      test_clear_comesBack();
+
+      // Iterators
+      test_find_inlineAndSpilled();
+      test_iterator_decrementEnd();
+      test_eraseIterator_acrossComingBack();
+      test_eraseRange_inline();
+      test_spy_noLeaks();
+      test_random_matchesStdSet();
+
+      report("SmallSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // default constructor, empty, inline and nothing built
+   void test_construct_default()
+   {  // setup
+      Spy::reset();
+      // exercise
+      custom::small_set<Spy> s;
+      // verify
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(s.is_inline());
+      assertUnit(s.empty());
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // a copy of either storage has the same elements in the same storage
+   void test_constructCopy_inlineAndSpilled()
+   {  // setup
+      Small sInline{ 3, 1, 2 };
+      Small sSpilled = range<Small>(0, 20);
+      // exercise
+      Small sInlineCopy(sInline);
+      Small sSpilledCopy(sSpilled);
+      // verify
+      assertUnit(sInlineCopy.is_inline());
+      assertUnit(!sSpilledCopy.is_inline());
+      assertUnit(toVector(sInlineCopy) == std::vector<int>({ 1, 2, 3 }));
+      assertUnit(toVector(sSpilledCopy) == toVector(sSpilled));
+   }  // teardown
+
+   // a move leaves the source empty and inline
+   void test_constructMove_empties()
+   {  // setup
+      Small sSrc = range<Small>(0, 20);
+      // exercise
+      Small sDest(std::move(sSrc));
+      // verify
+      assertUnit(sDest.size() == 20);
+      assertUnit(!sDest.is_inline());
+      assertUnit(sSrc.empty());
+      assertUnit(sSrc.is_inline());
+   }  // teardown
+
+   // swapping trades storage along with elements
+   void test_swap_inlineAndSpilled()
+   {  // setup
+      Small s1{ 1, 2 };
+      Small s2 = range<Small>(0, 20);
+      // exercise
+      s1.swap(s2);
+      // verify
+      assertUnit(!s1.is_inline());
+      assertUnit(toVector(s1) == toVector(range<Small>(0, 20)));
+      assertUnit(s2.is_inline());
+      assertUnit(toVector(s2) == std::vector<int>({ 1, 2 }));
+   }  // teardown
+
+   // the array shares its bytes with the tree
+   void test_sizeof_noBigger()
+   {  // verify
+      assertUnit(sizeof(custom::small_set<int, 2>) <= sizeof(custom::BST<int>) + 2 * sizeof(void*));
+      assertUnit(sizeof(custom::small_set<int, 8>) <= 8 * sizeof(int) + 2 * sizeof(void*));
+   }
+
+   /***************************************
+    * INLINE
+    ***************************************/
+
+   // values in the object stay sorted
+   //    [20 50]  -->  [20 30 50]
+   void test_insert_inlineSorted()
+   {  // setup
+      Small s{ 50, 20 };
+      // exercise
+      auto result = s.insert(30);
+      // verify
+      assertUnit(result.second);
+      assertUnit(*result.first == 30);
+      assertUnit(s.is_inline());
+      assertUnit(s.numInline == 3);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 50 }));
+   }  // teardown
+
+   // a value already there is not added
+   void test_insert_inlineDuplicate()
+   {  // setup
+      Small s{ 50, 20, 30 };
+      // exercise
+      auto result = s.insert(20);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(*result.first == 20);
+      assertUnit(s.size() == 3);
+   }  // teardown
+
+   // the N+1st value moves everything to a BST
+   void test_insert_spills()
+   {  // setup
+      Small s = range<Small>(0, 4);
+      assertUnit(s.is_inline());
+      // exercise
+      auto result = s.insert(2);
+      auto resultNew = s.insert(-1);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(resultNew.second);
+      assertUnit(*resultNew.first == -1);
+      assertUnit(!s.is_inline());
+      assertUnit(s.bst.size() == 5);
+      assertUnit(toVector(s) == std::vector<int>({ -1, 0, 1, 2, 3 }));
+   }  // teardown
+
+   // back inline only at N/2
+   void test_erase_comesBackAtHalf()
+   {  // setup
+      Small s = range<Small>(0, 5);
+      // exercise
+      s.erase(4);
+      s.erase(3);
+      bool inlineBefore = s.is_inline();
+      s.erase(2);
+      // verify
+      assertUnit(!inlineBefore);
+      assertUnit(s.is_inline());
+      assertUnit(toVector(s) == std::vector<int>({ 0, 1 }));
+   }  // teardown
+
+   // going back and forth over N does not move each time
+   void test_boundary_noFlapping()
+   {  // setup
+      Small s = range<Small>(0, 5);
+      // exercise and verify
+      for (int i = 0; i < 10; i++)
+      {
+         s.erase(4);
+         assertUnit(!s.is_inline());
+         s.insert(4);
+         assertUnit(!s.is_inline());
+      }
+   }  // teardown
+
+   // clear puts even a spilled set back inline
+   void test_clear_comesBack()
+   {  // setup
+      Small s = range<Small>(0, 20);
+      // exercise
+      s.clear();
+      s.insert(7);
+      // verify
+      assertUnit(s.is_inline());
+      assertUnit(toVector(s) == std::vector<int>({ 7 }));
+   }  // teardown
+
+   /***************************************
+    * ITERATORS
+    ***************************************/
+
+   // find works the same on either side of the spill
+   void test_find_inlineAndSpilled()
+   {  // setup
+      Small sInline{ 10, 20, 30 };
+      Small sSpilled = range<Small>(0, 20);
+      // exercise and verify
+      assertUnit(*sInline.find(20) == 20);
+      assertUnit(sInline.find(25) == sInline.end());
+      assertUnit(sInline.find(40) == sInline.end());
+      assertUnit(*sInline.lower_bound(25) == 30);
+      assertUnit(*sSpilled.find(13) == 13);
+      assertUnit(sSpilled.find(25) == sSpilled.end());
+      assertUnit(*sSpilled.lower_bound(-5) == 0);
+   }  // teardown
+
+   // stepping back from the end reaches the largest
+   void test_iterator_decrementEnd()
+   {  // setup
+      Small sInline{ 10, 20, 30 };
+      Small sSpilled = range<Small>(0, 20);
+      // exercise
+      auto itInline = sInline.end();
+      auto itSpilled = sSpilled.end();
+      --itInline;
+      --itSpilled;
+      // verify
+      assertUnit(*itInline == 30);
+      assertUnit(*itSpilled == 19);
+   }  // teardown
+
+   // the iterator erase hands back survives the move inline
+   void test_eraseIterator_acrossComingBack()
+   {  // setup
+      Small s = range<Small>(0, 5);
+      s.erase(4);
+      s.erase(3);
+      // exercise
+      auto it = s.find(1);
+      it = s.erase(it);
+      // verify
+      assertUnit(s.is_inline());
+      assertUnit(it != s.end() && *it == 2);
+      assertUnit(toVector(s) == std::vector<int>({ 0, 2 }));
+   }  // teardown
+
+   // a range in the array closes up
+   void test_eraseRange_inline()
+   {  // setup
+      Small s{ 1, 2, 3, 4 };
+      auto itBegin = s.find(2);
+      auto itEnd = s.find(4);
+      // exercise
+      auto it = s.erase(itBegin, itEnd);
+      // verify
+      assertUnit(*it == 4);
+      assertUnit(toVector(s) == std::vector<int>({ 1, 4 }));
+   }  // teardown
+
+   // every element made is destroyed, across spills and coming back
+   void test_spy_noLeaks()
+   {  // setup
+      Spy::reset();
+      {
+         custom::small_set<Spy, 4> s;
+         // exercise
+         for (int i = 0; i < 10; i++)
+            s.insert(Spy(i));
+         for (int i = 0; i < 9; i++)
+            s.erase(Spy(i));
+         custom::small_set<Spy, 4> sCopy(s);
+         s = custom::small_set<Spy, 4>{ Spy(1), Spy(2), Spy(3), Spy(4), Spy(5) };
+         s.swap(sCopy);
+      }
+      // verify
+      assertUnit(Spy::numAlloc() == Spy::numDelete());
+   }  // teardown
+
+   // a long random mix of everything agrees with std::set
+   void test_random_matchesStdSet()
+   {  // setup
+      Small s;
+      std::set<int> sStd;
+      srand(46);
+      // exercise
+      for (int i = 0; i < 20000; i++)
+      {
+         int value = rand() % 12;
+         int op = rand() % 10;
+         if (op < 4)
+            assertUnit(s.insert(value).second == sStd.insert(value).second);
+         else if (op < 8)
+            assertUnit(s.erase(value) == sStd.erase(value));
+         else
+            assertUnit((s.find(value) != s.end()) == (sStd.count(value) == 1));
+      }
+      // verify
+      assertUnit(toVector(s) == std::vector<int>(sStd.begin(), sStd.end()));
+   }  // teardown
+};
+
+#endif // DEBUG
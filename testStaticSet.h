@@ -0,0 +1,390 @@
+/***********************************************************************
+ * Header:
+ *    TEST STATIC SET
+ * Summary:
+ *    Unit tests for static_set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "static_set.h"
+#include "unitTest.h"
+#include "spy.h"
+#include <set>
+#include <vector>
+#include <cstdlib>    // for rand
+
+/***********************************************
+ * TEST STATIC SET
+ * Unit tests for the static_set class
+ ***********************************************/
+class TestStaticSet : public UnitTest
+{
+   using Small = custom::static_set<int, 8>;
+
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_construct_constexpr();
+      test_constructCopy_independent();
+      test_constructMove_empties();
+      test_swap_standard();
+      test_index_smallest();
+
+      // Insert
+      test_insert_sorted();
+      test_insert_duplicate();
+      test_insert_full();
+      test_insertRange_overflow();
+      test_erase_reusesNode();
+
+      // Iterators
+      test_iterator_bothWays();
+      test_eraseIterator_returnsNext();
+      test_eraseRange_middle();
+      test_insert_keepsIterators();
+      test_clear_startsOver();
+
+      // Heap
+      test_spy_noAllocation();
+      test_spy_destroysAll();
+      test_random_matchesStdSet();
+
+      report("StaticSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // default constructor: empty, and no element is built
+   void test_construct_default()
+   {  // setup
+      Spy::reset();
+      // exercise
+      custom::static_set<Spy, 8> s;
+      // verify
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(s.empty());
+      assertUnit(s.begin() == s.end());
+      assertUnit(s.capacity() == 8);
+   }  // teardown
+
+   // an empty set of ints can be a compile-time constant
+   void test_construct_constexpr()
+   {  // exercise
+      constexpr Small s;
+      static_assert(s.empty() && s.size() == 0 && !s.full(), "constexpr set");
+      // verify
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // a copy is equal and independent
+   void test_constructCopy_independent()
+   {  // setup
+      Small sSrc{ 50, 30, 70, 20 };
+      sSrc.erase(30);
+      // exercise
+      Small sDest(sSrc);
+      sSrc.insert(10);
+      sDest.insert(60);
+      // verify
+      assertUnit(toVector(sDest) == std::vector<int>({ 20, 50, 60, 70 }));
+      assertUnit(toVector(sSrc) == std::vector<int>({ 10, 20, 50, 70 }));
+      assertUnit(isRedBlack(sDest));
+   }  // teardown
+
+   // a move leaves the source empty, with all its nodes free
+   void test_constructMove_empties()
+   {  // setup
+      Small sSrc = range<Small>(0, 8);
+      // exercise
+      Small sDest(std::move(sSrc));
+      // verify
+      assertUnit(toVector(sDest) == toVector(range<Small>(0, 8)));
+      assertUnit(sSrc.empty());
+      assertUnit(sSrc.pool.numUsed == 0);
+      assertUnit(sSrc.insert(1).second);
+   }  // teardown
+
+   // swapping trades the elements
+   void test_swap_standard()
+   {  // setup
+      Small s1{ 1, 2 };
+      Small s2 = range<Small>(0, 8);
+      // exercise
+      s1.swap(s2);
+      // verify
+      assertUnit(toVector(s1) == toVector(range<Small>(0, 8)));
+      assertUnit(toVector(s2) == std::vector<int>({ 1, 2 }));
+   }  // teardown
+
+   // the links are as narrow as N allows
+   void test_index_smallest()
+   {  // verify
+      assertUnit(sizeof(custom::static_set<int, 254>::index) == 1);
+      assertUnit(sizeof(custom::static_set<int, 255>::index) == 2);
+      assertUnit(sizeof(custom::static_set<int, 70000>::index) == 4);
+      assertUnit(Small::bytes_per_element() == sizeof(int) + 4);
+   }
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // values come out sorted and the tree stays balanced
+   void test_insert_sorted()
+   {  // setup
+      Small s;
+      // exercise
+      for (int value : { 50, 30, 70, 20, 40, 60, 80, 10 })
+         assertUnit(s.insert(value).second);
+      // verify
+      assertUnit(toVector(s) == std::vector<int>({ 10, 20, 30, 40, 50, 60, 70, 80 }));
+      assertUnit(isRedBlack(s));
+   }  // teardown
+
+   // a value already there is not added
+   void test_insert_duplicate()
+   {  // setup
+      Small s{ 50, 20, 30 };
+      // exercise
+      auto result = s.insert(20);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(result.first != s.end() && *result.first == 20);
+      assertUnit(s.size() == 3);
+   }  // teardown
+
+   // a full set turns a new value away with end() and false, but
+   // still finds one it has
+   void test_insert_full()
+   {  // setup
+      Small s = range<Small>(0, 8);
+      assertUnit(s.full());
+      // exercise
+      auto resultNew = s.insert(100);
+      auto resultOld = s.insert(3);
+      // verify
+      assertUnit(!resultNew.second);
+      assertUnit(resultNew.first == s.end());
+      assertUnit(!resultOld.second);
+      assertUnit(*resultOld.first == 3);
+      assertUnit(toVector(s) == toVector(range<Small>(0, 8)));
+   }  // teardown
+
+   // a range that does not fit says so and keeps what did
+   void test_insertRange_overflow()
+   {  // setup
+      custom::static_set<int, 4> s{ 1, 2 };
+      std::vector<int> values{ 2, 3, 4, 5, 6 };
+      std::vector<int> valuesFit{ 1, 4 };
+      // exercise
+      bool fit = s.insert(values.begin(), values.end());
+      bool fitAgain = s.insert(valuesFit.begin(), valuesFit.end());
+      // verify
+      assertUnit(!fit);
+      assertUnit(fitAgain);
+      assertUnit(s.full());
+      assertUnit(s.find(4) != s.end());
+      assertUnit(s.find(5) == s.end());
+   }  // teardown
+
+   // an erased node is the next one handed out
+   void test_erase_reusesNode()
+   {  // setup
+      Small s = range<Small>(0, 8);
+      size_t iErased = s.find(5).i;
+      // exercise
+      s.erase(5);
+      auto result = s.insert(100);
+      // verify
+      assertUnit(result.second);
+      assertUnit(result.first.i == iErased);
+      assertUnit(s.pool.numUsed == 8);
+      assertUnit(isRedBlack(s));
+   }  // teardown
+
+   /***************************************
+    * ITERATORS
+    ***************************************/
+
+   // forward from begin() and back from end()
+   void test_iterator_bothWays()
+   {  // setup
+      Small s{ 30, 10, 20 };
+      // exercise
+      auto it = s.end();
+      --it;
+      int last = *it;
+      --it;
+      int middle = *it--;
+      // verify
+      assertUnit(last == 30);
+      assertUnit(middle == 20);
+      assertUnit(it == s.begin() && *it == 10);
+      assertUnit(std::vector<int>(s.begin(), s.end()) == std::vector<int>({ 10, 20, 30 }));
+   }  // teardown
+
+   // erasing hands back what followed
+   void test_eraseIterator_returnsNext()
+   {  // setup
+      Small s = range<Small>(0, 8);
+      // exercise
+      auto it = s.erase(s.find(3));
+      auto itLast = s.erase(s.find(7));
+      // verify
+      assertUnit(*it == 4);
+      assertUnit(itLast == s.end());
+      assertUnit(toVector(s) == std::vector<int>({ 0, 1, 2, 4, 5, 6 }));
+      assertUnit(isRedBlack(s));
+   }  // teardown
+
+   // a range between two iterators goes
+   void test_eraseRange_middle()
+   {  // setup
+      Small s = range<Small>(0, 8);
+      // exercise
+      auto it = s.erase(s.find(2), s.find(6));
+      // verify
+      assertUnit(*it == 6);
+      assertUnit(toVector(s) == std::vector<int>({ 0, 1, 6, 7 }));
+      assertUnit(isRedBlack(s));
+   }  // teardown
+
+   // nodes never move, so iterators survive other inserts and erases
+   void test_insert_keepsIterators()
+   {  // setup
+      Small s{ 40, 20 };
+      auto it = s.find(40);
+      // exercise
+      for (int value : { 10, 30, 50, 60, 70 })
+         s.insert(value);
+      s.erase(20);
+      // verify
+      assertUnit(*it == 40);
+      assertUnit(*++it == 50);
+   }  // teardown
+
+   // clear frees every node, even those on the free list
+   void test_clear_startsOver()
+   {  // setup
+      Small s = range<Small>(0, 8);
+      s.erase(2);
+      // exercise
+      s.clear();
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.pool.numUsed == 0);
+      assertUnit(s.pool.freeHead == Small::NIL);
+      assertUnit(s.insert(1).second);
+   }  // teardown
+
+   /***************************************
+    * HEAP
+    ***************************************/
+
+   // values moved in, erased, copied around and cleared: the set never
+   // allocates, so ALLOC sees nothing
+   void test_spy_noAllocation()
+   {  // setup
+      std::vector<Spy> values;
+      for (int i = 0; i < 6; i++)
+         values.push_back(Spy(i));
+      Spy::reset();
+      {
+         custom::static_set<Spy, 8> s;
+         // exercise
+         for (Spy& value : values)
+            s.insert(std::move(value));
+         s.erase(s.begin());
+         custom::static_set<Spy, 8> sMoved(std::move(s));
+         sMoved.swap(s);
+         s.clear();
+      }
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+   }  // teardown
+
+   // every element built is destroyed, by erase, clear or the destructor
+   void test_spy_destroysAll()
+   {  // setup
+      Spy::reset();
+      {
+         custom::static_set<Spy, 8> s;
+         // exercise
+         for (int i = 0; i < 10; i++)
+            s.insert(Spy(i));
+         s.erase(Spy(3));
+         custom::static_set<Spy, 8> sCopy(s);
+         sCopy.erase(Spy(4));
+         s = sCopy;
+      }
+      // verify
+      assertUnit(Spy::numAlloc() == Spy::numDelete());
+   }  // teardown
+
+   // a long random mix agrees with std::set, turning away only what
+   // would not fit, and stays a red-black tree throughout
+   void test_random_matchesStdSet()
+   {  // setup
+      custom::static_set<int, 64> s;
+      std::set<int> sStd;
+      srand(47);
+      bool balanced = true;
+      // exercise
+      for (int i = 0; i < 20000; i++)
+      {
+         int value = rand() % 100;
+         if (rand() % 2)
+         {
+            bool fits = sStd.size() < 64 || sStd.count(value);
+            bool isNew = fits && sStd.insert(value).second;
+            assertUnit(s.insert(value).second == isNew);
+         }
+         else
+            assertUnit(s.erase(value) == sStd.erase(value));
+         if (i % 100 == 0)
+            balanced = balanced && isRedBlack(s);
+      }
+      // verify
+      assertUnit(balanced);
+      assertUnit(toVector(s) == std::vector<int>(sStd.begin(), sStd.end()));
+   }  // teardown
+
+   /*************************************************************
+    * IS RED BLACK
+    * The root is black, no red node has a red child, every path
+    * has the same number of black nodes, and the parent links agree
+    *************************************************************/
+   template <class Set>
+   static bool isRedBlack(const Set& s)
+   {
+      return !s.isRed(s.root) && blackHeight(s, s.root, Set::NIL) >= 0;
+   }
+   template <class Set>
+   static int blackHeight(const Set& s, typename Set::index i, typename Set::index iParent)
+   {
+      if (i == Set::NIL)
+         return 0;
+      if (s.at(i).parent != iParent)
+         return -1;
+      if (s.isRed(i) && (s.isRed(s.at(i).left) || s.isRed(s.at(i).right)))
+         return -1;
+      int left = blackHeight(s, s.at(i).left, i);
+      int right = blackHeight(s, s.at(i).right, i);
+      if (left < 0 || left != right)
+         return -1;
+      return left + (s.isRed(i) ? 0 : 1);
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,373 @@
+/***********************************************************************
+ * Header:
+ *    TEST THREADED SET
+ * Summary:
+ *    Unit tests for threaded_set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "threaded_set.h"
+#include "unitTest.h"
+#include "spy.h"
+#include <set>
+#include <vector>
+#include <cstdlib>    // for rand
+
+/***********************************************
+ * TEST THREADED SET
+ * Unit tests for the threaded_set class
+ ***********************************************/
+class TestThreadedSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructCopy_threads();
+      test_node_noBiggerThanLean();
+
+      // Insert
+      test_insert_threadsLeaf();
+      test_insert_ascending();
+      test_insert_duplicate();
+
+      // Iterator
+      test_iterator_incrementFollowsThread();
+      test_iterator_bothWays();
+      test_iterator_decrementEnd();
+      test_lowerBound_standard();
+
+      // Remove
+      test_erase_leafRethreads();
+      test_erase_twoChildren();
+      test_erase_random();
+      test_eraseIterator_returnsNext();
+      test_clear_freesAll();
+
+      report("ThreadedSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // default constructor, no allocations
+   void test_construct_default()
+   {  // setup
+      Spy::reset();
+      // exercise
+      custom::threaded_set<Spy> s;
+      // verify
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(s.root == nullptr);
+      assertUnit(s.numElements == 0);
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // a copy is threaded through its own nodes, not the source's
+   void test_constructCopy_threads()
+   {  // setup
+      custom::threaded_set<int> sSrc;
+      for (int i = 0; i < 100; i++)
+         sSrc.insert((i * 37) % 100);
+      // exercise
+      custom::threaded_set<int> sDest(sSrc);
+      // verify
+      assertUnit(sDest.size() == 100);
+      assertUnit(verifyThreaded(sDest));
+      assertUnit(toVector(sDest) == toVector(sSrc));
+      sSrc.clear();
+      assertUnit(verifyThreaded(sDest));
+      assertUnit(toVector(sDest).size() == 100);
+   }  // teardown
+
+   // the thread flags fit in the padding after the color
+   void test_node_noBiggerThanLean()
+   {  // verify
+      assertUnit(sizeof(custom::threaded_set<int>::TNode) == 4 * sizeof(void*));
+   }
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // a new leaf threads to its neighbors on both sides
+   //                 50                             50
+   //          +-------+-------+              +-------+-------+
+   //         30              70     -->     30              70
+   //     +----+----+     +----+----+    +----+----+     +----+----+
+   //    20        40    60        80   20        40    60        80
+   //                                             +
+   //                                            35
+   void test_insert_threadsLeaf()
+   {  // setup
+      custom::threaded_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto p40 = s.find(40).pNode;
+      auto p30 = s.find(30).pNode;
+      // exercise
+      auto result = s.insert(35);
+      // verify
+      auto p35 = result.first.pNode;
+      assertUnit(result.second);
+      assertUnit(p40->left() == p35);
+      assertUnit(p35->leftThread && p35->pLeft == p30);
+      assertUnit(p35->rightThread && p35->pRight == p40);
+      assertUnit(verifyThreaded(s));
+   }  // teardown
+
+   // ascending inserts stay balanced and threaded
+   void test_insert_ascending()
+   {  // setup
+      custom::threaded_set<int> s;
+      // exercise
+      for (int i = 0; i < 1000; i++)
+         s.insert(i);
+      // verify
+      assertUnit(s.size() == 1000);
+      assertUnit(verifyThreaded(s));
+      assertUnit(height(s.root) <= 20);
+      std::vector<int> v;
+      for (int i = 0; i < 1000; i++)
+         v.push_back(i);
+      assertUnit(toVector(s) == v);
+   }  // teardown
+
+   // a duplicate changes nothing and points at the one already there
+   void test_insert_duplicate()
+   {  // setup
+      custom::threaded_set<int> s{ 50, 30, 70, 20, 40 };
+      // exercise
+      auto result = s.insert(40);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(result.first == s.find(40));
+      assertUnit(s.size() == 5);
+   }  // teardown
+
+   /***************************************
+    * ITERATOR
+    ***************************************/
+
+   // from 40, which has no right child, ++ is the thread up to 50
+   void test_iterator_incrementFollowsThread()
+   {  // setup
+      custom::threaded_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto it = s.find(40);
+      assertUnit(it.pNode->rightThread);
+      // exercise
+      ++it;
+      // verify
+      assertUnit(it != s.end());
+      if (it != s.end())
+         assertUnit(*it == 50);
+      assertUnit(it.pNode == s.root);
+   }  // teardown
+
+   // forward and backward visit the same elements
+   void test_iterator_bothWays()
+   {  // setup
+      custom::threaded_set<int> s;
+      for (int i = 0; i < 200; i += 2)
+         s.insert((i * 37) % 200);
+      std::vector<int> forward = toVector(s);
+      std::vector<int> backward;
+      // exercise
+      auto it = s.end();
+      while (it != s.begin())
+         backward.insert(backward.begin(), *--it);
+      // verify
+      assertUnit(forward.size() == 100);
+      assertUnit(backward == forward);
+   }  // teardown
+
+   // --end() is the largest
+   void test_iterator_decrementEnd()
+   {  // setup
+      custom::threaded_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto it = s.end();
+      // exercise
+      --it;
+      // verify
+      assertUnit(it != s.end());
+      if (it != s.end())
+         assertUnit(*it == 80);
+      ++it;
+      assertUnit(it == s.end());
+   }  // teardown
+
+   // lower_bound lands on the key or the next one up
+   void test_lowerBound_standard()
+   {  // setup
+      custom::threaded_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise and verify
+      assertUnit(*s.lower_bound(10) == 20);
+      assertUnit(*s.lower_bound(40) == 40);
+      assertUnit(*s.lower_bound(45) == 50);
+      assertUnit(s.lower_bound(85) == s.end());
+   }  // teardown
+
+   /***************************************
+    * REMOVE
+    ***************************************/
+
+   // the parent of an erased leaf threads past it
+   void test_erase_leafRethreads()
+   {  // setup
+      custom::threaded_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto p30 = s.find(30).pNode;
+      auto p50 = s.find(50).pNode;
+      // exercise
+      assertUnit(s.erase(40) == 1);
+      // verify
+      assertUnit(p30->rightThread && p30->pRight == p50);
+      assertUnit(toVector(s) == std::vector<int>({ 20, 30, 50, 60, 70, 80 }));
+      assertUnit(verifyThreaded(s));
+   }  // teardown
+
+   // the successor node takes the root's place; nothing is copied
+   void test_erase_twoChildren()
+   {  // setup
+      custom::threaded_set<Spy> s{ Spy(50), Spy(30), Spy(70), Spy(20), Spy(40), Spy(60), Spy(80) };
+      auto p60 = s.find(Spy(60)).pNode;
+      Spy::reset();
+      // exercise
+      assertUnit(s.erase(Spy(50)) == 1);
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAssign() == 0);
+      assertUnit(Spy::numAssignMove() == 0);
+      assertUnit(s.root == p60);
+      assertUnit(s.size() == 6);
+      assertUnit(verifyThreaded(s));
+   }  // teardown
+
+   // many inserts and erases agree with std::set and stay threaded
+   void test_erase_random()
+   {  // setup
+      srand(40);
+      custom::threaded_set<int> s;
+      std::set<int> model;
+      bool valid = true;
+      // exercise
+      for (int i = 0; i < 4000; i++)
+      {
+         int value = rand() % 400;
+         if (rand() % 3)
+         {
+            s.insert(value);
+            model.insert(value);
+         }
+         else
+            assertUnit(s.erase(value) == model.erase(value));
+         if (i % 50 == 0)
+            valid = valid && verifyThreaded(s);
+      }
+      // verify
+      assertUnit(valid);
+      assertUnit(s.size() == model.size());
+      assertUnit(toVector(s) == std::vector<int>(model.begin(), model.end()));
+      assertUnit(verifyThreaded(s));
+   }  // teardown
+
+   // erasing through an iterator returns the next one
+   void test_eraseIterator_returnsNext()
+   {  // setup
+      custom::threaded_set<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      auto it = s.find(50);
+      // exercise
+      auto itNext = s.erase(it);
+      // verify
+      assertUnit(itNext != s.end());
+      if (itNext != s.end())
+         assertUnit(*itNext == 60);
+      auto itBegin = s.find(30);
+      auto itEnd = s.find(70);
+      itNext = s.erase(itBegin, itEnd);
+      assertUnit(itNext == s.find(70));
+      assertUnit(toVector(s) == std::vector<int>({ 20, 70, 80 }));
+      assertUnit(verifyThreaded(s));
+   }  // teardown
+
+   // clear frees every node
+   void test_clear_freesAll()
+   {  // setup
+      custom::threaded_set<Spy> s{ Spy(50), Spy(30), Spy(70), Spy(20) };
+      Spy::reset();
+      // exercise
+      s.clear();
+      // verify
+      assertUnit(Spy::numDestructor() == 4);
+      assertUnit(s.root == nullptr);
+      assertUnit(s.empty());
+   }  // teardown
+
+   /*************************************************************
+    * HEIGHT
+    * The number of nodes on the longest path down
+    *************************************************************/
+   template <typename TNode>
+   int height(const TNode* p)
+   {
+      if (!p)
+         return 0;
+      int left = height(p->left());
+      int right = height(p->right());
+      return 1 + (left > right ? left : right);
+   }
+
+   /*************************************************************
+    * VERIFY THREADED
+    * A red-black tree with every empty slot threaded to the
+    * in-order neighbor on that side, and null at the two ends
+    *************************************************************/
+   template <typename T>
+   bool verifyThreaded(const custom::threaded_set<T>& s)
+   {
+      std::vector<const typename custom::threaded_set<T>::TNode*> nodes;
+      if (verifyRedBlack(s.root, nodes) < 0 || nodes.size() != s.size())
+         return false;
+      for (size_t i = 0; i < nodes.size(); i++)
+      {
+         if (nodes[i]->leftThread && nodes[i]->pLeft != (i ? nodes[i - 1] : nullptr))
+            return false;
+         if (nodes[i]->rightThread && nodes[i]->pRight != (i + 1 < nodes.size() ? nodes[i + 1] : nullptr))
+            return false;
+      }
+      return true;
+   }
+
+   /*************************************************************
+    * VERIFY RED BLACK
+    * Return the black height of a subtree, or -1 if it breaks
+    * ordering or any of the red-black rules. Collects the nodes
+    * in order, following children only.
+    *************************************************************/
+   template <typename TNode>
+   int verifyRedBlack(const TNode* p, std::vector<const TNode*>& nodes)
+   {
+      if (!p)
+         return 1;
+      if (p->isRed && (TNode::isRedNode(p->left()) || TNode::isRedNode(p->right())))
+         return -1;
+      if (p->left() && !(p->left()->data < p->data))
+         return -1;
+      if (p->right() && !(p->data < p->right()->data))
+         return -1;
+      int left = verifyRedBlack(p->left(), nodes);
+      nodes.push_back(p);
+      int right = verifyRedBlack(p->right(), nodes);
+      if (left < 0 || left != right)
+         return -1;
+      return left + (p->isRed ? 0 : 1);
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,825 @@
+/***********************************************************************
+ * Header:
+ *    Threaded Set
+ * Summary:
+ *    A red-black tree whose empty child slots are not wasted. A node
+ *    with no left child points at its in-order predecessor instead,
+ *    and one with no right child at its successor. A flag beside the
+ *    color says which slots are threads. The flags fit in the padding
+ *    after the color, so nodes are no bigger than lean_set's.
+ *
+ *    With the threads, ++ on a node without a right child is a single
+ *    pointer load where BST's iterator climbs parent pointers through
+ *    cold nodes. No increment ever goes up the tree, so a full scan
+ *    follows each link once. Iterators are one pointer, and there are
+ *    no parent pointers to keep.
+ *
+ *    insert() and erase() record the path on the way down, as
+ *    lean_set's do, and rotations carry the threads along with them.
+ *
+ *    This will contain the class definition of:
+ *        threaded_set               : A set of threaded nodes
+ *        threaded_set::iterator     : An iterator through a threaded set
+ * Author
+ *    Nathan Bird, Brock Hoskins
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <iterator>   // for std::bidirectional_iterator_tag
+#include <utility>    // for std::pair
+#include <initializer_list>
+
+class TestThreadedSet;    // forward declaration for unit tests
+
+namespace custom
+{
+
+   /************************************************
+    * THREADED SET
+    * A red-black tree set whose leaves point at
+    * their in-order neighbors
+    ***********************************************/
+   template <typename T>
+   class threaded_set
+   {
+      friend class ::TestThreadedSet; // give unit tests access to the privates
+   public:
+      // a red-black tree of 2^48 nodes is at most 96 deep
+      static const int MAX_DEPTH = 96;
+
+      //
+      // Construct
+      //
+      threaded_set() : root(nullptr), numElements(0)
+      {}
+      threaded_set(const threaded_set& rhs) : root(TNode::copy(rhs.root)), numElements(rhs.numElements)
+      {}
+      threaded_set(threaded_set&& rhs) : root(rhs.root), numElements(rhs.numElements)
+      {
+         rhs.root = nullptr;
+         rhs.numElements = 0;
+      }
+      threaded_set(const std::initializer_list<T>& il) : threaded_set()
+      {
+         insert(il);
+      }
+      template <class Iterator>
+      threaded_set(Iterator first, Iterator last) : threaded_set()
+      {
+         insert(first, last);
+      }
+      ~threaded_set()
+      {
+         clear();
+      }
+
+      //
+      // Assign
+      //
+      threaded_set& operator =(const threaded_set& rhs)
+      {
+         clear();
+         root = TNode::copy(rhs.root);
+         numElements = rhs.numElements;
+         return *this;
+      }
+      threaded_set& operator =(threaded_set&& rhs)
+      {
+         clear();
+         swap(rhs);
+         return *this;
+      }
+      threaded_set& operator =(const std::initializer_list<T>& il)
+      {
+         clear();
+         insert(il);
+         return *this;
+      }
+      void swap(threaded_set& rhs) noexcept
+      {
+         std::swap(root, rhs.root);
+         std::swap(numElements, rhs.numElements);
+      }
+
+      //
+      // Iterator
+      //
+      class iterator;
+      iterator begin() const noexcept;
+      iterator end()   const noexcept { return iterator(nullptr, this); }
+
+      //
+      // Access
+      //
+      iterator find(const T& t) const;
+      iterator lower_bound(const T& t) const;
+
+      //
+      // Status
+      //
+      bool   empty() const noexcept { return numElements == 0; }
+      size_t size()  const noexcept { return numElements; }
+
+      // heap bytes each element costs: one node, threads and all
+      static size_t bytes_per_element() noexcept { return sizeof(TNode); }
+
+      //
+      // Insert
+      //
+      std::pair<iterator, bool> insert(const T& t)
+      {
+         return insertNode(t);
+      }
+      std::pair<iterator, bool> insert(T&& t)
+      {
+         return insertNode(std::move(t));
+      }
+      void insert(const std::initializer_list<T>& il)
+      {
+         for (const T& t : il)
+            insert(t);
+      }
+      template <class Iterator>
+      void insert(Iterator first, Iterator last)
+      {
+         while (first != last)
+         {
+            insert(*first);
+            ++first;
+         }
+      }
+
+      //
+      // Remove
+      //
+      size_t   erase(const T& t);
+      iterator erase(iterator& it);
+      iterator erase(iterator& itBegin, iterator& itEnd);
+      void     clear() noexcept
+      {
+         TNode::clear(root);
+         root = nullptr;
+         numElements = 0;
+      }
+
+   private:
+
+      class TNode;
+      template <class U>
+      std::pair<iterator, bool> insertNode(U&& t);
+      int  findPath(const T& t, TNode** path) const;
+      void unlink(TNode** path, int depth);
+      void hook(TNode** path, int i, TNode* pNode);
+
+      TNode* root;              // root node of the red-black tree
+      size_t numElements;       // number of elements in the tree
+   };
+
+
+   /*****************************************************************
+    * THREADED NODE
+    * A node of a red-black tree. An empty child slot holds a thread
+    * to the in-order neighbor on that side, or null at either end.
+    *****************************************************************/
+   template <typename T>
+   class threaded_set<T>::TNode
+   {
+   public:
+      //
+      // Construct
+      //
+      TNode(const T& t) : data(t), pLeft(nullptr), pRight(nullptr),
+         isRed(true), leftThread(true), rightThread(true)
+      {}
+      TNode(T&& t) : data(std::move(t)), pLeft(nullptr), pRight(nullptr),
+         isRed(true), leftThread(true), rightThread(true)
+      {}
+
+      //
+      // Children, or null where there is a thread
+      //
+      TNode* left()  const { return leftThread ? nullptr : pLeft; }
+      TNode* right() const { return rightThread ? nullptr : pRight; }
+
+      // the neighbors, by thread or by descent
+      TNode* next() const;
+      TNode* prev() const;
+
+      //
+      // Whole trees
+      //
+      static TNode* copy(const TNode* pSrc, TNode* pPrev = nullptr, TNode* pNext = nullptr);
+      static void   clear(TNode* pNode) noexcept;
+
+      //
+      // Rotate: lift a child into this node's place and return it.
+      // The caller hangs it wherever this node hung. The child's
+      // inner slot moves across to this node; if it was a thread,
+      // it pointed back here, and now must point at the child.
+      //
+      TNode* rotateLeft()
+      {
+         TNode* pTop = pRight;
+         assert(!rightThread);
+         if (pTop->leftThread)
+         {
+            pRight = pTop;
+            rightThread = true;
+         }
+         else
+            pRight = pTop->pLeft;
+         pTop->pLeft = this;
+         pTop->leftThread = false;
+         return pTop;
+      }
+      TNode* rotateRight()
+      {
+         TNode* pTop = pLeft;
+         assert(!leftThread);
+         if (pTop->rightThread)
+         {
+            pLeft = pTop;
+            leftThread = true;
+         }
+         else
+            pLeft = pTop->pRight;
+         pTop->pRight = this;
+         pTop->rightThread = false;
+         return pTop;
+      }
+
+      static bool isRedNode(const TNode* p) { return p && p->isRed; }
+
+      //
+      // Data
+      //
+      T data;                  // Actual data stored in the node
+      TNode* pLeft;            // Left child, or the predecessor
+      TNode* pRight;           // Right child, or the successor
+      bool isRed;              // Red-black balancing stuff
+      bool leftThread;         // pLeft is the predecessor, not a child
+      bool rightThread;        // pRight is the successor, not a child
+   };
+
+   /**********************************************************
+    * THREADED SET ITERATOR
+    * Forward and reverse iterator through a threaded set
+    *********************************************************/
+   template <typename T>
+   class threaded_set<T>::iterator
+   {
+      friend class ::TestThreadedSet; // give unit tests access to the privates
+      friend class custom::threaded_set<T>;
+   public:
+      // so std::reverse_iterator and the algorithms can use it
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const T*;
+      using reference         = const T&;
+
+      // constructors and assignment
+      iterator() : pNode(nullptr), pTree(nullptr)
+      {}
+      iterator(TNode* pNode, const threaded_set* pTree) : pNode(pNode), pTree(pTree)
+      {}
+
+      // compare
+      bool operator ==(const iterator& rhs) const
+      {
+         return pNode == rhs.pNode;
+      }
+      bool operator !=(const iterator& rhs) const
+      {
+         return pNode != rhs.pNode;
+      }
+
+      // de-reference. Cannot change because it will invalidate the tree
+      const T& operator *() const
+      {
+         return pNode->data;
+      }
+
+      // increment and decrement
+      iterator& operator ++()
+      {
+         if (pNode)
+            pNode = pNode->next();
+         return *this;
+      }
+      iterator  operator ++(int postfix)
+      {
+         iterator temp(*this);
+         ++(*this);
+         return temp;
+      }
+      iterator& operator --();
+      iterator  operator --(int postfix)
+      {
+         iterator temp(*this);
+         --(*this);
+         return temp;
+      }
+
+   private:
+      TNode* pNode;                   // the node we are at, null for end()
+      const threaded_set* pTree;      // the set we walk, for --end()
+   };
+
+
+   /*********************************************
+    *********************************************
+    *************** THREADED SET ****************
+    *********************************************
+    *********************************************/
+
+   /*********************************************
+    * THREADED SET :: BEGIN
+    * The leftmost node
+    ********************************************/
+   template <typename T>
+   typename threaded_set<T>::iterator threaded_set<T>::begin() const noexcept
+   {
+      TNode* p = root;
+      if (p)
+         while (p->left())
+            p = p->pLeft;
+      return iterator(p, this);
+   }
+
+   /*********************************************
+    * THREADED SET :: FIND
+    * Return the element corresponding to a given value
+    ********************************************/
+   template <typename T>
+   typename threaded_set<T>::iterator threaded_set<T>::find(const T& t) const
+   {
+      TNode* p = root;
+      while (p && !(t == p->data))
+         p = (t < p->data) ? p->left() : p->right();
+      return iterator(p, this);
+   }
+
+   /*********************************************
+    * THREADED SET :: LOWER BOUND
+    * The first element not less than t
+    ********************************************/
+   template <typename T>
+   typename threaded_set<T>::iterator threaded_set<T>::lower_bound(const T& t) const
+   {
+      TNode* pFound = nullptr;
+      for (TNode* p = root; p; )
+      {
+         if (p->data < t)
+            p = p->right();
+         else
+         {
+            pFound = p;
+            p = p->left();
+         }
+      }
+      return iterator(pFound, this);
+   }
+
+   /*********************************************
+    * THREADED SET :: FIND PATH
+    * Record the path down to t. Return its length,
+    * or 0 if t is not there.
+    ********************************************/
+   template <typename T>
+   int threaded_set<T>::findPath(const T& t, TNode** path) const
+   {
+      int depth = 0;
+      for (TNode* p = root; p; p = (t < p->data) ? p->left() : p->right())
+      {
+         assert(depth < MAX_DEPTH);
+         path[depth++] = p;
+         if (t == p->data)
+            return depth;
+      }
+      return 0;
+   }
+
+   /*********************************************
+    * THREADED SET :: INSERT NODE
+    * Record the path down to the new leaf, thread it
+    * between its neighbors, then recolor and rotate
+    * back up along the path
+    ********************************************/
+   template <typename T>
+   template <class U>
+   std::pair<typename threaded_set<T>::iterator, bool> threaded_set<T>::insertNode(U&& t)
+   {
+      TNode* path[MAX_DEPTH];
+      int depth = 0;
+      for (TNode* p = root; p; p = (t < p->data) ? p->left() : p->right())
+      {
+         if (t == p->data)
+            return { iterator(p, this), false };
+         assert(depth + 1 < MAX_DEPTH);
+         path[depth++] = p;
+      }
+
+      // a new leaf takes over its parent's thread on one side and
+      // threads back to its parent on the other
+      TNode* pNew = new TNode(std::forward<U>(t));
+      if (!depth)
+         root = pNew;
+      else
+      {
+         TNode* pParent = path[depth - 1];
+         if (pNew->data < pParent->data)
+         {
+            pNew->pLeft = pParent->pLeft;
+            pNew->pRight = pParent;
+            pParent->pLeft = pNew;
+            pParent->leftThread = false;
+         }
+         else
+         {
+            pNew->pRight = pParent->pRight;
+            pNew->pLeft = pParent;
+            pParent->pRight = pNew;
+            pParent->rightThread = false;
+         }
+      }
+      path[depth] = pNew;
+      numElements++;
+
+      // path[i] is red; so, maybe, is its parent
+      for (int i = depth; i >= 2 && path[i - 1]->isRed; )
+      {
+         TNode* pParent = path[i - 1];
+         TNode* pGrandparent = path[i - 2];
+         bool parentLeft = (pGrandparent->left() == pParent);
+         TNode* pAunt = parentLeft ? pGrandparent->right() : pGrandparent->left();
+
+         // a red aunt: push the red up two levels and carry on
+         if (TNode::isRedNode(pAunt))
+         {
+            pParent->isRed = false;
+            pAunt->isRed = false;
+            pGrandparent->isRed = true;
+            i -= 2;
+            continue;
+         }
+
+         // a black aunt: at most two rotations and we are done
+         if (parentLeft && pParent->right() == path[i])
+         {
+            pGrandparent->pLeft = pParent->rotateLeft();
+            pParent = path[i];
+         }
+         else if (!parentLeft && pParent->left() == path[i])
+         {
+            pGrandparent->pRight = pParent->rotateRight();
+            pParent = path[i];
+         }
+         pParent->isRed = false;
+         pGrandparent->isRed = true;
+         hook(path, i - 2, parentLeft ? pGrandparent->rotateRight() : pGrandparent->rotateLeft());
+         break;
+      }
+      root->isRed = false;
+
+      // nodes never move between places in the order, so pNew is still good
+      return { iterator(pNew, this), true };
+   }
+
+   /*********************************************
+    * THREADED SET :: ERASE
+    * Remove the element with a given value, if there
+    ********************************************/
+   template <typename T>
+   size_t threaded_set<T>::erase(const T& t)
+   {
+      TNode* path[MAX_DEPTH + 1];
+      int depth = findPath(t, path);
+      if (!depth)
+         return 0;
+      unlink(path, depth);
+      return 1;
+   }
+
+   /*********************************************
+    * THREADED SET :: ERASE ITERATOR
+    * Remove the element an iterator refers to and return
+    * an iterator to the element after it. Unlinking needs
+    * the path, which the iterator does not have, so this
+    * costs one descent.
+    ********************************************/
+   template <typename T>
+   typename threaded_set<T>::iterator threaded_set<T>::erase(iterator& it)
+   {
+      if (it == end())
+         return end();
+
+      // the successor keeps its node, wherever rebalancing moves it
+      iterator itNext(it.pNode->next(), this);
+      TNode* path[MAX_DEPTH + 1];
+      int depth = findPath(it.pNode->data, path);
+      assert(depth && path[depth - 1] == it.pNode);
+      unlink(path, depth);
+      it.pNode = nullptr;
+      return itNext;
+   }
+
+   /*********************************************
+    * THREADED SET :: ERASE RANGE
+    * Remove [itBegin, itEnd)
+    ********************************************/
+   template <typename T>
+   typename threaded_set<T>::iterator threaded_set<T>::erase(iterator& itBegin, iterator& itEnd)
+   {
+      while (itBegin != itEnd)
+         itBegin = erase(itBegin);
+      return itBegin;
+   }
+
+   /*********************************************
+    * THREADED SET :: HOOK
+    * Hang pNode where path[i] hangs. path[i] is a real
+    * child, never a thread, so the flags stay as they are.
+    ********************************************/
+   template <typename T>
+   void threaded_set<T>::hook(TNode** path, int i, TNode* pNode)
+   {
+      if (i == 0)
+         root = pNode;
+      else if (path[i - 1]->left() == path[i])
+         path[i - 1]->pLeft = pNode;
+      else
+         path[i - 1]->pRight = pNode;
+   }
+
+   /*********************************************
+    * THREADED SET :: UNLINK
+    * Take path[depth - 1] out of the tree and free it,
+    * rethreading its neighbors. A node with two children
+    * trades places with its in-order successor first, so
+    * no value ever moves. If a black node left the tree,
+    * rebalance as lean_set does. The path is used as
+    * scratch space and needs one spare slot.
+    ********************************************/
+   template <typename T>
+   void threaded_set<T>::unlink(TNode** path, int depth)
+   {
+      int iDelete = depth - 1;
+      TNode* pDelete = path[iDelete];
+      TNode* pParent = iDelete ? path[iDelete - 1] : nullptr;
+      TNode* pX;                  // what moves into the hole, null for none
+      int iX;                     // where the hole is on the path
+      bool left;                  // which side of its parent the hole is
+      bool removedBlack;
+
+      if (!pDelete->left() && !pDelete->right())
+      {
+         // a leaf: the parent's slot becomes a thread to the leaf's
+         // neighbor on the same side
+         pX = nullptr;
+         removedBlack = !pDelete->isRed;
+         left = pParent && pParent->left() == pDelete;
+         if (!pParent)
+            root = nullptr;
+         else if (left)
+         {
+            pParent->pLeft = pDelete->pLeft;
+            pParent->leftThread = true;
+         }
+         else
+         {
+            pParent->pRight = pDelete->pRight;
+            pParent->rightThread = true;
+         }
+         iX = iDelete;
+      }
+      else if (!pDelete->left() || !pDelete->right())
+      {
+         // one child: whichever node threaded to pDelete threads past it
+         pX = pDelete->left() ? pDelete->pLeft : pDelete->pRight;
+         if (pDelete->left())
+            pDelete->prev()->pRight = pDelete->pRight;
+         else
+            pDelete->next()->pLeft = pDelete->pLeft;
+         removedBlack = !pDelete->isRed;
+         left = pParent && pParent->left() == pDelete;
+         hook(path, iDelete, pX);
+         iX = iDelete;
+      }
+      else
+      {
+         // the successor: right once, then left all the way down
+         int iNext = iDelete + 1;
+         path[iNext] = pDelete->pRight;
+         while (path[iNext]->left())
+         {
+            assert(iNext + 2 < MAX_DEPTH);   // room for one rotation below
+            path[iNext + 1] = path[iNext]->pLeft;
+            iNext++;
+         }
+         TNode* pNext = path[iNext];
+         removedBlack = !pNext->isRed;
+         pX = pNext->right();
+
+         // the predecessor threaded to pDelete; now it is pNext
+         pDelete->prev()->pRight = pNext;
+
+         // lift the successor's right child, or a thread, into its place
+         if (iNext == iDelete + 1)
+            left = false;          // pNext keeps its right side as it is
+         else
+         {
+            left = true;
+            TNode* pNextParent = path[iNext - 1];
+            if (pX)
+               pNextParent->pLeft = pX;
+            else
+            {
+               pNextParent->pLeft = pNext;
+               pNextParent->leftThread = true;
+            }
+            pNext->pRight = pDelete->pRight;
+            pNext->rightThread = false;
+         }
+
+         // and the successor into the deleted node's place
+         hook(path, iDelete, pNext);
+         pNext->pLeft = pDelete->pLeft;
+         pNext->leftThread = false;
+         pNext->isRed = pDelete->isRed;
+         path[iDelete] = pNext;
+         iX = iNext;
+      }
+
+      delete pDelete;
+      numElements--;
+
+      // pX, at path[iX] on the left or right of path[iX - 1], is one black short
+      path[iX] = pX;
+      while (removedBlack && iX > 0 && !TNode::isRedNode(pX))
+      {
+         TNode* pUp = path[iX - 1];
+         TNode* pSibling = left ? pUp->right() : pUp->left();
+         if (TNode::isRedNode(pSibling))
+         {
+            // a red sibling: rotate it up so the sibling is black
+            pSibling->isRed = false;
+            pUp->isRed = true;
+            hook(path, iX - 1, left ? pUp->rotateLeft() : pUp->rotateRight());
+            path[iX - 1] = pSibling;
+            path[iX] = pUp;
+            path[++iX] = pX;
+            pSibling = left ? pUp->right() : pUp->left();
+         }
+         if (!pSibling)
+         {
+            // only in a tree that was not a true red-black tree
+            pX = pUp;
+            iX--;
+            left = iX > 0 && path[iX - 1]->left() == pX;
+            continue;
+         }
+
+         TNode* pNear = left ? pSibling->left() : pSibling->right();
+         TNode* pFar = left ? pSibling->right() : pSibling->left();
+         if (!TNode::isRedNode(pNear) && !TNode::isRedNode(pFar))
+         {
+            // a black sibling with black children: make it red and go up
+            pSibling->isRed = true;
+            pX = pUp;
+            iX--;
+            left = iX > 0 && path[iX - 1]->left() == pX;
+            continue;
+         }
+
+         if (!TNode::isRedNode(pFar))
+         {
+            // the red nephew is on the near side: move it to the far side
+            pNear->isRed = false;
+            pSibling->isRed = true;
+            if (left)
+               pUp->pRight = pSibling->rotateRight();
+            else
+               pUp->pLeft = pSibling->rotateLeft();
+            pSibling = pNear;
+            pFar = left ? pSibling->right() : pSibling->left();
+         }
+
+         // a red nephew on the far side: one rotation and we are done
+         pSibling->isRed = pUp->isRed;
+         pUp->isRed = false;
+         pFar->isRed = false;
+         hook(path, iX - 1, left ? pUp->rotateLeft() : pUp->rotateRight());
+         pX = root;
+         break;
+      }
+      if (pX)
+         pX->isRed = false;
+      if (root)
+         root->isRed = false;
+   }
+
+
+   /*********************************************
+    *********************************************
+    *************** THREADED NODE ***************
+    *********************************************
+    *********************************************/
+
+   /******************************************************
+    * THREADED NODE :: NEXT
+    * The in-order successor: the thread, or the leftmost
+    * node of the right subtree. Never a climb.
+    ******************************************************/
+   template <typename T>
+   typename threaded_set<T>::TNode* threaded_set<T>::TNode::next() const
+   {
+      if (rightThread)
+         return pRight;
+      TNode* p = pRight;
+      while (!p->leftThread)
+         p = p->pLeft;
+      return p;
+   }
+
+   /******************************************************
+    * THREADED NODE :: PREV
+    * The in-order predecessor
+    ******************************************************/
+   template <typename T>
+   typename threaded_set<T>::TNode* threaded_set<T>::TNode::prev() const
+   {
+      if (leftThread)
+         return pLeft;
+      TNode* p = pLeft;
+      while (!p->rightThread)
+         p = p->pRight;
+      return p;
+   }
+
+   /******************************************************
+    * THREADED NODE :: COPY
+    * Copy a whole tree, colors and all. pPrev and pNext are
+    * the copies of the neighbors just outside this subtree,
+    * for the threads at its two ends.
+    ******************************************************/
+   template <typename T>
+   typename threaded_set<T>::TNode* threaded_set<T>::TNode::copy(const TNode* pSrc,
+                                                                  TNode* pPrev, TNode* pNext)
+   {
+      if (!pSrc)
+         return nullptr;
+      TNode* pNode = new TNode(pSrc->data);
+      pNode->isRed = pSrc->isRed;
+      pNode->leftThread = pSrc->leftThread;
+      pNode->rightThread = pSrc->rightThread;
+      pNode->pLeft = pSrc->left() ? copy(pSrc->pLeft, pPrev, pNode) : pPrev;
+      pNode->pRight = pSrc->right() ? copy(pSrc->pRight, pNode, pNext) : pNext;
+      return pNode;
+   }
+
+   /******************************************************
+    * THREADED NODE :: CLEAR
+    * Free a whole tree
+    ******************************************************/
+   template <typename T>
+   void threaded_set<T>::TNode::clear(TNode* pNode) noexcept
+   {
+      if (!pNode)
+         return;
+      clear(pNode->left());
+      clear(pNode->right());
+      delete pNode;
+   }
+
+
+   /*************************************************
+    *************************************************
+    *************************************************
+    ****************** ITERATOR *********************
+    *************************************************
+    *************************************************
+    *************************************************/
+
+   /**************************************************
+    * THREADED SET ITERATOR :: DECREMENT PREFIX
+    * back up by one. Decrementing end() lands on the last element
+    *************************************************/
+   template <typename T>
+   typename threaded_set<T>::iterator& threaded_set<T>::iterator::operator --()
+   {
+      if (pNode)
+         pNode = pNode->prev();
+      else if (pTree && pTree->root)
+      {
+         pNode = pTree->root;
+         while (pNode->right())
+            pNode = pNode->pRight;
+      }
+      return *this;
+   }
+
+} // namespace custom
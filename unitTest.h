@@ -31,6 +31,7 @@
 #include <vector>    // for std::vector
 #include <map>       // for std::map
 #include <sstream>   // for std::stringstream
+#include <type_traits> // for std::decay
 
 
 class UnitTest
@@ -77,6 +78,33 @@ private:
    }
 
 protected:
+   /*************************************************************
+    * RANGE
+    * A container of first ... last-1, through its range constructor
+    *************************************************************/
+   template <class Container>
+   static Container range(int first, int last)
+   {
+      std::vector<int> v;
+      for (int i = first; i < last; i++)
+         v.push_back(i);
+      return Container(v.begin(), v.end());
+   }
+
+   /*************************************************************
+    * TO VECTOR
+    * The values of a container in iteration order
+    *************************************************************/
+   template <class Container>
+   static std::vector<typename std::decay<decltype(*std::declval<const Container&>().begin())>::type>
+      toVector(const Container& c)
+   {
+      std::vector<typename std::decay<decltype(*c.begin())>::type> v;
+      for (auto it = c.begin(); it != c.end(); ++it)
+         v.push_back(*it);
+      return v;
+   }
+
    /*************************************************************
     * RESET
     * Reset the statistics